@@ -27,13 +27,22 @@
 #include <apt-pkg/progress.h>
 #include <apt-pkg/error.h>
 #include <apt-pkg/version.h>
+#include <apt-pkg/configuration.h>
+
+#include <sys/stat.h>
 
 #include "apt-utils.h"
 #include "apt-messages.h"
+#include "apt-search-index.h"
+#include "apt-dep-index.h"
+#include "apt-gst-index.h"
 
 AptCacheFile::AptCacheFile(PkBackendJob *job, bool const withLock) :
     pkgCacheFile(withLock),
     m_packageRecords(0),
+    m_searchIndex(0),
+    m_depIndex(0),
+    m_gstIndex(0),
     m_job(job)
 {
 }
@@ -41,8 +50,14 @@ AptCacheFile::AptCacheFile(PkBackendJob *job, bool const withLock) :
 AptCacheFile::~AptCacheFile()
 {
     delete m_packageRecords;
+    delete m_searchIndex;
+    delete m_depIndex;
+    delete m_gstIndex;
 
     m_packageRecords = 0;
+    m_searchIndex = 0;
+    m_depIndex = 0;
+    m_gstIndex = 0;
 
     // Discard all errors to avoid a future failure when opening
     // the package cache
@@ -51,6 +66,9 @@ AptCacheFile::~AptCacheFile()
 
 bool AptCacheFile::Open()
 {
+    // Take the stamp first so changes made while opening are not missed
+    m_stamp = stampFiles();
+
     OpPackageKitProgress progress(m_job);
     return pkgCacheFile::Open(progress);
 }
@@ -61,6 +79,42 @@ bool AptCacheFile::BuildCaches()
     return pkgCacheFile::BuildCaches(progress);
 }
 
+void AptCacheFile::setJob(PkBackendJob *job)
+{
+    m_job = job;
+}
+
+bool AptCacheFile::isOutdated() const
+{
+    return m_stamp != stampFiles();
+}
+
+std::vector<std::string> AptCacheFile::stampFileNames()
+{
+    return {
+        _config->FindFile("Dir::Cache::pkgcache"),
+        _config->FindFile("Dir::Cache::srcpkgcache"),
+        _config->FindFile("Dir::Etc::sourcelist"),
+        _config->FindDir("Dir::Etc::sourceparts"),
+        _config->FindDir("Dir::State::lists"),
+        RPM_PACKAGES_DB,
+    };
+}
+
+std::vector<gint64> AptCacheFile::stampFiles()
+{
+    std::vector<gint64> stamp;
+    for (const std::string &file : stampFileNames()) {
+        struct stat buf;
+        if (file.empty() || stat(file.c_str(), &buf) != 0) {
+            stamp.push_back(0);
+            continue;
+        }
+        stamp.push_back(buf.st_mtim.tv_sec * G_USEC_PER_SEC + buf.st_mtim.tv_nsec / 1000);
+    }
+    return stamp;
+}
+
 pkgCache* AptCacheFile::GetPkgCache()
 {
     OpPackageKitProgress progress(m_job);
@@ -271,6 +325,120 @@ void AptCacheFile::buildPkgRecords()
     m_packageRecords = new pkgRecords(*this);
 }
 
+AptSearchIndex* AptCacheFile::getSearchIndex(bool rebuild)
+{
+    if (m_searchIndex == nullptr) {
+        m_searchIndex = new AptSearchIndex;
+        m_searchIndex->open(this);
+    }
+
+    if (!m_searchIndex->isOpen() && rebuild) {
+        m_searchIndex->open(this, true);
+    }
+
+    return m_searchIndex->isOpen() ? m_searchIndex : nullptr;
+}
+
+AptDepIndex* AptCacheFile::getDepIndex()
+{
+    if (m_depIndex == nullptr) {
+        m_depIndex = new AptDepIndex(this);
+    }
+    return m_depIndex;
+}
+
+AptGstIndex* AptCacheFile::getGstIndex()
+{
+    if (m_gstIndex == nullptr) {
+        m_gstIndex = new AptGstIndex(this);
+    }
+    return m_gstIndex;
+}
+
+AptCacheFile::VersionAttributes AptCacheFile::versionAttributes(const pkgCache::VerIterator &ver)
+{
+    if (m_versionAttributes.empty()) {
+        buildVersionAttributes();
+    }
+
+    if (ver->ID >= m_versionAttributes.size()) {
+        VersionAttributes none = { 0, PK_GROUP_ENUM_UNKNOWN };
+        return none;
+    }
+    return m_versionAttributes[ver->ID];
+}
+
+void AptCacheFile::buildVersionAttributes()
+{
+    pkgCache *cache = GetPkgCache();
+    VersionAttributes none = { 0, PK_GROUP_ENUM_UNKNOWN };
+    m_versionAttributes.assign(cache->HeaderP->VersionCount, none);
+
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
+        std::string pkgName = pkg.Name();
+        bool develName = ends_with(pkgName, "-dev") || ends_with(pkgName, "-dbg");
+
+        for (pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver) {
+            if (ver->ID >= m_versionAttributes.size()) {
+                continue;
+            }
+
+            std::string str = ver.Section() == NULL ? "" : ver.Section();
+            std::string section, component;
+
+            size_t found;
+            found = str.find_last_of("/");
+            section = str.substr(found + 1);
+            if (found == str.npos) {
+                component = "main";
+            } else {
+                component = str.substr(0, found);
+            }
+
+            VersionAttributes &attributes = m_versionAttributes[ver->ID];
+            if (develName ||
+                    !section.compare("devel") ||
+                    !section.compare("libdevel")) {
+                attributes.flags |= VersionDevel;
+            }
+            if (!section.compare("x11") || !section.compare("gnome") ||
+                    !section.compare("kde") || !section.compare("graphics")) {
+                attributes.flags |= VersionGui;
+            }
+            // Must be in main and universe to be free
+            if (!component.compare("main") || !component.compare("universe")) {
+                attributes.flags |= VersionFree;
+            }
+            attributes.group = get_enum_group(str);
+        }
+    }
+}
+
+const std::string& AptCacheFile::packageOriginId(const pkgCache::VerFileIterator &vf)
+{
+    // No origin id is empty, so an empty string marks one not computed yet
+    if (m_originIds.empty()) {
+        m_originIds.resize(GetPkgCache()->HeaderP->PackageFileCount);
+    }
+
+    const pkgCache::PkgFileIterator &file = vf.File();
+    if (file->ID >= m_originIds.size()) {
+        m_originIds.resize(file->ID + 1);
+    }
+
+    std::string &originId = m_originIds[file->ID];
+    if (originId.empty()) {
+        originId = utilBuildPackageOriginId(vf);
+    }
+    return originId;
+}
+
+const char* AptCacheFile::buildPackageId(const pkgCache::VerIterator &ver)
+{
+    utilBuildPackageId(m_packageId, ver, packageOriginId(ver.FileList()));
+    return m_packageId.c_str();
+}
+
 bool AptCacheFile::doAutomaticRemove()
 {
     pkgAutoremove(*getDCache());
@@ -28,10 +28,32 @@
 #include <pk-backend.h>
 #include <apt-pkg/pkgrecords.h>
 
+#include <vector>
+
+#define RPM_PACKAGES_DB      "/var/lib/rpm/Packages"
+
 class pkgProblemResolver;
+class AptSearchIndex;
+class AptDepIndex;
+class AptGstIndex;
 class AptCacheFile : public pkgCacheFile
 {
 public:
+    /**
+     * Filter related properties of a version, see versionAttributes()
+     */
+    enum VersionFlag {
+        VersionDevel     = 1 << 0,
+        VersionGui       = 1 << 1,
+        VersionFree      = 1 << 2,
+        VersionInstalled = 1 << 3,
+    };
+
+    struct VersionAttributes {
+        guint8 flags;
+        guint8 group;
+    };
+
     AptCacheFile(PkBackendJob *job, bool withLock);
     ~AptCacheFile();
 
@@ -45,6 +67,24 @@ public:
       */
     bool BuildCaches();
 
+    /**
+      * Binds the cache to another job, progress and errors are
+      * reported to it from now on
+      */
+    void setJob(PkBackendJob *job);
+
+    /**
+      * Checks if the package lists, the sources or the rpm database
+      * changed on disk since this cache was opened
+      */
+    bool isOutdated() const;
+
+    /**
+      * The files isOutdated() looks at, they are written by apt-get
+      * and rpm as well
+      */
+    static std::vector<std::string> stampFileNames();
+
     /**
       * This routine generates the caches and then opens the dependency cache
       * and verifies that the system is OK.
@@ -69,6 +109,44 @@ public:
 
     inline pkgRecords* GetPkgRecords() { buildPkgRecords(); return m_packageRecords; }
 
+    /**
+      * Returns the name and description search index built from this cache
+      * @param rebuild build it if it is missing or outdated, which takes
+      * about as long as a full description search
+      * @returns nullptr if there is no usable index
+      */
+    AptSearchIndex* getSearchIndex(bool rebuild = false);
+
+    /**
+      * Returns the dependency graph of this cache, building it on first use
+      */
+    AptDepIndex* getDepIndex();
+
+    /**
+      * Returns the GStreamer capabilities of the packages, loading the
+      * index saved when the cache was built on first use
+      */
+    AptGstIndex* getGstIndex();
+
+    /**
+      * Returns the section derived attributes of a version, the
+      * table holding them is filled for all versions on first use.
+      * VersionInstalled is not part of it as it changes with the depCache.
+      */
+    VersionAttributes versionAttributes(const pkgCache::VerIterator &ver);
+
+    /**
+      * Returns the origin id of the given package file, it is computed
+      * once per package file of this cache
+      */
+    const std::string& packageOriginId(const pkgCache::VerFileIterator &vf);
+
+    /**
+      * Builds the package id of the given version in a buffer owned by
+      * this object, the returned string is only valid until the next call
+      */
+    const char* buildPackageId(const pkgCache::VerIterator &ver);
+
     /**
       * GetPolicy will build the policy object if needed and return it
       * @note This override if because the cache should be built before the policy
@@ -138,9 +216,18 @@ public:
 private:
     void buildPkgRecords();
     static std::string debParser(std::string descr);
+    static std::vector<gint64> stampFiles();
+    void buildVersionAttributes();
 
     pkgRecords *m_packageRecords;
+    AptSearchIndex *m_searchIndex;
+    AptDepIndex *m_depIndex;
+    AptGstIndex *m_gstIndex;
     PkBackendJob *m_job;
+    std::vector<gint64> m_stamp;
+    std::vector<VersionAttributes> m_versionAttributes;
+    std::vector<std::string> m_originIds;
+    std::string m_packageId;
 };
 
 /**
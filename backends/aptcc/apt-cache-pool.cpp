@@ -0,0 +1,183 @@
+/* apt-cache-pool.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-cache-pool.h"
+
+#include <apt-pkg/error.h>
+
+#include "apt-cache-file.h"
+
+// How many idle caches are kept around for concurrent readers
+#define APT_CACHE_POOL_SIZE 4
+
+AptCachePool::AptCachePool() :
+    m_readers(0),
+    m_writersWaiting(0),
+    m_writer(false)
+{
+    g_mutex_init(&m_mutex);
+    g_mutex_init(&m_lockMutex);
+    g_cond_init(&m_lockCond);
+}
+
+AptCachePool::~AptCachePool()
+{
+    for (const Slot &slot : m_slots) {
+        delete slot.cache;
+    }
+    g_cond_clear(&m_lockCond);
+    g_mutex_clear(&m_lockMutex);
+    g_mutex_clear(&m_mutex);
+}
+
+void AptCachePool::lock(PkBackendJob *job, bool shared)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_lockMutex);
+
+    if (shared) {
+        // Queue behind waiting writers too, or a steady stream of
+        // searches would keep an install from ever starting
+        if (m_writer || m_writersWaiting > 0) {
+            pk_backend_job_set_status(job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+            while (m_writer || m_writersWaiting > 0) {
+                g_cond_wait(&m_lockCond, &m_lockMutex);
+            }
+            pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
+        }
+        m_readers++;
+    } else {
+        m_writersWaiting++;
+        if (m_writer || m_readers > 0) {
+            pk_backend_job_set_status(job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+            while (m_writer || m_readers > 0) {
+                g_cond_wait(&m_lockCond, &m_lockMutex);
+            }
+        }
+        m_writersWaiting--;
+        m_writer = true;
+    }
+}
+
+void AptCachePool::unlock(bool shared)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_lockMutex);
+
+    if (shared) {
+        m_readers--;
+    } else {
+        m_writer = false;
+    }
+    g_cond_broadcast(&m_lockCond);
+}
+
+std::vector<AptCachePool::Slot>::iterator AptCachePool::dropSlot(std::vector<Slot>::iterator slot)
+{
+    delete slot->cache;
+    return m_slots.erase(slot);
+}
+
+AptCacheFile* AptCachePool::acquire(PkBackendJob *job)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    for (auto slot = m_slots.begin(); slot != m_slots.end();) {
+        if (slot->inUse) {
+            ++slot;
+            continue;
+        }
+
+        if (!slot->valid || slot->cache->isOutdated()) {
+            g_debug("dropping pooled cache as it is outdated");
+            slot = dropSlot(slot);
+            continue;
+        }
+
+        slot->cache->setJob(job);
+
+        if (slot->needsReset) {
+            // Forget the marks the previous job left behind, this
+            // also restores the policy candidates
+            pkgDepCache *depCache = slot->cache->GetDepCache();
+            if (!depCache->Init(nullptr) ||
+                    depCache->BrokenCount() != 0 ||
+                    depCache->DelCount() != 0 ||
+                    depCache->InstCount() != 0) {
+                g_debug("dropping pooled cache as it could not be reset");
+                _error->Discard();
+                slot = dropSlot(slot);
+                continue;
+            }
+            slot->needsReset = false;
+        }
+
+        g_debug("reusing pooled cache");
+        slot->inUse = true;
+        return slot->cache;
+    }
+
+    return nullptr;
+}
+
+void AptCachePool::release(AptCacheFile *cache, bool modified)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    // Don't leave a dangling job behind
+    cache->setJob(nullptr);
+
+    for (auto slot = m_slots.begin(); slot != m_slots.end(); ++slot) {
+        if (slot->cache != cache) {
+            continue;
+        }
+
+        slot->inUse = false;
+        slot->needsReset = slot->needsReset || modified;
+        if (!slot->valid) {
+            dropSlot(slot);
+        }
+        return;
+    }
+
+    // Keep the freshly opened cache if there is room for it
+    if (cache->isOutdated() || m_slots.size() >= APT_CACHE_POOL_SIZE) {
+        delete cache;
+        return;
+    }
+
+    m_slots.push_back(Slot{cache, false, true, modified});
+}
+
+void AptCachePool::invalidate(const gchar *why)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    if (m_slots.empty()) {
+        return;
+    }
+
+    g_debug("invalidating pooled caches as %s", why);
+    for (auto slot = m_slots.begin(); slot != m_slots.end();) {
+        if (slot->inUse) {
+            slot->valid = false;
+            ++slot;
+        } else {
+            slot = dropSlot(slot);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/* apt-cache-pool.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_CACHE_POOL_H
+#define APT_CACHE_POOL_H
+
+#include <glib.h>
+#include <pk-backend.h>
+
+#include <vector>
+
+class AptCacheFile;
+
+/**
+ * Keeps opened, verified AptCacheFiles alive between jobs so that
+ * query roles don't have to reopen the whole cache every time.
+ *
+ * Every concurrent reader gets a cache of its own, the pkgCache mmap
+ * is read-only but the depCache marks and the record parsers are not.
+ */
+class AptCachePool
+{
+public:
+    AptCachePool();
+    ~AptCachePool();
+
+    /**
+     * Waits until the job may use the cache, shared jobs only read it
+     * and run side by side while an exclusive job runs alone
+     */
+    void lock(PkBackendJob *job, bool shared);
+
+    /**
+     * Lets the jobs waiting in lock() go on
+     */
+    void unlock(bool shared);
+
+    /**
+     * Returns an idle pooled cache bound to the given job
+     * @returns nullptr if there is no cache that can be reused,
+     * the caller then has to open a new one
+     */
+    AptCacheFile* acquire(PkBackendJob *job);
+
+    /**
+     * Hands a cache back once the job is done with it, the pool takes
+     * ownership and deletes it if it can't be kept
+     * @param modified whether the job touched the dependency cache marks,
+     * in which case they are reset before the next job gets the cache
+     */
+    void release(AptCacheFile *cache, bool modified);
+
+    /**
+     * Drops the pooled caches, caches still in use are dropped on release
+     */
+    void invalidate(const gchar *why);
+
+private:
+    struct Slot {
+        AptCacheFile *cache;
+        bool          inUse;
+        bool          valid;
+        bool          needsReset;
+    };
+
+    std::vector<Slot>::iterator dropSlot(std::vector<Slot>::iterator slot);
+
+    GMutex            m_mutex;
+    std::vector<Slot> m_slots;
+
+    GMutex m_lockMutex;
+    GCond  m_lockCond;
+    guint  m_readers;
+    guint  m_writersWaiting;
+    bool   m_writer;
+};
+
+#endif // APT_CACHE_POOL_H
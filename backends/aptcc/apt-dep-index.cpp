@@ -0,0 +1,133 @@
+/* apt-dep-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-dep-index.h"
+
+#include <algorithm>
+
+#include "apt-cache-file.h"
+
+AptDepIndex::AptDepIndex(AptCacheFile *cache) :
+    m_cache(cache)
+{
+    pkgCache *pkgcache = cache->GetPkgCache();
+    guint32 count = pkgcache->HeaderP->PackageCount;
+
+    m_packages.assign(count, nullptr);
+    m_dependsOffsets.assign(count + 1, 0);
+    m_requiredByOffsets.assign(count + 1, 0);
+
+    // Forward edges come out grouped by package, count the reverse
+    // ones on the way and lay them out afterwards
+    std::vector<std::pair<guint32, guint32>> edges;
+    std::vector<guint32> ids;
+    for (pkgCache::PkgIterator pkg = pkgcache->PkgBegin(); !pkg.end(); ++pkg) {
+        if (pkg->ID >= count) {
+            continue;
+        }
+        m_packages[pkg->ID] = &*pkg;
+
+        const pkgCache::VerIterator &ver = cache->findVer(pkg);
+        if (ver.end()) {
+            continue;
+        }
+
+        resolveDepends(cache, ver, ids);
+        for (guint32 id : ids) {
+            edges.push_back(std::make_pair(pkg->ID, id));
+            m_dependsOffsets[pkg->ID + 1]++;
+            m_requiredByOffsets[id + 1]++;
+        }
+    }
+
+    for (guint32 i = 0; i < count; ++i) {
+        m_dependsOffsets[i + 1] += m_dependsOffsets[i];
+        m_requiredByOffsets[i + 1] += m_requiredByOffsets[i];
+    }
+
+    m_depends.resize(edges.size());
+    m_requiredBy.resize(edges.size());
+    std::vector<guint32> dependsFill(m_dependsOffsets.begin(), m_dependsOffsets.end() - 1);
+    std::vector<guint32> requiredByFill(m_requiredByOffsets.begin(), m_requiredByOffsets.end() - 1);
+    for (const std::pair<guint32, guint32> &edge : edges) {
+        m_depends[dependsFill[edge.first]++] = edge.second;
+        m_requiredBy[requiredByFill[edge.second]++] = edge.first;
+    }
+
+    g_debug("dependency index: %u packages, %zu edges", count, edges.size());
+}
+
+guint32 AptDepIndex::size() const
+{
+    return m_packages.size();
+}
+
+pkgCache::PkgIterator AptDepIndex::package(guint32 id) const
+{
+    return pkgCache::PkgIterator(*m_cache->GetPkgCache(), m_packages[id]);
+}
+
+AptDepIndex::Range AptDepIndex::depends(guint32 id) const
+{
+    if (id >= size()) {
+        return Range(nullptr, nullptr);
+    }
+    return Range(m_depends.data() + m_dependsOffsets[id],
+                 m_depends.data() + m_dependsOffsets[id + 1]);
+}
+
+AptDepIndex::Range AptDepIndex::requiredBy(guint32 id) const
+{
+    if (id >= size()) {
+        return Range(nullptr, nullptr);
+    }
+    return Range(m_requiredBy.data() + m_requiredByOffsets[id],
+                 m_requiredBy.data() + m_requiredByOffsets[id + 1]);
+}
+
+void AptDepIndex::resolveDepends(AptCacheFile *cache,
+                                 const pkgCache::VerIterator &ver,
+                                 std::vector<guint32> &ids)
+{
+    ids.clear();
+    for (pkgCache::DepIterator dep = ver.DependsList(); !dep.end(); ++dep) {
+        if (dep->Type != pkgCache::Dep::Depends) {
+            continue;
+        }
+
+        pkgCache::PkgIterator target = dep.TargetPkg();
+        if (!cache->findVer(target).end()) {
+            ids.push_back(target->ID);
+            continue;
+        }
+
+        // A virtual package, take whatever provides a matching version
+        pkgCache::Version **targets = dep.AllTargets();
+        for (pkgCache::Version **it = targets; *it != nullptr; ++it) {
+            pkgCache::PkgIterator provider = pkgCache::VerIterator(*cache->GetPkgCache(), *it).ParentPkg();
+            if (!cache->findVer(provider).end()) {
+                ids.push_back(provider->ID);
+            }
+        }
+        delete [] targets;
+    }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
@@ -0,0 +1,79 @@
+/* apt-dep-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_DEP_INDEX_H
+#define APT_DEP_INDEX_H
+
+#include <glib.h>
+
+#include <apt-pkg/pkgcache.h>
+
+#include <utility>
+#include <vector>
+
+class AptCacheFile;
+
+/**
+ * Dependency graph of the cache, in both directions, keyed by package ID.
+ *
+ * Edges go from the version findVer() picks for a package to the packages
+ * its Depends resolve to, virtual targets are already replaced by the
+ * packages providing them.
+ */
+class AptDepIndex
+{
+public:
+    typedef std::pair<const guint32*, const guint32*> Range;
+
+    explicit AptDepIndex(AptCacheFile *cache);
+
+    /**
+     * Number of package IDs, for sizing bitmaps
+     */
+    guint32 size() const;
+
+    pkgCache::PkgIterator package(guint32 id) const;
+
+    /**
+     * Packages the given package depends on
+     */
+    Range depends(guint32 id) const;
+
+    /**
+     * Packages depending on the given package
+     */
+    Range requiredBy(guint32 id) const;
+
+    /**
+     * Resolves the Depends of a version to package IDs, each ID once
+     */
+    static void resolveDepends(AptCacheFile *cache,
+                               const pkgCache::VerIterator &ver,
+                               std::vector<guint32> &ids);
+
+private:
+    AptCacheFile *m_cache;
+    std::vector<pkgCache::Package*> m_packages;
+    std::vector<guint32> m_dependsOffsets;
+    std::vector<guint32> m_depends;
+    std::vector<guint32> m_requiredByOffsets;
+    std::vector<guint32> m_requiredBy;
+};
+
+#endif // APT_DEP_INDEX_H
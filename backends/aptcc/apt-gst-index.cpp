@@ -0,0 +1,261 @@
+/* apt-gst-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-gst-index.h"
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/pkgrecords.h>
+
+#include <cstring>
+
+#include "apt-cache-file.h"
+#include "apt-search-index.h"
+#include "apt-utils.h"
+#include "gst-matcher.h"
+
+#define GST_INDEX_FILE    "pkgstidx.bin"
+#define GST_INDEX_MAGIC   "PKGIDX\r\n"
+#define GST_INDEX_VERSION 1
+
+struct AptGstIndex::Header {
+    char    magic[8];
+    guint32 version;
+    guint32 recordCount;
+    guint64 fingerprint;
+    guint64 recordsOffset;
+    guint64 textOffset;
+    guint64 textSize;
+};
+
+// The "\nGstreamer-*" lines of the record of one package
+struct AptGstIndex::Record {
+    guint32 pkgId;
+    guint32 textOffset;
+    guint32 textLen;
+    guint32 padding;
+};
+
+namespace {
+
+GRecMutex buildMutex;
+
+pkgCache::VerIterator findProviderVer(AptCacheFile *cache, const pkgCache::PkgIterator &pkg)
+{
+    // TODO search in updates packages
+    pkgCache::VerIterator ver = cache->findVer(pkg);
+    if (ver.end() == true) {
+        ver = cache->findCandidateVer(pkg);
+    }
+    return ver;
+}
+
+void appendGstFields(std::string &text, const char *start, const char *stop)
+{
+    const char *line = start;
+    while (line < stop) {
+        const char *end = static_cast<const char*>(memchr(line, '\n', stop - line));
+        if (end == nullptr) {
+            end = stop;
+        }
+        if (end - line > 10 && strncmp(line, "Gstreamer-", 10) == 0) {
+            text += '\n';
+            text.append(line, end - line);
+        }
+        line = end + 1;
+    }
+}
+
+}
+
+AptGstIndex::AptGstIndex(AptCacheFile *cache)
+{
+    if (load(cache)) {
+        return;
+    }
+
+    // Another job may have built it while we were waiting
+    g_autoptr(GRecMutexLocker) locker = g_rec_mutex_locker_new(&buildMutex);
+    if (!load(cache) && build(cache)) {
+        load(cache);
+    }
+}
+
+AptGstIndex::~AptGstIndex()
+{
+    for (const Entry &entry : m_entries) {
+        delete entry.provides;
+    }
+}
+
+std::string AptGstIndex::indexPath()
+{
+    return _config->FindDir("Dir::Cache") + GST_INDEX_FILE;
+}
+
+bool AptGstIndex::build(AptCacheFile *cache)
+{
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GRecMutexLocker) locker = g_rec_mutex_locker_new(&buildMutex);
+
+    pkgCache *pkgcache = cache->GetPkgCache();
+    if (pkgcache == nullptr) {
+        return false;
+    }
+
+    std::vector<Record> records;
+    std::string text;
+    for (pkgCache::PkgIterator pkg = pkgcache->PkgBegin(); !pkg.end(); ++pkg) {
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+            continue;
+        }
+
+        // Ignore debug packages - these aren't interesting as codec providers,
+        // but they do have apt GStreamer-* metadata.
+        if (ends_with(pkg.Name(), "-dbg") || ends_with(pkg.Name(), "-dbgsym")) {
+            continue;
+        }
+
+        // Ignore virtual packages
+        const pkgCache::VerIterator &ver = findProviderVer(cache, pkg);
+        if (ver.end() == true) {
+            continue;
+        }
+
+        pkgRecords::Parser &rec = cache->GetPkgRecords()->Lookup(ver.FileList());
+        const char *start, *stop;
+        rec.GetRec(start, stop);
+
+        Record record;
+        memset(&record, 0, sizeof(record));
+        record.pkgId = pkg->ID;
+        record.textOffset = text.size();
+        appendGstFields(text, start, stop);
+        record.textLen = text.size() - record.textOffset;
+
+        // Only the packages declaring a version are codec providers
+        if (text.find("\nGstreamer-Version: ", record.textOffset) == std::string::npos) {
+            text.resize(record.textOffset);
+            continue;
+        }
+        if (text.size() > G_MAXUINT32) {
+            g_warning("GStreamer fields are too large to be indexed");
+            return false;
+        }
+        records.push_back(record);
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GST_INDEX_MAGIC, sizeof(header.magic));
+    header.version = GST_INDEX_VERSION;
+    header.recordCount = records.size();
+    header.fingerprint = AptSearchIndex::fingerprint(pkgcache, nullptr);
+    header.recordsOffset = sizeof(Header);
+    header.textOffset = header.recordsOffset + records.size() * sizeof(Record);
+    header.textSize = text.size();
+
+    std::string data;
+    data.reserve(header.textOffset + text.size());
+    data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    data += text;
+
+    const std::string &path = indexPath();
+    if (!g_file_set_contents(path.c_str(), data.data(), data.size(), &error)) {
+        g_debug("failed to save the GStreamer index: %s", error->message);
+        return false;
+    }
+
+    g_debug("saved the GStreamer fields of %u packages to %s", header.recordCount, path.c_str());
+    return true;
+}
+
+bool AptGstIndex::load(AptCacheFile *cache)
+{
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GMappedFile) file = nullptr;
+    std::vector<pkgCache::Package*> packages;
+
+    pkgCache *pkgcache = cache->GetPkgCache();
+    if (pkgcache == nullptr) {
+        return false;
+    }
+
+    const std::string &path = indexPath();
+    file = g_mapped_file_new(path.c_str(), FALSE, &error);
+    if (file == nullptr) {
+        g_debug("no GStreamer index: %s", error->message);
+        return false;
+    }
+
+    const char *contents = g_mapped_file_get_contents(file);
+    gsize size = g_mapped_file_get_length(file);
+    const Header *header = reinterpret_cast<const Header*>(contents);
+    if (size < sizeof(Header) ||
+            memcmp(header->magic, GST_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != GST_INDEX_VERSION ||
+            header->recordsOffset + header->recordCount * sizeof(Record) > size ||
+            header->textOffset + header->textSize > size) {
+        g_debug("ignoring invalid GStreamer index %s", path.c_str());
+        return false;
+    }
+
+    if (header->fingerprint != AptSearchIndex::fingerprint(pkgcache, &packages)) {
+        g_debug("ignoring GStreamer index built for another cache");
+        return false;
+    }
+
+    // Only the few providers are parsed, the caps are kept for matching
+    const Record *records = reinterpret_cast<const Record*>(contents + header->recordsOffset);
+    const char *text = contents + header->textOffset;
+    for (guint32 i = 0; i < header->recordCount; ++i) {
+        const Record &record = records[i];
+        if (record.textOffset + (guint64) record.textLen > header->textSize ||
+                record.pkgId >= packages.size() || packages[record.pkgId] == nullptr) {
+            continue;
+        }
+
+        pkgCache::PkgIterator pkg(*pkgcache, packages[record.pkgId]);
+        pkgCache::VerIterator ver = findProviderVer(cache, pkg);
+        if (ver.end() == true) {
+            continue;
+        }
+
+        std::string fields(text + record.textOffset, record.textLen);
+        GstProvides *provides = new GstProvides(fields, ver.Arch() == NULL ? "" : ver.Arch());
+        if (!provides->isValid()) {
+            delete provides;
+            continue;
+        }
+
+        Entry entry = { ver, provides };
+        m_entries.push_back(entry);
+    }
+    return true;
+}
+
+void AptGstIndex::providers(const GstMatcher &matcher, PkgList &output) const
+{
+    for (const Entry &entry : m_entries) {
+        if (matcher.matches(*entry.provides)) {
+            output.push_back(entry.ver);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/* apt-gst-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_GST_INDEX_H
+#define APT_GST_INDEX_H
+
+#include <apt-pkg/pkgcache.h>
+
+#include <string>
+#include <vector>
+
+#include "pkg-list.h"
+
+class AptCacheFile;
+class GstMatcher;
+class GstProvides;
+
+/**
+ * The GStreamer capabilities of the packages that declare some.
+ *
+ * The GStreamer fields are read from the package records when the cache
+ * is built and saved next to the search index, keyed by the same cache
+ * fingerprint, so codec lookups only have to map them and intersect caps.
+ */
+class AptGstIndex
+{
+public:
+    /**
+     * Loads the saved index, building it first if it is missing or was
+     * built from another cache
+     */
+    explicit AptGstIndex(AptCacheFile *cache);
+    ~AptGstIndex();
+
+    /**
+     * Reads the GStreamer fields of the given cache and saves them
+     * @returns false if it could not be written
+     */
+    static bool build(AptCacheFile *cache);
+
+    /**
+     * Appends the versions providing one of the matcher's capabilities
+     */
+    void providers(const GstMatcher &matcher, PkgList &output) const;
+
+private:
+    struct Header;
+    struct Record;
+
+    struct Entry {
+        pkgCache::VerIterator ver;
+        GstProvides *provides;
+    };
+
+    static std::string indexPath();
+    bool load(AptCacheFile *cache);
+
+    std::vector<Entry> m_entries;
+};
+
+#endif // APT_GST_INDEX_H
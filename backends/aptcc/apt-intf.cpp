@@ -45,6 +45,7 @@
 #include <sys/statfs.h>
 #include <sys/wait.h>
 #include <sys/fcntl.h>
+#include <poll.h>
 #include <pty.h>
 
 #include <algorithm>
@@ -55,6 +56,10 @@
 #include <regex.h>
 
 #include "apt-cache-file.h"
+#include "apt-cache-pool.h"
+#include "apt-dep-index.h"
+#include "apt-gst-index.h"
+#include "apt-search-index.h"
 #include "apt-utils.h"
 #include "gst-matcher.h"
 #include "apt-messages.h"
@@ -62,42 +67,91 @@
 
 #define RAMFS_MAGIC     0x858458f6
 
-AptIntf::AptIntf(PkBackendJob *job) :
+// Larger results are emitted in cache order, sorting them only costs time
+#define SORTED_RESULTS_MAX 1000
+
+// Number of packages emitPackages() sends to the daemon at once
+#define EMIT_PACKAGES_BATCH 500
+
+// How long updateInterface() waits for the child, in milliseconds
+#define STATUS_POLL_TIMEOUT 100
+
+AptIntf::AptIntf(PkBackendJob *job, AptCachePool *pool) :
     m_cache(0),
+    m_pool(pool),
     m_job(job),
     m_cancel(false),
+    m_pooled(false),
+    m_cacheModified(false),
     m_lastSubProgress(0),
+    m_ptyOpen(false),
     m_terminalTimeout(120)
 {
     m_cancel = false;
 }
 
+// Roles that only read the cache, so they can share it with other jobs
+static bool isReadOnlyRole(PkRoleEnum role)
+{
+    switch (role) {
+    case PK_ROLE_ENUM_DEPENDS_ON:
+    case PK_ROLE_ENUM_REQUIRED_BY:
+    case PK_ROLE_ENUM_GET_DETAILS:
+    case PK_ROLE_ENUM_GET_UPDATE_DETAIL:
+    case PK_ROLE_ENUM_GET_UPDATES:
+    case PK_ROLE_ENUM_GET_PACKAGES:
+    case PK_ROLE_ENUM_WHAT_PROVIDES:
+    case PK_ROLE_ENUM_DOWNLOAD_PACKAGES:
+    case PK_ROLE_ENUM_RESOLVE:
+    case PK_ROLE_ENUM_SEARCH_NAME:
+    case PK_ROLE_ENUM_SEARCH_DETAILS:
+    case PK_ROLE_ENUM_SEARCH_GROUP:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Guards the process wide state init() touches: the locale, the
+// environment, _config and the cache files that Open() may rebuild
+static GMutex initMutex;
+
+bool AptIntf::canRunConcurrently(PkRoleEnum role)
+{
+    // Downloads write to the archives directory
+    return role != PK_ROLE_ENUM_DOWNLOAD_PACKAGES && isReadOnlyRole(role);
+}
+
 bool AptIntf::init(gchar **localDebs)
 {
     const gchar *http_proxy;
     const gchar *ftp_proxy;
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&initMutex);
 
     // set locale
     setEnvLocaleFromJob();
 
-    // set http proxy
-    http_proxy = pk_backend_job_get_proxy_http(m_job);
-    if (http_proxy != NULL) {
-        g_autofree gchar *uri = pk_backend_convert_uri(http_proxy);
-        g_setenv("http_proxy", uri, TRUE);
-    }
+    // Concurrent readers never go online
+    PkRoleEnum role = pk_backend_job_get_role(m_job);
+    if (!canRunConcurrently(role)) {
+        // set http proxy
+        http_proxy = pk_backend_job_get_proxy_http(m_job);
+        if (http_proxy != NULL) {
+            g_autofree gchar *uri = pk_backend_convert_uri(http_proxy);
+            g_setenv("http_proxy", uri, TRUE);
+        }
 
-    // set ftp proxy
-    ftp_proxy = pk_backend_job_get_proxy_ftp(m_job);
-    if (ftp_proxy != NULL) {
-        g_autofree gchar *uri = pk_backend_convert_uri(ftp_proxy);
-        g_setenv("ftp_proxy", uri, TRUE);
+        // set ftp proxy
+        ftp_proxy = pk_backend_job_get_proxy_ftp(m_job);
+        if (ftp_proxy != NULL) {
+            g_autofree gchar *uri = pk_backend_convert_uri(ftp_proxy);
+            g_setenv("ftp_proxy", uri, TRUE);
+        }
     }
 
     // Check if we should open the Cache with lock
     bool withLock;
     bool AllowBroken = false;
-    PkRoleEnum role = pk_backend_job_get_role(m_job);
     switch (role) {
     case PK_ROLE_ENUM_INSTALL_PACKAGES:
     case PK_ROLE_ENUM_INSTALL_FILES:
@@ -145,31 +199,45 @@ bool AptIntf::init(gchar **localDebs)
         }
     }
 
-    // Create the AptCacheFile class to search for packages
-    m_cache = new AptCacheFile(m_job,withLock);
-    while (m_cache->Open() == false) {
-        if (withLock == false || (timeout <= 0)) {
-            show_errors(m_job, PK_ERROR_ENUM_CANNOT_GET_LOCK);
-            return false;
-        } else {
-            _error->Discard();
-            pk_backend_job_set_status(m_job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
-            sleep(1);
-            timeout--;
-        }
+    // Query roles can reuse the warm cache a previous job left in the pool
+    bool poolable = m_pool != nullptr && !withLock && isReadOnlyRole(role);
+    if (poolable) {
+        m_cache = m_pool->acquire(m_job);
+    }
 
-        // If we are going to try again, we can either simply try Open() once
-        // again (since pkgCacheFile is monotonic in creating required objects),
-        // or simply continue with a new pkgCacheFile object.
-        delete m_cache;
+    bool reused = m_cache != nullptr;
+    if (!reused) {
+        // Create the AptCacheFile class to search for packages
         m_cache = new AptCacheFile(m_job,withLock);
-    }
+        while (m_cache->Open() == false) {
+            if (withLock == false || (timeout <= 0)) {
+                show_errors(m_job, PK_ERROR_ENUM_CANNOT_GET_LOCK);
+                return false;
+            } else {
+                _error->Discard();
+                pk_backend_job_set_status(m_job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+                sleep(1);
+                timeout--;
+            }
 
-    // default settings
-    _config->CndSet("APT::Get::AutomaticRemove::Kernels", _config->FindB("APT::Get::AutomaticRemove", true));
+            // If we are going to try again, we can either simply try Open() once
+            // again (since pkgCacheFile is monotonic in creating required objects),
+            // or simply continue with a new pkgCacheFile object.
+            delete m_cache;
+            m_cache = new AptCacheFile(m_job,withLock);
+        }
+    }
 
     m_interactive = pk_backend_job_get_interactive(m_job);
-    if (!m_interactive) {
+
+    // Concurrent readers must not write to _config, they don't use
+    // these settings anyway
+    if (!canRunConcurrently(role)) {
+        // default settings
+        _config->CndSet("APT::Get::AutomaticRemove::Kernels", _config->FindB("APT::Get::AutomaticRemove", true));
+    }
+
+    if (!m_interactive && !canRunConcurrently(role)) {
         // Do not ask about config updates if we are not interactive
         _config->Set("Dpkg::Options::", "--force-confdef");
         _config->Set("Dpkg::Options::", "--force-confold");
@@ -178,13 +246,31 @@ bool AptIntf::init(gchar **localDebs)
         g_setenv("APT_LISTBUGS_FRONTEND", "none", TRUE);
     }
 
+    g_clear_pointer(&locker, g_mutex_locker_free);
+
+    // The pooled cache was already checked by the job that opened it
+    if (reused) {
+        m_pooled = true;
+        return true;
+    }
+
     // Check if there are half-installed packages and if we can fix them
-    return m_cache->CheckDeps(AllowBroken);
+    if (!m_cache->CheckDeps(AllowBroken)) {
+        return false;
+    }
+
+    m_pooled = poolable;
+    return true;
 }
 
 AptIntf::~AptIntf()
 {
-    delete m_cache;
+    if (m_pooled) {
+        // Hand the cache back so the next query doesn't have to reopen it
+        m_pool->release(m_cache, m_cacheModified);
+    } else {
+        delete m_cache;
+    }
 }
 
 void AptIntf::setEnvLocaleFromJob()
@@ -193,6 +279,11 @@ void AptIntf::setEnvLocaleFromJob()
     if (locale == NULL)
         return;
 
+    // Nothing to do for the jobs sharing the cache, the ones that need
+    // another locale run alone, see backend_job_thread()
+    if (g_strcmp0(g_getenv("LANG"), locale) == 0)
+        return;
+
     // set daemon locale
     setlocale(LC_ALL, locale);
 
@@ -218,98 +309,60 @@ bool AptIntf::cancelled() const
     return m_cancel;
 }
 
-bool AptIntf::matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters)
+// Turns the filters into the VersionFlags a version must and must not have
+static void filterMasks(PkBitfield filters, guint8 &required, guint8 &forbidden)
 {
-    if (filters != 0) {
-        const pkgCache::PkgIterator &pkg = ver.ParentPkg();
-        bool installed = false;
+    required = 0;
+    forbidden = 0;
 
-        // Check if the package is installed
-        if (pkg->CurrentState == pkgCache::State::Installed && pkg.CurrentVer() == ver) {
-            installed = true;
-        }
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
+        forbidden |= AptCacheFile::VersionInstalled;
+    }
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED)) {
+        required |= AptCacheFile::VersionInstalled;
+    }
 
-        std::string str = ver.Section() == NULL ? "" : ver.Section();
-        std::string section, component;
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DEVELOPMENT)) {
+        required |= AptCacheFile::VersionDevel;
+    } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_DEVELOPMENT)) {
+        forbidden |= AptCacheFile::VersionDevel;
+    }
 
-        size_t found;
-        found = str.find_last_of("/");
-        section = str.substr(found + 1);
-        if(found == str.npos) {
-            component = "main";
-        } else {
-            component = str.substr(0, found);
-        }
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_GUI)) {
+        required |= AptCacheFile::VersionGui;
+    } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_GUI)) {
+        forbidden |= AptCacheFile::VersionGui;
+    }
 
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED) && installed) {
-            return false;
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED) && !installed) {
-            return false;
-        }
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_FREE)) {
+        required |= AptCacheFile::VersionFree;
+    } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_FREE)) {
+        forbidden |= AptCacheFile::VersionFree;
+    }
 
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DEVELOPMENT)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than devel
-            std::string pkgName = pkg.Name();
-            if (!ends_with(pkgName, "-dev") &&
-                    !ends_with(pkgName, "-dbg") &&
-                    section.compare("devel") &&
-                    section.compare("libdevel")) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_DEVELOPMENT)) {
-            std::string pkgName = pkg.Name();
-            if (ends_with(pkgName, "-dev") ||
-                    ends_with(pkgName, "-dbg") ||
-                    !section.compare("devel") ||
-                    !section.compare("libdevel")) {
-                return false;
-            }
-        }
+    // PK_FILTER_ENUM_COLLECTIONS is for virtual group packages, which
+    // the "metapackages" component check never matched -- left unhandled
+}
 
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_GUI)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than x11
-            if (section.compare("x11") && section.compare("gnome") &&
-                    section.compare("kde") && section.compare("graphics")) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_GUI)) {
-            if (!section.compare("x11") || !section.compare("gnome") ||
-                    !section.compare("kde") || !section.compare("graphics")) {
-                return false;
-            }
-        }
+bool AptIntf::matchFlags(const pkgCache::VerIterator &ver, guint8 required, guint8 forbidden)
+{
+    const pkgCache::PkgIterator &pkg = ver.ParentPkg();
+    guint8 flags = m_cache->versionAttributes(ver).flags;
 
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_FREE)) {
-            if (component.compare("main") != 0 &&
-                    component.compare("universe") != 0) {
-                // Must be in main and universe to be free
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_FREE)) {
-            if (component.compare("main") == 0 ||
-                    component.compare("universe") == 0) {
-                // Must not be in main or universe to be free
-                return false;
-            }
-        }
+    // Check if the package is installed
+    if (pkg->CurrentState == pkgCache::State::Installed && pkg.CurrentVer() == ver) {
+        flags |= AptCacheFile::VersionInstalled;
+    }
 
-        // TODO test this one..
-#if 0
-        // I couldn'tfind any packages with the metapackages component, and I
-        // think the check is the wrong way around; PK_FILTER_ENUM_COLLECTIONS
-        // is for virtual group packages -- hughsie
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_COLLECTIONS)) {
-            if (!component.compare("metapackages")) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_COLLECTIONS)) {
-            if (component.compare("metapackages")) {
-                return false;
-            }
-        }
-#endif
+    return (flags & required) == required && (flags & forbidden) == 0;
+}
+
+bool AptIntf::matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters)
+{
+    if (filters != 0) {
+        guint8 required, forbidden;
+        filterMasks(filters, required, forbidden);
+        return matchFlags(ver, required, forbidden);
     }
     return true;
 }
@@ -320,8 +373,10 @@ PkgList AptIntf::filterPackages(const PkgList &packages, PkBitfield filters)
         PkgList ret;
         ret.reserve(packages.size());
 
+        guint8 required, forbidden;
+        filterMasks(filters, required, forbidden);
         for (const pkgCache::VerIterator &ver : packages) {
-            if (matchPackage(ver, filters)) {
+            if (matchFlags(ver, required, forbidden)) {
                 ret.push_back(ver);
             }
         }
@@ -330,6 +385,9 @@ PkgList AptIntf::filterPackages(const PkgList &packages, PkBitfield filters)
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DOWNLOADED) && ret.size() > 0) {
             PkgList downloaded;
 
+            // tryToInstall() below changes the candidates and marks
+            m_cacheModified = true;
+
             pkgProblemResolver Fix(*m_cache);
             {
                 for (auto autoInst : { true, false }) {
@@ -387,8 +445,8 @@ PkgList AptIntf::filterPackages(const PkgList &packages, PkBitfield filters)
     }
 }
 
-// used to emit packages it collects all the needed info
-void AptIntf::emitPackage(const pkgCache::VerIterator &ver, PkInfoEnum state)
+// Returns the info to emit a package with when none was given
+static PkInfoEnum packageState(const pkgCache::VerIterator &ver, PkInfoEnum state)
 {
     // check the state enum to see if it was not set.
     if (state == PK_INFO_ENUM_UNKNOWN) {
@@ -401,39 +459,71 @@ void AptIntf::emitPackage(const pkgCache::VerIterator &ver, PkInfoEnum state)
             state = PK_INFO_ENUM_AVAILABLE;
         }
     }
+    return state;
+}
 
-    gchar *package_id;
-    package_id = utilBuildPackageId(ver);
+// used to emit packages it collects all the needed info
+void AptIntf::emitPackage(const pkgCache::VerIterator &ver, PkInfoEnum state)
+{
     pk_backend_job_package(m_job,
-                           state,
-                           package_id,
+                           packageState(ver, state),
+                           m_cache->buildPackageId(ver),
                            m_cache->getShortDescription(ver).c_str());
-    g_free(package_id);
+}
+
+PkPackage* AptIntf::buildPackage(const pkgCache::VerIterator &ver, PkInfoEnum state)
+{
+    g_autoptr(GError) error = NULL;
+    g_autoptr(PkPackage) item = pk_package_new();
+
+    const char *packageId = m_cache->buildPackageId(ver);
+    if (!pk_package_set_id(item, packageId, &error)) {
+        g_warning("package_id %s invalid and cannot be processed: %s",
+                  packageId, error->message);
+        return nullptr;
+    }
+    pk_package_set_info(item, packageState(ver, state));
+    pk_package_set_summary(item, m_cache->getShortDescription(ver).c_str());
+    return static_cast<PkPackage*>(g_steal_pointer(&item));
 }
 
 void AptIntf::emitPackageProgress(const pkgCache::VerIterator &ver, PkStatusEnum status, uint percentage)
 {
-    gchar *package_id;
-    package_id = utilBuildPackageId(ver);
-    pk_backend_job_set_item_progress(m_job, package_id, status, percentage);
-    g_free(package_id);
+    pk_backend_job_set_item_progress(m_job, m_cache->buildPackageId(ver), status, percentage);
 }
 
 void AptIntf::emitPackages(PkgList &output, PkBitfield filters, PkInfoEnum state)
 {
-    // Sort so we can remove the duplicated entries
-    output.sort();
-
     // Remove the duplicated entries
     output.removeDuplicates();
 
+    if (output.size() <= SORTED_RESULTS_MAX) {
+        output.sort();
+    }
+
     output = filterPackages(output, filters);
+
+    // Hand the packages to the daemon in batches, each one is a single
+    // main loop dispatch and D-Bus signal instead of one per package
+    g_autoptr(GPtrArray) batch = g_ptr_array_new_with_free_func(g_object_unref);
     for (const pkgCache::VerIterator &verIt : output) {
         if (m_cancel) {
             break;
         }
 
-        emitPackage(verIt, state);
+        PkPackage *item = buildPackage(verIt, state);
+        if (item != nullptr) {
+            g_ptr_array_add(batch, item);
+        }
+
+        if (batch->len >= EMIT_PACKAGES_BATCH) {
+            pk_backend_job_packages(m_job, batch);
+            g_ptr_array_set_size(batch, 0);
+        }
+    }
+
+    if (batch->len > 0 && !m_cancel) {
+        pk_backend_job_packages(m_job, batch);
     }
 }
 
@@ -446,81 +536,25 @@ void AptIntf::emitRequireRestart(PkgList &output)
     output.removeDuplicates();
 
     for (const pkgCache::VerIterator &verIt : output) {
-        gchar *package_id;
-        package_id = utilBuildPackageId(verIt);
-        pk_backend_job_require_restart(m_job, PK_RESTART_ENUM_SYSTEM, package_id);
-        g_free(package_id);
+        pk_backend_job_require_restart(m_job, PK_RESTART_ENUM_SYSTEM, m_cache->buildPackageId(verIt));
     }
 }
 
 void AptIntf::emitUpdates(PkgList &output, PkBitfield filters)
 {
-    PkInfoEnum state;
-    // Sort so we can remove the duplicated entries
-    output.sort();
-
-    // Remove the duplicated entries
-    output.removeDuplicates();
-
-    output = filterPackages(output, filters);
-    for (const pkgCache::VerIterator &verIt : output) {
-        if (m_cancel) {
-            break;
-        }
-
-        // the default update info
-        state = PK_INFO_ENUM_NORMAL;
-
-        emitPackage(verIt, state);
-    }
+    // the default update info
+    emitPackages(output, filters, PK_INFO_ENUM_NORMAL);
 }
 
 // search packages which provide a codec (specified in "values")
 void AptIntf::providesCodec(PkgList &output, gchar **values)
 {
-    string arch;
     GstMatcher matcher(values);
     if (!matcher.hasMatches()) {
         return;
     }
 
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
-        if (m_cancel) {
-            break;
-        }
-
-        // Ignore packages that exist only due to dependencies.
-        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
-            continue;
-        }
-
-        // Ignore debug packages - these aren't interesting as codec providers,
-        // but they do have apt GStreamer-* metadata.
-        if (ends_with (pkg.Name(), "-dbg") || ends_with (pkg.Name(), "-dbgsym")) {
-            continue;
-        }
-
-        // TODO search in updates packages
-        // Ignore virtual packages
-        pkgCache::VerIterator ver = m_cache->findVer(pkg);
-        if (ver.end() == true) {
-            ver = m_cache->findCandidateVer(pkg);
-        }
-        if (ver.end() == true) {
-            continue;
-        }
-
-        arch = string(ver.Arch());
-
-        pkgCache::VerFileIterator vf = ver.FileList();
-        pkgRecords::Parser &rec = m_cache->GetPkgRecords()->Lookup(vf);
-        const char *start, *stop;
-        rec.GetRec(start, stop);
-        string record(start, stop - start);
-        if (matcher.matches(record, arch)) {
-            output.push_back(ver);
-        }
-    }
+    m_cache->getGstIndex()->providers(matcher, output);
 }
 
 // search packages which provide the libraries specified in "values"
@@ -567,32 +601,56 @@ void AptIntf::providesLibrary(PkgList &output, gchar **values)
 
             g_debug ("pkg-name: %s", libPkgName.c_str ());
 
-            for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
-                // Ignore packages that exist only due to dependencies.
-                if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
-                    continue;
-                }
+            // Make everything lower-case
+            std::transform(libPkgName.begin(), libPkgName.end(), libPkgName.begin(), ::tolower);
 
+            const pkgCache::PkgIterator &pkg = (*m_cache)->FindPkg(libPkgName);
+            if (!pkg.end()) {
                 // TODO: Ignore virtual packages
                 pkgCache::VerIterator ver = m_cache->findVer(pkg);
                 if (ver.end()) {
                     ver = m_cache->findCandidateVer(pkg);
-                    if (ver.end()) {
-                        continue;
-                    }
                 }
-
-                // Make everything lower-case
-                std::transform(libPkgName.begin(), libPkgName.end(), libPkgName.begin(), ::tolower);
-
-                if (g_strcmp0 (pkg.Name (), libPkgName.c_str ()) == 0) {
+                if (!ver.end()) {
                     output.push_back(ver);
                 }
             }
+
+            // Packages not named after the library still provide its soname
+            appendLibraryProviders(output, value);
         } else {
             g_debug("libmatcher: Did not match: %s", value);
         }
     }
+    regfree(&libreg);
+}
+
+void AptIntf::appendLibraryProviders(PkgList &output, const std::string &soname)
+{
+    // rpm provides sonames with a suffix on 64bit architectures
+    const std::string names[] = { soname, soname + "()(64bit)" };
+    for (const std::string &name : names) {
+        const pkgCache::PkgIterator &provided = (*m_cache)->FindPkg(name);
+        if (provided.end()) {
+            continue;
+        }
+
+        for (pkgCache::PrvIterator prv = provided.ProvidesList(); !prv.end(); ++prv) {
+            const pkgCache::PkgIterator &owner = prv.OwnerPkg();
+            if (output.contains(owner)) {
+                continue;
+            }
+
+            // only if it is the version we would report for the package
+            pkgCache::VerIterator ver = m_cache->findVer(owner);
+            if (ver.end()) {
+                ver = m_cache->findCandidateVer(owner);
+            }
+            if (!ver.end() && ver == prv.OwnerVer()) {
+                output.push_back(ver);
+            }
+        }
+    }
 }
 
 // Mostly copied from pkgAcqArchive.
@@ -708,18 +766,14 @@ void AptIntf::emitPackageDetail(const pkgCache::VerIterator &ver)
         size = ver->Size;
     }
 
-    gchar *package_id;
-    package_id = utilBuildPackageId(ver);
     pk_backend_job_details(m_job,
-                           package_id,
+                           m_cache->buildPackageId(ver),
                            m_cache->getShortDescription(ver).c_str(),
                            "unknown",
                            get_enum_group(section),
                            m_cache->getLongDescriptionParsed(ver).c_str(),
                            "",
                            size);
-
-    g_free(package_id);
 }
 
 void AptIntf::emitDetails(PkgList &pkgs)
@@ -875,62 +929,62 @@ void AptIntf::getDepends(PkgList &output,
                          const pkgCache::VerIterator &ver,
                          bool recursive)
 {
-    pkgCache::DepIterator dep = ver.DependsList();
-    while (!dep.end()) {
-        if (m_cancel) {
-            break;
-        }
-
-        const pkgCache::VerIterator &ver = m_cache->findVer(dep.TargetPkg());
-        // Ignore packages that exist only due to dependencies.
-        if (ver.end()) {
-            dep++;
-            continue;
-        } else if (dep->Type == pkgCache::Dep::Depends) {
-            if (recursive) {
-                if (!output.contains(dep.TargetPkg())) {
-                    output.push_back(ver);
-                    getDepends(output, ver, recursive);
-                }
-            } else {
-                output.push_back(ver);
-            }
-        }
-        dep++;
-    }
+    std::vector<guint32> ids;
+    AptDepIndex::resolveDepends(m_cache, ver, ids);
+    walkDepends(output, ids, recursive, true);
 }
 
 void AptIntf::getRequires(PkgList &output,
                           const pkgCache::VerIterator &ver,
                           bool recursive)
 {
-    for (pkgCache::PkgIterator parentPkg = m_cache->GetPkgCache()->PkgBegin(); !parentPkg.end(); ++parentPkg) {
+    const AptDepIndex::Range &range = m_cache->getDepIndex()->requiredBy(ver.ParentPkg()->ID);
+    std::vector<guint32> ids(range.first, range.second);
+    walkDepends(output, ids, recursive, false);
+}
+
+void AptIntf::walkDepends(PkgList &output,
+                          const std::vector<guint32> &ids,
+                          bool recursive,
+                          bool forward)
+{
+    AptDepIndex *index = m_cache->getDepIndex();
+    if (!recursive) {
+        for (guint32 id : ids) {
+            const pkgCache::VerIterator &ver = m_cache->findVer(index->package(id));
+            if (!ver.end()) {
+                output.push_back(ver);
+            }
+        }
+        return;
+    }
+
+    // Breadth first, every package is visited once however many
+    // paths lead to it
+    std::vector<bool> seen(index->size(), false);
+    std::vector<guint32> queue;
+    for (guint32 id : ids) {
+        if (!seen[id]) {
+            seen[id] = true;
+            queue.push_back(id);
+        }
+    }
+
+    for (size_t i = 0; i < queue.size(); ++i) {
         if (m_cancel) {
             break;
         }
 
-        // Ignore packages that exist only due to dependencies.
-        if (parentPkg.VersionList().end() && parentPkg.ProvidesList().end()) {
-            continue;
+        const pkgCache::VerIterator &ver = m_cache->findVer(index->package(queue[i]));
+        if (!ver.end()) {
+            output.push_back(ver);
         }
 
-        // Don't insert virtual packages instead add what it provides
-        const pkgCache::VerIterator &parentVer = m_cache->findVer(parentPkg);
-        if (parentVer.end() == false) {
-            PkgList deps;
-            getDepends(deps, parentVer, false);
-            for (const pkgCache::VerIterator &depVer : deps) {
-                if (depVer == ver) {
-                    if (recursive) {
-                        if (!output.contains(parentPkg)) {
-                            output.push_back(parentVer);
-                            getRequires(output, parentVer, recursive);
-                        }
-                    } else {
-                        output.push_back(parentVer);
-                    }
-                    break;
-                }
+        const AptDepIndex::Range &next = forward ? index->depends(queue[i]) : index->requiredBy(queue[i]);
+        for (const guint32 *id = next.first; id != next.second; ++id) {
+            if (!seen[*id]) {
+                seen[*id] = true;
+                queue.push_back(*id);
             }
         }
     }
@@ -1042,11 +1096,11 @@ PkgList AptIntf::getPackagesFromGroup(gchar **values)
         // Ignore virtual packages
         const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
         if (ver.end() == false) {
-            string section = pkg.VersionList().Section() == NULL ? "" : pkg.VersionList().Section();
+            guint8 section = m_cache->versionAttributes(pkg.VersionList()).group;
 
             // Don't insert virtual packages instead add what it provides
             for (PkGroupEnum group : groups) {
-                if (group == get_enum_group(section)) {
+                if (group == section) {
                     output.push_back(ver);
                     break;
                 }
@@ -1074,10 +1128,41 @@ bool AptIntf::matchesQueries(const vector<string> &queries, string s) {
     return false;
 }
 
+void AptIntf::appendSearchMatch(PkgList &output, const pkgCache::PkgIterator &pkg)
+{
+    const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
+    if (ver.end() == false) {
+        output.push_back(ver);
+        return;
+    }
+
+    // Don't insert virtual packages instead add what it provides
+    for (pkgCache::PrvIterator Prv = pkg.ProvidesList(); Prv.end() == false; ++Prv) {
+        const pkgCache::VerIterator &ownerVer = m_cache->findVer(Prv.OwnerPkg());
+
+        // check to see if the provided package isn't virtual too
+        if (ownerVer.end() == false) {
+            output.push_back(ownerVer);
+        }
+    }
+}
+
 PkgList AptIntf::searchPackageName(const vector<string> &queries)
 {
     PkgList output;
 
+    // The index is only used if it's there, names alone are quick to scan
+    AptSearchIndex *index = m_cache->getSearchIndex();
+    if (index != nullptr) {
+        for (const pkgCache::PkgIterator &pkg : index->search(queries, false)) {
+            if (m_cancel) {
+                break;
+            }
+            appendSearchMatch(output, pkg);
+        }
+        return output;
+    }
+
     for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
         if (m_cancel) {
             break;
@@ -1114,6 +1199,19 @@ PkgList AptIntf::searchPackageDetails(const vector<string> &queries)
 {
     PkgList output;
 
+    // Building the index costs about one scan over the records, so
+    // do it right away and have the following searches use it
+    AptSearchIndex *index = m_cache->getSearchIndex(true);
+    if (index != nullptr) {
+        for (const pkgCache::PkgIterator &pkg : index->search(queries, true)) {
+            if (m_cancel) {
+                break;
+            }
+            appendSearchMatch(output, pkg);
+        }
+        return output;
+    }
+
     for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
         if (m_cancel) {
             break;
@@ -1154,6 +1252,9 @@ PkgList AptIntf::getUpdates(PkgList &blocked, PkgList &downgrades, PkgList &inst
 {
     PkgList updates;
 
+    // DistUpgrade() leaves the upgrade marked in the depCache
+    m_cacheModified = true;
+
     if (m_cache->DistUpgrade() == false) {
         m_cache->ShowBroken(false);
         g_debug("Internal error, DistUpgrade broke stuff");
@@ -1384,69 +1485,154 @@ PkgList AptIntf::checkChangedPackages(bool emitChanged)
 
 pkgCache::VerIterator AptIntf::findTransactionPackage(const std::string &name)
 {
-    for (const pkgCache::VerIterator &verIt : m_pkgs) {
-        if (verIt.ParentPkg().Name() == name) {
-            return verIt;
-        }
+    const auto it = m_transactionPkgs.find(name);
+    if (it != m_transactionPkgs.end()) {
+        return it->second;
     }
 
+    pkgCache::VerIterator ret;
     const pkgCache::PkgIterator &pkg = (*m_cache)->FindPkg(name);
     // Ignore packages that could not be found or that exist only due to dependencies.
-    if (pkg.end() == true ||
-            (pkg.VersionList().end() && pkg.ProvidesList().end())) {
-        return pkgCache::VerIterator();
-    }
-
-    const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
-    // check to see if the provided package isn't virtual too
-    if (ver.end() == false) {
-        return ver;
+    if (pkg.end() == false &&
+            (pkg.VersionList().end() == false || pkg.ProvidesList().end() == false)) {
+        ret = m_cache->findVer(pkg);
+        // check to see if the provided package isn't virtual too
+        if (ret.end() == true) {
+            // Return the last try anyway
+            ret = m_cache->findCandidateVer(pkg);
+        }
     }
 
-    const pkgCache::VerIterator &candidateVer = m_cache->findCandidateVer(pkg);
-
-    // Return the last try anyway
-    return candidateVer;
+    // the status fd mentions a package several times
+    m_transactionPkgs.emplace(name, ret);
+    return ret;
 }
 
-void AptIntf::updateInterface(int fd, int writeFd)
+// Splits a status fd line, "status:package:percent:message", in its fields
+static guint splitStatusLine(const std::string &line, std::string fields[4])
 {
-    char buf[2];
-    static char line[1024] = "";
-
-    while (1) {
-        // This algorithm should be improved (it's the same as the rpm one ;)
-        int len = read(fd, buf, 1);
-
-        // nothing was read
-        if(len < 1) {
+    guint count = 0;
+    size_t start = 0;
+    while (count < 4) {
+        size_t end = line.find(':', start);
+        size_t first = line.find_first_not_of(" \t\r\n\f\v", start);
+        size_t last = line.find_last_not_of(" \t\r\n\f\v",
+                                            end == string::npos ? string::npos : end - 1);
+        if (first < end && last != string::npos && last >= first) {
+            fields[count] = line.substr(first, last - first + 1);
+        }
+        ++count;
+        if (end == string::npos) {
             break;
         }
+        start = end + 1;
+    }
+    return count;
+}
 
-        // update the time we last saw some action
-        m_lastTermAction = time(NULL);
+void AptIntf::handleStatusLine(const std::string &line)
+{
+    if (m_cancel) {
+        kill(m_child_pid, SIGTERM);
+    }
+    //cout << "got line: " << line << endl;
 
-        if( buf[0] == '\n') {
-            if (m_cancel) {
-                kill(m_child_pid, SIGTERM);
+    std::string fields[4];
+    // major problem here, we got unexpected input. should _never_ happen
+    if (splitStatusLine(line, fields) < 2) {
+        return;
+    }
+    const char *status  = fields[0].c_str();
+    const std::string &pkg = fields[1];
+    const char *percent = fields[2].c_str();
+    const std::string &str = fields[3];
+
+    // Since PackageKit doesn't emulate finished anymore
+    // we need to manually do it here, as at this point
+    // dpkg doesn't process two packages at the same time
+    if (!m_lastPackage.empty() && m_lastPackage.compare(pkg) != 0) {
+        const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
+        if (!ver.end()) {
+            emitPackage(ver, PK_INFO_ENUM_FINISHED);
+        }
+        m_lastSubProgress = 0;
+    }
+
+    // first check for errors and conf-file prompts
+    if (strstr(status, "pmerror") != NULL) {
+        // error from dpkg
+        pk_backend_job_error_code(m_job,
+                                  PK_ERROR_ENUM_PACKAGE_FAILED_TO_INSTALL,
+                                  "Error while installing package: %s",
+                                  str.c_str());
+    } else if (strstr(status, "pmstatus") != NULL) {
+        // INSTALL & UPDATE
+        // - Running dpkg
+        // loops ALL
+        // -  0 Installing pkg (sometimes this is skiped)
+        // - 25 Preparing pkg
+        // - 50 Unpacking pkg
+        // - 75 Preparing to configure pkg
+        //   ** Some pkgs have
+        //   - Running post-installation
+        //   - Running dpkg
+        // reloops all
+        // -   0 Configuring pkg
+        // - +25 Configuring pkg (SOMETIMES)
+        // - 100 Installed pkg
+        // after all
+        // - Running post-installation
+
+        // REMOVE
+        // - Running dpkg
+        // loops
+        // - 25  Removing pkg
+        // - 50  Preparing for removal of pkg
+        // - 75  Removing pkg
+        // - 100 Removed pkg
+        // after all
+        // - Running post-installation
+
+        // Let's start parsing the status:
+        if (starts_with(str, "Preparing to configure")) {
+            // Preparing to Install/configure
+            // cout << "Found Preparing to configure! " << line << endl;
+            // The next item might be Configuring so better it be 100
+            m_lastSubProgress = 100;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_PREPARING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_SETUP, 75);
             }
-            //cout << "got line: " << line << endl;
-
-            gchar **split  = g_strsplit(line, ":",5);
-            gchar *status  = g_strstrip(split[0]);
-            gchar *pkg     = g_strstrip(split[1]);
-            gchar *percent = g_strstrip(split[2]);
-            gchar *str     = g_strdup(g_strstrip(split[3]));
-
-            // major problem here, we got unexpected input. should _never_ happen
-            if(!(pkg && status)) {
-                continue;
+        } else if (starts_with(str, "Preparing for removal")) {
+            // Preparing to Install/configure
+            // cout << "Found Preparing for removal! " << line << endl;
+            m_lastSubProgress = 50;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_REMOVING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_SETUP, m_lastSubProgress);
             }
-
-            // Since PackageKit doesn't emulate finished anymore
-            // we need to manually do it here, as at this point
-            // dpkg doesn't process two packages at the same time
-            if (!m_lastPackage.empty() && m_lastPackage.compare(pkg) != 0) {
+        } else if (starts_with(str, "Preparing")) {
+            // Preparing to Install/configure
+            // cout << "Found Preparing! " << line << endl;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_PREPARING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_SETUP, 25);
+            }
+        } else if (starts_with(str, "Unpacking")) {
+            // cout << "Found Unpacking! " << line << endl;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_DECOMPRESSING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_INSTALL, 50);
+            }
+        } else if (starts_with(str, "Configuring")) {
+            // Installing Package
+            // cout << "Found Configuring! " << line << endl;
+            if (m_lastSubProgress >= 100 && !m_lastPackage.empty()) {
+                // cout << "FINISH the last package: " << m_lastPackage << endl;
                 const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
                 if (!ver.end()) {
                     emitPackage(ver, PK_INFO_ENUM_FINISHED);
@@ -1454,170 +1640,122 @@ void AptIntf::updateInterface(int fd, int writeFd)
                 m_lastSubProgress = 0;
             }
 
-            // first check for errors and conf-file prompts
-            if (strstr(status, "pmerror") != NULL) {
-                // error from dpkg
-                pk_backend_job_error_code(m_job,
-                                          PK_ERROR_ENUM_PACKAGE_FAILED_TO_INSTALL,
-                                          "Error while installing package: %s",
-                                          str);
-            } else if (strstr(status, "pmstatus") != NULL) {
-                // INSTALL & UPDATE
-                // - Running dpkg
-                // loops ALL
-                // -  0 Installing pkg (sometimes this is skiped)
-                // - 25 Preparing pkg
-                // - 50 Unpacking pkg
-                // - 75 Preparing to configure pkg
-                //   ** Some pkgs have
-                //   - Running post-installation
-                //   - Running dpkg
-                // reloops all
-                // -   0 Configuring pkg
-                // - +25 Configuring pkg (SOMETIMES)
-                // - 100 Installed pkg
-                // after all
-                // - Running post-installation
-
-                // REMOVE
-                // - Running dpkg
-                // loops
-                // - 25  Removing pkg
-                // - 50  Preparing for removal of pkg
-                // - 75  Removing pkg
-                // - 100 Removed pkg
-                // after all
-                // - Running post-installation
-
-                // Let's start parsing the status:
-                if (starts_with(str, "Preparing to configure")) {
-                    // Preparing to Install/configure
-                    // cout << "Found Preparing to configure! " << line << endl;
-                    // The next item might be Configuring so better it be 100
-                    m_lastSubProgress = 100;
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_PREPARING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_SETUP, 75);
-                    }
-                } else if (starts_with(str, "Preparing for removal")) {
-                    // Preparing to Install/configure
-                    // cout << "Found Preparing for removal! " << line << endl;
-                    m_lastSubProgress = 50;
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_REMOVING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_SETUP, m_lastSubProgress);
-                    }
-                } else if (starts_with(str, "Preparing")) {
-                    // Preparing to Install/configure
-                    // cout << "Found Preparing! " << line << endl;
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_PREPARING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_SETUP, 25);
-                    }
-                } else if (starts_with(str, "Unpacking")) {
-                    // cout << "Found Unpacking! " << line << endl;
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_DECOMPRESSING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_INSTALL, 50);
-                    }
-                } else if (starts_with(str, "Configuring")) {
-                    // Installing Package
-                    // cout << "Found Configuring! " << line << endl;
-                    if (m_lastSubProgress >= 100 && !m_lastPackage.empty()) {
-                        // cout << "FINISH the last package: " << m_lastPackage << endl;
-                        const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
-                        if (!ver.end()) {
-                            emitPackage(ver, PK_INFO_ENUM_FINISHED);
-                        }
-                        m_lastSubProgress = 0;
-                    }
-
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_INSTALLING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_INSTALL, m_lastSubProgress);
-                    }
-                    m_lastSubProgress += 25;
-                } else if (starts_with(str, "Running dpkg")) {
-                    // cout << "Found Running dpkg! " << line << endl;
-                } else if (starts_with(str, "Running")) {
-                    // cout << "Found Running! " << line << endl;
-                    pk_backend_job_set_status (m_job, PK_STATUS_ENUM_COMMIT);
-                } else if (starts_with(str, "Installing")) {
-                    // cout << "Found Installing! " << line << endl;
-                    // FINISH the last package
-                    if (!m_lastPackage.empty()) {
-                        // cout << "FINISH the last package: " << m_lastPackage << endl;
-                        const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
-                        if (!ver.end()) {
-                            emitPackage(ver, PK_INFO_ENUM_FINISHED);
-                        }
-                    }
-                    m_lastSubProgress = 0;
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_INSTALLING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_INSTALL, m_lastSubProgress);
-                    }
-                } else if (starts_with(str, "Removing")) {
-                    // cout << "Found Removing! " << line << endl;
-                    if (m_lastSubProgress >= 100 && !m_lastPackage.empty()) {
-                        // cout << "FINISH the last package: " << m_lastPackage << endl;
-                        const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
-                        if (!ver.end()) {
-                            emitPackage(ver, PK_INFO_ENUM_FINISHED);
-                        }
-                    }
-                    m_lastSubProgress += 25;
-
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_REMOVING);
-                        emitPackageProgress(ver, PK_STATUS_ENUM_REMOVE, m_lastSubProgress);
-                    }
-                } else if (starts_with(str, "Installed") ||
-                           starts_with(str, "Removed")) {
-                    // cout << "Found FINISHED! " << line << endl;
-                    m_lastSubProgress = 100;
-                    const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
-                    if (!ver.end()) {
-                        emitPackage(ver, PK_INFO_ENUM_FINISHED);
-                        //                         emitPackageProgress(ver, m_lastSubProgress);
-                    }
-                } else {
-                    cout << ">>>Unmaped value<<< :" << line << endl;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_INSTALLING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_INSTALL, m_lastSubProgress);
+            }
+            m_lastSubProgress += 25;
+        } else if (starts_with(str, "Running dpkg")) {
+            // cout << "Found Running dpkg! " << line << endl;
+        } else if (starts_with(str, "Running")) {
+            // cout << "Found Running! " << line << endl;
+            pk_backend_job_set_status (m_job, PK_STATUS_ENUM_COMMIT);
+        } else if (starts_with(str, "Installing")) {
+            // cout << "Found Installing! " << line << endl;
+            // FINISH the last package
+            if (!m_lastPackage.empty()) {
+                // cout << "FINISH the last package: " << m_lastPackage << endl;
+                const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
+                if (!ver.end()) {
+                    emitPackage(ver, PK_INFO_ENUM_FINISHED);
                 }
-
-                if (!starts_with(str, "Running")) {
-                    m_lastPackage = pkg;
+            }
+            m_lastSubProgress = 0;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_INSTALLING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_INSTALL, m_lastSubProgress);
+            }
+        } else if (starts_with(str, "Removing")) {
+            // cout << "Found Removing! " << line << endl;
+            if (m_lastSubProgress >= 100 && !m_lastPackage.empty()) {
+                // cout << "FINISH the last package: " << m_lastPackage << endl;
+                const pkgCache::VerIterator &ver = findTransactionPackage(m_lastPackage);
+                if (!ver.end()) {
+                    emitPackage(ver, PK_INFO_ENUM_FINISHED);
                 }
-                m_startCounting = true;
-            } else {
-                m_startCounting = true;
             }
+            m_lastSubProgress += 25;
 
-            int val = atoi(percent);
-            //cout << "progress: " << val << endl;
-            pk_backend_job_set_percentage(m_job, val);
-
-            // clean-up
-            g_strfreev(split);
-            g_free(str);
-            line[0] = 0;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_REMOVING);
+                emitPackageProgress(ver, PK_STATUS_ENUM_REMOVE, m_lastSubProgress);
+            }
+        } else if (starts_with(str, "Installed") ||
+                   starts_with(str, "Removed")) {
+            // cout << "Found FINISHED! " << line << endl;
+            m_lastSubProgress = 100;
+            const pkgCache::VerIterator &ver = findTransactionPackage(pkg);
+            if (!ver.end()) {
+                emitPackage(ver, PK_INFO_ENUM_FINISHED);
+                //                         emitPackageProgress(ver, m_lastSubProgress);
+            }
         } else {
-            buf[1] = 0;
-            strcat(line, buf);
+            cout << ">>>Unmaped value<<< :" << line << endl;
+        }
+
+        if (!starts_with(str, "Running")) {
+            m_lastPackage = pkg;
+        }
+        m_startCounting = true;
+    } else {
+        m_startCounting = true;
+    }
+
+    int val = atoi(percent);
+    //cout << "progress: " << val << endl;
+    pk_backend_job_set_percentage(m_job, val);
+}
+
+void AptIntf::updateInterface(int fd, int writeFd)
+{
+    struct pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = m_ptyOpen ? writeFd : -1;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    // wait for the child to write something rather than polling on a timer
+    if (poll(fds, 2, STATUS_POLL_TIMEOUT) > 0) {
+        if (fds[1].revents != 0) {
+            // TODO: This is dpkg's raw output. Maybe save it for error-solving?
+            char masterbuf[1024];
+            ssize_t len;
+            while ((len = read(writeFd, masterbuf, sizeof(masterbuf))) > 0);
+            if (len == 0 || (errno != EAGAIN && errno != EINTR)) {
+                // the child closed the terminal, don't wake up for it anymore
+                m_ptyOpen = false;
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char buf[4096];
+            ssize_t len;
+            while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                // update the time we last saw some action
+                m_lastTermAction = time(NULL);
+
+                const char *start = buf;
+                const char *end = buf + len;
+                const char *newline;
+                while ((newline = static_cast<const char*>(memchr(start, '\n', end - start))) != NULL) {
+                    m_statusLine.append(start, newline - start);
+                    handleStatusLine(m_statusLine);
+                    m_statusLine.clear();
+                    start = newline + 1;
+                }
+                m_statusLine.append(start, end - start);
+            }
         }
     }
 
     time_t now = time(NULL);
 
     if(!m_startCounting) {
-        usleep(100000);
         // wait until we get the first message from apt
         m_lastTermAction = now;
     }
@@ -1628,9 +1766,6 @@ void AptIntf::updateInterface(int fd, int writeFd)
                   " seconds",m_terminalTimeout);
         m_lastTermAction = time(NULL);
     }
-
-    // sleep for a while to don't obcess over it
-    usleep(5000);
 }
 
 PkgList AptIntf::resolvePackageIds(gchar **package_ids, PkBitfield filters)
@@ -1713,10 +1848,20 @@ void AptIntf::refreshCache()
     // would be a waste of time for refreshCache(): nothing saved to disk.)
     // So does apt-get update, too.
 
+    // Whatever is pooled was built from the old lists
+    if (m_pool != nullptr) {
+        m_pool->invalidate("the cache was refreshed");
+    }
+
     // Ultimately, force the cache to be computed.
     if (m_cache->BuildCaches() == false) {
         return;
     }
+
+    // Have the searches start with up to date indexes
+    pk_backend_job_set_status(m_job, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+    AptSearchIndex::build(m_cache);
+    AptGstIndex::build(m_cache);
 }
 
 void AptIntf::markAutoInstalled(const PkgList &pkgs)
@@ -1824,6 +1969,12 @@ bool AptIntf::runTransaction(const PkgList &install, const PkgList &remove, cons
     // will just calculate the trusted packages
     const auto ret = installPackages(flags);
 
+    // The installed packages are about to differ from the pooled cache
+    if (m_pool != nullptr &&
+            !pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE)) {
+        m_pool->invalidate("packages were changed");
+    }
+
     if (g_file_test(REBOOT_REQUIRED, G_FILE_TEST_EXISTS)) {
         struct stat restartStat;
         g_stat(REBOOT_REQUIRED, &restartStat);
@@ -1971,6 +2122,12 @@ bool AptIntf::installPackages(PkBitfield flags)
         // Store the packages that are going to change
         // so we can emit them as we process it
         m_pkgs = checkChangedPackages(false);
+
+        // index them by name for the status fd parser
+        m_transactionPkgs.clear();
+        for (const pkgCache::VerIterator &ver : m_pkgs) {
+            m_transactionPkgs.emplace(ver.ParentPkg().Name(), ver);
+        }
     }
 
     // Download and check if we can continue
@@ -2079,14 +2236,16 @@ bool AptIntf::installPackages(PkBitfield flags)
     m_lastTermAction = time(NULL);
     m_startCounting = false;
 
+    m_statusLine.clear();
+    m_ptyOpen = true;
+
     // Check if the child died
     int ret;
-    char masterbuf[1024];
     while (waitpid(m_child_pid, &ret, WNOHANG) == 0) {
-        // TODO: This is dpkg's raw output. Maybe save it for error-solving?
-        while(read(pty_master, masterbuf, sizeof(masterbuf)) > 0);
         updateInterface(readFromChildFD[0], pty_master);
     }
+    // pick up the status lines written right before it exited
+    updateInterface(readFromChildFD[0], pty_master);
 
     close(readFromChildFD[0]);
     close(readFromChildFD[1]);
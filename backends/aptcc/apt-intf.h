@@ -33,6 +33,8 @@
 
 #include <pk-backend.h>
 
+#include <unordered_map>
+
 #include "pkg-list.h"
 #include "apt-sourceslist.h"
 
@@ -41,13 +43,20 @@
 class pkgProblemResolver;
 class Matcher;
 class AptCacheFile;
+class AptCachePool;
 class AptIntf
 {
 public:
-    AptIntf(PkBackendJob *job);
+    AptIntf(PkBackendJob *job, AptCachePool *pool = nullptr);
     ~AptIntf();
 
     bool init(gchar **localDebs = nullptr);
+
+    /**
+     * Whether jobs with this role only read the cache, so several
+     * of them can run at the same time
+     */
+    static bool canRunConcurrently(PkRoleEnum role);
     void cancel();
     bool cancelled() const;
 
@@ -164,6 +173,11 @@ public:
       */
     bool matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters);
 
+    /**
+      * Checks a package against filters already turned into VersionFlags
+      */
+    bool matchFlags(const pkgCache::VerIterator &ver, guint8 required, guint8 forbidden);
+
     /**
       * Returns the list of packages with the ones that passed the given filters
       */
@@ -220,26 +234,44 @@ public:
 private:
     void setEnvLocaleFromJob();
     bool matchesQueries(const vector<string> &queries, string s);
+    void appendSearchMatch(PkgList &output, const pkgCache::PkgIterator &pkg);
+    PkPackage* buildPackage(const pkgCache::VerIterator &ver, PkInfoEnum state);
+    void appendLibraryProviders(PkgList &output, const std::string &soname);
+    void walkDepends(PkgList &output,
+                     const std::vector<guint32> &ids,
+                     bool recursive,
+                     bool forward);
 
     /**
      *  interprets dpkg status fd
      */
     void updateInterface(int readFd, int writeFd);
+    void handleStatusLine(const std::string &line);
     PkgList checkChangedPackages(bool emitChanged);
     pkgCache::VerIterator findTransactionPackage(const std::string &name);
 
     AptCacheFile *m_cache;
+    AptCachePool *m_pool;
     PkBackendJob  *m_job;
     bool       m_cancel;
+    // m_cache goes back to m_pool when we are done
+    bool       m_pooled;
+    // the depCache marks were changed by this job
+    bool       m_cacheModified;
     struct stat m_restartStat;
 
     PkgList m_pkgs;
     PkgList m_restartPackages;
+    // m_pkgs by package name, plus the other packages the status fd mentioned
+    std::unordered_map<std::string, pkgCache::VerIterator> m_transactionPkgs;
 
     time_t     m_lastTermAction;
     string     m_lastPackage;
     uint       m_lastSubProgress;
     bool       m_startCounting;
+    // the status fd line read so far
+    string     m_statusLine;
+    bool       m_ptyOpen;
     bool       m_interactive;
 
     // when the internal terminal timesout after no activity
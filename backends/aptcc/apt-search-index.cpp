@@ -0,0 +1,501 @@
+/* apt-search-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-search-index.h"
+
+#include <apt-pkg/configuration.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include "apt-cache-file.h"
+
+#define SEARCH_INDEX_FILE    "pksearchidx.bin"
+#define SEARCH_INDEX_MAGIC   "PKSIDX\r\n"
+#define SEARCH_INDEX_VERSION 1
+
+struct AptSearchIndex::Header {
+    char    magic[8];
+    guint32 version;
+    guint32 entryCount;
+    guint64 fingerprint;
+    guint32 trigramCount;
+    guint32 padding;
+    guint64 entriesOffset;
+    guint64 trigramsOffset;
+    guint64 postingsOffset;
+    guint64 postingsSize;
+    guint64 textOffset;
+    guint64 textSize;
+};
+
+// The folded name, a newline and the folded description of one package
+struct AptSearchIndex::Entry {
+    guint32 pkgId;
+    guint32 textOffset;
+    guint32 nameLen;
+    guint32 textLen;
+};
+
+// Entry indexes are stored delta encoded as LEB128 varints
+struct AptSearchIndex::Trigram {
+    guint32 key;
+    guint32 count;
+    guint64 offset;
+};
+
+namespace {
+
+struct Posting {
+    std::string data;
+    guint32 last = 0;
+    guint32 count = 0;
+};
+
+GRecMutex buildMutex;
+
+void appendFolded(std::string &text, const char *str, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        text += g_ascii_tolower(str[i]);
+    }
+}
+
+void addTrigrams(std::vector<guint32> &keys, const char *str, size_t len)
+{
+    for (size_t i = 0; i + 2 < len; ++i) {
+        keys.push_back((guint8) str[i] << 16 | (guint8) str[i + 1] << 8 | (guint8) str[i + 2]);
+    }
+}
+
+void appendVarint(std::string &data, guint32 value)
+{
+    while (value >= 0x80) {
+        data += (char) (value | 0x80);
+        value >>= 7;
+    }
+    data += (char) value;
+}
+
+template<typename T>
+void appendStruct(std::string &data, const T &value)
+{
+    data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
+
+AptSearchIndex::AptSearchIndex() :
+    m_file(nullptr),
+    m_header(nullptr),
+    m_entries(nullptr),
+    m_text(nullptr),
+    m_trigrams(nullptr),
+    m_postings(nullptr),
+    m_cache(nullptr)
+{
+}
+
+AptSearchIndex::~AptSearchIndex()
+{
+    unmap();
+}
+
+std::string AptSearchIndex::indexPath()
+{
+    return _config->FindDir("Dir::Cache") + SEARCH_INDEX_FILE;
+}
+
+guint64 AptSearchIndex::fingerprint(pkgCache *cache, std::vector<pkgCache::Package*> *packages)
+{
+    // The descriptions change with the versions while the names stay the
+    // same, so mix in the cache files, which are written again whenever
+    // the lists or the installed packages change
+    guint64 sum = cache->HeaderP->PackageCount;
+    sum = sum * 1099511628211ULL + cache->HeaderP->VersionCount;
+    const std::string files[] = {
+        _config->FindFile("Dir::Cache::pkgcache"),
+        _config->FindFile("Dir::Cache::srcpkgcache"),
+    };
+    for (const std::string &file : files) {
+        struct stat buf;
+        if (file.empty() || stat(file.c_str(), &buf) != 0) {
+            continue;
+        }
+        sum = sum * 1099511628211ULL + buf.st_size;
+        sum = sum * 1099511628211ULL + buf.st_mtim.tv_sec * G_USEC_PER_SEC + buf.st_mtim.tv_nsec / 1000;
+    }
+
+    // The entries refer to packages by ID, make sure the IDs still
+    // point to the same names. Summed up, so the walk order doesn't matter.
+    if (packages != nullptr) {
+        packages->assign(cache->HeaderP->PackageCount, nullptr);
+    }
+
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
+        guint64 hash = 14695981039346656037ULL;
+        for (const char *c = pkg.Name(); *c != '\0'; ++c) {
+            hash = (hash ^ (guint8) *c) * 1099511628211ULL;
+        }
+        sum += (hash ^ pkg->ID) * 1099511628211ULL;
+
+        if (packages != nullptr && pkg->ID < packages->size()) {
+            (*packages)[pkg->ID] = &*pkg;
+        }
+    }
+    return sum;
+}
+
+bool AptSearchIndex::build(AptCacheFile *cache)
+{
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GRecMutexLocker) locker = g_rec_mutex_locker_new(&buildMutex);
+
+    pkgCache *pkgcache = cache->GetPkgCache();
+    if (pkgcache == nullptr) {
+        return false;
+    }
+
+    std::vector<Entry> entries;
+    std::string text;
+    std::unordered_map<guint32, Posting> postings;
+    std::vector<guint32> keys;
+    for (pkgCache::PkgIterator pkg = pkgcache->PkgBegin(); !pkg.end(); ++pkg) {
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+            continue;
+        }
+
+        Entry entry;
+        entry.pkgId = pkg->ID;
+        entry.textOffset = text.size();
+        appendFolded(text, pkg.Name(), strlen(pkg.Name()));
+        entry.nameLen = text.size() - entry.textOffset;
+
+        // Virtual packages are only found by their name
+        const pkgCache::VerIterator &ver = cache->findVer(pkg);
+        if (!ver.end()) {
+            const std::string &description = cache->getLongDescription(ver);
+            text += '\n';
+            appendFolded(text, description.data(), description.size());
+        }
+        entry.textLen = text.size() - entry.textOffset;
+
+        if (text.size() > G_MAXUINT32) {
+            g_warning("package descriptions are too large to be indexed");
+            return false;
+        }
+
+        // Don't index the trigrams spanning the name and the description
+        keys.clear();
+        addTrigrams(keys, text.data() + entry.textOffset, entry.nameLen);
+        if (entry.textLen > entry.nameLen) {
+            addTrigrams(keys,
+                        text.data() + entry.textOffset + entry.nameLen + 1,
+                        entry.textLen - entry.nameLen - 1);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        guint32 index = entries.size();
+        for (guint32 key : keys) {
+            Posting &posting = postings[key];
+            appendVarint(posting.data, index - posting.last);
+            posting.last = index;
+            posting.count++;
+        }
+        entries.push_back(entry);
+    }
+
+    keys.clear();
+    for (const auto &posting : postings) {
+        keys.push_back(posting.first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEARCH_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SEARCH_INDEX_VERSION;
+    header.entryCount = entries.size();
+    header.fingerprint = fingerprint(pkgcache, nullptr);
+    header.trigramCount = keys.size();
+    header.entriesOffset = sizeof(Header);
+    header.trigramsOffset = header.entriesOffset + entries.size() * sizeof(Entry);
+    header.postingsOffset = header.trigramsOffset + keys.size() * sizeof(Trigram);
+
+    std::string blob;
+    std::vector<Trigram> trigrams;
+    for (guint32 key : keys) {
+        const Posting &posting = postings[key];
+        Trigram trigram;
+        trigram.key = key;
+        trigram.count = posting.count;
+        trigram.offset = blob.size();
+        trigrams.push_back(trigram);
+        blob += posting.data;
+    }
+    postings.clear();
+
+    header.postingsSize = blob.size();
+    header.textOffset = header.postingsOffset + blob.size();
+    header.textSize = text.size();
+
+    std::string data;
+    data.reserve(header.textOffset + text.size());
+    appendStruct(data, header);
+    for (const Entry &entry : entries) {
+        appendStruct(data, entry);
+    }
+    for (const Trigram &trigram : trigrams) {
+        appendStruct(data, trigram);
+    }
+    data += blob;
+    data += text;
+
+    const std::string &path = indexPath();
+    if (!g_file_set_contents(path.c_str(), data.data(), data.size(), &error)) {
+        g_debug("failed to save the search index: %s", error->message);
+        return false;
+    }
+
+    g_debug("saved the search index for %u packages to %s", header.entryCount, path.c_str());
+    return true;
+}
+
+bool AptSearchIndex::open(AptCacheFile *cache, bool rebuild)
+{
+    pkgCache *pkgcache = cache->GetPkgCache();
+    if (pkgcache == nullptr) {
+        return false;
+    }
+
+    if (map(pkgcache) || !rebuild) {
+        return isOpen();
+    }
+
+    // Another job may have rebuilt it while we were waiting
+    g_autoptr(GRecMutexLocker) locker = g_rec_mutex_locker_new(&buildMutex);
+    if (map(pkgcache)) {
+        return true;
+    }
+
+    return build(cache) && map(pkgcache);
+}
+
+bool AptSearchIndex::isOpen() const
+{
+    return m_header != nullptr;
+}
+
+bool AptSearchIndex::map(pkgCache *cache)
+{
+    g_autoptr(GError) error = nullptr;
+
+    unmap();
+
+    const std::string &path = indexPath();
+    m_file = g_mapped_file_new(path.c_str(), FALSE, &error);
+    if (m_file == nullptr) {
+        g_debug("no search index: %s", error->message);
+        return false;
+    }
+
+    const char *contents = g_mapped_file_get_contents(m_file);
+    gsize size = g_mapped_file_get_length(m_file);
+    const Header *header = reinterpret_cast<const Header*>(contents);
+    if (size < sizeof(Header) ||
+            memcmp(header->magic, SEARCH_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != SEARCH_INDEX_VERSION ||
+            header->entriesOffset + header->entryCount * sizeof(Entry) > size ||
+            header->trigramsOffset + header->trigramCount * sizeof(Trigram) > size ||
+            header->postingsOffset + header->postingsSize > size ||
+            header->textOffset + header->textSize > size) {
+        g_debug("ignoring invalid search index %s", path.c_str());
+        unmap();
+        return false;
+    }
+
+    if (header->fingerprint != fingerprint(cache, &m_packages)) {
+        g_debug("ignoring search index built for another cache");
+        unmap();
+        return false;
+    }
+
+    m_header = header;
+    m_entries = reinterpret_cast<const Entry*>(contents + header->entriesOffset);
+    m_trigrams = reinterpret_cast<const Trigram*>(contents + header->trigramsOffset);
+    m_postings = reinterpret_cast<const guint8*>(contents + header->postingsOffset);
+    m_text = contents + header->textOffset;
+    m_cache = cache;
+    return true;
+}
+
+void AptSearchIndex::unmap()
+{
+    g_clear_pointer(&m_file, g_mapped_file_unref);
+    m_header = nullptr;
+    m_entries = nullptr;
+    m_trigrams = nullptr;
+    m_postings = nullptr;
+    m_text = nullptr;
+    m_cache = nullptr;
+    m_packages.clear();
+}
+
+const AptSearchIndex::Trigram* AptSearchIndex::findTrigram(guint32 key) const
+{
+    const Trigram *end = m_trigrams + m_header->trigramCount;
+    const Trigram *trigram = std::lower_bound(m_trigrams, end, key,
+                                              [](const Trigram &t, guint32 k) {
+        return t.key < k;
+    });
+    if (trigram == end || trigram->key != key || trigram->offset >= m_header->postingsSize) {
+        return nullptr;
+    }
+    return trigram;
+}
+
+bool AptSearchIndex::matches(const Entry &entry, const std::string &query, bool details) const
+{
+    if (entry.textOffset + entry.textLen > m_header->textSize) {
+        return false;
+    }
+
+    const char *name = m_text + entry.textOffset;
+    if (memmem(name, entry.nameLen, query.data(), query.size()) != nullptr) {
+        return true;
+    }
+
+    if (!details || entry.textLen <= entry.nameLen) {
+        return false;
+    }
+
+    const char *description = name + entry.nameLen + 1;
+    return memmem(description, entry.textLen - entry.nameLen - 1,
+                  query.data(), query.size()) != nullptr;
+}
+
+std::vector<pkgCache::PkgIterator> AptSearchIndex::search(const std::vector<std::string> &queries,
+                                                          bool details) const
+{
+    std::vector<pkgCache::PkgIterator> output;
+    if (!isOpen()) {
+        return output;
+    }
+
+    const guint8 *postingsEnd = m_postings + m_header->postingsSize;
+    std::vector<bool> hits(m_header->entryCount, false);
+    std::vector<guint32> keys;
+    std::vector<guint32> candidates;
+    std::vector<guint32> list;
+    std::vector<guint32> merged;
+    for (const std::string &query : queries) {
+        std::string folded;
+        appendFolded(folded, query.data(), query.size());
+
+        // Too short for a trigram, check every entry
+        if (folded.size() < 3) {
+            for (guint32 i = 0; i < m_header->entryCount; ++i) {
+                if (!hits[i] && matches(m_entries[i], folded, details)) {
+                    hits[i] = true;
+                }
+            }
+            continue;
+        }
+
+        keys.clear();
+        addTrigrams(keys, folded.data(), folded.size());
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        std::vector<const Trigram*> trigrams;
+        for (guint32 key : keys) {
+            const Trigram *trigram = findTrigram(key);
+            if (trigram == nullptr) {
+                trigrams.clear();
+                break;
+            }
+            trigrams.push_back(trigram);
+        }
+        if (trigrams.empty()) {
+            continue;
+        }
+
+        // Start with the rarest trigram so the candidate set stays small
+        std::sort(trigrams.begin(), trigrams.end(),
+                  [](const Trigram *a, const Trigram *b) {
+            return a->count < b->count;
+        });
+
+        candidates.clear();
+        for (const Trigram *trigram : trigrams) {
+            list.clear();
+            const guint8 *p = m_postings + trigram->offset;
+            guint32 index = 0;
+            for (guint32 i = 0; i < trigram->count && p < postingsEnd; ++i) {
+                guint32 delta = 0;
+                for (guint shift = 0; p < postingsEnd && shift < 32; shift += 7) {
+                    guint8 byte = *p++;
+                    delta |= (guint32) (byte & 0x7f) << shift;
+                    if (!(byte & 0x80)) {
+                        break;
+                    }
+                }
+                index += delta;
+                list.push_back(index);
+            }
+
+            if (trigram == trigrams.front()) {
+                candidates.swap(list);
+            } else {
+                merged.clear();
+                std::set_intersection(candidates.begin(), candidates.end(),
+                                      list.begin(), list.end(),
+                                      std::back_inserter(merged));
+                candidates.swap(merged);
+            }
+            if (candidates.empty()) {
+                break;
+            }
+        }
+
+        // The trigrams only narrow it down, check the actual text
+        for (guint32 i : candidates) {
+            if (i < m_header->entryCount && !hits[i] && matches(m_entries[i], folded, details)) {
+                hits[i] = true;
+            }
+        }
+    }
+
+    for (guint32 i = 0; i < m_header->entryCount; ++i) {
+        if (!hits[i]) {
+            continue;
+        }
+
+        guint32 id = m_entries[i].pkgId;
+        if (id < m_packages.size() && m_packages[id] != nullptr) {
+            output.push_back(pkgCache::PkgIterator(*m_cache, m_packages[id]));
+        }
+    }
+    return output;
+}
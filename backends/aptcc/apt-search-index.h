@@ -0,0 +1,94 @@
+/* apt-search-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_SEARCH_INDEX_H
+#define APT_SEARCH_INDEX_H
+
+#include <glib.h>
+
+#include <apt-pkg/pkgcache.h>
+
+#include <string>
+#include <vector>
+
+class AptCacheFile;
+
+/**
+ * Case folded trigram index over the package names and descriptions,
+ * so substring searches don't have to look up every package record.
+ *
+ * It is saved next to the apt caches and mapped at query time, entries
+ * are keyed by the pkgCache package ID so an index is only used with the
+ * cache it was built from.
+ */
+class AptSearchIndex
+{
+public:
+    AptSearchIndex();
+    ~AptSearchIndex();
+
+    /**
+     * Builds the index for the given cache and saves it
+     * @returns false if it could not be written
+     */
+    static bool build(AptCacheFile *cache);
+
+    /**
+     * Maps the saved index if it was built from the given cache
+     * @param rebuild build it first if it is missing or outdated
+     */
+    bool open(AptCacheFile *cache, bool rebuild = false);
+
+    bool isOpen() const;
+
+    /**
+     * Finds the packages whose name, or description if details is set,
+     * contains one of the queries, ignoring case
+     */
+    std::vector<pkgCache::PkgIterator> search(const std::vector<std::string> &queries,
+                                              bool details) const;
+
+    /**
+     * Identifies the cache the saved indexes were built from
+     * @param packages if set, filled with the packages by ID
+     */
+    static guint64 fingerprint(pkgCache *cache, std::vector<pkgCache::Package*> *packages);
+
+private:
+    struct Header;
+    struct Entry;
+    struct Trigram;
+
+    static std::string indexPath();
+    bool map(pkgCache *cache);
+    void unmap();
+    bool matches(const Entry &entry, const std::string &query, bool details) const;
+    const Trigram* findTrigram(guint32 key) const;
+
+    GMappedFile  *m_file;
+    const Header *m_header;
+    const Entry  *m_entries;
+    const char   *m_text;
+    const Trigram *m_trigrams;
+    const guint8 *m_postings;
+    pkgCache     *m_cache;
+    std::vector<pkgCache::Package*> m_packages;
+};
+
+#endif // APT_SEARCH_INDEX_H
@@ -29,7 +29,6 @@
 #include <glib/gstdio.h>
 
 #include <fstream>
-#include <regex>
 #include <map>
 
 static const std::map<std::string, PkGroupEnum> groups_map = {
@@ -403,6 +402,26 @@ bool utilRestartRequired(const string &packageName)
     return false;
 }
 
+// Lower case the string and replace every run of space, control and
+// punctuation characters by a single underscore
+static void sanitizeOriginPart(string &str)
+{
+    string::iterator out = str.begin();
+    bool replacing = false;
+    for (char c : str) {
+        if (g_ascii_isspace(c) || g_ascii_iscntrl(c) || g_ascii_ispunct(c)) {
+            if (!replacing) {
+                *out++ = '_';
+                replacing = true;
+            }
+        } else {
+            *out++ = g_ascii_tolower(c);
+            replacing = false;
+        }
+    }
+    str.erase(out, str.end());
+}
+
 string utilBuildPackageOriginId(pkgCache::VerFileIterator vf)
 {
     if (vf.File().Origin() == NULL)
@@ -443,14 +462,9 @@ string utilBuildPackageOriginId(pkgCache::VerFileIterator vf)
        // In particular the punctuations ',' and ';' may be used as list separators
        // so we must not have them appear in our package_ids as that would break
        // any number of higher level features.
-       std::transform(origin.begin(), origin.end(), origin.begin(), ::tolower);
-       origin = std::regex_replace(origin, std::regex("[[:space:][:cntrl:][:punct:]]+"), "_");
-
-       std::transform(suite.begin(), suite.end(), suite.begin(), ::tolower);
-       suite = std::regex_replace(suite, std::regex("[[:space:][:cntrl:][:punct:]]+"), "_");
-
-       std::transform(component.begin(), component.end(), component.begin(), ::tolower);
-       component = std::regex_replace(component, std::regex("[[:space:][:cntrl:][:punct:]]+"), "_");
+       sanitizeOriginPart(origin);
+       sanitizeOriginPart(suite);
+       sanitizeOriginPart(component);
 
        res = origin + "-" + suite + "-" + component;
     }
@@ -458,30 +472,39 @@ string utilBuildPackageOriginId(pkgCache::VerFileIterator vf)
     return res;
 }
 
-gchar* utilBuildPackageId(const pkgCache::VerIterator &ver)
+void utilBuildPackageId(string &buffer, const pkgCache::VerIterator &ver, const string &originId)
 {
-    gchar *package_id;
-    pkgCache::VerFileIterator vf = ver.FileList();
-
-    string data = "";
     const pkgCache::PkgIterator &pkg = ver.ParentPkg();
+
+    buffer.clear();
+    buffer.append(pkg.Name());
+    buffer.push_back(';');
+    if (ver.VerStr() != NULL) {
+        buffer.append(ver.VerStr());
+    }
+    buffer.push_back(';');
+    if (ver.Arch() != NULL) {
+        buffer.append(ver.Arch());
+    }
+    buffer.push_back(';');
     if (pkg->CurrentState == pkgCache::State::Installed && pkg.CurrentVer() == ver) {
         // when a package is installed, the data part of a package-id is "installed:<repo-id>"
-        data = "installed:" + utilBuildPackageOriginId(vf);
-    } else {
-        data = utilBuildPackageOriginId(vf);
+        buffer.append("installed:");
     }
+    buffer.append(originId);
+}
 
-    package_id = pk_package_id_build(ver.ParentPkg().Name(),
-                                     ver.VerStr(),
-                                     ver.Arch(),
-                                     data.c_str());
-    return package_id;
+gchar* utilBuildPackageId(const pkgCache::VerIterator &ver)
+{
+    string package_id;
+    utilBuildPackageId(package_id, ver, utilBuildPackageOriginId(ver.FileList()));
+    return g_strdup(package_id.c_str());
 }
 
 const char *utf8(const char *str)
 {
-    static char *_str = NULL;
+    // one buffer per thread as jobs may run concurrently
+    static GPrivate _str = G_PRIVATE_INIT(g_free);
     if (str == NULL) {
         return NULL;
     }
@@ -490,8 +513,6 @@ const char *utf8(const char *str)
         return str;
     }
 
-    g_free(_str);
-    _str = NULL;
-    _str = g_locale_to_utf8(str, -1, NULL, NULL, NULL);
-    return _str;
+    g_private_replace(&_str, g_locale_to_utf8(str, -1, NULL, NULL, NULL));
+    return static_cast<const char*>(g_private_get(&_str));
 }
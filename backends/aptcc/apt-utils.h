@@ -77,6 +77,12 @@ bool utilRestartRequired(const string &packageName);
   */
 gchar* utilBuildPackageId(const pkgCache::VerIterator &ver);
 
+/**
+  * Build a package id from the given package version and the origin id
+  * of its package file into buffer, replacing its previous content
+  */
+void utilBuildPackageId(string &buffer, const pkgCache::VerIterator &ver, const string &originId);
+
 /**
  * Build a unique repository origin, in the form of
  * {distro}-{suite}-{component}
@@ -22,16 +22,71 @@
 #include "apt-utils.h"
 
 #include <regex.h>
+#include <string.h>
 #include <gst/gst.h>
 
-static bool inited = false;
+static gsize inited = 0;
 
-GstMatcher::GstMatcher(gchar **values)
+static void initGst()
 {
-    if (!inited) {
+    if (g_once_init_enter(&inited)) {
         gst_init(NULL, NULL);
-        inited = true;
+        g_once_init_leave(&inited, 1);
+    }
+}
+
+static const char *gstTypes[] = {
+    "Gstreamer-Encoders: ",
+    "Gstreamer-Decoders: ",
+    "Gstreamer-Uri-Sources: ",
+    "Gstreamer-Uri-Sinks: ",
+    "Gstreamer-Elements: ",
+};
+
+GstProvides::GstProvides(const string &record, const string &arch) :
+    arch(arch)
+{
+    size_t found = record.find("\nGstreamer-Version: ");
+    if (found == string::npos) {
+        return;
+    }
+    version = record.substr(found, record.find('\n', found + 1) - found);
+
+    initGst();
+    for (const char *type : gstTypes) {
+        // Tries to find the type "Gstreamer-Uri-Sinks: "
+        found = record.find(type);
+        if (found == string::npos) {
+            continue;
+        }
+
+        found += strlen(type); // skips the "Gstreamer-Uri-Sinks: " string
+        size_t endOfLine;
+        endOfLine = record.find('\n', found);
+
+        GstCaps *gstCaps;
+        gstCaps = gst_caps_from_string(record.substr(found, endOfLine - found).c_str());
+        if (gstCaps != NULL) {
+            caps.push_back(make_pair(string(type), static_cast<void*>(gstCaps)));
+        }
+    }
+}
+
+GstProvides::~GstProvides()
+{
+    for (const pair<string, void*> &typeCaps : caps) {
+        gst_caps_unref(static_cast<GstCaps*>(typeCaps.second));
     }
+}
+
+bool GstProvides::isValid() const
+{
+    return !version.empty();
+}
+
+GstMatcher::GstMatcher(gchar **values)
+{
+    initGst();
 
     // The search term from PackageKit daemon:
     // gstreamer0.10(urisource-foobar)
@@ -136,31 +191,27 @@ GstMatcher::~GstMatcher()
 }
 
 bool GstMatcher::matches(string record, string arch)
+{
+    GstProvides provides(record, arch);
+    return provides.isValid() && matches(provides);
+}
+
+bool GstMatcher::matches(const GstProvides &provides) const
 {
     for (const Match &match : m_matches) {
         // Tries to find "Gstreamer-version: xxx"
-        if (record.find(match.version) != string::npos) {
-            size_t found;
-            if (!match.arch.empty() && arch != match.arch)
+        if (provides.version.find(match.version) != string::npos) {
+            if (!match.arch.empty() && provides.arch != match.arch)
                     continue;
-            found = record.find(match.type);
-            // Tries to find the type "Gstreamer-Uri-Sinks: "
-            if (found != string::npos) {
-                found += match.type.size(); // skips the "Gstreamer-Uri-Sinks: " string
-                size_t endOfLine;
-                endOfLine = record.find('\n', found);
-
-                GstCaps *caps;
-                caps = gst_caps_from_string(record.substr(found, endOfLine - found).c_str());
-                if (caps == NULL) {
+
+            for (const pair<string, void*> &typeCaps : provides.caps) {
+                if (typeCaps.first != match.type) {
                     continue;
                 }
 
                 // if the record is capable of intersect them we found the package
-                bool provides = gst_caps_can_intersect(static_cast<GstCaps*>(match.caps), caps);
-                gst_caps_unref(caps);
-
-                if (provides) {
+                if (gst_caps_can_intersect(static_cast<GstCaps*>(match.caps),
+                                           static_cast<GstCaps*>(typeCaps.second))) {
                     return true;
                 }
             }
@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <string>
+#include <utility>
 
 using namespace std;
 
@@ -37,6 +38,32 @@ typedef struct {
     string   arch;
 } Match;
 
+/**
+ * The GStreamer fields of a package record, with the capabilities
+ * already parsed so they can be matched many times
+ */
+class GstProvides
+{
+public:
+    GstProvides(const string &record, const string &arch);
+    ~GstProvides();
+
+    /**
+     * Returns false if the record has no Gstreamer-Version field
+     */
+    bool isValid() const;
+
+    // "\nGstreamer-Version: 1.0"
+    string version;
+    string arch;
+    // the first field of each type, e.g. "Gstreamer-Decoders: ", and its caps
+    vector<pair<string, void*> > caps;
+
+private:
+    GstProvides(const GstProvides &);
+    GstProvides& operator=(const GstProvides &);
+};
+
 class GstMatcher
 {
 public:
@@ -44,6 +71,7 @@ public:
     ~GstMatcher();
 
     bool matches(string record, string arch);
+    bool matches(const GstProvides &provides) const;
     bool hasMatches() const;
 
 private:
@@ -36,12 +36,14 @@
 
 #include "apt-intf.h"
 #include "apt-cache-file.h"
+#include "apt-cache-pool.h"
 #include "apt-messages.h"
 #include "acqpkitstatus.h"
 #include "apt-sourceslist.h"
 
 /* static bodges */
 static PkBackendSpawn *spawn;
+static AptCachePool *cachePool;
 
 const gchar* pk_backend_get_description(PkBackend *backend)
 {
@@ -56,8 +58,52 @@ const gchar* pk_backend_get_author(PkBackend *backend)
 gboolean
 pk_backend_supports_parallelization (PkBackend *backend)
 {
-    // we need to set this to TRUE as soon as the parallelization work is completed!
-    return FALSE;
+    // queries run side by side, see backend_thread_create()
+    return TRUE;
+}
+
+static void backend_cache_changed_cb(PkBackend *backend, gpointer user_data)
+{
+    cachePool->invalidate(static_cast<const gchar*>(user_data));
+}
+
+/**
+ * The locale is process wide, so a job that has to switch it can't run
+ * next to others. Only call this holding the cache lock, the locale is
+ * only changed by jobs holding it exclusively.
+ */
+static bool backend_job_changes_locale(PkBackendJob *job)
+{
+    const gchar *locale = pk_backend_job_get_locale(job);
+    return locale != NULL && g_strcmp0(g_getenv("LANG"), locale) != 0;
+}
+
+static void backend_job_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+    PkBackendJobThreadFunc func = reinterpret_cast<PkBackendJobThreadFunc>(user_data);
+    bool shared = AptIntf::canRunConcurrently(pk_backend_job_get_role(job));
+
+    cachePool->lock(job, shared);
+    if (shared && backend_job_changes_locale(job)) {
+        // wait for the jobs using the current locale to finish
+        cachePool->unlock(shared);
+        shared = false;
+        cachePool->lock(job, shared);
+    }
+    func(job, params, nullptr);
+    cachePool->unlock(shared);
+}
+
+/**
+ * Runs the job in a thread of its own, jobs that only read the cache run
+ * concurrently while the ones changing it wait for them and run alone
+ */
+static void backend_thread_create(PkBackendJob *job, PkBackendJobThreadFunc func)
+{
+    pk_backend_job_thread_create_concurrent(job,
+                                            backend_job_thread,
+                                            reinterpret_cast<gpointer>(func),
+                                            NULL);
 }
 
 void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
@@ -86,11 +132,37 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
     spawn = pk_backend_spawn_new(conf);
     //     pk_backend_spawn_set_job(spawn, backend);
     pk_backend_spawn_set_name(spawn, "aptcc");
+
+    // Keep the cache opened between query jobs, dropping it whenever
+    // the package database or the repositories change
+    cachePool = new AptCachePool;
+    g_signal_connect(backend, "installed-db-changed",
+                     G_CALLBACK(backend_cache_changed_cb), (gpointer) "the installed packages changed");
+    g_signal_connect(backend, "updates-changed",
+                     G_CALLBACK(backend_cache_changed_cb), (gpointer) "the updates changed");
+    g_signal_connect(backend, "repo-list-changed",
+                     G_CALLBACK(backend_cache_changed_cb), (gpointer) "the repo list changed");
+
+    // Nothing tells us when apt-get or rpm are run directly, so make the
+    // daemon check the same files before answering from its results cache
+    PkResultsCache *resultsCache = pk_backend_get_results_cache(backend);
+    for (const std::string &file : AptCacheFile::stampFileNames()) {
+        if (!file.empty()) {
+            pk_results_cache_add_stamp_file(resultsCache, file.c_str());
+        }
+    }
 }
 
 void pk_backend_destroy(PkBackend *backend)
 {
     g_debug("APTcc being destroyed");
+
+    // the handlers were connected with a different reason each, so only
+    // match on the function
+    g_signal_handlers_disconnect_matched(backend, G_SIGNAL_MATCH_FUNC, 0, 0,
+                                         NULL, (gpointer) backend_cache_changed_cb, NULL);
+    delete cachePool;
+    cachePool = nullptr;
 }
 
 PkBitfield pk_backend_get_groups(PkBackend *backend)
@@ -144,7 +216,7 @@ gchar** pk_backend_get_mime_types(PkBackend *backend)
 void pk_backend_start_job(PkBackend *backend, PkBackendJob *job)
 {
     /* create private state for this job */
-    AptIntf *apt = new AptIntf(job);
+    AptIntf *apt = new AptIntf(job, cachePool);
     pk_backend_job_set_user_data(job, apt);
 }
 
@@ -229,7 +301,7 @@ static void backend_depends_on_or_requires_thread(PkBackendJob *job, GVariant *p
 void pk_backend_depends_on(PkBackend *backend, PkBackendJob *job, PkBitfield filters,
                            gchar **package_ids, gboolean recursive)
 {
-    pk_backend_job_thread_create(job, backend_depends_on_or_requires_thread, NULL, NULL);
+    backend_thread_create(job, backend_depends_on_or_requires_thread);
 }
 
 void pk_backend_required_by(PkBackend *backend,
@@ -238,7 +310,7 @@ void pk_backend_required_by(PkBackend *backend,
                             gchar **package_ids,
                             gboolean recursive)
 {
-    pk_backend_job_thread_create(job, backend_depends_on_or_requires_thread, NULL, NULL);
+    backend_thread_create(job, backend_depends_on_or_requires_thread);
 }
 
 static void backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -270,12 +342,12 @@ static void backend_get_details_thread(PkBackendJob *job, GVariant *params, gpoi
 
 void pk_backend_get_update_detail(PkBackend *backend, PkBackendJob *job, gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_get_details_thread, NULL, NULL);
+    backend_thread_create(job, backend_get_details_thread);
 }
 
 void pk_backend_get_details(PkBackend *backend, PkBackendJob *job, gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_get_details_thread, NULL, NULL);
+    backend_thread_create(job, backend_get_details_thread);
 }
 
 static void backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -311,7 +383,7 @@ static void backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpoi
 
 void pk_backend_get_updates(PkBackend *backend, PkBackendJob *job, PkBitfield filters)
 {
-    pk_backend_job_thread_create(job, backend_get_updates_thread, NULL, NULL);
+    backend_thread_create(job, backend_get_updates_thread);
 }
 
 static void backend_what_provides_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -352,7 +424,7 @@ void pk_backend_what_provides(PkBackend *backend,
                               PkBitfield filters,
                               gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_what_provides_thread, NULL, NULL);
+    backend_thread_create(job, backend_what_provides_thread);
 }
 
 /**
@@ -468,7 +540,7 @@ void pk_backend_download_packages(PkBackend *backend,
                                   gchar **package_ids,
                                   const gchar *directory)
 {
-    pk_backend_job_thread_create(job, pk_backend_download_packages_thread, NULL, NULL);
+    backend_thread_create(job, pk_backend_download_packages_thread);
 }
 
 static void pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -497,7 +569,7 @@ static void pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params,
 
 void pk_backend_refresh_cache(PkBackend *backend, PkBackendJob *job, gboolean force)
 {
-    pk_backend_job_thread_create(job, pk_backend_refresh_cache_thread, NULL, NULL);
+    backend_thread_create(job, pk_backend_refresh_cache_thread);
 }
 
 static void pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -524,7 +596,7 @@ static void pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpoin
 
 void pk_backend_resolve(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **packages)
 {
-    pk_backend_job_thread_create(job, pk_backend_resolve_thread, NULL, NULL);
+    backend_thread_create(job, pk_backend_resolve_thread);
 }
 
 static void backend_search_groups_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -552,7 +624,7 @@ static void backend_search_groups_thread(PkBackendJob *job, GVariant *params, gp
 
 void pk_backend_search_groups(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_search_groups_thread, NULL, NULL);
+    backend_thread_create(job, backend_search_groups_thread);
 }
 
 static void backend_search_package_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -602,12 +674,12 @@ static void backend_search_package_thread(PkBackendJob *job, GVariant *params, g
 
 void pk_backend_search_names(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_search_package_thread, NULL, NULL);
+    backend_thread_create(job, backend_search_package_thread);
 }
 
 void pk_backend_search_details(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_search_package_thread, NULL, NULL);
+    backend_thread_create(job, backend_search_package_thread);
 }
 
 static void backend_manage_packages_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -697,7 +769,7 @@ void pk_backend_install_packages(PkBackend *backend,
                                  PkBitfield transaction_flags,
                                  gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_update_packages(PkBackend *backend,
@@ -705,7 +777,7 @@ void pk_backend_update_packages(PkBackend *backend,
                                 PkBitfield transaction_flags,
                                 gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_install_files(PkBackend *backend,
@@ -713,7 +785,7 @@ void pk_backend_install_files(PkBackend *backend,
                               PkBitfield transaction_flags,
                               gchar **full_paths)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_remove_packages(PkBackend *backend,
@@ -723,12 +795,12 @@ void pk_backend_remove_packages(PkBackend *backend,
                                 gboolean allow_deps,
                                 gboolean autoremove)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_repair_system(PkBackend *backend, PkBackendJob *job, PkBitfield transaction_flags)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_thread_create(job, backend_manage_packages_thread);
 }
 
 static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -865,12 +937,12 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
 
 void pk_backend_get_repo_list(PkBackend *backend, PkBackendJob *job, PkBitfield filters)
 {
-    pk_backend_job_thread_create(job, backend_repo_manager_thread, NULL, NULL);
+    backend_thread_create(job, backend_repo_manager_thread);
 }
 
 void pk_backend_repo_enable(PkBackend *backend, PkBackendJob *job, const gchar *repo_id, gboolean enabled)
 {
-    pk_backend_job_thread_create(job, backend_repo_manager_thread, NULL, NULL);
+    backend_thread_create(job, backend_repo_manager_thread);
 }
 
 void
@@ -880,7 +952,7 @@ pk_backend_repo_remove (PkBackend *backend,
                         const gchar *repo_id,
                         gboolean autoremove)
 {
-    pk_backend_job_thread_create(job, backend_repo_manager_thread, NULL, NULL);
+    backend_thread_create(job, backend_repo_manager_thread);
 }
 
 static void backend_get_packages_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -905,7 +977,7 @@ static void backend_get_packages_thread(PkBackendJob *job, GVariant *params, gpo
 
 void pk_backend_get_packages(PkBackend *backend, PkBackendJob *job, PkBitfield filters)
 {
-    pk_backend_job_thread_create(job, backend_get_packages_thread, NULL, NULL);
+    backend_thread_create(job, backend_get_packages_thread);
 }
 
 
@@ -49,45 +49,55 @@ public:
     }
 };
 
-/** \brief operator== for match results. */
-class result_equality
+PkgList::PkgList() :
+    m_indexed(0)
 {
-public:
-    result_equality() {}
-    
-    bool operator() (const pkgCache::VerIterator &a, const pkgCache::VerIterator &b) {
-        bool ret;
-        ret = strcmp(a.ParentPkg().Name(), b.ParentPkg().Name()) == 0 &&
-                strcmp(a.VerStr(), b.VerStr()) == 0 &&
-                strcmp(a.Arch(), b.Arch()) == 0;
-        if (ret) {
-            pkgCache::VerFileIterator aVF = a.FileList();
-            pkgCache::VerFileIterator bVF = b.FileList();
-            ret = strcmp(aVF.File().Archive() == NULL ? "" : aVF.File().Archive(),
-                         bVF.File().Archive() == NULL ? "" : bVF.File().Archive()) == 0;
+}
+
+void PkgList::updateIndex()
+{
+    for (; m_indexed < size(); ++m_indexed) {
+        const pkgCache::PkgIterator &pkg = (*this)[m_indexed].ParentPkg();
+        if (pkg->ID >= m_packages.size()) {
+            m_packages.resize(std::max<size_t>(pkg->ID + 1, m_packages.size() * 2), false);
         }
-        return ret;
+        m_packages[pkg->ID] = true;
     }
-};
+}
 
 bool PkgList::contains(const pkgCache::PkgIterator &pkg)
 {
-    for (const pkgCache::VerIterator &ver : *this) {
-        if (ver.ParentPkg() == pkg) {
-            return true;
-        }
-    }
-    return false;
+    updateIndex();
+    return pkg->ID < m_packages.size() && m_packages[pkg->ID];
 }
 
 void PkgList::sort()
 {
-    // Sort so we can remove the duplicated entries
+    // Index everything first, the sorted list holds the same packages
+    updateIndex();
+
     std::sort(begin(), end(), compare());
 }
 
 void PkgList::removeDuplicates()
 {
-    // Remove the duplicated entries
-    erase(unique(begin(), end(), result_equality()), end());
+    // The same version has the same ID, whichever way it was found
+    vector<bool> seen;
+    iterator last = begin();
+    for (iterator it = begin(); it != end(); ++it) {
+        const pkgCache::VerIterator &ver = *it;
+        if (ver->ID >= seen.size()) {
+            seen.resize(std::max<size_t>(ver->ID + 1, seen.size() * 2), false);
+        }
+        if (seen[ver->ID]) {
+            continue;
+        }
+        seen[ver->ID] = true;
+        *last++ = *it;
+    }
+    erase(last, end());
+
+    // Dropping entries changes the packages, not just their order
+    m_packages.clear();
+    m_indexed = 0;
 }
@@ -28,10 +28,16 @@ using std::vector;
 
 /**
  * This class is meant to show Operation Progress using PackageKit
+ *
+ * Next to the versions it keeps a bitmap indexed by Package::ID, so
+ * lookups are O(1). Only appended entries are tracked, anything else
+ * changing the list has to go through the methods below.
  */
 class PkgList : public vector<pkgCache::VerIterator>
 {
 public:
+    PkgList();
+
     /**
      * Return if the given vector contain a package
      */
@@ -43,9 +49,16 @@ public:
     void sort();
 
     /**
-     * Remove duplicated packages (it's recommended to sort() first)
+     * Remove duplicated packages, keeping the first occurrence of every
+     * version in place so the list doesn't have to be sorted first
      */
     void removeDuplicates();
+
+private:
+    void updateIndex();
+
+    vector<bool> m_packages;
+    size_t       m_indexed;
 };
 
 #endif // PKG_LIST_H
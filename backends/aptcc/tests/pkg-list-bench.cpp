@@ -0,0 +1,142 @@
+/* pkg-list-bench.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Compares the bitmap backed PkgList operations with the linear scans and
+ * the sort() + std::unique() deduplication they replace, on a list of every
+ * version in the system cache, each one added twice.
+ *
+ * Usage: pk-aptcc-pkg-list-bench [ROUNDS]
+ */
+
+#include <apt-pkg/cachefile.h>
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/error.h>
+#include <apt-pkg/init.h>
+#include <apt-pkg/pkgsystem.h>
+#include <apt-pkg/progress.h>
+
+#include <glib.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "pkg-list.h"
+
+// Sample every Nth package for the linear contains(), it's quadratic
+#define LINEAR_CONTAINS_STEP 100
+
+static bool linearContains(const PkgList &list, const pkgCache::PkgIterator &pkg)
+{
+    for (const pkgCache::VerIterator &ver : list) {
+        if (ver.ParentPkg() == pkg) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool sameResult(const pkgCache::VerIterator &a, const pkgCache::VerIterator &b)
+{
+    return strcmp(a.ParentPkg().Name(), b.ParentPkg().Name()) == 0 &&
+            strcmp(a.VerStr(), b.VerStr()) == 0 &&
+            strcmp(a.Arch(), b.Arch()) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    guint rounds = argc > 1 ? atoi(argv[1]) : 10;
+
+    if (!pkgInitConfig(*_config) || !pkgInitSystem(*_config, _system)) {
+        _error->DumpErrors();
+        return EXIT_FAILURE;
+    }
+
+    OpProgress progress;
+    pkgCacheFile cacheFile(false);
+    pkgCache *cache = cacheFile.GetPkgCache(progress);
+    if (cache == nullptr) {
+        _error->DumpErrors();
+        return EXIT_FAILURE;
+    }
+
+    PkgList list;
+    std::vector<pkgCache::PkgIterator> packages;
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
+        packages.push_back(pkg);
+        for (pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver) {
+            list.push_back(ver);
+        }
+    }
+    const PkgList once = list;
+    for (const pkgCache::VerIterator &ver : once) {
+        list.push_back(ver);
+    }
+
+    g_print("%zu packages, %zu list entries, %u rounds\n",
+            packages.size(), list.size(), rounds);
+
+    g_autoptr(GTimer) timer = g_timer_new();
+    gsize kept = 0;
+
+    g_timer_start(timer);
+    for (guint i = 0; i < rounds; ++i) {
+        PkgList copy = list;
+        copy.sort();
+        copy.erase(std::unique(copy.begin(), copy.end(), sameResult), copy.end());
+        kept = copy.size();
+    }
+    g_print("dedup, sort + unique:   %8.3f ms (%zu kept)\n",
+            g_timer_elapsed(timer, NULL) * 1000 / rounds, kept);
+
+    g_timer_start(timer);
+    for (guint i = 0; i < rounds; ++i) {
+        PkgList copy = list;
+        copy.removeDuplicates();
+        kept = copy.size();
+    }
+    g_print("dedup, bitmap:          %8.3f ms (%zu kept)\n",
+            g_timer_elapsed(timer, NULL) * 1000 / rounds, kept);
+
+    guint found = 0;
+    guint lookups = 0;
+    g_timer_start(timer);
+    for (size_t i = 0; i < packages.size(); i += LINEAR_CONTAINS_STEP) {
+        found += linearContains(list, packages[i]);
+        lookups++;
+    }
+    g_print("contains, linear:       %8.3f us per lookup (%u/%u found)\n",
+            g_timer_elapsed(timer, NULL) * G_USEC_PER_SEC / MAX(lookups, 1), found, lookups);
+
+    found = 0;
+    lookups = 0;
+    g_timer_start(timer);
+    for (guint i = 0; i < rounds; ++i) {
+        for (const pkgCache::PkgIterator &pkg : packages) {
+            found += list.contains(pkg);
+            lookups++;
+        }
+    }
+    g_print("contains, bitmap:       %8.3f us per lookup (%u/%u found)\n",
+            g_timer_elapsed(timer, NULL) * G_USEC_PER_SEC / MAX(lookups, 1), found, lookups);
+
+    return EXIT_SUCCESS;
+}
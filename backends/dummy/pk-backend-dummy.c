@@ -238,6 +238,7 @@ pk_backend_get_details (PkBackend *backend, PkBackendJob *job, gchar **package_i
 						"features, such as CMYK color, easy PDF creation, Encapsulated Postscript "
 						"import/export and creation of color separations.", "http://live.gnome.org/scribus", 44*1024*1024);
 		}
+		pk_backend_job_set_percentage (job, (i + 1) * 100 / len);
 	}
 	pk_backend_job_set_percentage (job, 100);
 	pk_backend_job_finished (job);
@@ -880,19 +881,67 @@ pk_backend_search_files (PkBackend *backend, PkBackendJob *job, PkBitfield filte
 void
 pk_backend_search_groups (PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
+	const gchar *package_ids[] = { "vips-doc;7.12.4-2.fc8;noarch;linva",
+				       "bǣwulf-utf8;0.1;noarch;hughsie",
+				       NULL };
+	const gchar *summaries[] = { "The vips documentation package.",
+				     "The bǣwulf server test name.",
+				     NULL };
+	guint i;
+	g_autoptr(GPtrArray) packages = NULL;
+
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 	pk_backend_job_set_allow_cancel (job, TRUE);
-	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
-				"vips-doc;7.12.4-2.fc8;noarch;linva",
-				"The vips documentation package.");
-	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
-				"bǣwulf-utf8;0.1;noarch;hughsie",
-				"The bǣwulf server test name.");
+
+	/* all at once, so the tests cover the Packages signal */
+	packages = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; package_ids[i] != NULL; i++) {
+		PkPackage *item = pk_package_new ();
+		pk_package_set_id (item, package_ids[i], NULL);
+		pk_package_set_info (item, PK_INFO_ENUM_AVAILABLE);
+		pk_package_set_summary (item, summaries[i]);
+		g_ptr_array_add (packages, item);
+	}
+	pk_backend_job_packages (job, packages);
 	pk_backend_job_finished (job);
 }
 
+/* how many searches are running at once, atomic as they run in threads */
+static gint search_names_in_flight = 0;
+static gint search_names_in_flight_max = 0;
+
 static void
-pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+pk_backend_search_names_in_flight_add (gint delta)
+{
+	gint in_flight;
+	gint max;
+
+	in_flight = g_atomic_int_add (&search_names_in_flight, delta) + delta;
+	do {
+		max = g_atomic_int_get (&search_names_in_flight_max);
+	} while (in_flight > max &&
+		 !g_atomic_int_compare_and_exchange (&search_names_in_flight_max, max, in_flight));
+}
+
+/**
+ * pk_backend_dummy_get_search_names_in_flight_max:
+ *
+ * Only here for the self test program to use, so it can check the
+ * searches really ran side by side.
+ *
+ * Return value: the most searches that were running at once since the
+ * last call
+ **/
+guint
+pk_backend_dummy_get_search_names_in_flight_max (void)
+{
+	gint max = g_atomic_int_get (&search_names_in_flight_max);
+	g_atomic_int_set (&search_names_in_flight_max, 0);
+	return (guint) max;
+}
+
+static void
+pk_backend_search_names_thread_run (PkBackendJob *job, GVariant *params)
 {
 	guint i;
 	const gchar *locale;
@@ -911,6 +960,19 @@ pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer us
 			       &search);
 	}
 
+	/* the first match is found straight away, so the self tests can
+	 * check it is replayed to transactions sharing the search */
+	locale = pk_backend_job_get_locale (job);
+	if (g_strcmp0 (locale, "en_GB.utf8") != 0) {
+		pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
+					"evince;0.9.3-5.fc8;i386;installed",
+					"PDF Dokument Ƥrŏgrȃɱ");
+	} else {
+		pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
+					"evince;0.9.3-5.fc8;i386;installed",
+					"PDF Document viewer");
+	}
+
 	/* delay, checking cancelled */
 	for (i = 0; i < 1000; i++) {
 		if (g_cancellable_is_cancelled (job_data->cancellable)) {
@@ -922,15 +984,12 @@ pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer us
 		g_usleep (2000);
 	}
 
-	locale = pk_backend_job_get_locale (job);
-	if (g_strcmp0 (locale, "en_GB.utf8") != 0) {
-		pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
-					"evince;0.9.3-5.fc8;i386;installed",
-					"PDF Dokument Ƥrŏgrȃɱ");
-	} else {
-		pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
-					"evince;0.9.3-5.fc8;i386;installed",
-					"PDF Document viewer");
+	/* so the self tests can check the failure reaches everyone */
+	if (search != NULL && g_strcmp0 (search[0], "fail") == 0) {
+		pk_backend_job_error_code (job,
+					   PK_ERROR_ENUM_INTERNAL_ERROR,
+					   "The search failed as asked");
+		return;
 	}
 	pk_backend_job_package (job, PK_INFO_ENUM_INSTALLED,
 				"tetex;3.0-41.fc8;i386;fedora",
@@ -943,6 +1002,14 @@ pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer us
 				"The vips documentation package.");
 }
 
+static void
+pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	pk_backend_search_names_in_flight_add (1);
+	pk_backend_search_names_thread_run (job, params);
+	pk_backend_search_names_in_flight_add (-1);
+}
+
 void
 pk_backend_search_names (PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
@@ -950,7 +1017,8 @@ pk_backend_search_names (PkBackend *backend, PkBackendJob *job, PkBitfield filte
 	pk_backend_job_set_allow_cancel (job, TRUE);
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 
-	pk_backend_job_thread_create (job, pk_backend_search_names_thread, NULL, NULL);
+	/* several searches may run at once, the self tests rely on it */
+	pk_backend_job_thread_create_concurrent (job, pk_backend_search_names_thread, NULL, NULL);
 }
 
 static void
@@ -783,6 +783,9 @@ class PackageKitPortageMixin(object):
 
 class PackageKitPortageBackend(PackageKitPortageMixin, PackageKitBaseBackend):
 
+    # search results are large, frames avoid escaping and splitting them
+    binary_framing = True
+
     # Portage <-> PackageKit groups map
     GROUP_MAP = {
         'accessibility': GROUP_ACCESSIBILITY,
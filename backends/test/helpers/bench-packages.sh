@@ -0,0 +1,19 @@
+#!/bin/sh
+#
+# Copyright (C) 2026 PackageKit contributors
+#
+# Licensed under the GNU General Public License Version 2
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# Writes lots of package lines as fast as possible, used by pk-spawn-bench
+
+awk -v count="${1:-100000}" 'BEGIN {
+	for (i = 0; i < count; i++)
+		printf "package\tavailable\tbench-%d;1.0-alt1;x86_64;Sisyphus\tBenchmark package %d\n", i, i
+	printf "finished\n"
+}'
+exit 0
@@ -0,0 +1,26 @@
+#!/bin/sh
+#
+# Licensed under the GNU General Public License Version 2
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# a dispatcher that answers every command with its own PID, so the tests
+# can tell which helper in the pool ran the job
+
+answer ()
+{
+	printf 'package\tavailable\tpool;0.0.1;noarch;test\t%s\n' "$$"
+	printf 'finished\n'
+}
+
+answer
+while read -r line; do
+	if [ "$line" = "exit" ]; then
+		exit 0
+	fi
+	answer
+done
+exit 0
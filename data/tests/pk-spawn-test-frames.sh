@@ -0,0 +1,26 @@
+#!/bin/sh
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# ask for binary framing, then write little endian length prefixed frames
+printf 'framing\tbinary\n'
+
+case "$1" in
+valid)
+	# percentage 50, then finished
+	printf '\004\000\000\000\006\00250'
+	printf '\001\000\000\000\002'
+	;;
+truncated)
+	# says 10 bytes, but only 4 follow
+	printf '\012\000\000\000\006\00250'
+	;;
+oversize)
+	# nothing after this can be parsed, so we should be killed
+	printf '\377\377\377\377\006\00250'
+	exec sleep 10
+	;;
+esac
@@ -66,6 +66,9 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	guint			 cache_age;
+	PkClientPackageFunc	 package_func;
+	gpointer		 package_user_data;
+	GDestroyNotify		 package_destroy;
 };
 
 enum {
@@ -545,6 +548,18 @@ pk_client_set_property_value (PkClientState *state,
 		return;
 	}
 
+	/* queue-wait-time */
+	if (g_strcmp0 (key, "QueueWaitTime") == 0) {
+		ret = pk_progress_set_queue_wait_time (state->progress,
+						       g_variant_get_uint32 (value));
+		if (ret && state->progress_callback != NULL) {
+			state->progress_callback (state->progress,
+						  PK_PROGRESS_TYPE_QUEUE_WAIT_TIME,
+						  state->progress_user_data);
+		}
+		return;
+	}
+
 	/* uid */
 	if (g_strcmp0 (key, "Uid") == 0) {
 		ret = pk_progress_set_uid (state->progress,
@@ -763,22 +778,28 @@ pk_client_signal_package (PkClientState *state,
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkPackage) package = NULL;
 
-	/* create virtual package */
-	package = pk_package_new ();
-	if (!pk_package_set_id (package, package_id, &error)) {
-		g_warning ("failed to set package id for %s", package_id);
-		return;
+	/* stream to the caller rather than keeping it, unless PkTask needs
+	 * the simulated packages to ask the user */
+	if (info_enum != PK_INFO_ENUM_FINISHED &&
+	    state->client->priv->package_func != NULL &&
+	    !pk_bitfield_contain (state->transaction_flags,
+				  PK_TRANSACTION_FLAG_ENUM_SIMULATE)) {
+		state->client->priv->package_func (state->tid,
+						   info_enum,
+						   package_id,
+						   summary,
+						   state->client->priv->package_user_data);
+	} else if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED) {
+		/* add to results, the package object is only created if needed */
+		if (!pk_results_add_package_id (state->results,
+						info_enum,
+						package_id,
+						summary,
+						state->transaction_id)) {
+			g_warning ("failed to set package id for %s", package_id);
+			return;
+		}
 	}
-	g_object_set (package,
-		      "info", info_enum,
-		      "summary", summary,
-		      "role", state->role,
-		      "transaction-id", state->transaction_id,
-		      NULL);
-
-	/* add to results */
-	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
-		pk_results_add_package (state->results, package);
 
 	/* only emit progress for verb packages */
 	switch (info_enum) {
@@ -793,6 +814,19 @@ pk_client_signal_package (PkClientState *state,
 	case PK_INFO_ENUM_PREPARING:
 	case PK_INFO_ENUM_DECOMPRESSING:
 	case PK_INFO_ENUM_FINISHED:
+		/* create virtual package */
+		package = pk_package_new ();
+		if (!pk_package_set_id (package, package_id, &error)) {
+			g_warning ("failed to set package id for %s", package_id);
+			return;
+		}
+		g_object_set (package,
+			      "info", info_enum,
+			      "summary", summary,
+			      "role", state->role,
+			      "transaction-id", state->transaction_id,
+			      NULL);
+
 		ret = pk_progress_set_package_id (state->progress, package_id);
 		if (state->progress_callback != NULL && ret) {
 			state->progress_callback (state->progress,
@@ -1092,6 +1126,21 @@ pk_client_signal_cb (GDBusProxy *proxy,
 					  tmp_str[2]);
 		return;
 	}
+	if (g_strcmp0 (signal_name, "Packages") == 0) {
+		GVariantIter *iter;
+		g_variant_get (parameters, "(a(uss))", &iter);
+		while (g_variant_iter_loop (iter, "(u&s&s)",
+					    &tmp_uint,
+					    &tmp_str[1],
+					    &tmp_str[2])) {
+			pk_client_signal_package (state,
+						  tmp_uint,
+						  tmp_str[1],
+						  tmp_str[2]);
+		}
+		g_variant_iter_free (iter);
+		return;
+	}
 	if (g_strcmp0 (signal_name, "Details") == 0) {
 		gchar *key;
 		GVariantIter *dictionary;
@@ -2070,6 +2119,10 @@ pk_client_get_proxy_cb (GObject *object,
 				pk_client_bool_to_string (state->client->priv->interactive));
 	g_ptr_array_add (array, hint);
 
+	/* we handle the Packages signal */
+	hint = g_strdup ("supports-packages=true");
+	g_ptr_array_add (array, hint);
+
 	/* cache-age */
 	if (state->client->priv->cache_age > 0) {
 		hint = g_strdup_printf ("cache-age=%u",
@@ -4887,6 +4940,46 @@ pk_client_get_cache_age (PkClient *client)
 	return client->priv->cache_age;
 }
 
+/**
+ * pk_client_set_package_func:
+ * @client: a valid #PkClient instance
+ * @func: (scope notified) (nullable): the function to call for each package, or %NULL
+ * @user_data: (closure func): data to pass to @func
+ * @destroy: (nullable): the function to free @user_data, or %NULL
+ *
+ * Passes the packages of the transactions to @func as soon as they are
+ * received, rather than collecting them in the #PkResults. This keeps the
+ * memory use constant for huge results, e.g. GetPackages or SearchFiles,
+ * and allows acting on the first package before the last one arrives.
+ *
+ * The packages of simulated transactions are still added to the results,
+ * as #PkTask needs them to ask the user about the transaction.
+ *
+ * @func is used for all the transactions of @client, including those
+ * already running. When several run at once, use the transaction ID
+ * passed to @func, which is also set on the #PkProgress of each call,
+ * to tell their packages apart.
+ *
+ * Since: 1.2.4
+ **/
+void
+pk_client_set_package_func (PkClient *client,
+			    PkClientPackageFunc func,
+			    gpointer user_data,
+			    GDestroyNotify destroy)
+{
+	PkClientPrivate *priv;
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	priv = client->priv;
+	if (priv->package_destroy != NULL)
+		priv->package_destroy (priv->package_user_data);
+	priv->package_func = func;
+	priv->package_user_data = user_data;
+	priv->package_destroy = destroy;
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4987,6 +5080,8 @@ pk_client_finalize (GObject *object)
 	g_free (client->priv->locale);
 	g_object_unref (priv->control);
 	g_ptr_array_unref (priv->calls);
+	if (priv->package_destroy != NULL)
+		priv->package_destroy (priv->package_user_data);
 
 	G_OBJECT_CLASS (pk_client_parent_class)->finalize (object);
 }
@@ -105,6 +105,24 @@ struct _PkClientClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkClientPackageFunc:
+ * @transaction_id: the transaction the package was received for
+ * @info: the #PkInfoEnum of the package
+ * @package_id: the package ID
+ * @summary: the package summary
+ * @user_data: the data passed to pk_client_set_package_func()
+ *
+ * The function called for each package received by the client.
+ *
+ * Since: 1.2.4
+ **/
+typedef void	(*PkClientPackageFunc)			(const gchar		*transaction_id,
+							 PkInfoEnum		 info,
+							 const gchar		*package_id,
+							 const gchar		*summary,
+							 gpointer		 user_data);
+
 GQuark		 pk_client_error_quark			(void);
 GType		 pk_client_get_type		  	(void);
 PkClient	*pk_client_new				(void);
@@ -429,6 +447,10 @@ gboolean	 pk_client_get_idle			(PkClient		*client);
 void		 pk_client_set_cache_age		(PkClient		*client,
 							 guint			 cache_age);
 guint		 pk_client_get_cache_age		(PkClient		*client);
+void		 pk_client_set_package_func		(PkClient		*client,
+							 PkClientPackageFunc	 func,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy);
 
 G_END_DECLS
 
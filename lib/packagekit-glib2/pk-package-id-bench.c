@@ -0,0 +1,128 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "pk-package-id.h"
+
+/* checks and splits package IDs the old way, with g_strsplit(), and then
+ * with pk_package_id_parse(), and reports how long each took */
+
+#define PK_PACKAGE_ID_BENCH_IDS		1000000
+
+/*
+ * pk_package_id_bench_split_old:
+ **/
+static gchar **
+pk_package_id_bench_split_old (const gchar *package_id)
+{
+	gchar **sections = NULL;
+
+	if (package_id == NULL)
+		goto out;
+	sections = g_strsplit (package_id, ";", -1);
+	if (g_strv_length (sections) != 4)
+		goto out;
+	if (sections[0][0] != '\0')
+		return sections;
+out:
+	g_strfreev (sections);
+	return NULL;
+}
+
+/*
+ * pk_package_id_bench_check_old:
+ **/
+static gboolean
+pk_package_id_bench_check_old (const gchar *package_id)
+{
+	g_auto(GStrv) sections = NULL;
+
+	if (package_id == NULL)
+		return FALSE;
+	if (!g_utf8_validate (package_id, -1, NULL))
+		return FALSE;
+	sections = pk_package_id_bench_split_old (package_id);
+	return sections != NULL;
+}
+
+static void
+pk_package_id_bench_report (const gchar *what, guint count, gdouble elapsed)
+{
+	g_print ("%-24s %u ids in %.3fs (%.0f ids/s)\n",
+		 what, count, elapsed,
+		 elapsed > 0 ? count / elapsed : 0.f);
+}
+
+int
+main (int argc, char **argv)
+{
+	guint count = PK_PACKAGE_ID_BENCH_IDS;
+	guint i;
+	guint valid = 0;
+	gsize len = 0;
+	PkPackageIdView view;
+	g_autoptr(GPtrArray) ids = NULL;
+	g_autoptr(GTimer) timer = NULL;
+
+	if (argc > 1)
+		count = (guint) atoi (argv[1]);
+
+	/* the shape of the IDs sent by the apt backends */
+	ids = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < count; i++) {
+		g_ptr_array_add (ids, g_strdup_printf ("package-%u;1:%u.%u-alt%u;x86_64;Sisyphus",
+						       i, i % 17, i % 5, i % 3 + 1));
+	}
+
+	timer = g_timer_new ();
+	for (i = 0; i < count; i++)
+		valid += pk_package_id_bench_check_old (g_ptr_array_index (ids, i));
+	pk_package_id_bench_report ("check (g_strsplit)", count, g_timer_elapsed (timer, NULL));
+
+	g_timer_start (timer);
+	for (i = 0; i < count; i++)
+		valid += pk_package_id_check (g_ptr_array_index (ids, i));
+	pk_package_id_bench_report ("check (parse)", count, g_timer_elapsed (timer, NULL));
+
+	g_timer_start (timer);
+	for (i = 0; i < count; i++) {
+		g_auto(GStrv) sections = pk_package_id_bench_split_old (g_ptr_array_index (ids, i));
+		len += strlen (sections[PK_PACKAGE_ID_NAME]);
+	}
+	pk_package_id_bench_report ("name (g_strsplit)", count, g_timer_elapsed (timer, NULL));
+
+	g_timer_start (timer);
+	for (i = 0; i < count; i++) {
+		pk_package_id_parse (g_ptr_array_index (ids, i), &view);
+		len += view.length[PK_PACKAGE_ID_NAME];
+	}
+	pk_package_id_bench_report ("name (parse)", count, g_timer_elapsed (timer, NULL));
+
+	/* so the loops are not optimized away */
+	g_debug ("%u valid, %" G_GSIZE_FORMAT " bytes of names", valid, len);
+	return valid == count * 2 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
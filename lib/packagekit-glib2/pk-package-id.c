@@ -27,10 +27,73 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <packagekit-glib2/pk-package-id.h>
 
+/*
+ * pk_package_id_parse_internal:
+ * @non_ascii: set to %TRUE if any byte was not ASCII
+ *
+ * Finds the sections in one pass over the string, without copying them.
+ **/
+static gboolean
+pk_package_id_parse_internal (const gchar *package_id,
+			      PkPackageIdView *view,
+			      gboolean *non_ascii)
+{
+	guchar high = 0;
+	guint cnt = 0;
+	gsize i;
+
+	if (package_id == NULL)
+		return FALSE;
+
+	view->package_id = package_id;
+	view->offset[0] = 0;
+	for (i = 0; package_id[i] != '\0'; i++) {
+		high |= (guchar) package_id[i];
+		if (package_id[i] != ';')
+			continue;
+		if (++cnt > 3)
+			return FALSE;
+		view->length[cnt - 1] = i - view->offset[cnt - 1];
+		view->offset[cnt] = i + 1;
+	}
+	if (cnt != 3)
+		return FALSE;
+	view->length[3] = i - view->offset[3];
+	if (non_ascii != NULL)
+		*non_ascii = (high & 0x80) != 0;
+
+	/* name has to be valid */
+	return view->length[PK_PACKAGE_ID_NAME] > 0;
+}
+
+/**
+ * pk_package_id_parse:
+ * @package_id: the ; delimited PackageID to parse
+ * @view: (out caller-allocates): the sections of @package_id
+ *
+ * Finds the sections of a PackageID, checking the correct number of
+ * delimiters are present. Unlike pk_package_id_split() nothing is
+ * allocated, and @view is only valid as long as @package_id is.
+ *
+ * The PackageID is not checked to be valid UTF-8.
+ *
+ * Return value: %TRUE if the PackageID could be parsed
+ *
+ * Since: 1.2.4
+ **/
+gboolean
+pk_package_id_parse (const gchar *package_id, PkPackageIdView *view)
+{
+	g_return_val_if_fail (view != NULL, FALSE);
+	return pk_package_id_parse_internal (package_id, view, NULL);
+}
+
 /**
  * pk_package_id_split:
  * @package_id: the ; delimited PackageID to split
@@ -45,22 +108,17 @@
 gchar **
 pk_package_id_split (const gchar *package_id)
 {
-	gchar **sections = NULL;
+	PkPackageIdView view;
+	gchar **sections;
+	guint i;
 
-	if (package_id == NULL)
-		goto out;
-
-	/* split by delimeter ';' */
-	sections = g_strsplit (package_id, ";", -1);
-	if (g_strv_length (sections) != 4)
-		goto out;
+	if (!pk_package_id_parse_internal (package_id, &view, NULL))
+		return NULL;
 
-	/* name has to be valid */
-	if (sections[0][0] != '\0')
-		return sections;
-out:
-	g_strfreev (sections);
-	return NULL;
+	sections = g_new0 (gchar *, 5);
+	for (i = 0; i < 4; i++)
+		sections[i] = g_strndup (package_id + view.offset[i], view.length[i]);
+	return sections;
 }
 
 /**
@@ -76,22 +134,16 @@ out:
 gboolean
 pk_package_id_check (const gchar *package_id)
 {
-	g_auto(GStrv) sections = NULL;
-	gboolean ret;
+	PkPackageIdView view;
+	gboolean non_ascii = FALSE;
 
-	/* NULL check */
-	if (package_id == NULL)
-		return FALSE;
-
-	/* UTF8 */
-	ret = g_utf8_validate (package_id, -1, NULL);
-	if (!ret)
+	/* NULL check and correct number of sections */
+	if (!pk_package_id_parse_internal (package_id, &view, &non_ascii))
 		return FALSE;
 
-	/* correct number of sections */
-	sections = pk_package_id_split (package_id);
-	if (sections == NULL)
-		return FALSE;
+	/* UTF8, which plain ASCII always is */
+	if (non_ascii)
+		return g_utf8_validate (package_id, -1, NULL);
 	return TRUE;
 }
 
@@ -125,25 +177,44 @@ pk_package_id_build (const gchar *name, const gchar *version,
  * pk_arch_base_ix86:
  **/
 static gboolean
-pk_arch_base_ix86 (const gchar *arch)
+pk_arch_base_ix86 (const gchar *arch, gsize len)
 {
-	if (g_strcmp0 (arch, "i386") == 0 ||
-	    g_strcmp0 (arch, "i486") == 0 ||
-	    g_strcmp0 (arch, "i586") == 0 ||
-	    g_strcmp0 (arch, "i686") == 0)
+	if (len == 4 &&
+	    arch[0] == 'i' &&
+	    arch[1] >= '3' && arch[1] <= '6' &&
+	    arch[2] == '8' && arch[3] == '6')
 		return TRUE;
 	return FALSE;
 }
 
+/*
+ * pk_package_id_view_section_equal:
+ **/
+static gboolean
+pk_package_id_view_section_equal (const PkPackageIdView *view1,
+				  const PkPackageIdView *view2,
+				  guint section)
+{
+	if (view1->length[section] != view2->length[section])
+		return FALSE;
+	return memcmp (view1->package_id + view1->offset[section],
+		       view2->package_id + view2->offset[section],
+		       view1->length[section]) == 0;
+}
+
 /*
  * pk_package_id_equal_fuzzy_arch_section:
  **/
 static gboolean
-pk_package_id_equal_fuzzy_arch_section (const gchar *arch1, const gchar *arch2)
+pk_package_id_equal_fuzzy_arch_section (const PkPackageIdView *view1,
+					const PkPackageIdView *view2)
 {
-	if (g_strcmp0 (arch1, arch2) == 0)
+	if (pk_package_id_view_section_equal (view1, view2, PK_PACKAGE_ID_ARCH))
 		return TRUE;
-	if (pk_arch_base_ix86 (arch1) && pk_arch_base_ix86 (arch2))
+	if (pk_arch_base_ix86 (view1->package_id + view1->offset[PK_PACKAGE_ID_ARCH],
+			       view1->length[PK_PACKAGE_ID_ARCH]) &&
+	    pk_arch_base_ix86 (view2->package_id + view2->offset[PK_PACKAGE_ID_ARCH],
+			       view2->length[PK_PACKAGE_ID_ARCH]))
 		return TRUE;
 	return FALSE;
 }
@@ -163,14 +234,15 @@ pk_package_id_equal_fuzzy_arch_section (const gchar *arch1, const gchar *arch2)
 gboolean
 pk_package_id_equal_fuzzy_arch (const gchar *package_id1, const gchar *package_id2)
 {
-	g_auto(GStrv) sections1 = NULL;
-	g_auto(GStrv) sections2 = NULL;
-
-	sections1 = pk_package_id_split (package_id1);
-	sections2 = pk_package_id_split (package_id2);
-	if (g_strcmp0 (sections1[0], sections2[0]) == 0 &&
-	    g_strcmp0 (sections1[1], sections2[1]) == 0 &&
-	    pk_package_id_equal_fuzzy_arch_section (sections1[2], sections2[2]))
+	PkPackageIdView view1;
+	PkPackageIdView view2;
+
+	if (!pk_package_id_parse_internal (package_id1, &view1, NULL) ||
+	    !pk_package_id_parse_internal (package_id2, &view2, NULL))
+		return FALSE;
+	if (pk_package_id_view_section_equal (&view1, &view2, PK_PACKAGE_ID_NAME) &&
+	    pk_package_id_view_section_equal (&view1, &view2, PK_PACKAGE_ID_VERSION) &&
+	    pk_package_id_equal_fuzzy_arch_section (&view1, &view2))
 		return TRUE;
 	return FALSE;
 }
@@ -188,31 +260,31 @@ pk_package_id_equal_fuzzy_arch (const gchar *package_id1, const gchar *package_i
 gchar *
 pk_package_id_to_printable (const gchar *package_id)
 {
-	g_auto(GStrv) parts = NULL;
-	gchar *value = NULL;
-	GString *string = NULL;
+	PkPackageIdView view;
+	GString *string;
 
 	/* invalid */
-	if (package_id == NULL)
-		goto out;
-
-	/* split */
-	parts = pk_package_id_split (package_id);
-	if (parts == NULL)
-		goto out;
+	if (!pk_package_id_parse_internal (package_id, &view, NULL))
+		return NULL;
 
 	/* name */
-	string = g_string_new (parts[PK_PACKAGE_ID_NAME]);
+	string = g_string_new_len (package_id + view.offset[PK_PACKAGE_ID_NAME],
+				   view.length[PK_PACKAGE_ID_NAME]);
 
 	/* version if present */
-	if (parts[PK_PACKAGE_ID_VERSION][0] != '\0')
-		g_string_append_printf (string, "-%s", parts[PK_PACKAGE_ID_VERSION]);
+	if (view.length[PK_PACKAGE_ID_VERSION] > 0) {
+		g_string_append_c (string, '-');
+		g_string_append_len (string,
+				     package_id + view.offset[PK_PACKAGE_ID_VERSION],
+				     view.length[PK_PACKAGE_ID_VERSION]);
+	}
 
 	/* arch if present */
-	if (parts[PK_PACKAGE_ID_ARCH][0] != '\0')
-		g_string_append_printf (string, ".%s", parts[PK_PACKAGE_ID_ARCH]);
-out:
-	if (string != NULL)
-		value = g_string_free (string, FALSE);
-	return value;
+	if (view.length[PK_PACKAGE_ID_ARCH] > 0) {
+		g_string_append_c (string, '.');
+		g_string_append_len (string,
+				     package_id + view.offset[PK_PACKAGE_ID_ARCH],
+				     view.length[PK_PACKAGE_ID_ARCH]);
+	}
+	return g_string_free (string, FALSE);
 }
@@ -58,11 +58,28 @@ G_BEGIN_DECLS
  */
 #define PK_PACKAGE_ID_DATA	3
 
+/**
+ * PkPackageIdView:
+ * @package_id: the PackageID that was parsed
+ * @offset: where each section starts in @package_id
+ * @length: the length of each section in bytes
+ *
+ * The sections of a PackageID, without copying them out of the string.
+ * Index @offset and @length with %PK_PACKAGE_ID_NAME and friends.
+ */
+typedef struct {
+	const gchar	*package_id;
+	gsize		 offset[4];
+	gsize		 length[4];
+} PkPackageIdView;
+
 gchar		*pk_package_id_build			(const gchar		*name,
 							 const gchar		*version,
 							 const gchar		*arch,
 							 const gchar		*data);
 gboolean	 pk_package_id_check			(const gchar		*package_id);
+gboolean	 pk_package_id_parse			(const gchar		*package_id,
+							 PkPackageIdView	*view);
 gchar		**pk_package_id_split			(const gchar		*package_id);
 gchar		*pk_package_id_to_printable		(const gchar		*package_id);
 gboolean	 pk_package_id_equal_fuzzy_arch		(const gchar		*package_id1,
@@ -30,6 +30,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib-object.h>
 #include <gio/gio.h>
 
@@ -51,11 +53,25 @@ static void     pk_package_sack_finalize	(GObject     *object);
  **/
 struct _PkPackageSackPrivate
 {
-	GHashTable		*table;
+	GHashTable		*table;		/* package_id : PkPackage */
+	GHashTable		*names;		/* name : GPtrArray of PkPackage */
 	GPtrArray		*array;
 	PkClient		*client;
+	guint			 batch_size;
+	guint			 max_parallel;
+	guint			 info_count[PK_INFO_ENUM_LAST];
+	gboolean		 info_count_valid;
+	guint64			 total_bytes;
+	gboolean		 total_bytes_valid;
 };
 
+/* the sort key of each package, looked up once rather than per comparison */
+typedef struct {
+	const gchar		*key;
+	PkInfoEnum		 info;
+	PkPackage		*package;
+} PkPackageSackSortItem;
+
 enum {
 	SIGNAL_CHANGED,
 	SIGNAL_LAST
@@ -63,6 +79,202 @@ enum {
 
 G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 
+/*
+ * pk_package_sack_index_keys:
+ *
+ * Adds the package to the lookup tables.
+ *
+ * The keys are copies, as the package ID and name can be changed with
+ * pk_package_set_id() while the package is in the sack.
+ **/
+static void
+pk_package_sack_index_keys (PkPackageSack *sack, PkPackage *package)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	GPtrArray *bucket;
+	const gchar *id;
+	const gchar *name;
+
+	id = pk_package_get_id (package);
+	if (id != NULL)
+		g_hash_table_replace (priv->table, g_strdup (id), (gpointer) package);
+
+	name = pk_package_get_name (package);
+	if (name != NULL) {
+		bucket = g_hash_table_lookup (priv->names, name);
+		if (bucket == NULL) {
+			bucket = g_ptr_array_new ();
+			g_hash_table_insert (priv->names, g_strdup (name), bucket);
+		}
+		g_ptr_array_add (bucket, package);
+	}
+}
+
+static gboolean
+pk_package_sack_table_remove_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	return value == user_data;
+}
+
+static gboolean
+pk_package_sack_names_remove_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	GPtrArray *bucket = (GPtrArray *) value;
+	g_ptr_array_remove (bucket, user_data);
+	return bucket->len == 0;
+}
+
+/*
+ * pk_package_sack_unindex_keys:
+ *
+ * Removes the package from the lookup tables.
+ **/
+static void
+pk_package_sack_unindex_keys (PkPackageSack *sack, PkPackage *package)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	GPtrArray *bucket = NULL;
+	const gchar *id;
+	const gchar *name;
+
+	id = pk_package_get_id (package);
+	if (id != NULL && g_hash_table_lookup (priv->table, id) == package) {
+		g_hash_table_remove (priv->table, id);
+	} else {
+		/* the ID is being changed, or it was replaced by another
+		 * package with the same ID */
+		g_hash_table_foreach_remove (priv->table,
+					     pk_package_sack_table_remove_cb,
+					     package);
+	}
+
+	name = pk_package_get_name (package);
+	if (name != NULL)
+		bucket = g_hash_table_lookup (priv->names, name);
+	if (bucket != NULL && g_ptr_array_remove (bucket, package)) {
+		if (bucket->len == 0)
+			g_hash_table_remove (priv->names, name);
+	} else {
+		/* the name is being changed */
+		g_hash_table_foreach_remove (priv->names,
+					     pk_package_sack_names_remove_cb,
+					     package);
+	}
+}
+
+/*
+ * pk_package_sack_notify_cb:
+ *
+ * The info and size are kept up to date incrementally, so recount them
+ * when they are changed behind our back, and move a package to its new
+ * keys when the ID is changed.
+ **/
+static void
+pk_package_sack_notify_cb (PkPackage *package, GParamSpec *pspec, PkPackageSack *sack)
+{
+	if (g_strcmp0 (pspec->name, "info") == 0) {
+		sack->priv->info_count_valid = FALSE;
+	} else if (g_strcmp0 (pspec->name, "size") == 0) {
+		sack->priv->total_bytes_valid = FALSE;
+	} else if (g_strcmp0 (pspec->name, "package-id") == 0) {
+		pk_package_sack_unindex_keys (sack, package);
+		pk_package_sack_index_keys (sack, package);
+	}
+}
+
+static guint64
+pk_package_sack_get_package_size (PkPackage *package)
+{
+	guint64 size = 0;
+	g_object_get (package, "size", &size, NULL);
+	return size;
+}
+
+/*
+ * pk_package_sack_index_package:
+ *
+ * Adds the package to the lookup tables and running totals.
+ **/
+static void
+pk_package_sack_index_package (PkPackageSack *sack, PkPackage *package)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	PkInfoEnum info;
+
+	pk_package_sack_index_keys (sack, package);
+
+	info = pk_package_get_info (package);
+	if (priv->info_count_valid && info < PK_INFO_ENUM_LAST)
+		priv->info_count[info]++;
+	if (priv->total_bytes_valid)
+		priv->total_bytes += pk_package_sack_get_package_size (package);
+	g_signal_connect (package, "notify",
+			  G_CALLBACK (pk_package_sack_notify_cb), sack);
+}
+
+/*
+ * pk_package_sack_unindex_package:
+ *
+ * Removes the package from the lookup tables and running totals, which
+ * has to be done before the sack drops its reference.
+ **/
+static void
+pk_package_sack_unindex_package (PkPackageSack *sack, PkPackage *package)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	PkInfoEnum info;
+	gulong handler_id;
+
+	/* the same package may have been added more than once */
+	handler_id = g_signal_handler_find (package,
+					    G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
+					    0, 0, NULL,
+					    pk_package_sack_notify_cb,
+					    sack);
+	if (handler_id != 0)
+		g_signal_handler_disconnect (package, handler_id);
+
+	pk_package_sack_unindex_keys (sack, package);
+
+	info = pk_package_get_info (package);
+	if (priv->info_count_valid && info < PK_INFO_ENUM_LAST)
+		priv->info_count[info]--;
+	if (priv->total_bytes_valid)
+		priv->total_bytes -= pk_package_sack_get_package_size (package);
+}
+
+static void
+pk_package_sack_ensure_info_count (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	PkInfoEnum info;
+	guint i;
+
+	if (priv->info_count_valid)
+		return;
+	memset (priv->info_count, 0, sizeof (priv->info_count));
+	for (i = 0; i < priv->array->len; i++) {
+		info = pk_package_get_info (g_ptr_array_index (priv->array, i));
+		if (info < PK_INFO_ENUM_LAST)
+			priv->info_count[info]++;
+	}
+	priv->info_count_valid = TRUE;
+}
+
+static void
+pk_package_sack_ensure_total_bytes (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	guint i;
+
+	if (priv->total_bytes_valid)
+		return;
+	priv->total_bytes = 0;
+	for (i = 0; i < priv->array->len; i++)
+		priv->total_bytes += pk_package_sack_get_package_size (g_ptr_array_index (priv->array, i));
+	priv->total_bytes_valid = TRUE;
+}
+
 /**
  * pk_package_sack_clear:
  * @sack: a valid #PkPackageSack instance
@@ -74,10 +286,24 @@ G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 void
 pk_package_sack_clear (PkPackageSack *sack)
 {
+	PkPackageSackPrivate *priv;
+	guint i;
+
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
 
-	g_ptr_array_set_size (sack->priv->array, 0);
-	g_hash_table_remove_all (sack->priv->table);
+	priv = sack->priv;
+	for (i = 0; i < priv->array->len; i++) {
+		g_signal_handlers_disconnect_by_func (g_ptr_array_index (priv->array, i),
+						      pk_package_sack_notify_cb,
+						      sack);
+	}
+	g_ptr_array_set_size (priv->array, 0);
+	g_hash_table_remove_all (priv->table);
+	g_hash_table_remove_all (priv->names);
+	memset (priv->info_count, 0, sizeof (priv->info_count));
+	priv->info_count_valid = TRUE;
+	priv->total_bytes = 0;
+	priv->total_bytes_valid = TRUE;
 }
 
 /**
@@ -161,8 +387,8 @@ pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 {
 	PkPackageSack *results;
 	PkPackage *package;
-	PkInfoEnum info_tmp;
 	guint i;
+	guint remaining = 0;
 	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
@@ -170,12 +396,18 @@ pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 	/* create new sack */
 	results = pk_package_sack_new ();
 
+	/* we know how many there are, so stop when they have been found */
+	pk_package_sack_ensure_info_count (sack);
+	if (info < PK_INFO_ENUM_LAST)
+		remaining = priv->info_count[info];
+
 	/* add each that matches the info enum */
-	for (i = 0; i < priv->array->len; i++) {
+	for (i = 0; remaining > 0 && i < priv->array->len; i++) {
 		package = g_ptr_array_index (priv->array, i);
-		info_tmp = pk_package_get_info (package);
-		if (info_tmp == info)
+		if (pk_package_get_info (package) == info) {
 			pk_package_sack_add_package (results, package);
+			remaining--;
+		}
 	}
 
 	return results;
@@ -237,9 +469,7 @@ pk_package_sack_add_package (PkPackageSack *sack, PkPackage *package)
 	/* add to array */
 	g_ptr_array_add (sack->priv->array,
 			 g_object_ref (package));
-	g_hash_table_insert (sack->priv->table,
-			     (gpointer) pk_package_get_id (package),
-			     (gpointer) package);
+	pk_package_sack_index_package (sack, package);
 
 	return TRUE;
 }
@@ -414,8 +644,12 @@ pk_package_sack_remove_package (PkPackageSack *sack, PkPackage *package)
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
+	/* not ours */
+	if (!g_ptr_array_find (sack->priv->array, package, NULL))
+		return FALSE;
+
 	/* remove from array */
-	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
+	pk_package_sack_unindex_package (sack, package);
 	return g_ptr_array_remove (sack->priv->array, package);
 }
 
@@ -436,21 +670,14 @@ pk_package_sack_remove_package_by_id (PkPackageSack *sack,
 				      const gchar *package_id)
 {
 	PkPackage *package;
-	guint i;
-	GPtrArray *array;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (package_id != NULL, FALSE);
 
-	array = sack->priv->array;
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		if (g_strcmp0 (package_id, pk_package_get_id (package)) == 0) {
-			pk_package_sack_remove_package (sack, package);
-			return TRUE;
-		}
-	}
-	return FALSE;
+	package = g_hash_table_lookup (sack->priv->table, package_id);
+	if (package == NULL)
+		return FALSE;
+	return pk_package_sack_remove_package (sack, package);
 }
 
 /**
@@ -471,26 +698,35 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 				  PkPackageSackFilterFunc filter_cb,
 				  gpointer user_data)
 {
-	gboolean ret = FALSE;
 	PkPackage *package;
-	gint i;
+	guint i;
+	guint kept = 0;
 	PkPackageSackPrivate *priv = sack->priv;
+	g_autoptr(GPtrArray) removed = NULL;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (filter_cb != NULL, FALSE);
 
-	/* add each that matches the info enum */
-	for (i = 0; i < (gint) priv->array->len; i++) {
+	/* move the ones to keep to the front in one pass, rather than
+	 * removing each one from the middle of the array */
+	removed = g_ptr_array_new ();
+	for (i = 0; i < priv->array->len; i++) {
 		package = g_ptr_array_index (priv->array, i);
-		if (!filter_cb (package, user_data)) {
-			ret = TRUE;
-			pk_package_sack_remove_package (sack, package);
-
-			/* ensure we pick up subsequent matches */
-			i--;
+		if (filter_cb (package, user_data)) {
+			priv->array->pdata[kept++] = package;
+			continue;
 		}
+		pk_package_sack_unindex_package (sack, package);
+		g_ptr_array_add (removed, package);
 	}
-	return ret;
+	if (removed->len == 0)
+		return FALSE;
+
+	/* the array drops its references to the removed ones */
+	for (i = 0; i < removed->len; i++)
+		priv->array->pdata[kept + i] = g_ptr_array_index (removed, i);
+	g_ptr_array_remove_range (priv->array, kept, removed->len);
+	return TRUE;
 }
 
 /**
@@ -535,6 +771,7 @@ pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 PkPackage *
 pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_id)
 {
+	GPtrArray *bucket;
 	PkPackage *pkg_tmp;
 	guint i;
 	g_auto(GStrv) split = NULL;
@@ -546,11 +783,14 @@ pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_
 	split = pk_package_id_split (package_id);
 	if (split == NULL)
 		return NULL;
-	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg_tmp = g_ptr_array_index (sack->priv->array, i);
-		if (g_strcmp0 (pk_package_get_name (pkg_tmp),
-			       split[PK_PACKAGE_ID_NAME]) == 0 &&
-		    g_strcmp0 (pk_package_get_arch (pkg_tmp),
+	bucket = g_hash_table_lookup (sack->priv->names, split[PK_PACKAGE_ID_NAME]);
+	if (bucket == NULL)
+		return NULL;
+
+	/* only the packages with the same name are left to check */
+	for (i = 0; i < bucket->len; i++) {
+		pkg_tmp = g_ptr_array_index (bucket, i);
+		if (g_strcmp0 (pk_package_get_arch (pkg_tmp),
 			       split[PK_PACKAGE_ID_ARCH]) == 0) {
 			return g_object_ref (pkg_tmp);
 		}
@@ -559,62 +799,27 @@ pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_
 }
 
 /*
- * pk_package_sack_sort_compare_name_func:
+ * pk_package_sack_sort_compare_key_func:
  **/
 static gint
-pk_package_sack_sort_compare_name_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_key_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	const gchar *package_id1;
-	const gchar *package_id2;
-	g_auto(GStrv) split1 = NULL;
-	g_auto(GStrv) split2 = NULL;
-
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	split1 = pk_package_id_split (package_id1);
-	split2 = pk_package_id_split (package_id2);
-	return g_strcmp0 (split1[PK_PACKAGE_ID_NAME], split2[PK_PACKAGE_ID_NAME]);
-}
-
-/*
- * pk_package_sack_sort_compare_package_id_func:
- **/
-static gint
-pk_package_sack_sort_compare_package_id_func (PkPackage **a, PkPackage **b)
-{
-	const gchar *package_id1;
-	const gchar *package_id2;
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	return g_strcmp0 (package_id1, package_id2);
-}
-
-/*
- * pk_package_sack_sort_compare_summary_func:
- **/
-static gint
-pk_package_sack_sort_compare_summary_func (PkPackage **a, PkPackage **b)
-{
-	const gchar *summary1;
-	const gchar *summary2;
-	summary1 = pk_package_get_summary (*a);
-	summary2 = pk_package_get_summary (*b);
-	return g_strcmp0 (summary1, summary2);
+	const PkPackageSackSortItem *item1 = a;
+	const PkPackageSackSortItem *item2 = b;
+	return g_strcmp0 (item1->key, item2->key);
 }
 
 /*
  * pk_package_sack_sort_compare_info_func:
  **/
 static gint
-pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_info_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	PkInfoEnum info1;
-	PkInfoEnum info2;
-	info1 = pk_package_get_info (*a);
-	info2 = pk_package_get_info (*b);
-	if (info1 == info2)
+	const PkPackageSackSortItem *item1 = a;
+	const PkPackageSackSortItem *item2 = b;
+	if (item1->info == item2->info)
 		return 0;
-	else if (info1 > info2)
+	else if (item1->info > item2->info)
 		return -1;
 	return 1;
 }
@@ -631,15 +836,41 @@ pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
 void
 pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 {
+	GPtrArray *array;
+	GCompareDataFunc func = pk_package_sack_sort_compare_key_func;
+	PkPackage *package;
+	guint i;
+	g_autofree PkPackageSackSortItem *items = NULL;
+
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
-	if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_name_func);
-	else if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_package_id_func);
-	else if (type == PK_PACKAGE_SACK_SORT_TYPE_SUMMARY)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_summary_func);
-	else if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_info_func);
+
+	if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
+		func = pk_package_sack_sort_compare_info_func;
+	else if (type != PK_PACKAGE_SACK_SORT_TYPE_NAME &&
+		 type != PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID &&
+		 type != PK_PACKAGE_SACK_SORT_TYPE_SUMMARY)
+		return;
+
+	/* get each key once, then sort the keys */
+	array = sack->priv->array;
+	items = g_new (PkPackageSackSortItem, array->len);
+	for (i = 0; i < array->len; i++) {
+		package = g_ptr_array_index (array, i);
+		items[i].package = package;
+		items[i].key = NULL;
+		items[i].info = PK_INFO_ENUM_UNKNOWN;
+		if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME)
+			items[i].key = pk_package_get_name (package);
+		else if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
+			items[i].key = pk_package_get_id (package);
+		else if (type == PK_PACKAGE_SACK_SORT_TYPE_SUMMARY)
+			items[i].key = pk_package_get_summary (package);
+		else
+			items[i].info = pk_package_get_info (package);
+	}
+	g_qsort_with_data (items, array->len, sizeof (PkPackageSackSortItem), func, NULL);
+	for (i = 0; i < array->len; i++)
+		array->pdata[i] = items[i].package;
 }
 
 /**
@@ -655,24 +886,11 @@ pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 guint64
 pk_package_sack_get_total_bytes (PkPackageSack *sack)
 {
-	PkPackage *package = NULL;
-	guint i;
-	GPtrArray *array;
-	guint64 bytes = 0;
-	guint64 bytes_tmp = 0;
-
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 
-	array = sack->priv->array;
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		g_object_get (package,
-			      "size", &bytes_tmp,
-			      NULL);
-		bytes += bytes_tmp;
-	}
-
-	return bytes;
+	/* only counted again if a size was changed */
+	pk_package_sack_ensure_total_bytes (sack);
+	return sack->priv->total_bytes;
 }
 
 /*
@@ -704,8 +922,54 @@ typedef struct {
 	GCancellable		*cancellable;
 	gboolean		 ret;
 	GSimpleAsyncResult	*res;
+	PkRoleEnum		 role;
+	PkProgressCallback	 progress_callback;
+	gpointer		 progress_user_data;
+	gchar			**package_ids;
+	guint			 package_ids_len;
+	guint			 chunk_size;
+	guint			 chunks;
+	guint			 chunks_started;
+	guint			 chunks_running;
+	guint			 merged;
+	GError			*error;
 } PkPackageSackState;
 
+static void pk_package_sack_state_dispatch (PkPackageSackState *state);
+
+/**
+ * pk_package_sack_set_batch_size:
+ * @sack: a valid #PkPackageSack instance
+ * @batch_size: the most package IDs to send in one transaction, or 0
+ * @max_parallel: the most transactions to have running at once, or 0
+ *
+ * Splits the resolve, details and update detail queries into several
+ * transactions, which keeps each D-Bus message small for large sacks.
+ * Each batch is merged into the sack as soon as it finishes.
+ *
+ * Up to @max_parallel batches are sent at once; the daemon still runs
+ * them one after the other if the backend cannot run them in parallel.
+ *
+ * Progress is not combined: the progress callback gets the #PkProgress of
+ * each batch's own transaction, so the percentage goes from 0 to 100 once
+ * per batch. Use the transaction ID of the progress to tell them apart.
+ *
+ * If a batch fails no more are started, and the error is returned once
+ * the batches already running have finished. The results of the batches
+ * that succeeded stay merged into the sack.
+ *
+ * The default is to send all the package IDs in one transaction.
+ *
+ * Since: 1.2.4
+ **/
+void
+pk_package_sack_set_batch_size (PkPackageSack *sack, guint batch_size, guint max_parallel)
+{
+	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
+	sack->priv->batch_size = batch_size;
+	sack->priv->max_parallel = max_parallel > 0 ? max_parallel : 1;
+}
+
 /***************************************************************************************************/
 
 /*
@@ -727,42 +991,29 @@ pk_package_sack_merge_bool_state_finish (PkPackageSackState *state, const GError
 	/* deallocate */
 	if (state->cancellable != NULL)
 		g_object_unref (state->cancellable);
+	g_clear_error (&state->error);
+	g_strfreev (state->package_ids);
 	g_object_unref (state->res);
 	g_object_unref (state->sack);
 	g_slice_free (PkPackageSackState, state);
 }
 
 /*
- * pk_package_sack_resolve_cb:
+ * pk_package_sack_merge_resolve:
+ *
+ * Return value: the number of packages merged into the sack
  **/
-static void
-pk_package_sack_resolve_cb (GObject *source_object, GAsyncResult *res, PkPackageSackState *state)
+static guint
+pk_package_sack_merge_resolve (PkPackageSackState *state, PkResults *results)
 {
-	PkClient *client = PK_CLIENT (source_object);
 	PkPackage *item;
 	guint i;
 	PkPackage *package;
 	const gchar *package_id;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GPtrArray) packages = NULL;
 
-	/* get the results */
-	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to resolve: %s", error->message);
-		pk_package_sack_merge_bool_state_finish (state, error);
-		return;
-	}
-
 	/* get the packages */
 	packages = pk_results_get_package_array (results);
-	if (packages->len == 0) {
-		g_warning ("%i", state->ret);
-		error = g_error_new (1, 0, "no packages found!");
-		pk_package_sack_merge_bool_state_finish (state, error);
-		return;
-	}
 
 	/* set data on each item */
 	for (i = 0; i < packages->len; i++) {
@@ -781,117 +1032,24 @@ pk_package_sack_resolve_cb (GObject *source_object, GAsyncResult *res, PkPackage
 			      NULL);
 		g_object_unref (package);
 	}
-
-	/* all okay */
-	state->ret = TRUE;
-
-	/* we're done */
-	pk_package_sack_merge_bool_state_finish (state, error);
-}
-
-/**
- * pk_package_sack_resolve_async:
- * @sack: a valid #PkPackageSack instance
- * @cancellable: a #GCancellable or %NULL
- * @progress_callback: (scope notified): the function to run when the progress changes
- * @progress_user_data: data to pass to @progress_callback
- * @callback: the function to run on completion
- * @user_data: the data to pass to @callback
- *
- * Merges in details about packages using resolve.
- *
- * Since: 0.5.2
- **/
-void
-pk_package_sack_resolve_async (PkPackageSack *sack, GCancellable *cancellable,
-				     PkProgressCallback progress_callback, gpointer progress_user_data,
-				     GAsyncReadyCallback callback, gpointer user_data)
-{
-	PkPackageSackState *state;
-	g_autoptr(GSimpleAsyncResult) res = NULL;
-	g_auto(GStrv) package_ids = NULL;
-
-	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
-	g_return_if_fail (callback != NULL);
-
-	res = g_simple_async_result_new (G_OBJECT (sack), callback, user_data, pk_package_sack_resolve_async);
-
-	/* save state */
-	state = g_slice_new0 (PkPackageSackState);
-	state->res = g_object_ref (res);
-	state->sack = g_object_ref (sack);
-	if (cancellable != NULL)
-		state->cancellable = g_object_ref (cancellable);
-	state->ret = FALSE;
-
-	/* start resolve async */
-	package_ids = pk_package_sack_get_package_ids (sack);
-	pk_client_resolve_async (sack->priv->client,
-				 pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), package_ids,
-				 cancellable, progress_callback, progress_user_data,
-				 (GAsyncReadyCallback) pk_package_sack_resolve_cb, state);
-}
-
-/**
- * pk_package_sack_merge_generic_finish:
- * @sack: a valid #PkPackageSack instance
- * @res: the #GAsyncResult
- * @error: A #GError or %NULL
- *
- * Gets the result from the asynchronous function.
- *
- * Return value: %TRUE for success
- *
- * Since: 0.5.2
- **/
-gboolean
-pk_package_sack_merge_generic_finish (PkPackageSack *sack, GAsyncResult *res, GError **error)
-{
-	GSimpleAsyncResult *simple;
-
-	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
-	g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
-	simple = G_SIMPLE_ASYNC_RESULT (res);
-
-	if (g_simple_async_result_propagate_error (simple, error))
-		return FALSE;
-
-	return g_simple_async_result_get_op_res_gboolean (simple);
+	return packages->len;
 }
 
-/***************************************************************************************************/
-
 /*
- * pk_package_sack_get_details_cb:
+ * pk_package_sack_merge_details:
+ *
+ * Return value: the number of details merged into the sack
  **/
-static void
-pk_package_sack_get_details_cb (GObject *source_object, GAsyncResult *res, PkPackageSackState *state)
+static guint
+pk_package_sack_merge_details (PkPackageSackState *state, PkResults *results)
 {
-	PkClient *client = PK_CLIENT (source_object);
 	PkDetails *item;
 	guint i;
 	PkPackage *package;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GPtrArray) details = NULL;
 
-	/* get the results */
-	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to details: %s", error->message);
-		pk_package_sack_merge_bool_state_finish (state, error);
-		return;
-	}
-
 	/* get the details */
 	details = pk_results_get_details_array (results);
-	if (details->len == 0) {
-		error = g_error_new (1, 0, "no details found!");
-		pk_package_sack_merge_bool_state_finish (state, error);
-		return;
-	}
 
 	/* set data on each item */
 	for (i = 0; i < details->len; i++) {
@@ -918,85 +1076,24 @@ pk_package_sack_get_details_cb (GObject *source_object, GAsyncResult *res, PkPac
 			      NULL);
 		g_object_unref (package);
 	}
-
-	/* all okay */
-	state->ret = TRUE;
-
-	/* we're done */
-	pk_package_sack_merge_bool_state_finish (state, error);
+	return details->len;
 }
 
-/**
- * pk_package_sack_get_details_async:
- * @sack: a valid #PkPackageSack instance
- * @cancellable: a #GCancellable or %NULL
- * @progress_callback: (scope notified): the function to run when the progress changes
- * @progress_user_data: data to pass to @progress_callback
- * @callback: the function to run on completion
- * @user_data: the data to pass to @callback
- *
- * Merges in details about packages.
- **/
-void
-pk_package_sack_get_details_async (PkPackageSack *sack, GCancellable *cancellable,
-				   PkProgressCallback progress_callback, gpointer progress_user_data,
-				   GAsyncReadyCallback callback, gpointer user_data)
-{
-	PkPackageSackState *state;
-	g_autoptr(GSimpleAsyncResult) res = NULL;
-	g_auto(GStrv) package_ids = NULL;
-
-	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
-	g_return_if_fail (callback != NULL);
-
-	res = g_simple_async_result_new (G_OBJECT (sack), callback, user_data, pk_package_sack_get_details_async);
-
-	/* save state */
-	state = g_slice_new0 (PkPackageSackState);
-	state->res = g_object_ref (res);
-	state->sack = g_object_ref (sack);
-	if (cancellable != NULL)
-		state->cancellable = g_object_ref (cancellable);
-	state->ret = FALSE;
-
-	/* start details async */
-	package_ids = pk_package_sack_get_package_ids (sack);
-	pk_client_get_details_async (sack->priv->client, package_ids,
-				     cancellable, progress_callback, progress_user_data,
-				     (GAsyncReadyCallback) pk_package_sack_get_details_cb, state);
-}
-
-/***************************************************************************************************/
-
 /*
- * pk_package_sack_get_update_detail_cb:
+ * pk_package_sack_merge_update_detail:
+ *
+ * Return value: the number of update details merged into the sack
  **/
-static void
-pk_package_sack_get_update_detail_cb (GObject *source_object, GAsyncResult *res, PkPackageSackState *state)
+static guint
+pk_package_sack_merge_update_detail (PkPackageSackState *state, PkResults *results)
 {
-	PkClient *client = PK_CLIENT (source_object);
 	PkUpdateDetail *item;
 	guint i;
 	PkPackage *package;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GPtrArray) update_details = NULL;
 
-	/* get the results */
-	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to update_detail: %s", error->message);
-		pk_package_sack_merge_bool_state_finish (state, error);
-		return;
-	}
-
 	/* get the update_details */
 	update_details = pk_results_get_update_detail_array (results);
-	if (update_details->len == 0) {
-		error = g_error_new (1, 0, "no update details found!");
-		pk_package_sack_merge_bool_state_finish (state, error);
-		return;
-	}
 
 	/* set data on each item */
 	for (i = 0; i < update_details->len; i++) {
@@ -1052,14 +1149,243 @@ pk_package_sack_get_update_detail_cb (GObject *source_object, GAsyncResult *res,
 			      NULL);
 		g_object_unref (package);
 	}
+	return update_details->len;
+}
+
+/*
+ * pk_package_sack_chunk_cb:
+ *
+ * Merges the results of one batch as soon as it finishes.
+ **/
+static void
+pk_package_sack_chunk_cb (GObject *source_object, GAsyncResult *res, PkPackageSackState *state)
+{
+	PkClient *client = PK_CLIENT (source_object);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	state->chunks_running--;
+
+	/* get the results */
+	/* the first error is returned once the running batches finish */
+	results = pk_client_generic_finish (client, res, &error);
+	if (results == NULL) {
+		g_debug ("failed to %s: %s",
+			 pk_role_enum_to_string (state->role),
+			 error->message);
+		if (state->error == NULL)
+			state->error = g_steal_pointer (&error);
+	} else if (state->role == PK_ROLE_ENUM_RESOLVE) {
+		state->merged += pk_package_sack_merge_resolve (state, results);
+	} else if (state->role == PK_ROLE_ENUM_GET_DETAILS) {
+		state->merged += pk_package_sack_merge_details (state, results);
+	} else {
+		state->merged += pk_package_sack_merge_update_detail (state, results);
+	}
+
+	/* start the next batch, or finish */
+	pk_package_sack_state_dispatch (state);
+}
+
+/*
+ * pk_package_sack_state_dispatch:
+ *
+ * Keeps up to max-parallel batches running, and completes the request
+ * when all of them have finished or one has failed.
+ **/
+static void
+pk_package_sack_state_dispatch (PkPackageSackState *state)
+{
+	PkPackageSackPrivate *priv = state->sack->priv;
+	guint offset;
+	guint len;
+	g_autoptr(GError) error = NULL;
+
+	while (state->error == NULL &&
+	       state->chunks_started < state->chunks &&
+	       state->chunks_running < priv->max_parallel) {
+		g_autofree gchar **package_ids = NULL;
+
+		/* the strings are borrowed, the client copies them */
+		offset = state->chunks_started * state->chunk_size;
+		len = MIN (state->chunk_size, state->package_ids_len - offset);
+		package_ids = g_new0 (gchar *, len + 1);
+		memcpy (package_ids, state->package_ids + offset, len * sizeof (gchar *));
+		state->chunks_started++;
+		state->chunks_running++;
+
+		if (state->role == PK_ROLE_ENUM_RESOLVE) {
+			pk_client_resolve_async (priv->client,
+						 pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), package_ids,
+						 state->cancellable,
+						 state->progress_callback, state->progress_user_data,
+						 (GAsyncReadyCallback) pk_package_sack_chunk_cb, state);
+		} else if (state->role == PK_ROLE_ENUM_GET_DETAILS) {
+			pk_client_get_details_async (priv->client, package_ids,
+						     state->cancellable,
+						     state->progress_callback, state->progress_user_data,
+						     (GAsyncReadyCallback) pk_package_sack_chunk_cb, state);
+		} else {
+			pk_client_get_update_detail_async (priv->client, package_ids,
+							   state->cancellable,
+							   state->progress_callback, state->progress_user_data,
+							   (GAsyncReadyCallback) pk_package_sack_chunk_cb, state);
+		}
+	}
+
+	/* wait for the batches still running */
+	if (state->chunks_running > 0)
+		return;
+	if (state->error != NULL) {
+		pk_package_sack_merge_bool_state_finish (state, state->error);
+		return;
+	}
+	/* nothing at all came back */
+	if (state->merged == 0) {
+		if (state->role == PK_ROLE_ENUM_RESOLVE)
+			error = g_error_new (1, 0, "no packages found!");
+		else if (state->role == PK_ROLE_ENUM_GET_DETAILS)
+			error = g_error_new (1, 0, "no details found!");
+		else
+			error = g_error_new (1, 0, "no update details found!");
+		pk_package_sack_merge_bool_state_finish (state, error);
+		return;
+	}
 
 	/* all okay */
 	state->ret = TRUE;
 
 	/* we're done */
-	pk_package_sack_merge_bool_state_finish (state, error);
+	pk_package_sack_merge_bool_state_finish (state, NULL);
+}
+
+/*
+ * pk_package_sack_state_new:
+ **/
+static PkPackageSackState *
+pk_package_sack_state_new (PkPackageSack *sack, PkRoleEnum role,
+			   GCancellable *cancellable,
+			   PkProgressCallback progress_callback, gpointer progress_user_data,
+			   GSimpleAsyncResult *res)
+{
+	PkPackageSackState *state;
+
+	/* save state */
+	state = g_slice_new0 (PkPackageSackState);
+	state->res = g_object_ref (res);
+	state->sack = g_object_ref (sack);
+	if (cancellable != NULL)
+		state->cancellable = g_object_ref (cancellable);
+	state->ret = FALSE;
+	state->role = role;
+	state->progress_callback = progress_callback;
+	state->progress_user_data = progress_user_data;
+
+	/* an empty sack is still sent as one transaction, as before */
+	state->package_ids = pk_package_sack_get_package_ids (sack);
+	state->package_ids_len = g_strv_length (state->package_ids);
+	state->chunk_size = sack->priv->batch_size;
+	if (state->chunk_size == 0 || state->chunk_size > state->package_ids_len)
+		state->chunk_size = MAX (state->package_ids_len, 1);
+	state->chunks = MAX ((state->package_ids_len + state->chunk_size - 1) / state->chunk_size, 1);
+	return state;
+}
+
+/**
+ * pk_package_sack_resolve_async:
+ * @sack: a valid #PkPackageSack instance
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: (scope notified): the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Merges in details about packages using resolve.
+ *
+ * Since: 0.5.2
+ **/
+void
+pk_package_sack_resolve_async (PkPackageSack *sack, GCancellable *cancellable,
+				     PkProgressCallback progress_callback, gpointer progress_user_data,
+				     GAsyncReadyCallback callback, gpointer user_data)
+{
+	PkPackageSackState *state;
+	g_autoptr(GSimpleAsyncResult) res = NULL;
+
+	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
+	g_return_if_fail (callback != NULL);
+
+	res = g_simple_async_result_new (G_OBJECT (sack), callback, user_data, pk_package_sack_resolve_async);
+
+	/* start resolve async */
+	state = pk_package_sack_state_new (sack, PK_ROLE_ENUM_RESOLVE, cancellable,
+					   progress_callback, progress_user_data, res);
+	pk_package_sack_state_dispatch (state);
+}
+
+/**
+ * pk_package_sack_merge_generic_finish:
+ * @sack: a valid #PkPackageSack instance
+ * @res: the #GAsyncResult
+ * @error: A #GError or %NULL
+ *
+ * Gets the result from the asynchronous function.
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 0.5.2
+ **/
+gboolean
+pk_package_sack_merge_generic_finish (PkPackageSack *sack, GAsyncResult *res, GError **error)
+{
+	GSimpleAsyncResult *simple;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
+	g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	simple = G_SIMPLE_ASYNC_RESULT (res);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	return g_simple_async_result_get_op_res_gboolean (simple);
 }
 
+/***************************************************************************************************/
+
+/**
+ * pk_package_sack_get_details_async:
+ * @sack: a valid #PkPackageSack instance
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: (scope notified): the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Merges in details about packages.
+ **/
+void
+pk_package_sack_get_details_async (PkPackageSack *sack, GCancellable *cancellable,
+				   PkProgressCallback progress_callback, gpointer progress_user_data,
+				   GAsyncReadyCallback callback, gpointer user_data)
+{
+	PkPackageSackState *state;
+	g_autoptr(GSimpleAsyncResult) res = NULL;
+
+	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
+	g_return_if_fail (callback != NULL);
+
+	res = g_simple_async_result_new (G_OBJECT (sack), callback, user_data, pk_package_sack_get_details_async);
+
+	/* start details async */
+	state = pk_package_sack_state_new (sack, PK_ROLE_ENUM_GET_DETAILS, cancellable,
+					   progress_callback, progress_user_data, res);
+	pk_package_sack_state_dispatch (state);
+}
+
+/***************************************************************************************************/
+
 /**
  * pk_package_sack_get_update_detail_async:
  * @sack: a valid #PkPackageSack instance
@@ -1080,26 +1406,16 @@ pk_package_sack_get_update_detail_async (PkPackageSack *sack, GCancellable *canc
 {
 	PkPackageSackState *state;
 	g_autoptr(GSimpleAsyncResult) res = NULL;
-	g_auto(GStrv) package_ids = NULL;
 
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
 	g_return_if_fail (callback != NULL);
 
 	res = g_simple_async_result_new (G_OBJECT (sack), callback, user_data, pk_package_sack_get_update_detail_async);
 
-	/* save state */
-	state = g_slice_new0 (PkPackageSackState);
-	state->res = g_object_ref (res);
-	state->sack = g_object_ref (sack);
-	if (cancellable != NULL)
-		state->cancellable = g_object_ref (cancellable);
-	state->ret = FALSE;
-
 	/* start update_detail async */
-	package_ids = pk_package_sack_get_package_ids (sack);
-	pk_client_get_update_detail_async (sack->priv->client, package_ids,
-					   cancellable, progress_callback, progress_user_data,
-					   (GAsyncReadyCallback) pk_package_sack_get_update_detail_cb, state);
+	state = pk_package_sack_state_new (sack, PK_ROLE_ENUM_GET_UPDATE_DETAIL, cancellable,
+					   progress_callback, progress_user_data, res);
+	pk_package_sack_state_dispatch (state);
 }
 
 /***************************************************************************************************/
@@ -1141,9 +1457,14 @@ pk_package_sack_init (PkPackageSack *sack)
 	sack->priv = PK_PACKAGE_SACK_GET_PRIVATE (sack);
 	priv = sack->priv;
 
-	priv->table = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify) g_ptr_array_unref);
 	priv->array = g_ptr_array_new_with_free_func (g_object_unref);
+	priv->info_count_valid = TRUE;
+	priv->total_bytes_valid = TRUE;
 	priv->client = pk_client_new ();
+	priv->max_parallel = 1;
 }
 
 /*
@@ -1155,8 +1476,10 @@ pk_package_sack_finalize (GObject *object)
 	PkPackageSack *sack = PK_PACKAGE_SACK (object);
 	PkPackageSackPrivate *priv = sack->priv;
 
+	pk_package_sack_clear (sack);
 	g_ptr_array_unref (priv->array);
 	g_hash_table_unref (priv->table);
+	g_hash_table_unref (priv->names);
 	g_object_unref (priv->client);
 
 	G_OBJECT_CLASS (pk_package_sack_parent_class)->finalize (object);
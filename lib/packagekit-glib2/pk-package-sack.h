@@ -138,6 +138,9 @@ PkPackageSack	*pk_package_sack_filter			(PkPackageSack		*sack,
 							 PkPackageSackFilterFunc filter_cb,
 							 gpointer		 user_data);
 guint64		 pk_package_sack_get_total_bytes	(PkPackageSack		*sack);
+void		 pk_package_sack_set_batch_size		(PkPackageSack		*sack,
+							 guint			 batch_size,
+							 guint			 max_parallel);
 
 gboolean	 pk_package_sack_merge_generic_finish	(PkPackageSack		*sack,
 							 GAsyncResult		*res,
@@ -151,7 +151,8 @@ pk_package_equal_id (PkPackage *package1, PkPackage *package2)
  * @package_id: the valid package_id
  * @error: a #GError to put the error code and message in, or %NULL
  *
- * Sets the package object to have the given ID
+ * Sets the package object to have the given ID and notifies
+ * #PkPackage:package-id, even if the ID was invalid.
  *
  * Return value: %TRUE if the package_id was set
  *
@@ -198,6 +199,7 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 		goto out;
 	}
 out:
+	g_object_notify (G_OBJECT (package), "package-id");
 	return ret;
 }
 
@@ -229,11 +231,10 @@ pk_package_parse (PkPackage *package, const gchar *data, GError **error)
 	}
 
 	/* parse object */
-	package->priv->info = pk_info_enum_from_string (sections[0]);
+	pk_package_set_info (package, pk_info_enum_from_string (sections[0]));
 	if (!pk_package_set_id (package, sections[1], error))
 		return FALSE;
-	g_free (package->priv->summary);
-	package->priv->summary = g_strdup (sections[2]);
+	pk_package_set_summary (package, sections[2]);
 	return TRUE;
 }
 
@@ -259,7 +260,7 @@ pk_package_get_info (PkPackage *package)
  * @package: a valid #PkPackage instance
  * @info: the #PkInfoEnum
  *
- * Sets the package info enum.
+ * Sets the package info enum, notifying #PkPackage:info if it changed.
  *
  * Since: 0.8.14
  **/
@@ -267,7 +268,10 @@ void
 pk_package_set_info (PkPackage *package, PkInfoEnum info)
 {
 	g_return_if_fail (PK_IS_PACKAGE (package));
+	if (package->priv->info == info)
+		return;
 	package->priv->info = info;
+	g_object_notify (G_OBJECT (package), "info");
 }
 
 /**
@@ -275,7 +279,7 @@ pk_package_set_info (PkPackage *package, PkInfoEnum info)
  * @package: a valid #PkPackage instance
  * @summary: the package summary
  *
- * Sets the package summary.
+ * Sets the package summary and notifies #PkPackage:summary.
  *
  * Since: 0.8.14
  **/
@@ -285,6 +289,7 @@ pk_package_set_summary (PkPackage *package, const gchar *summary)
 	g_return_if_fail (PK_IS_PACKAGE (package));
 	g_free (package->priv->summary);
 	package->priv->summary = g_strdup (summary);
+	g_object_notify (G_OBJECT (package), "summary");
 }
 
 /**
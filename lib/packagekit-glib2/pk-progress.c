@@ -56,6 +56,7 @@ struct _PkProgressPrivate
 	guint				 speed;
 	guint64				 download_size_remaining;
 	guint64				 transaction_flags;
+	guint				 queue_wait_time;
 	guint				 uid;
 	PkItemProgress			*item_progress;
 	PkPackage			*package;
@@ -75,6 +76,7 @@ enum {
 	PROP_SPEED,
 	PROP_DOWNLOAD_SIZE_REMAINING,
 	PROP_TRANSACTION_FLAGS,
+	PROP_QUEUE_WAIT_TIME,
 	PROP_UID,
 	PROP_PACKAGE,
 	PROP_ITEM_PROGRESS,
@@ -131,6 +133,9 @@ pk_progress_get_property (GObject *object, guint prop_id, GValue *value, GParamS
 	case PROP_TRANSACTION_FLAGS:
 		g_value_set_uint64 (value, progress->priv->transaction_flags);
 		break;
+	case PROP_QUEUE_WAIT_TIME:
+		g_value_set_uint (value, progress->priv->queue_wait_time);
+		break;
 	case PROP_UID:
 		g_value_set_uint (value, progress->priv->uid);
 		break;
@@ -730,6 +735,50 @@ pk_progress_get_transaction_flags (PkProgress *progress)
 	return progress->priv->transaction_flags;
 }
 
+/**
+ * pk_progress_set_queue_wait_time:
+ * @progress: a valid #PkProgress instance
+ * @queue_wait_time: time in milliseconds
+ *
+ * Set the amount of time the transaction waited to be run.
+ *
+ * Return value: %TRUE if value changed.
+ *
+ * Since: 1.2.4
+ **/
+gboolean
+pk_progress_set_queue_wait_time (PkProgress *progress, guint queue_wait_time)
+{
+	g_return_val_if_fail (PK_IS_PROGRESS (progress), FALSE);
+
+	/* the same as before? */
+	if (progress->priv->queue_wait_time == queue_wait_time)
+		return FALSE;
+
+	/* new value */
+	progress->priv->queue_wait_time = queue_wait_time;
+	g_object_notify (G_OBJECT(progress), "queue-wait-time");
+
+	return TRUE;
+}
+
+/**
+ * pk_progress_get_queue_wait_time:
+ * @progress: a valid #PkProgress instance
+ *
+ * Get the amount of time the transaction waited to be run.
+ *
+ * Return value: time in milliseconds
+ *
+ * Since: 1.2.4
+ **/
+guint
+pk_progress_get_queue_wait_time (PkProgress *progress)
+{
+	g_return_val_if_fail (PK_IS_PROGRESS (progress), 0);
+	return progress->priv->queue_wait_time;
+}
+
 /**
  * pk_progress_set_uid:
  * @progress: a valid #PkProgress instance
@@ -859,6 +908,9 @@ pk_progress_set_property (GObject *object, guint prop_id, const GValue *value, G
 	case PROP_SPEED:
 		pk_progress_set_speed (progress, g_value_get_uint (value));
 		break;
+	case PROP_QUEUE_WAIT_TIME:
+		pk_progress_set_queue_wait_time (progress, g_value_get_uint (value));
+		break;
 	case PROP_UID:
 		pk_progress_set_uid (progress, g_value_get_uint (value));
 		break;
@@ -1032,6 +1084,18 @@ pk_progress_class_init (PkProgressClass *klass)
 				     G_PARAM_READWRITE);
 	g_object_class_install_property (object_class, PROP_TRANSACTION_FLAGS, pspec);
 
+	/**
+	 * PkProgress:queue-wait-time:
+	 *
+         * Amount of time the transaction waited to be run in milliseconds.
+         *
+	 * Since: 1.2.4
+	 */
+	pspec = g_param_spec_uint ("queue-wait-time", NULL, NULL,
+				   0, G_MAXUINT, 0,
+				   G_PARAM_READWRITE);
+	g_object_class_install_property (object_class, PROP_QUEUE_WAIT_TIME, pspec);
+
 	/**
 	 * PkProgress:uid:
 	 *
@@ -86,6 +86,7 @@ PkProgress	*pk_progress_new			(void);
  * @PK_PROGRESS_TYPE_PACKAGE: package updated
  * @PK_PROGRESS_TYPE_ITEM_PROGRESS: item progress updated
  * @PK_PROGRESS_TYPE_TRANSACTION_FLAGS: transaction flags updated
+ * @PK_PROGRESS_TYPE_QUEUE_WAIT_TIME: queue wait time updated
  * @PK_PROGRESS_TYPE_INVALID:
  *
  * Flag to show which progress field has been updated.
@@ -106,6 +107,7 @@ typedef enum {
 	PK_PROGRESS_TYPE_PACKAGE,
 	PK_PROGRESS_TYPE_ITEM_PROGRESS,
 	PK_PROGRESS_TYPE_TRANSACTION_FLAGS,
+	PK_PROGRESS_TYPE_QUEUE_WAIT_TIME,
 	PK_PROGRESS_TYPE_INVALID
 } PkProgressType;
 
@@ -160,6 +162,9 @@ guint64	 pk_progress_get_download_size_remaining(PkProgress		*progress);
 gboolean	 pk_progress_set_transaction_flags	(PkProgress		*progress,
 							 guint64		 transaction_flags);
 guint64	 pk_progress_get_transaction_flags	(PkProgress		*progress);
+gboolean	 pk_progress_set_queue_wait_time	(PkProgress		*progress,
+							 guint			 queue_wait_time);
+guint		 pk_progress_get_queue_wait_time	(PkProgress		*progress);
 gboolean	 pk_progress_set_uid			(PkProgress		*progress,
 							 guint			 uid);
 guint		 pk_progress_get_uid			(PkProgress		*progress);
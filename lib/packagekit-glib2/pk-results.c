@@ -27,10 +27,16 @@
  * PackageKit. This will include Package(), ErrorCode() and all the other types
  * of objects. Everything is refcounted, so ensure you unref when done with the
  * data.
+ *
+ * Packages added with pk_results_add_package_id() are kept as compact records
+ * and only turned into #PkPackage objects when the package array or sack is
+ * requested. Use a #PkResultsPackageIter to read them without doing that.
  */
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib-object.h>
 
 #include <packagekit-glib2/pk-results.h>
@@ -66,8 +72,33 @@ struct _PkResultsPrivate
 	GPtrArray		*media_change_required_array;
 	GPtrArray		*repo_detail_array;
 	PkPackageSack		*package_sack;
+	GArray			*packages;
+	guint			 packages_in_sack;
+	GStringChunk		*strings;
 };
 
+/* a package, either added as an object or packed into the string chunk
+ * until somebody asks for the #PkPackage */
+typedef struct {
+	PkPackage		*package;
+	const gchar		*package_id;
+	const gchar		*name;
+	const gchar		*version;
+	const gchar		*arch;
+	const gchar		*data;
+	const gchar		*summary;
+	const gchar		*transaction_id;
+	guint16			 info;
+	guint16			 role;
+} PkResultsPackage;
+
+typedef struct {
+	PkResults		*results;
+	guint			 index;
+} PkResultsRealPackageIter;
+
+G_STATIC_ASSERT (sizeof (PkResultsRealPackageIter) <= sizeof (PkResultsPackageIter));
+
 enum {
 	PROP_0,
 	PROP_ROLE,
@@ -203,10 +234,296 @@ pk_results_add_package (PkResults *results, PkPackage *item)
 		g_warning ("Finished packages cannot be added to PkResults");
 		return FALSE;
 	}
-	pk_package_sack_add_package (results->priv->package_sack, item);
+	g_array_set_size (results->priv->packages, results->priv->packages->len + 1);
+	g_array_index (results->priv->packages, PkResultsPackage,
+		       results->priv->packages->len - 1).package = g_object_ref (item);
 	return TRUE;
 }
 
+/*
+ * pk_results_strings_insert_len:
+ *
+ * Copies part of a string into the string chunk, sharing the copy with
+ * any previous one if @len is small enough to be looked up cheaply.
+ **/
+static const gchar *
+pk_results_strings_insert_len (GStringChunk *strings, const gchar *str, gsize len)
+{
+	gchar buf[64];
+
+	if (len >= sizeof (buf))
+		return g_string_chunk_insert_len (strings, str, len);
+	memcpy (buf, str, len);
+	buf[len] = '\0';
+	return g_string_chunk_insert_const (strings, buf);
+}
+
+/**
+ * pk_results_add_package_id:
+ * @results: a valid #PkResults instance
+ * @info: the #PkInfoEnum of the package
+ * @package_id: the package ID
+ * @summary: (nullable): the package summary
+ * @transaction_id: (nullable): the transaction ID that emitted the package
+ *
+ * Adds a package to the results set without creating a #PkPackage, which
+ * is much cheaper when there are thousands of them.
+ *
+ * Return value: %TRUE if the package ID was valid and the value was set
+ *
+ * Since: 1.2.4
+ **/
+gboolean
+pk_results_add_package_id (PkResults *results,
+			   PkInfoEnum info,
+			   const gchar *package_id,
+			   const gchar *summary,
+			   const gchar *transaction_id)
+{
+	PkResultsPrivate *priv;
+	PkResultsPackage *item;
+	const gchar *sections[4];
+	guint cnt = 0;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	/* do not allow finished types */
+	if (info == PK_INFO_ENUM_FINISHED) {
+		g_warning ("Finished packages cannot be added to PkResults");
+		return FALSE;
+	}
+
+	/* find the sections without splitting the string */
+	sections[0] = package_id;
+	for (i = 0; package_id[i] != '\0'; i++) {
+		if (package_id[i] == ';' && ++cnt <= 3)
+			sections[cnt] = &package_id[i + 1];
+	}
+	if (cnt != 3 || sections[0][0] == ';')
+		return FALSE;
+
+	/* the name and version are mostly unique, the rest repeats a lot */
+	priv = results->priv;
+	if (priv->strings == NULL)
+		priv->strings = g_string_chunk_new (16 * 1024);
+	g_array_set_size (priv->packages, priv->packages->len + 1);
+	item = &g_array_index (priv->packages, PkResultsPackage, priv->packages->len - 1);
+	item->package_id = g_string_chunk_insert_len (priv->strings, package_id, i);
+	item->name = g_string_chunk_insert_len (priv->strings, sections[0],
+						sections[1] - sections[0] - 1);
+	item->version = g_string_chunk_insert_len (priv->strings, sections[1],
+						   sections[2] - sections[1] - 1);
+	item->arch = pk_results_strings_insert_len (priv->strings, sections[2],
+						    sections[3] - sections[2] - 1);
+	item->data = g_string_chunk_insert_const (priv->strings, sections[3]);
+	if (summary != NULL)
+		item->summary = g_string_chunk_insert (priv->strings, summary);
+	if (transaction_id != NULL)
+		item->transaction_id = g_string_chunk_insert_const (priv->strings, transaction_id);
+	item->info = info;
+	item->role = priv->role;
+	return TRUE;
+}
+
+/*
+ * pk_results_get_package:
+ *
+ * Return value: (transfer none): the #PkPackage for the record, created
+ * if it was only packed so far
+ **/
+static PkPackage *
+pk_results_get_package (PkResultsPackage *item)
+{
+	g_autoptr(GError) error = NULL;
+
+	if (item->package != NULL)
+		return item->package;
+
+	item->package = pk_package_new ();
+	if (!pk_package_set_id (item->package, item->package_id, &error))
+		g_warning ("failed to set package id for %s: %s", item->package_id, error->message);
+	pk_package_set_info (item->package, item->info);
+	pk_package_set_summary (item->package, item->summary);
+	g_object_set (item->package,
+		      "role", item->role,
+		      "transaction-id", item->transaction_id,
+		      NULL);
+	return item->package;
+}
+
+/*
+ * pk_results_sync_package_sack:
+ *
+ * Adds the packages that are not already in the sack, in the order they
+ * were added to the results.
+ **/
+static void
+pk_results_sync_package_sack (PkResults *results)
+{
+	PkResultsPrivate *priv = results->priv;
+	PkResultsPackage *item;
+
+	for (; priv->packages_in_sack < priv->packages->len; priv->packages_in_sack++) {
+		item = &g_array_index (priv->packages, PkResultsPackage, priv->packages_in_sack);
+		pk_package_sack_add_package (priv->package_sack, pk_results_get_package (item));
+	}
+}
+
+/**
+ * pk_results_package_iter_init:
+ * @iter: an uninitialized #PkResultsPackageIter
+ * @results: a valid #PkResults instance
+ *
+ * Initializes an iterator over the packages, in the order they were added.
+ *
+ * Since: 1.2.4
+ **/
+void
+pk_results_package_iter_init (PkResultsPackageIter *iter, PkResults *results)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	ri->results = results;
+	ri->index = 0;
+}
+
+/**
+ * pk_results_package_iter_next:
+ * @iter: an initialized #PkResultsPackageIter
+ * @info: (out) (optional): the #PkInfoEnum of the package
+ * @package_id: (out) (optional) (transfer none): the package ID
+ * @summary: (out) (optional) (transfer none) (nullable): the package summary
+ *
+ * Advances @iter to the next package, without creating a #PkPackage. The
+ * strings are owned by the results.
+ *
+ * Return value: %FALSE if there are no more packages
+ *
+ * Since: 1.2.4
+ **/
+gboolean
+pk_results_package_iter_next (PkResultsPackageIter *iter,
+			      PkInfoEnum *info,
+			      const gchar **package_id,
+			      const gchar **summary)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	PkResultsPackage *item;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+
+	if (ri->index >= ri->results->priv->packages->len)
+		return FALSE;
+	item = &g_array_index (ri->results->priv->packages, PkResultsPackage, ri->index++);
+	if (item->package_id == NULL) {
+		if (info != NULL)
+			*info = pk_package_get_info (item->package);
+		if (package_id != NULL)
+			*package_id = pk_package_get_id (item->package);
+		if (summary != NULL)
+			*summary = pk_package_get_summary (item->package);
+		return TRUE;
+	}
+	if (info != NULL)
+		*info = item->info;
+	if (package_id != NULL)
+		*package_id = item->package_id;
+	if (summary != NULL)
+		*summary = item->summary;
+	return TRUE;
+}
+
+static PkResultsPackage *
+pk_results_package_iter_get_item (PkResultsPackageIter *iter)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+
+	g_return_val_if_fail (iter != NULL, NULL);
+	g_return_val_if_fail (ri->index > 0, NULL);
+	return &g_array_index (ri->results->priv->packages, PkResultsPackage, ri->index - 1);
+}
+
+/**
+ * pk_results_package_iter_get_name:
+ * @iter: a #PkResultsPackageIter
+ *
+ * Return value: the name of the current package
+ *
+ * Since: 1.2.4
+ **/
+const gchar *
+pk_results_package_iter_get_name (PkResultsPackageIter *iter)
+{
+	PkResultsPackage *item = pk_results_package_iter_get_item (iter);
+	if (item == NULL)
+		return NULL;
+	if (item->package_id == NULL)
+		return pk_package_get_name (item->package);
+	return item->name;
+}
+
+/**
+ * pk_results_package_iter_get_version:
+ * @iter: a #PkResultsPackageIter
+ *
+ * Return value: the version of the current package
+ *
+ * Since: 1.2.4
+ **/
+const gchar *
+pk_results_package_iter_get_version (PkResultsPackageIter *iter)
+{
+	PkResultsPackage *item = pk_results_package_iter_get_item (iter);
+	if (item == NULL)
+		return NULL;
+	if (item->package_id == NULL)
+		return pk_package_get_version (item->package);
+	return item->version;
+}
+
+/**
+ * pk_results_package_iter_get_arch:
+ * @iter: a #PkResultsPackageIter
+ *
+ * Return value: the architecture of the current package
+ *
+ * Since: 1.2.4
+ **/
+const gchar *
+pk_results_package_iter_get_arch (PkResultsPackageIter *iter)
+{
+	PkResultsPackage *item = pk_results_package_iter_get_item (iter);
+	if (item == NULL)
+		return NULL;
+	if (item->package_id == NULL)
+		return pk_package_get_arch (item->package);
+	return item->arch;
+}
+
+/**
+ * pk_results_package_iter_get_data:
+ * @iter: a #PkResultsPackageIter
+ *
+ * Return value: the data of the current package, e.g. the repository
+ *
+ * Since: 1.2.4
+ **/
+const gchar *
+pk_results_package_iter_get_data (PkResultsPackageIter *iter)
+{
+	PkResultsPackage *item = pk_results_package_iter_get_item (iter);
+	if (item == NULL)
+		return NULL;
+	if (item->package_id == NULL)
+		return pk_package_get_data (item->package);
+	return item->data;
+}
+
 /**
  * pk_results_add_details:
  * @results: a valid #PkResults instance
@@ -578,6 +895,7 @@ GPtrArray *
 pk_results_get_package_array (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	pk_results_sync_package_sack (results);
 	return pk_package_sack_get_array (results->priv->package_sack);
 }
 
@@ -595,6 +913,7 @@ PkPackageSack *
 pk_results_get_package_sack (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	pk_results_sync_package_sack (results);
 	return g_object_ref (results->priv->package_sack);
 }
 
@@ -825,6 +1144,13 @@ pk_results_get_repo_detail_array (PkResults *results)
 	return g_ptr_array_ref (results->priv->repo_detail_array);
 }
 
+static void
+pk_results_package_clear (PkResultsPackage *item)
+{
+	if (item->package != NULL)
+		g_object_unref (item->package);
+}
+
 /*
  * pk_results_class_init:
  **/
@@ -898,6 +1224,8 @@ pk_results_init (PkResults *results)
 	results->priv->progress = NULL;
 	results->priv->error_code = NULL;
 	results->priv->package_sack = pk_package_sack_new ();
+	results->priv->packages = g_array_new (FALSE, TRUE, sizeof (PkResultsPackage));
+	g_array_set_clear_func (results->priv->packages, (GDestroyNotify) pk_results_package_clear);
 	results->priv->details_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->update_detail_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->category_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -932,6 +1260,9 @@ pk_results_finalize (GObject *object)
 	g_ptr_array_unref (priv->media_change_required_array);
 	g_ptr_array_unref (priv->repo_detail_array);
 	g_object_unref (priv->package_sack);
+	g_array_unref (priv->packages);
+	if (priv->strings != NULL)
+		g_string_chunk_free (priv->strings);
 	if (results->priv->progress != NULL)
 		g_object_unref (results->priv->progress);
 	if (results->priv->error_code != NULL)
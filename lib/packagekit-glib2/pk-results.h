@@ -67,6 +67,20 @@ struct _PkResults
 	 PkResultsPrivate	*priv;
 };
 
+/**
+ * PkResultsPackageIter:
+ *
+ * An opaque structure used to iterate over the packages of a #PkResults
+ * without creating a #PkPackage for each one.
+ *
+ * Since: 1.2.4
+ **/
+typedef struct {
+	/*< private >*/
+	gpointer	 dummy1;
+	guint		 dummy2;
+} PkResultsPackageIter;
+
 struct _PkResultsClass
 {
 	GObjectClass	parent_class;
@@ -92,6 +106,11 @@ gboolean	 pk_results_set_error_code 		(PkResults		*results,
 /* add */
 gboolean	 pk_results_add_package			(PkResults		*results,
 							 PkPackage		*item);
+gboolean	 pk_results_add_package_id		(PkResults		*results,
+							 PkInfoEnum		 info,
+							 const gchar		*package_id,
+							 const gchar		*summary,
+							 const gchar		*transaction_id);
 gboolean	 pk_results_add_details			(PkResults		*results,
 							 PkDetails		*item);
 gboolean	 pk_results_add_update_detail		(PkResults		*results,
@@ -137,6 +156,18 @@ GPtrArray	*pk_results_get_eula_required_array	(PkResults		*results);
 GPtrArray	*pk_results_get_media_change_required_array (PkResults		*results);
 GPtrArray	*pk_results_get_repo_detail_array	(PkResults		*results);
 
+/* iterate packages */
+void		 pk_results_package_iter_init		(PkResultsPackageIter	*iter,
+							 PkResults		*results);
+gboolean	 pk_results_package_iter_next		(PkResultsPackageIter	*iter,
+							 PkInfoEnum		*info,
+							 const gchar		**package_id,
+							 const gchar		**summary);
+const gchar	*pk_results_package_iter_get_name	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_version	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_arch	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_data	(PkResultsPackageIter	*iter);
+
 G_END_DECLS
 
 #endif /* __PK_RESULTS_H */
@@ -28,6 +28,7 @@
 
 #include "pk-client.h"
 #include "pk-client-helper.h"
+#include "pk-common.h"
 #include "pk-control.h"
 #include "pk-console-shared.h"
 #include "pk-offline.h"
@@ -723,6 +724,204 @@ pk_test_client_func (void)
 #endif
 }
 
+static void
+pk_test_client_package_func_cb (const gchar *transaction_id,
+				PkInfoEnum info,
+				const gchar *package_id,
+				const gchar *summary,
+				gpointer user_data)
+{
+	GHashTable *streamed = (GHashTable *) user_data;
+	g_assert (transaction_id != NULL);
+	g_hash_table_insert (streamed, g_strdup (transaction_id), g_strdup (package_id));
+}
+
+static void
+pk_test_client_package_func_progress_cb (PkProgress *progress, PkProgressType type, gpointer user_data)
+{
+	gchar **tid = (gchar **) user_data;
+	if (*tid == NULL)
+		g_object_get (progress, "transaction-id", tid, NULL);
+}
+
+static void
+pk_test_client_package_func_resolve_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	guint *pending = (guint *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* the packages went to the function instead */
+	results = pk_client_generic_finish (PK_CLIENT (object), res, &error);
+	g_assert_no_error (error);
+	g_assert (results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 0);
+
+	if (--(*pending) == 0)
+		_g_test_loop_quit ();
+}
+
+static void
+pk_test_client_package_func_simulate_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* simulated packages are still collected for PkTask */
+	results = pk_client_generic_finish (PK_CLIENT (object), res, &error);
+	g_assert_no_error (error);
+	g_assert (results != NULL);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 6);
+
+	_g_test_loop_quit ();
+}
+
+static void
+pk_test_client_package_func_func (void)
+{
+	guint pending = 2;
+	g_autofree gchar *tid_glib2 = NULL;
+	g_autofree gchar *tid_powertop = NULL;
+	g_autoptr(GHashTable) streamed = NULL;
+	g_autoptr(PkClient) client = NULL;
+	g_auto(GStrv) glib2 = NULL;
+	g_auto(GStrv) powertop = NULL;
+
+	client = pk_client_new ();
+	streamed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	pk_client_set_package_func (client, pk_test_client_package_func_cb, streamed, NULL);
+
+	/* two transactions at once, each package goes with its own one */
+	glib2 = pk_package_ids_from_id ("glib2;2.14.0;i386;fedora");
+	powertop = pk_package_ids_from_id ("powertop;1.8-1.fc8;i386;fedora");
+	pk_client_resolve_async (client, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), glib2, NULL,
+				 pk_test_client_package_func_progress_cb, &tid_glib2,
+				 pk_test_client_package_func_resolve_cb, &pending);
+	pk_client_resolve_async (client, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), powertop, NULL,
+				 pk_test_client_package_func_progress_cb, &tid_powertop,
+				 pk_test_client_package_func_resolve_cb, &pending);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert_cmpint (pending, ==, 0);
+	g_assert (tid_glib2 != NULL);
+	g_assert (tid_powertop != NULL);
+	g_assert_cmpstr (tid_glib2, !=, tid_powertop);
+	g_assert_cmpint (g_hash_table_size (streamed), ==, 2);
+	g_assert_cmpstr (g_hash_table_lookup (streamed, tid_glib2), ==, glib2[0]);
+	g_assert_cmpstr (g_hash_table_lookup (streamed, tid_powertop), ==, powertop[0]);
+
+	/* but not when simulating */
+	g_hash_table_remove_all (streamed);
+	pk_client_install_packages_async (client,
+					  pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE),
+					  glib2, NULL, NULL, NULL,
+					  pk_test_client_package_func_simulate_cb, NULL);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert_cmpint (g_hash_table_size (streamed), ==, 0);
+}
+
+static void
+pk_test_client_packages_get_tid_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	gchar **tid = (gchar **) user_data;
+	g_autoptr(GError) error = NULL;
+
+	*tid = pk_control_get_tid_finish (PK_CONTROL (object), res, &error);
+	g_assert_no_error (error);
+	g_assert (*tid != NULL);
+	_g_test_loop_quit ();
+}
+
+static void
+pk_test_client_packages_signal_cb (GDBusProxy *proxy,
+				   const gchar *sender_name,
+				   const gchar *signal_name,
+				   GVariant *parameters,
+				   gpointer user_data)
+{
+	GPtrArray *package_ids = (GPtrArray *) user_data;
+	const gchar *package_id;
+
+	/* only clients sending the hint get the batched signal */
+	g_assert_cmpstr (signal_name, !=, "Packages");
+	if (g_strcmp0 (signal_name, "Package") == 0) {
+		g_variant_get (parameters, "(u&s&s)", NULL, &package_id, NULL);
+		g_ptr_array_add (package_ids, g_strdup (package_id));
+	} else if (g_strcmp0 (signal_name, "Finished") == 0) {
+		_g_test_loop_quit ();
+	}
+}
+
+static void
+pk_test_client_packages_func (void)
+{
+	const gchar *expected[] = { "vips-doc;7.12.4-2.fc8;noarch;linva",
+				    "bǣwulf-utf8;0.1;noarch;hughsie",
+				    NULL };
+	gchar *values[] = { (gchar *) "system", NULL };
+	guint i;
+	g_autofree gchar *tid = NULL;
+	g_autoptr(GDBusProxy) proxy = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) package_ids = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GVariant) retval = NULL;
+	g_autoptr(PkClient) client = NULL;
+	g_autoptr(PkControl) control = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* the dummy backend emits the groups all at once, which PkClient
+	 * gets as one Packages signal */
+	client = pk_client_new ();
+	results = pk_client_search_groups (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					   values, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 2);
+	for (i = 0; expected[i] != NULL; i++) {
+		PkPackage *package = g_ptr_array_index (packages, i);
+		g_assert_cmpstr (pk_package_get_id (package), ==, expected[i]);
+		g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_AVAILABLE);
+		g_assert (pk_package_get_summary (package) != NULL);
+	}
+
+	/* without the supports-packages hint every package is sent in its
+	 * own Package signal */
+	control = pk_control_new ();
+	pk_control_get_tid_async (control, NULL,
+				  (GAsyncReadyCallback) pk_test_client_packages_get_tid_cb, &tid);
+	_g_test_loop_run_with_timeout (5000);
+	g_assert (tid != NULL);
+	proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
+					       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+					       NULL,
+					       PK_DBUS_SERVICE,
+					       tid,
+					       PK_DBUS_INTERFACE_TRANSACTION,
+					       NULL,
+					       &error);
+	g_assert_no_error (error);
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	g_signal_connect (proxy, "g-signal",
+			  G_CALLBACK (pk_test_client_packages_signal_cb), package_ids);
+	retval = g_dbus_proxy_call_sync (proxy, "SearchGroups",
+					 g_variant_new ("(t^as)",
+							pk_bitfield_value (PK_FILTER_ENUM_NONE),
+							values),
+					 G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	g_assert_no_error (error);
+	_g_test_loop_run_with_timeout (5000);
+	g_assert_cmpint (package_ids->len, ==, 2);
+	for (i = 0; expected[i] != NULL; i++)
+		g_assert_cmpstr (g_ptr_array_index (package_ids, i), ==, expected[i]);
+}
+
 static void
 pk_test_console_func (void)
 {
@@ -1011,17 +1210,45 @@ pk_test_package_sack_filter_cb (PkPackage *package, gpointer user_data)
 	return TRUE;
 }
 
+static void
+pk_test_package_sack_resolve_fail_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	PkPackageSack *sack = PK_PACKAGE_SACK (object);
+	g_autoptr(GError) error = NULL;
+	gboolean ret;
+
+	/* the daemon refused the batch with the invalid name */
+	ret = pk_package_sack_merge_generic_finish (sack, res, &error);
+	g_assert_error (error, PK_CLIENT_ERROR, PK_CLIENT_ERROR_INVALID_INPUT);
+	g_assert (!ret);
+
+	_g_test_loop_quit ();
+}
+
 static void
 pk_test_package_sack_func (void)
 {
 	gboolean ret;
 	PkPackageSack *sack;
+	PkPackageSack *batch;
 	PkPackage *package;
 	gchar *text;
 	gchar **strv;
+	guint i;
 	guint size;
 	PkInfoEnum info = PK_INFO_ENUM_UNKNOWN;
 	guint64 bytes;
+	const gchar *batch_ids[] = { "powertop;1.8-1.fc8;i386;fedora",
+				     "glib2;2.14.0;i386;fedora",
+				     "kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed",
+				     "gtkhtml2;2.19.1-4.fc8;i386;fedora",
+				     NULL };
+	g_autofree gchar *invalid_name = NULL;
+	g_autofree gchar *invalid_id = NULL;
+
+	/* longer than the daemon accepts */
+	invalid_name = g_strnfill (1100, 'x');
+	invalid_id = g_strdup_printf ("%s;1.0;i386;fedora", invalid_name);
 
 	sack = pk_package_sack_new ();
 	g_assert (sack != NULL);
@@ -1108,6 +1335,49 @@ pk_test_package_sack_func (void)
 	bytes = pk_package_sack_get_total_bytes (sack);
 	g_assert_cmpint (bytes, ==, 103424);
 
+	/* merge resolve results in batches smaller than the sack */
+	batch = pk_package_sack_new ();
+	for (i = 0; batch_ids[i] != NULL; i++) {
+		ret = pk_package_sack_add_package_by_id (batch, batch_ids[i], NULL);
+		g_assert (ret);
+	}
+	pk_package_sack_set_batch_size (batch, 3, 2);
+	pk_package_sack_resolve_async (batch, NULL, NULL, NULL, (GAsyncReadyCallback) pk_test_package_sack_resolve_cb, NULL);
+	_g_test_loop_run_with_timeout (5000);
+	g_debug ("resolved in batches in %f", g_test_timer_elapsed ());
+	for (i = 0; batch_ids[i] != NULL; i++) {
+		package = pk_package_sack_find_by_id (batch, batch_ids[i]);
+		g_assert (package != NULL);
+		g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_INSTALLED);
+		g_assert (pk_package_get_summary (package) != NULL);
+		g_object_unref (package);
+	}
+	g_object_unref (batch);
+
+	/* a failed batch stops the ones after it, the ones before are kept */
+	batch = pk_package_sack_new ();
+	for (i = 0; batch_ids[i] != NULL; i++) {
+		ret = pk_package_sack_add_package_by_id (batch, batch_ids[i], NULL);
+		g_assert (ret);
+		if (i == 1) {
+			ret = pk_package_sack_add_package_by_id (batch, invalid_id, NULL);
+			g_assert (ret);
+		}
+	}
+	pk_package_sack_set_batch_size (batch, 2, 1);
+	pk_package_sack_resolve_async (batch, NULL, NULL, NULL, (GAsyncReadyCallback) pk_test_package_sack_resolve_fail_cb, NULL);
+	_g_test_loop_run_with_timeout (5000);
+	package = pk_package_sack_find_by_id (batch, batch_ids[1]);
+	g_assert (package != NULL);
+	g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_INSTALLED);
+	g_object_unref (package);
+	package = pk_package_sack_find_by_id (batch, batch_ids[3]);
+	g_assert (package != NULL);
+	g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpstr (pk_package_get_summary (package), ==, NULL);
+	g_object_unref (package);
+	g_object_unref (batch);
+
 	/* remove package */
 	ret = pk_package_sack_remove_package_by_id (sack, "powertop;1.8-1.fc8;i386;fedora");
 	g_assert (ret);
@@ -1438,6 +1708,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/transaction-list", pk_test_transaction_list_func);
 	g_test_add_func ("/packagekit-glib2/client-helper", pk_test_client_helper_func);
 	g_test_add_func ("/packagekit-glib2/client", pk_test_client_func);
+	g_test_add_func ("/packagekit-glib2/client-package-func", pk_test_client_package_func_func);
+	g_test_add_func ("/packagekit-glib2/client-packages", pk_test_client_packages_func);
 	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/task", pk_test_task_func);
 	g_test_add_func ("/packagekit-glib2/task-wrapper", pk_test_task_wrapper_func);
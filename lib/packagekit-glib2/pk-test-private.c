@@ -31,6 +31,7 @@
 #include "pk-package.h"
 #include "pk-package-id.h"
 #include "pk-package-ids.h"
+#include "pk-package-sack.h"
 #include "pk-progress-bar.h"
 #include "pk-results.h"
 
@@ -331,6 +332,7 @@ pk_test_package_id_func (void)
 	gboolean ret;
 	gchar *text;
 	gchar **sections;
+	PkPackageIdView view;
 
 	/* check not valid - NULL */
 	ret = pk_package_id_check (NULL);
@@ -402,6 +404,35 @@ pk_test_package_id_func (void)
 	/* test fail missing first */
 	sections = pk_package_id_split (";0.1.2;i386;data");
 	g_assert (sections == NULL);
+
+	/* check not valid - not UTF8 */
+	ret = pk_package_id_check ("moo;0.0.1\xff;i386;fedora");
+	g_assert (!ret);
+
+	/* check valid - UTF8 */
+	ret = pk_package_id_check ("mo\xc3\xb6;0.0.1;i386;fedora");
+	g_assert (ret);
+
+	/* parse without copying */
+	ret = pk_package_id_parse ("kde-i18n-csb;4:3.5.8~pre20071001-0ubuntu1;all;", &view);
+	g_assert (ret);
+	g_assert_cmpint (view.offset[PK_PACKAGE_ID_NAME], ==, 0);
+	g_assert_cmpint (view.length[PK_PACKAGE_ID_NAME], ==, 12);
+	g_assert_cmpint (view.offset[PK_PACKAGE_ID_VERSION], ==, 13);
+	g_assert_cmpint (view.length[PK_PACKAGE_ID_VERSION], ==, 28);
+	g_assert_cmpint (view.offset[PK_PACKAGE_ID_ARCH], ==, 42);
+	g_assert_cmpint (view.length[PK_PACKAGE_ID_ARCH], ==, 3);
+	g_assert_cmpint (view.offset[PK_PACKAGE_ID_DATA], ==, 46);
+	g_assert_cmpint (view.length[PK_PACKAGE_ID_DATA], ==, 0);
+	g_assert (!pk_package_id_parse ("foo;moo;dave;clive;dan", &view));
+	g_assert (!pk_package_id_parse (";0.1.2;i386;data", &view));
+	g_assert (!pk_package_id_parse (NULL, &view));
+
+	/* fuzzy arch */
+	g_assert (pk_package_id_equal_fuzzy_arch ("moo;0.0.1;i386;fedora", "moo;0.0.1;i686;updates"));
+	g_assert (!pk_package_id_equal_fuzzy_arch ("moo;0.0.1;i386;fedora", "moo;0.0.1;x86_64;fedora"));
+	g_assert (!pk_package_id_equal_fuzzy_arch ("moo;0.0.1;i386;fedora", "moo;0.0.2;i386;fedora"));
+	g_assert (!pk_package_id_equal_fuzzy_arch ("moo;0.0.1;i386;fedora", "moo;0.0.1"));
 }
 
 static void
@@ -462,7 +493,10 @@ pk_test_results_func (void)
 	PkInfoEnum info;
 	gchar *package_id;
 	gchar *summary;
+	const gchar *id;
+	const gchar *text;
 	GError *error = NULL;
+	PkResultsPackageIter iter;
 
 	/* get results */
 	results = pk_results_new ();
@@ -532,6 +566,40 @@ pk_test_results_func (void)
 	g_free (package_id);
 	g_free (summary);
 
+	/* add packed packages */
+	ret = pk_results_add_package_id (results, PK_INFO_ENUM_INSTALLED,
+					 "powertop;1.8-1.fc8;i386;installed:fedora",
+					 "Power consumption monitor", "/1_abc");
+	g_assert (ret);
+	ret = pk_results_add_package_id (results, PK_INFO_ENUM_AVAILABLE,
+					 "powertop;1.8-1.fc8", NULL, NULL);
+	g_assert (!ret);
+
+	/* iterate without creating objects */
+	pk_results_package_iter_init (&iter, results);
+	g_assert (pk_results_package_iter_next (&iter, &info, &id, &text));
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpstr (id, ==, "gnome-power-manager;0.1.2;i386;fedora");
+	g_assert_cmpstr (pk_results_package_iter_get_name (&iter), ==, "gnome-power-manager");
+	g_assert (pk_results_package_iter_next (&iter, &info, &id, &text));
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (id, ==, "powertop;1.8-1.fc8;i386;installed:fedora");
+	g_assert_cmpstr (text, ==, "Power consumption monitor");
+	g_assert_cmpstr (pk_results_package_iter_get_name (&iter), ==, "powertop");
+	g_assert_cmpstr (pk_results_package_iter_get_version (&iter), ==, "1.8-1.fc8");
+	g_assert_cmpstr (pk_results_package_iter_get_arch (&iter), ==, "i386");
+	g_assert_cmpstr (pk_results_package_iter_get_data (&iter), ==, "installed:fedora");
+	g_assert (!pk_results_package_iter_next (&iter, NULL, NULL, NULL));
+
+	/* the objects are created in order when asked for */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 2);
+	item = g_ptr_array_index (packages, 1);
+	g_assert_cmpint (pk_package_get_info (item), ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "powertop;1.8-1.fc8;i386;installed:fedora");
+	g_assert_cmpstr (pk_package_get_summary (item), ==, "Power consumption monitor");
+	g_ptr_array_unref (packages);
+
 	g_object_unref (results);
 }
 
@@ -598,6 +666,110 @@ pk_test_package_func (void)
 	g_object_unref (package);
 }
 
+static gboolean
+pk_test_package_sack_filter_cb (PkPackage *package, gpointer user_data)
+{
+	return g_strcmp0 (pk_package_get_arch (package), "i386") != 0;
+}
+
+static void
+pk_test_package_sack_func (void)
+{
+	const gchar *ids[] = { "powertop;1.8-1;i386;fedora",
+			       "powertop;1.8-1;x86_64;fedora",
+			       "kernel;2.6.32-1;x86_64;fedora",
+			       "abiword;2.8.6-1;i386;fedora",
+			       NULL };
+	guint i;
+	PkPackage *package;
+	g_autoptr(PkPackage) found = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(PkPackageSack) sack_info = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GError) error = NULL;
+
+	sack = pk_package_sack_new ();
+	for (i = 0; ids[i] != NULL; i++) {
+		package = pk_package_new ();
+		g_assert (pk_package_set_id (package, ids[i], &error));
+		g_assert_no_error (error);
+		g_object_set (package,
+			      "info", i < 2 ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE,
+			      "size", (guint64) (i + 1) * 1000,
+			      NULL);
+		g_assert (pk_package_sack_add_package (sack, package));
+		g_object_unref (package);
+	}
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 4);
+	g_assert_cmpint (pk_package_sack_get_total_bytes (sack), ==, 10000);
+
+	/* find by name and arch */
+	found = pk_package_sack_find_by_id_name_arch (sack, "powertop;1.9-1;x86_64;updates");
+	g_assert (found != NULL);
+	g_assert_cmpstr (pk_package_get_id (found), ==, "powertop;1.8-1;x86_64;fedora");
+	g_clear_object (&found);
+	found = pk_package_sack_find_by_id_name_arch (sack, "kernel;2.6.32-1;i386;fedora");
+	g_assert (found == NULL);
+
+	/* the info counts follow changes to the packages */
+	sack_info = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (sack_info), ==, 2);
+	g_clear_object (&sack_info);
+	package = pk_package_sack_find_by_id (sack, "kernel;2.6.32-1;x86_64;fedora");
+	g_object_set (package, "info", PK_INFO_ENUM_INSTALLED, "size", (guint64) 0, NULL);
+	g_object_unref (package);
+	sack_info = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (sack_info), ==, 3);
+	g_assert_cmpint (pk_package_sack_get_total_bytes (sack), ==, 7000);
+
+	/* sort */
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_NAME);
+	array = pk_package_sack_get_array (sack);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_name (package), ==, "abiword");
+
+	/* the setters notify too, so the counts are not stale */
+	g_clear_object (&sack_info);
+	sack_info = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpint (pk_package_sack_get_size (sack_info), ==, 1);
+	g_clear_object (&sack_info);
+	package = pk_package_sack_find_by_id (sack, "abiword;2.8.6-1;i386;fedora");
+	pk_package_set_info (package, PK_INFO_ENUM_INSTALLED);
+	sack_info = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (sack_info), ==, 4);
+	g_clear_object (&sack_info);
+	sack_info = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpint (pk_package_sack_get_size (sack_info), ==, 0);
+
+	/* renamed while in the sack, so only found under the new ID */
+	g_assert (pk_package_set_id (package, "gedit;2.28.0-1;i386;fedora", &error));
+	g_assert_no_error (error);
+	g_object_unref (package);
+	found = pk_package_sack_find_by_id_name_arch (sack, "abiword;2.8.6-1;i386;fedora");
+	g_assert (found == NULL);
+	found = pk_package_sack_find_by_id (sack, "abiword;2.8.6-1;i386;fedora");
+	g_assert (found == NULL);
+	found = pk_package_sack_find_by_id (sack, "gedit;2.28.0-1;i386;fedora");
+	g_assert (found != NULL);
+	g_clear_object (&found);
+	found = pk_package_sack_find_by_id_name_arch (sack, "gedit;2.30.0-1;i386;updates");
+	g_assert (found != NULL);
+	g_assert_cmpstr (pk_package_get_id (found), ==, "gedit;2.28.0-1;i386;fedora");
+	g_clear_object (&found);
+
+	/* remove the i386 packages, keeping the name of the other powertop */
+	g_assert (pk_package_sack_remove_by_filter (sack, pk_test_package_sack_filter_cb, NULL));
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 2);
+	g_assert_cmpint (pk_package_sack_get_total_bytes (sack), ==, 2000);
+	found = pk_package_sack_find_by_id_name_arch (sack, "powertop;1.8-1;x86_64;fedora");
+	g_assert (found != NULL);
+	g_clear_object (&found);
+	g_assert (pk_package_sack_remove_package_by_id (sack, "powertop;1.8-1;x86_64;fedora"));
+	g_assert (!pk_package_sack_remove_package_by_id (sack, "powertop;1.8-1;x86_64;fedora"));
+	found = pk_package_sack_find_by_id_name_arch (sack, "powertop;1.8-1;x86_64;fedora");
+	g_assert (found == NULL);
+}
+
 static void
 pk_test_offline_func (void)
 {
@@ -929,6 +1101,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
 	g_test_add_func ("/packagekit-glib2/results", pk_test_results_func);
 	g_test_add_func ("/packagekit-glib2/package", pk_test_package_func);
+	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/progress-bar", pk_test_progress_bar);
 	g_test_add_func ("/packagekit-glib2/offline", pk_test_offline_func);
 	g_test_add_func ("/packagekit-glib2/offline-upgrade", pk_test_offline_upgrade_func);
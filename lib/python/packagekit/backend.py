@@ -25,6 +25,7 @@
 from __future__ import print_function
 
 import sys
+import struct
 import traceback
 import os.path
 
@@ -46,6 +47,31 @@ def _to_utf8(txt, errors='replace'):
         return txt.encode('utf-8', errors=errors)
     return str(txt)
 
+def _to_bytes(txt):
+    if isinstance(txt, bytes):
+        return txt
+    try:
+        return txt.encode('utf-8', 'replace')
+    except AttributeError:
+        return str(txt).encode('utf-8')
+
+def _varint(value):
+    data = bytearray()
+    while value > 0x7f:
+        data.append((value & 0x7f) | 0x80)
+        value >>= 7
+    data.append(value)
+    return data
+
+# the tags of the binary frames, this has to match the order of
+# pk_backend_spawn_commands in src/pk-backend-spawn.c
+_FRAME_TAGS = dict((cmd, tag) for tag, cmd in enumerate([
+    'package', 'details', 'finished', 'files', 'repo-detail', 'updatedetail',
+    'percentage', 'item-progress', 'error', 'requirerestart', 'status',
+    'speed', 'download-size-remaining', 'allow-cancel', 'no-percentage-updates',
+    'repo-signature-required', 'eula-required', 'media-change-required',
+    'distro-upgrade', 'category', 'framing']))
+
 class PkError(Exception):
     def __init__(self, code, details):
         self.code = code
@@ -55,6 +81,10 @@ class PkError(Exception):
 
 class PackageKitBaseBackend:
 
+    # set to True to use length prefixed frames rather than tab separated
+    # lines on stdout, if the daemon supports them
+    binary_framing = False
+
     def __init__(self, cmds):
         # Setup a custom exception handler
         installExceptionHandler(self)
@@ -107,6 +137,46 @@ class PackageKitBaseBackend:
         except KeyError as e:
             pass
 
+        # ask for binary framing, nothing but frames can be written after this
+        self._framing = False
+        self._frame_out = None
+        if self.binary_framing and os.environ.get('PK_BACKEND_FRAMING') == 'binary':
+            self._emit("framing", "binary")
+            self._framing = True
+            # keep the real stdout for frames and send anything else that
+            # writes to it, e.g. a library or a subprocess, to stderr
+            sys.stdout.flush()
+            self._frame_out = os.fdopen(os.dup(1), 'wb')
+            os.dup2(2, 1)
+            sys.stdout = sys.stderr
+
+    def _emit(self, command, *sections):
+        '''
+        Write a command for the daemon to stdout
+        @param command: The command name, e.g. "package"
+        @param sections: The arguments of the command
+        '''
+        if self._framing:
+            tag = _FRAME_TAGS.get(command)
+            if tag is None:
+                # there's no frame for it, so log it like the daemon
+                # would log a line it can't parse
+                line = "\t".join(["%s" % section for section in (command,) + sections])
+                sys.stderr.write(_to_utf8(line + "\n"))
+                sys.stderr.flush()
+                return
+            payload = bytearray([tag])
+            for section in sections:
+                data = _to_bytes(section)
+                payload += _varint(len(data))
+                payload += data
+            self._frame_out.write(struct.pack('<I', len(payload)) + bytes(payload))
+            self._frame_out.flush()
+        else:
+            line = "\t".join(["%s" % section for section in (command,) + sections])
+            sys.stdout.write(_to_utf8(line + "\n"))
+            sys.stdout.flush()
+
     def doLock(self):
         ''' Generic locking, overide and extend in child class'''
         self._locked = True
@@ -124,19 +194,17 @@ class PackageKitBaseBackend:
         @param percent: Progress percentage (int preferred)
         '''
         if percent == None:
-            sys.stdout.write(_to_utf8("no-percentage-updates\n"))
+            self._emit("no-percentage-updates")
         elif percent == 0 or percent > self.percentage_old:
-            sys.stdout.write(_to_utf8("percentage\t%i\n" % percent))
+            self._emit("percentage", "%i" % percent)
             self.percentage_old = percent
-        sys.stdout.flush()
 
     def speed(self, bps=0):
         '''
         Write progress speed
         @param bps: Progress speed (int, bytes per second)
         '''
-        sys.stdout.write(_to_utf8("speed\t%i\n" % bps))
-        sys.stdout.flush()
+        self._emit("speed", "%i" % bps)
 
     def item_progress(self, package_id, status, percent=None):
         '''
@@ -144,8 +212,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param percent: percentage of the current item (int preferred)
         '''
-        sys.stdout.write(_to_utf8("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent)))
-        sys.stdout.flush()
+        self._emit("item-progress", package_id, status, "%i" % percent)
 
     def error(self, err, description, exit=True):
         '''
@@ -159,8 +226,7 @@ class PackageKitBaseBackend:
             self.unLock()
 
         # this should be fast now
-        sys.stdout.write(_to_utf8("error\t%s\t%s\n" % (err, description)))
-        sys.stdout.flush()
+        self._emit("error", err, description)
         if exit:
             # Paradoxically, we don't want to print "finished" to stdout here.
             # Python takes an _enormous_ amount of time to exit, and leaves a
@@ -174,8 +240,7 @@ class PackageKitBaseBackend:
         send 'message' signal
         @param typ: MESSAGE_BROKEN_MIRROR
         '''
-        sys.stdout.write(_to_utf8("message\t%s\t%s\n" % (typ, msg)))
-        sys.stdout.flush()
+        self._emit("message", typ, msg)
 
     def package(self, package_id, status, summary):
         '''
@@ -184,8 +249,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param summary: The package Summary
         '''
-        sys.stdout.write(_to_utf8("package\t%s\t%s\t%s\n" % (status, package_id, summary)))
-        sys.stdout.flush()
+        self._emit("package", status, package_id, summary)
 
     def media_change_required(self, mtype, id, text):
         '''
@@ -194,8 +258,7 @@ class PackageKitBaseBackend:
         @param id: the localised label of the media
         @param text: the localised text describing the media
         '''
-        sys.stdout.write(_to_utf8("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text)))
-        sys.stdout.flush()
+        self._emit("media-change-required", mtype, id, text)
 
     def distro_upgrade(self, dtype, name, summary):
         '''
@@ -204,16 +267,14 @@ class PackageKitBaseBackend:
         @param name: The distro name, e.g. "fedora-9"
         @param summary: The localised distribution name and description
         '''
-        sys.stdout.write(_to_utf8("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary)))
-        sys.stdout.flush()
+        self._emit("distro-upgrade", dtype, name, summary)
 
     def status(self, state):
         '''
         send 'status' signal
         @param state: STATUS_DOWNLOAD, STATUS_INSTALL, STATUS_UPDATE, STATUS_REMOVE, STATUS_WAIT
         '''
-        sys.stdout.write(_to_utf8("status\t%s\n" % state))
-        sys.stdout.flush()
+        self._emit("status", state)
 
     def repo_detail(self, repoid, name, state):
         '''
@@ -221,16 +282,14 @@ class PackageKitBaseBackend:
         @param repoid: The repo id tag
         @param state: false is repo is disabled else true.
         '''
-        sys.stdout.write(_to_utf8("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state))))
-        sys.stdout.flush()
+        self._emit("repo-detail", repoid, name, _bool_to_string(state))
 
     def data(self, data):
         '''
         send 'data' signal:
         @param data:  The current worked on package
         '''
-        sys.stdout.write(_to_utf8("data\t%s\n" % data))
-        sys.stdout.flush()
+        self._emit("data", data)
 
     def details(self, package_id, summary, package_license, group, desc, url, bytes):
         '''
@@ -243,16 +302,14 @@ class PackageKitBaseBackend:
         @param url: The upstream project homepage
         @param bytes: The size of the package, in bytes
         '''
-        sys.stdout.write(_to_utf8("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes)))
-        sys.stdout.flush()
+        self._emit("details", package_id, summary, package_license, group, desc, url, "%ld" % bytes)
 
     def files(self, package_id, file_list):
         '''
         Send 'files' signal
         @param file_list: List of the files in the package, separated by ';'
         '''
-        sys.stdout.write(_to_utf8("files\t%s\t%s\n" % (package_id, file_list)))
-        sys.stdout.flush()
+        self._emit("files", package_id, file_list)
 
     def category(self, parent_id, cat_id, name, summary, icon):
         '''
@@ -263,15 +320,13 @@ class PackageKitBaseBackend:
         summery   : a summary of the category in current locale.
         icon      : an icon name to represent the category
         '''
-        sys.stdout.write(_to_utf8("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon)))
-        sys.stdout.flush()
+        self._emit("category", parent_id, cat_id, name, summary, icon)
 
     def finished(self):
         '''
         Send 'finished' signal
         '''
-        sys.stdout.write(_to_utf8("finished\n"))
-        sys.stdout.flush()
+        self._emit("finished")
 
     def update_detail(self, package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated):
         '''
@@ -289,8 +344,7 @@ class PackageKitBaseBackend:
         @param issued:
         @param updated:
         '''
-        sys.stdout.write(_to_utf8("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)))
-        sys.stdout.flush()
+        self._emit("updatedetail", package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)
 
     def require_restart(self, restart_type, details):
         '''
@@ -298,8 +352,7 @@ class PackageKitBaseBackend:
         @param restart_type: RESTART_SYSTEM, RESTART_APPLICATION, RESTART_SESSION
         @param details: Optional details about the restart
         '''
-        sys.stdout.write(_to_utf8("requirerestart\t%s\t%s\n" % (restart_type, details)))
-        sys.stdout.flush()
+        self._emit("requirerestart", restart_type, details)
 
     def allow_cancel(self, allow):
         '''
@@ -310,8 +363,7 @@ class PackageKitBaseBackend:
             data = 'true'
         else:
             data = 'false'
-        sys.stdout.write(_to_utf8("allow-cancel\t%s\n" % data))
-        sys.stdout.flush()
+        self._emit("allow-cancel", data)
 
     def repo_signature_required(self, package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type):
         '''
@@ -325,10 +377,8 @@ class PackageKitBaseBackend:
         @param key_timestamp:   Key timestamp
         @param sig_type:        Key type (GPG)
         '''
-        sys.stdout.write(_to_utf8("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
-            package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type
-            )))
-        sys.stdout.flush()
+        self._emit("repo-signature-required", package_id, repo_name, key_url,
+                   key_userid, key_id, key_fingerprint, key_timestamp, sig_type)
 
     def eula_required(self, eula_id, package_id, vendor_name, license_agreement):
         '''
@@ -338,10 +388,7 @@ class PackageKitBaseBackend:
         @param vendor_name:     Name of the vendor that wrote the EULA
         @param license_agreement: The license text
         '''
-        sys.stdout.write(_to_utf8("eula-required\t%s\t%s\t%s\t%s\n" % (
-            eula_id, package_id, vendor_name, license_agreement
-            )))
-        sys.stdout.flush()
+        self._emit("eula-required", eula_id, package_id, vendor_name, license_agreement)
 
 #
 # Backend Action Methods
@@ -66,6 +66,24 @@ typedef struct {
 	gpointer		 user_data;
 } PkBackendJobVFuncItem;
 
+/* used to call vfuncs in the main daemon thread */
+typedef struct {
+	PkBackendJob		*job;
+	PkBackendJobSignal	 signal_kind;
+	GObject			*object;
+	GDestroyNotify		 destroy_func;
+} PkBackendJobVFuncHelper;
+
+/* an event waiting in the queue of the job */
+typedef struct {
+	PkBackendJobSignal	 signal_kind;
+	gpointer		 object;
+	GDestroyNotify		 destroy_func;
+} PkBackendJobEvent;
+
+/* initial size of the event queue, always a power of two */
+#define PK_BACKEND_JOB_EVENTS_SIZE	64
+
 struct PkBackendJobPrivate
 {
 	gboolean		 finished;
@@ -107,6 +125,15 @@ struct PkBackendJobPrivate
 	PkStatusEnum		 status;
 	GTimer			*timer;
 	gboolean		 started;
+	/* ring buffer of events for the main thread, protected by events_lock */
+	GMutex			 events_lock;
+	PkBackendJobEvent	*events;
+	guint			 events_size;
+	guint			 events_head;
+	guint			 events_len;
+	GSource			*events_source;
+	/* jobs sharing the results of this one */
+	GPtrArray		*subscribers;
 };
 
 G_DEFINE_TYPE (PkBackendJob, pk_backend_job, G_TYPE_OBJECT)
@@ -513,13 +540,6 @@ pk_backend_job_get_is_error_set (PkBackendJob *job)
 	return job->priv->set_error;
 }
 
-/* used to call vfuncs in the main daemon thread */
-typedef struct {
-	PkBackendJob		*job;
-	PkBackendJobSignal	 signal_kind;
-	GObject			*object;
-	GDestroyNotify		 destroy_func;
-} PkBackendJobVFuncHelper;
 
 static const gchar *
 pk_backend_job_signal_to_string (PkBackendJobSignal id)
@@ -564,6 +584,8 @@ pk_backend_job_signal_to_string (PkBackendJobSignal id)
 		return "UpdateDetail";
 	if (id == PK_BACKEND_SIGNAL_CATEGORY)
 		return "Category";
+	if (id == PK_BACKEND_SIGNAL_PACKAGES)
+		return "Packages";
 	return NULL;
 }
 
@@ -576,28 +598,184 @@ pk_backend_job_vfunc_event_free (PkBackendJobVFuncHelper *helper)
 	g_free (helper);
 }
 
-static gboolean
-pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
+static void
+pk_backend_job_dispatch_vfunc (PkBackendJob *job,
+			       PkBackendJobSignal signal_kind,
+			       gpointer object)
 {
-	PkBackendJobVFuncHelper *helper = (PkBackendJobVFuncHelper *) user_data;
 	PkBackendJobVFuncItem *item;
 
 	/* call transaction vfunc on main thread */
-	item = &helper->job->priv->vfunc_items[helper->signal_kind];
+	item = &job->priv->vfunc_items[signal_kind];
 	if (item != NULL && item->vfunc != NULL) {
-		item->vfunc (helper->job, helper->object, item->user_data);
+		item->vfunc (job, object, item->user_data);
 	} else {
 		g_warning ("tried to do signal %s when no longer connected",
-			   pk_backend_job_signal_to_string (helper->signal_kind));
+			   pk_backend_job_signal_to_string (signal_kind));
+	}
+
+	/* and again for the jobs sharing the results, which may well
+	 * unsubscribe from the vfunc */
+	if (job->priv->subscribers->len > 0) {
+		g_autoptr(GPtrArray) subscribers = NULL;
+		guint i;
+
+		subscribers = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		for (i = 0; i < job->priv->subscribers->len; i++)
+			g_ptr_array_add (subscribers, g_object_ref (g_ptr_array_index (job->priv->subscribers, i)));
+
+		/* there will be nothing more to share */
+		if (signal_kind == PK_BACKEND_SIGNAL_FINISHED)
+			g_ptr_array_set_size (job->priv->subscribers, 0);
+
+		for (i = 0; i < subscribers->len; i++)
+			pk_backend_job_dispatch_vfunc (g_ptr_array_index (subscribers, i), signal_kind, object);
 	}
+}
+
+/**
+ * pk_backend_job_replay_vfunc:
+ *
+ * Calls the vfunc now, for results the job missed as it only subscribed
+ * to another job after it had started. This has to be called in the main
+ * thread.
+ **/
+void
+pk_backend_job_replay_vfunc (PkBackendJob *job,
+			     PkBackendJobSignal signal_kind,
+			     gpointer object)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (pk_is_thread_default ());
+	pk_backend_job_dispatch_vfunc (job, signal_kind, object);
+}
+
+/**
+ * pk_backend_job_add_subscriber:
+ *
+ * Calls the vfuncs of @subscriber too for every signal of the job until
+ * it is finished, so the results of one backend run can be shared.
+ **/
+void
+pk_backend_job_add_subscriber (PkBackendJob *job, PkBackendJob *subscriber)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (PK_IS_BACKEND_JOB (subscriber));
+	g_return_if_fail (pk_is_thread_default ());
+	g_ptr_array_add (job->priv->subscribers, g_object_ref (subscriber));
+}
+
+/**
+ * pk_backend_job_remove_subscriber:
+ **/
+void
+pk_backend_job_remove_subscriber (PkBackendJob *job, PkBackendJob *subscriber)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (pk_is_thread_default ());
+	g_ptr_array_remove (job->priv->subscribers, subscriber);
+}
+
+static gboolean
+pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
+{
+	PkBackendJobVFuncHelper *helper = (PkBackendJobVFuncHelper *) user_data;
+	pk_backend_job_dispatch_vfunc (helper->job, helper->signal_kind, helper->object);
 	return FALSE;
 }
 
+/*
+ * pk_backend_job_events_cb:
+ *
+ * Dispatches the events that were queued when it started, the ones
+ * queued meanwhile are left for the next main loop iteration.
+ **/
+static gboolean
+pk_backend_job_events_cb (gpointer user_data)
+{
+	PkBackendJob *job = PK_BACKEND_JOB (user_data);
+	PkBackendJobPrivate *priv = job->priv;
+	PkBackendJobEvent event;
+	guint count;
+
+	g_mutex_lock (&priv->events_lock);
+	for (count = priv->events_len; count > 0; count--) {
+		event = priv->events[priv->events_head];
+		priv->events_head = (priv->events_head + 1) & (priv->events_size - 1);
+		priv->events_len--;
+
+		/* the vfunc may well queue more events */
+		g_mutex_unlock (&priv->events_lock);
+		pk_backend_job_dispatch_vfunc (job, event.signal_kind, event.object);
+		if (event.destroy_func != NULL)
+			event.destroy_func (event.object);
+		g_mutex_lock (&priv->events_lock);
+	}
+
+	/* producers attach a new source once this one is gone */
+	if (priv->events_len == 0) {
+		priv->events_source = NULL;
+		g_mutex_unlock (&priv->events_lock);
+		return G_SOURCE_REMOVE;
+	}
+	g_mutex_unlock (&priv->events_lock);
+	return G_SOURCE_CONTINUE;
+}
+
+/*
+ * pk_backend_job_queue_event:
+ *
+ * Appends the event to the ring buffer, growing it when full, and makes
+ * sure a source is attached to drain it.
+ **/
+static void
+pk_backend_job_queue_event (PkBackendJob *job,
+			    PkBackendJobSignal signal_kind,
+			    gpointer object,
+			    GDestroyNotify destroy_func)
+{
+	PkBackendJobPrivate *priv = job->priv;
+	PkBackendJobEvent *event;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->events_lock);
+
+	if (priv->events_len == priv->events_size) {
+		guint size = priv->events_size > 0 ? priv->events_size * 2 : PK_BACKEND_JOB_EVENTS_SIZE;
+		PkBackendJobEvent *events = g_new (PkBackendJobEvent, size);
+		guint i;
+
+		for (i = 0; i < priv->events_len; i++)
+			events[i] = priv->events[(priv->events_head + i) & (priv->events_size - 1)];
+		g_free (priv->events);
+		priv->events = events;
+		priv->events_size = size;
+		priv->events_head = 0;
+	}
+
+	event = &priv->events[(priv->events_head + priv->events_len) & (priv->events_size - 1)];
+	event->signal_kind = signal_kind;
+	event->object = object;
+	event->destroy_func = destroy_func;
+	priv->events_len++;
+
+	/* one source drains all the events, only attach it when needed */
+	if (priv->events_source == NULL) {
+		priv->events_source = g_idle_source_new ();
+		g_source_set_priority (priv->events_source, G_PRIORITY_DEFAULT_IDLE);
+		g_source_set_callback (priv->events_source,
+				       pk_backend_job_events_cb,
+				       g_object_ref (job),
+				       g_object_unref);
+		g_source_set_name (priv->events_source, "[PkBackendJob] events_cb");
+		g_source_attach (priv->events_source, NULL);
+		g_source_unref (priv->events_source);
+	}
+}
+
 /**
  * pk_backend_job_call_vfunc:
  *
  * This method can be called in any thread, and the vfunc is guaranteed
- * to be called idle in the main thread.
+ * to be called idle in the main thread, in the order the events were sent.
  **/
 static void
 pk_backend_job_call_vfunc (PkBackendJob *job,
@@ -607,7 +785,6 @@ pk_backend_job_call_vfunc (PkBackendJob *job,
 {
 	PkBackendJobVFuncHelper *helper;
 	PkBackendJobVFuncItem *item;
-	guint priority = G_PRIORITY_DEFAULT_IDLE;
 	g_autoptr(GSource) source = NULL;
 
 	/* call transaction vfunc if not disabled and set */
@@ -615,18 +792,20 @@ pk_backend_job_call_vfunc (PkBackendJob *job,
 	if (!item->enabled || item->vfunc == NULL)
 		return;
 
-	/* order this last if others are still pending */
-	if (signal_kind == PK_BACKEND_SIGNAL_FINISHED)
-		priority = G_PRIORITY_LOW;
+	if (signal_kind != PK_BACKEND_SIGNAL_FINISHED) {
+		pk_backend_job_queue_event (job, signal_kind, object, destroy_func);
+		return;
+	}
 
-	/* emit idle */
+	/* order this last if others are still pending, the events source
+	 * has a higher priority so the queue is drained first */
 	helper = g_new0 (PkBackendJobVFuncHelper, 1);
 	helper->job = g_object_ref (job);
 	helper->signal_kind = signal_kind;
 	helper->object = object;
 	helper->destroy_func = destroy_func;
 	source = g_idle_source_new ();
-	g_source_set_priority (source, priority);
+	g_source_set_priority (source, G_PRIORITY_LOW);
 	g_source_set_callback (source,
 			       pk_backend_job_call_vfunc_idle_cb,
 			       helper,
@@ -712,6 +891,7 @@ typedef struct {
 	PkBackendJobThreadFunc	 func;
 	gpointer		 user_data;
 	GDestroyNotify		 destroy_func;
+	gboolean		 serialize;
 } PkBackendJobThreadHelper;
 
 static gpointer
@@ -720,10 +900,12 @@ pk_backend_job_thread_setup (gpointer thread_data)
 	PkBackendJobThreadHelper *helper = (PkBackendJobThreadHelper *) thread_data;
 
 	/* run original function with automatic locking */
-	pk_backend_thread_start (helper->backend, helper->job, helper->func);
+	if (helper->serialize)
+		pk_backend_thread_start (helper->backend, helper->job, helper->func);
 	helper->func (helper->job, helper->job->priv->params, helper->user_data);
 	pk_backend_job_finished (helper->job);
-	pk_backend_thread_stop (helper->backend, helper->job, helper->func);
+	if (helper->serialize)
+		pk_backend_thread_stop (helper->backend, helper->job, helper->func);
 
 	/* set idle IO priority */
 #ifdef PK_BUILD_DAEMON
@@ -743,15 +925,12 @@ pk_backend_job_thread_setup (gpointer thread_data)
 	return NULL;
 }
 
-/**
- * pk_backend_job_thread_create:
- * @func: (scope call):
- **/
-gboolean
-pk_backend_job_thread_create (PkBackendJob *job,
-			      PkBackendJobThreadFunc func,
-			      gpointer user_data,
-			      GDestroyNotify destroy_func)
+static gboolean
+pk_backend_job_thread_create_internal (PkBackendJob *job,
+				       PkBackendJobThreadFunc func,
+				       gpointer user_data,
+				       GDestroyNotify destroy_func,
+				       gboolean serialize)
 {
 	PkBackendJobThreadHelper *helper = NULL;
 
@@ -765,6 +944,7 @@ pk_backend_job_thread_create (PkBackendJob *job,
 	helper->backend = job->priv->backend;
 	helper->func = func;
 	helper->user_data = user_data;
+	helper->serialize = serialize;
 
 	/* create a thread and unref it immediately as we do not need to join()
 	 * this at any stage */
@@ -774,6 +954,37 @@ pk_backend_job_thread_create (PkBackendJob *job,
 	return TRUE;
 }
 
+/**
+ * pk_backend_job_thread_create:
+ * @func: (scope call):
+ **/
+gboolean
+pk_backend_job_thread_create (PkBackendJob *job,
+			      PkBackendJobThreadFunc func,
+			      gpointer user_data,
+			      GDestroyNotify destroy_func)
+{
+	return pk_backend_job_thread_create_internal (job, func, user_data,
+						      destroy_func, TRUE);
+}
+
+/**
+ * pk_backend_job_thread_create_concurrent:
+ * @func: (scope call):
+ *
+ * Like pk_backend_job_thread_create(), but jobs running the same @func
+ * are not serialized, so the backend has to do its own locking.
+ **/
+gboolean
+pk_backend_job_thread_create_concurrent (PkBackendJob *job,
+					 PkBackendJobThreadFunc func,
+					 gpointer user_data,
+					 GDestroyNotify destroy_func)
+{
+	return pk_backend_job_thread_create_internal (job, func, user_data,
+						      destroy_func, FALSE);
+}
+
 void
 pk_backend_job_set_percentage (PkBackendJob *job, guint percentage)
 {
@@ -955,35 +1166,22 @@ pk_backend_job_set_status (PkBackendJob *job, PkStatusEnum status)
 				   NULL);
 }
 
-void
-pk_backend_job_package (PkBackendJob *job,
-			PkInfoEnum info,
-			const gchar *package_id,
-			const gchar *summary)
+/*
+ * pk_backend_job_package_emit_check:
+ *
+ * Records the package as emitted and sets the transaction status from
+ * its info. Returns %FALSE if it must not be sent to the transaction.
+ **/
+static gboolean
+pk_backend_job_package_emit_check (PkBackendJob *job, PkPackage *item)
 {
 	PkPackage *emitted_item;
-	gboolean ret;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkPackage) item = NULL;
-
-	g_return_if_fail (PK_IS_BACKEND_JOB (job));
-	g_return_if_fail (package_id != NULL);
-
-	/* check we are valid */
-	item = pk_package_new ();
-	ret = pk_package_set_id (item, package_id, &error);
-	if (!ret) {
-		g_warning ("package_id %s invalid and cannot be processed: %s",
-			   package_id, error->message);
-		return;
-	}
-	pk_package_set_info (item, info);
-	pk_package_set_summary (item, summary);
+	PkInfoEnum info = pk_package_get_info (item);
 
 	/* already emitted? */
 	emitted_item = g_hash_table_lookup (job->priv->emitted, pk_package_get_id (item));
 	if (emitted_item != NULL && pk_package_equal (emitted_item, item))
-		return;
+		return FALSE;
 
 	/* update the emitted package table */
 	g_hash_table_insert (job->priv->emitted,
@@ -992,8 +1190,8 @@ pk_backend_job_package (PkBackendJob *job,
 
 	/* have we already set an error? */
 	if (job->priv->set_error) {
-		g_warning ("already set error: package %s", package_id);
-		return;
+		g_warning ("already set error: package %s", pk_package_get_id (item));
+		return FALSE;
 	}
 
 	/* we automatically set the transaction status  */
@@ -1012,6 +1210,35 @@ pk_backend_job_package (PkBackendJob *job,
 
 	/* we've sent a package for this transaction */
 	job->priv->has_sent_package = TRUE;
+	return TRUE;
+}
+
+void
+pk_backend_job_package (PkBackendJob *job,
+			PkInfoEnum info,
+			const gchar *package_id,
+			const gchar *summary)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkPackage) item = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (package_id != NULL);
+
+	/* check we are valid */
+	item = pk_package_new ();
+	ret = pk_package_set_id (item, package_id, &error);
+	if (!ret) {
+		g_warning ("package_id %s invalid and cannot be processed: %s",
+			   package_id, error->message);
+		return;
+	}
+	pk_package_set_info (item, info);
+	pk_package_set_summary (item, summary);
+
+	if (!pk_backend_job_package_emit_check (job, item))
+		return;
 
 	/* emit */
 	pk_backend_job_call_vfunc (job,
@@ -1020,6 +1247,53 @@ pk_backend_job_package (PkBackendJob *job,
 				   g_object_unref);
 }
 
+/**
+ * pk_backend_job_packages:
+ * @job: A valid #PkBackendJob
+ * @packages: (element-type PkPackage): packages with their id, info and summary set
+ *
+ * Emits several packages at once, which only needs one main loop
+ * dispatch and lets the transaction send them in one D-Bus signal.
+ **/
+void
+pk_backend_job_packages (PkBackendJob *job, GPtrArray *packages)
+{
+	GPtrArray *array;
+	guint i;
+
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (packages != NULL);
+
+	array = g_ptr_array_new_full (packages->len, g_object_unref);
+	for (i = 0; i < packages->len; i++) {
+		PkPackage *item = g_ptr_array_index (packages, i);
+		if (pk_backend_job_package_emit_check (job, item))
+			g_ptr_array_add (array, g_object_ref (item));
+	}
+	if (array->len == 0) {
+		g_ptr_array_unref (array);
+		return;
+	}
+
+	/* emit them one by one if nothing handles the batched signal */
+	if (!pk_backend_job_get_vfunc_enabled (job, PK_BACKEND_SIGNAL_PACKAGES)) {
+		for (i = 0; i < array->len; i++) {
+			pk_backend_job_call_vfunc (job,
+						   PK_BACKEND_SIGNAL_PACKAGE,
+						   g_object_ref (g_ptr_array_index (array, i)),
+						   g_object_unref);
+		}
+		g_ptr_array_unref (array);
+		return;
+	}
+
+	/* emit */
+	pk_backend_job_call_vfunc (job,
+				   PK_BACKEND_SIGNAL_PACKAGES,
+				   array,
+				   (GDestroyNotify) g_ptr_array_unref);
+}
+
 void
 pk_backend_job_update_detail (PkBackendJob *job,
 			      const gchar *package_id,
@@ -1669,6 +1943,9 @@ pk_backend_job_finalize (GObject *object)
 	g_timer_destroy (job->priv->timer);
 	g_key_file_unref (job->priv->conf);
 	g_object_unref (job->priv->cancellable);
+	g_free (job->priv->events);
+	g_mutex_clear (&job->priv->events_lock);
+	g_ptr_array_unref (job->priv->subscribers);
 
 	G_OBJECT_CLASS (pk_backend_job_parent_class)->finalize (object);
 }
@@ -1696,6 +1973,8 @@ pk_backend_job_init (PkBackendJob *job)
 	job->priv->status = PK_STATUS_ENUM_UNKNOWN;
 	job->priv->emitted = g_hash_table_new_full (g_str_hash, g_str_equal,
 	                                            g_free, (GDestroyNotify) g_object_unref);
+	g_mutex_init (&job->priv->events_lock);
+	job->priv->subscribers = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 }
 
 /**
@@ -60,6 +60,7 @@ typedef enum {
 	PK_BACKEND_SIGNAL_LOCKED_CHANGED,
 	PK_BACKEND_SIGNAL_UPDATE_DETAIL,
 	PK_BACKEND_SIGNAL_CATEGORY,
+	PK_BACKEND_SIGNAL_PACKAGES,
 	PK_BACKEND_SIGNAL_LAST
 } PkBackendJobSignal;
 
@@ -157,6 +158,13 @@ void		 pk_backend_job_set_vfunc		(PkBackendJob	*job,
 							 gpointer	 user_data);
 gboolean	 pk_backend_job_get_vfunc_enabled	(PkBackendJob	*job,
 							 PkBackendJobSignal signal_kind);
+void		 pk_backend_job_replay_vfunc		(PkBackendJob	*job,
+							 PkBackendJobSignal signal_kind,
+							 gpointer	 object);
+void		 pk_backend_job_add_subscriber		(PkBackendJob	*job,
+							 PkBackendJob	*subscriber);
+void		 pk_backend_job_remove_subscriber	(PkBackendJob	*job,
+							 PkBackendJob	*subscriber);
 
 /* thread helpers */
 typedef void	(*PkBackendJobThreadFunc)		(PkBackendJob	*job,
@@ -166,6 +174,10 @@ gboolean	 pk_backend_job_thread_create		(PkBackendJob	*job,
 							 PkBackendJobThreadFunc func,
 							 gpointer	 user_data,
 							 GDestroyNotify destroy_func);
+gboolean	 pk_backend_job_thread_create_concurrent (PkBackendJob	*job,
+							 PkBackendJobThreadFunc func,
+							 gpointer	 user_data,
+							 GDestroyNotify destroy_func);
 
 /* signal helpers */
 void		 pk_backend_job_finished		(PkBackendJob	*job);
@@ -173,6 +185,8 @@ void		 pk_backend_job_package			(PkBackendJob	*job,
 							 PkInfoEnum	 info,
 							 const gchar	*package_id,
 							 const gchar	*summary);
+void		 pk_backend_job_packages		(PkBackendJob	*job,
+							 GPtrArray	*packages);
 void		 pk_backend_job_repo_detail		(PkBackendJob	*job,
 							 const gchar	*repo_id,
 							 const gchar	*description,
@@ -51,20 +51,32 @@
 #define PK_BACKEND_SPAWN_PERCENTAGE_INVALID	101
 
 #define	PK_UNSAFE_DELIMITERS	"\\\f\r\t"
+#define PK_BACKEND_SPAWN_SECTIONS_MAX		13
+
+/* a helper process in the pool */
+typedef struct {
+	PkBackendSpawn		*backend_spawn;
+	PkSpawn			*spawn;
+	guint			 idle_id;
+	gint64			 last_used;
+} PkBackendSpawnInstance;
 
 struct PkBackendSpawnPrivate
 {
-	PkSpawn			*spawn;
+	PkSpawn			*spawn;		/* the instance running the job */
+	GPtrArray		*instances;
+	guint			 pool_size;
+	guint			 idle_timeout;
 	PkBackend		*backend;
 	PkBackendJob		*job;
 	gchar			*name;
-	guint			 kill_id;
 	GKeyFile		*conf;
 	gboolean		 finished;
 	gboolean		 allow_sigkill;
 	gboolean		 is_busy;
 	PkBackendSpawnFilterFunc stdout_func;
 	PkBackendSpawnFilterFunc stderr_func;
+	GString			*frame_buf;
 };
 
 G_DEFINE_TYPE (PkBackendSpawn, pk_backend_spawn, G_TYPE_OBJECT)
@@ -85,470 +97,687 @@ pk_backend_spawn_set_filter_stderr (PkBackendSpawn *backend_spawn, PkBackendSpaw
 	return TRUE;
 }
 
+static PkBackendSpawnInstance *
+pk_backend_spawn_instance_for_spawn (PkBackendSpawn *backend_spawn, PkSpawn *spawn)
+{
+	guint i;
+	PkBackendSpawnInstance *instance;
+
+	for (i = 0; i < backend_spawn->priv->instances->len; i++) {
+		instance = g_ptr_array_index (backend_spawn->priv->instances, i);
+		if (instance->spawn == spawn)
+			return instance;
+	}
+	return NULL;
+}
+
 static gboolean
-pk_backend_spawn_exit_timeout_cb (PkBackendSpawn *backend_spawn)
+pk_backend_spawn_instance_idle_cb (gpointer user_data)
 {
-	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+	PkBackendSpawnInstance *instance = (PkBackendSpawnInstance *) user_data;
 
 	/* only try to close if running */
-	if (pk_spawn_is_running (backend_spawn->priv->spawn)) {
+	instance->idle_id = 0;
+	if (pk_spawn_is_running (instance->spawn)) {
 		g_debug ("closing dispatcher as running and is idle");
-		pk_spawn_exit (backend_spawn->priv->spawn);
+		pk_spawn_exit (instance->spawn);
 	}
-	backend_spawn->priv->kill_id = 0;
 	return FALSE;
 }
 
 static void
 pk_backend_spawn_start_kill_timer (PkBackendSpawn *backend_spawn)
 {
-	gint timeout;
+	PkBackendSpawnInstance *instance;
 	PkBackendSpawnPrivate *priv = backend_spawn->priv;
 
 	/* we finished okay, so we don't need to emulate Finished() for a crashing script */
 	priv->finished = TRUE;
 	g_debug ("backend marked as finished, so starting kill timer");
 
-	if (priv->kill_id > 0)
-		g_source_remove (priv->kill_id);
-
-	/* get policy timeout */
-	timeout = g_key_file_get_integer (priv->conf, "Daemon", "BackendShutdownTimeout", NULL);
-	if (timeout == 0) {
-		g_warning ("using built in default value");
-		timeout = 5;
-	}
+	instance = pk_backend_spawn_instance_for_spawn (backend_spawn, priv->spawn);
+	if (instance == NULL)
+		return;
+	if (instance->idle_id > 0)
+		g_source_remove (instance->idle_id);
 
 	/* close down the dispatcher if it is still open after this much time */
-	priv->kill_id = g_timeout_add_seconds (timeout, (GSourceFunc) pk_backend_spawn_exit_timeout_cb, backend_spawn);
-	g_source_set_name_by_id (priv->kill_id, "[PkBackendSpawn] exit");
+	instance->idle_id = g_timeout_add_seconds (priv->idle_timeout,
+						   pk_backend_spawn_instance_idle_cb,
+						   instance);
+	g_source_set_name_by_id (instance->idle_id, "[PkBackendSpawn] exit");
 }
 
+typedef gboolean (*PkBackendSpawnParseFunc)	(PkBackendSpawn	*backend_spawn,
+						 PkBackendJob	*job,
+						 gchar		**sections,
+						 GError		**error);
+
+typedef struct {
+	const gchar		*command;
+	guint			 size;
+	PkBackendSpawnParseFunc	 func;
+} PkBackendSpawnCommand;
+
 static gboolean
-pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
-			       PkBackendJob *job,
-			       const gchar *line,
-			       GError **error)
+pk_backend_spawn_parse_package (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				gchar **sections, GError **error)
 {
-	guint size;
-	gchar *command;
-	gchar *text;
-	guint64 speed;
-	guint64 download_size_remaining;
 	PkInfoEnum info;
-	PkRestartEnum restart;
+
+	if (pk_package_id_check (sections[2]) == FALSE) {
+		g_set_error_literal (error, 1, 0, "invalid package_id");
+		return FALSE;
+	}
+	info = pk_info_enum_from_string (sections[1]);
+	if (info == PK_INFO_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Info enum not recognised, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
+	g_strdelimit (sections[3], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[3], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[3]);
+		return FALSE;
+	}
+	pk_backend_job_package (job, info, sections[2], sections[3]);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_details (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				gchar **sections, GError **error)
+{
 	PkGroupEnum group;
 	gulong package_size;
+	gchar *text;
+
+	group = pk_group_enum_from_string (sections[4]);
+
+	/* ITS4: ignore, checked for overflow */
+	package_size = atol (sections[7]);
+	if (package_size > 1073741824) {
+		g_set_error_literal (error, 1, 0,
+				     "package size cannot be that large");
+		return FALSE;
+	}
+	g_strdelimit (sections[5], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[4], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[5]);
+		return FALSE;
+	}
+	text = g_strdup (sections[5]);
+	/* convert ; to \n as we can't emit them on stdout */
+	g_strdelimit (text, ";", '\n');
+	pk_backend_job_details (job, sections[1], sections[2], sections[3],
+				group, text, sections[6], package_size);
+	g_free (text);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_finished (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				 gchar **sections, GError **error)
+{
+	pk_backend_job_finished (job);
+	backend_spawn->priv->is_busy = FALSE;
+
+	/* from this point on, we can start the kill timer */
+	pk_backend_spawn_start_kill_timer (backend_spawn);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_files (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+			      gchar **sections, GError **error)
+{
+	g_auto(GStrv) tmp = NULL;
+
+	tmp = g_strsplit (sections[2], ";", -1);
+	pk_backend_job_files (job, sections[1], tmp);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_repo_detail (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				    gchar **sections, GError **error)
+{
+	g_strdelimit (sections[2], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[2], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[2]);
+		return FALSE;
+	}
+	if (g_strcmp0 (sections[3], "true") == 0) {
+		pk_backend_job_repo_detail (job, sections[1], sections[2], TRUE);
+	} else if (g_strcmp0 (sections[3], "false") == 0) {
+		pk_backend_job_repo_detail (job, sections[1], sections[2], FALSE);
+	} else {
+		g_set_error (error, 1, 0, "invalid qualifier '%s'", sections[3]);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_update_detail (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				      gchar **sections, GError **error)
+{
+	PkRestartEnum restart;
+	PkUpdateStateEnum update_state_enum;
+	g_auto(GStrv) updates = NULL;
+	g_auto(GStrv) obsoletes = NULL;
+	g_auto(GStrv) vendor_urls = NULL;
+	g_auto(GStrv) bugzilla_urls = NULL;
+	g_auto(GStrv) cve_urls = NULL;
+
+	restart = pk_restart_enum_from_string (sections[7]);
+	if (restart == PK_RESTART_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Restart enum not recognised, and hence ignored: '%s'", sections[7]);
+		return FALSE;
+	}
+	g_strdelimit (sections[12], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[12], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[12]);
+		return FALSE;
+	}
+	update_state_enum = pk_update_state_enum_from_string (sections[10]);
+	/* convert ; to \n as we can't emit them on stdout */
+	g_strdelimit (sections[8], ";", '\n');
+	g_strdelimit (sections[9], ";", '\n');
+	updates = g_strsplit (sections[2], "&", -1);
+	obsoletes = g_strsplit (sections[3], "&", -1);
+	vendor_urls = g_strsplit (sections[4], ";", -1);
+	bugzilla_urls = g_strsplit (sections[5], ";", -1);
+	cve_urls = g_strsplit (sections[6], ";", -1);
+	pk_backend_job_update_detail (job,
+				  sections[1],
+				  updates,
+				  obsoletes,
+				  vendor_urls,
+				  bugzilla_urls,
+				  cve_urls,
+				  restart,
+				  sections[8],
+				  sections[9],
+				  update_state_enum,
+				  sections[11],
+				  sections[12]);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_percentage (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				   gchar **sections, GError **error)
+{
+	gint percentage;
+
+	if (!pk_strtoint (sections[1], &percentage)) {
+		g_set_error (error, 1, 0, "invalid percentage value %s", sections[1]);
+		return FALSE;
+	}
+	if (percentage < 0 || percentage > 100) {
+		g_set_error (error, 1, 0, "invalid percentage value %i", percentage);
+		return FALSE;
+	}
+	pk_backend_job_set_percentage (job, percentage);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_item_progress (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				      gchar **sections, GError **error)
+{
 	gint percentage;
-	PkErrorEnum error_enum;
 	PkStatusEnum status_enum;
+
+	if (!pk_package_id_check (sections[1])) {
+		g_set_error (error, 1, 0, "invalid package_id");
+		return FALSE;
+	}
+	status_enum = pk_status_enum_from_string (sections[2]);
+	if (status_enum == PK_STATUS_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Status enum not recognised, and hence ignored: '%s'", sections[2]);
+		return FALSE;
+	}
+	if (!pk_strtoint (sections[3], &percentage)) {
+		g_set_error (error, 1, 0, "invalid item-progress value %s", sections[3]);
+		return FALSE;
+	}
+	if (percentage < 0 || percentage > 100) {
+		g_set_error (error, 1, 0, "invalid item-progress value %i", percentage);
+		return FALSE;
+	}
+	pk_backend_job_set_item_progress (job,
+					  sections[1],
+					  status_enum,
+					  percentage);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_error (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+			      gchar **sections, GError **error)
+{
+	PkErrorEnum error_enum;
+	gchar *text;
+
+	error_enum = pk_error_enum_from_string (sections[1]);
+	if (error_enum == PK_ERROR_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Error enum not recognised, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
+	/* convert back all the ;'s to newlines */
+	text = g_strdup (sections[2]);
+
+	/* convert ; to \n as we can't emit them on stdout */
+	g_strdelimit (text, ";", '\n');
+
+	/* convert % else we try to format them */
+	g_strdelimit (text, "%", '$');
+
+	pk_backend_job_error_code (job, error_enum, "%s", text);
+	g_free (text);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_require_restart (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+					gchar **sections, GError **error)
+{
 	PkRestartEnum restart_enum;
+
+	restart_enum = pk_restart_enum_from_string (sections[1]);
+	if (restart_enum == PK_RESTART_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Restart enum not recognised, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
+	if (!pk_package_id_check (sections[2])) {
+		g_set_error (error, 1, 0, "invalid package_id");
+		return FALSE;
+	}
+	pk_backend_job_require_restart (job, restart_enum, sections[2]);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_status (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+			       gchar **sections, GError **error)
+{
+	PkStatusEnum status_enum;
+
+	status_enum = pk_status_enum_from_string (sections[1]);
+	if (status_enum == PK_STATUS_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Status enum not recognised, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
+	pk_backend_job_set_status (job, status_enum);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_speed (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+			      gchar **sections, GError **error)
+{
+	guint64 speed;
+
+	if (!pk_strtouint64 (sections[1], &speed)) {
+		g_set_error (error, 1, 0,
+			     "failed to parse speed: '%s'",
+			     sections[1]);
+		return FALSE;
+	}
+	pk_backend_job_set_speed (job, speed);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_download_size_remaining (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+						gchar **sections, GError **error)
+{
+	guint64 download_size_remaining;
+
+	if (!pk_strtouint64 (sections[1], &download_size_remaining)) {
+		g_set_error (error, 1, 0,
+			     "failed to parse download_size_remaining: '%s'",
+			     sections[1]);
+		return FALSE;
+	}
+	pk_backend_job_set_download_size_remaining (job, download_size_remaining);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_allow_cancel (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				     gchar **sections, GError **error)
+{
+	if (g_strcmp0 (sections[1], "true") == 0) {
+		pk_backend_job_set_allow_cancel (job, TRUE);
+	} else if (g_strcmp0 (sections[1], "false") == 0) {
+		pk_backend_job_set_allow_cancel (job, FALSE);
+	} else {
+		g_set_error (error, 1, 0, "invalid section '%s'", sections[1]);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_no_percentage_updates (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+					      gchar **sections, GError **error)
+{
+	pk_backend_job_set_percentage (job, PK_BACKEND_PERCENTAGE_INVALID);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_repo_signature_required (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+						gchar **sections, GError **error)
+{
 	PkSigTypeEnum sig_type;
-	PkUpdateStateEnum update_state_enum;
-	PkMediaTypeEnum media_type_enum;
-	PkDistroUpgradeEnum distro_upgrade_enum;
-	PkBackendSpawnPrivate *priv = backend_spawn->priv;
-	g_auto(GStrv) sections = NULL;
 
-	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+	sig_type = pk_sig_type_enum_from_string (sections[8]);
+	if (sig_type == PK_SIGTYPE_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Sig enum not recognised, and hence ignored: '%s'", sections[8]);
+		return FALSE;
+	}
+	if (pk_strzero (sections[1])) {
+		g_set_error (error, 1, 0, "package_id blank, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
+	if (pk_strzero (sections[2])) {
+		g_set_error (error, 1, 0, "repository name blank, and hence ignored: '%s'", sections[2]);
+		return FALSE;
+	}
 
-	/* check if output line */
-	if (line == NULL)
+	/* pass _all_ of the data */
+	pk_backend_job_repo_signature_required (job, sections[1],
+						  sections[2], sections[3], sections[4],
+						  sections[5], sections[6], sections[7], sig_type);
+	return TRUE;
+}
+
+static gboolean
+pk_backend_spawn_parse_eula_required (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				      gchar **sections, GError **error)
+{
+	if (pk_strzero (sections[1])) {
+		g_set_error (error, 1, 0, "eula_id blank, and hence ignored: '%s'", sections[1]);
 		return FALSE;
+	}
 
-	/* split by tab */
-	sections = g_strsplit (line, "\t", 0);
-	command = sections[0];
+	if (pk_strzero (sections[2])) {
+		g_set_error (error, 1, 0, "package_id blank, and hence ignored: '%s'", sections[2]);
+		return FALSE;
+	}
 
-	/* get size */
-	size = g_strv_length (sections);
+	if (pk_strzero (sections[4])) {
+		g_set_error (error, 1, 0, "agreement name blank, and hence ignored: '%s'", sections[4]);
+		return FALSE;
+	}
 
-	if (g_strcmp0 (command, "package") == 0) {
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (pk_package_id_check (sections[2]) == FALSE) {
-			g_set_error_literal (error, 1, 0, "invalid package_id");
-			return FALSE;
-		}
-		info = pk_info_enum_from_string (sections[1]);
-		if (info == PK_INFO_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Info enum not recognised, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
-		g_strdelimit (sections[3], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[3], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[3]);
-			return FALSE;
-		}
-		pk_backend_job_package (job, info, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "details") == 0) {
-		if (size != 8) {
-			g_set_error (error, 1, 0,
-				     "invalid command'%s', size %i",
-				     command, size);
-			return FALSE;
-		}
-		group = pk_group_enum_from_string (sections[4]);
+	pk_backend_job_eula_required (job, sections[1], sections[2], sections[3], sections[4]);
+	return TRUE;
+}
 
-		/* ITS4: ignore, checked for overflow */
-		package_size = atol (sections[7]);
-		if (package_size > 1073741824) {
-			g_set_error_literal (error, 1, 0,
-					     "package size cannot be that large");
-			return FALSE;
-		}
-		g_strdelimit (sections[5], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[4], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[5]);
-			return FALSE;
-		}
-		text = g_strdup (sections[5]);
-		/* convert ; to \n as we can't emit them on stdout */
-		g_strdelimit (text, ";", '\n');
-		pk_backend_job_details (job, sections[1], sections[2], sections[3],
-					group, text, sections[6], package_size);
-		g_free (text);
-	} else if (g_strcmp0 (command, "finished") == 0) {
-		if (size != 1) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		pk_backend_job_finished (job);
-		priv->is_busy = FALSE;
+static gboolean
+pk_backend_spawn_parse_media_change_required (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+					      gchar **sections, GError **error)
+{
+	PkMediaTypeEnum media_type_enum;
 
-		/* from this point on, we can start the kill timer */
-		pk_backend_spawn_start_kill_timer (backend_spawn);
+	media_type_enum = pk_media_type_enum_from_string (sections[1]);
+	if (media_type_enum == PK_MEDIA_TYPE_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "media type enum not recognised, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
 
-	} else if (g_strcmp0 (command, "files") == 0) {
-		g_auto(GStrv) tmp = NULL;
-		if (size != 3) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		tmp = g_strsplit (sections[2], ";", -1);
-		pk_backend_job_files (job, sections[1], tmp);
-	} else if (g_strcmp0 (command, "repo-detail") == 0) {
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		g_strdelimit (sections[2], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[2], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[2]);
-			return FALSE;
-		}
-		if (g_strcmp0 (sections[3], "true") == 0) {
-			pk_backend_job_repo_detail (job, sections[1], sections[2], TRUE);
-		} else if (g_strcmp0 (sections[3], "false") == 0) {
-			pk_backend_job_repo_detail (job, sections[1], sections[2], FALSE);
-		} else {
-			g_set_error (error, 1, 0, "invalid qualifier '%s'", sections[3]);
-			return FALSE;
-		}
-	} else if (g_strcmp0 (command, "updatedetail") == 0) {
-		g_auto(GStrv) updates = NULL;
-		g_auto(GStrv) obsoletes = NULL;
-		g_auto(GStrv) vendor_urls = NULL;
-		g_auto(GStrv) bugzilla_urls = NULL;
-		g_auto(GStrv) cve_urls = NULL;
-		if (size != 13) {
-			g_set_error (error, 1, 0, "invalid command '%s', size %i", command, size);
-			return FALSE;
-		}
-		restart = pk_restart_enum_from_string (sections[7]);
-		if (restart == PK_RESTART_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Restart enum not recognised, and hence ignored: '%s'", sections[7]);
-			return FALSE;
-		}
-		g_strdelimit (sections[12], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[12], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[12]);
-			return FALSE;
-		}
-		update_state_enum = pk_update_state_enum_from_string (sections[10]);
-		/* convert ; to \n as we can't emit them on stdout */
-		g_strdelimit (sections[8], ";", '\n');
-		g_strdelimit (sections[9], ";", '\n');
-		updates = g_strsplit (sections[2], "&", -1);
-		obsoletes = g_strsplit (sections[3], "&", -1);
-		vendor_urls = g_strsplit (sections[4], ";", -1);
-		bugzilla_urls = g_strsplit (sections[5], ";", -1);
-		cve_urls = g_strsplit (sections[6], ";", -1);
-		pk_backend_job_update_detail (job,
-					  sections[1],
-					  updates,
-					  obsoletes,
-					  vendor_urls,
-					  bugzilla_urls,
-					  cve_urls,
-					  restart,
-					  sections[8],
-					  sections[9],
-					  update_state_enum,
-					  sections[11],
-					  sections[12]);
-	} else if (g_strcmp0 (command, "percentage") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (!pk_strtoint (sections[1], &percentage)) {
-			g_set_error (error, 1, 0, "invalid percentage value %s", sections[1]);
-			return FALSE;
-		} else if (percentage < 0 || percentage > 100) {
-			g_set_error (error, 1, 0, "invalid percentage value %i", percentage);
-			return FALSE;
-		} else {
-			pk_backend_job_set_percentage (job, percentage);
-		}
-	} else if (g_strcmp0 (command, "item-progress") == 0) {
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (!pk_package_id_check (sections[1])) {
-			g_set_error (error, 1, 0, "invalid package_id");
-			return FALSE;
-		}
-		status_enum = pk_status_enum_from_string (sections[2]);
-		if (status_enum == PK_STATUS_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Status enum not recognised, and hence ignored: '%s'", sections[2]);
-			return FALSE;
-		}
-		if (!pk_strtoint (sections[3], &percentage)) {
-			g_set_error (error, 1, 0, "invalid item-progress value %s", sections[3]);
-			return FALSE;
-		}
-		if (percentage < 0 || percentage > 100) {
-			g_set_error (error, 1, 0, "invalid item-progress value %i", percentage);
-			return FALSE;
-		}
-		pk_backend_job_set_item_progress (job,
-						  sections[1],
-						  status_enum,
-						  percentage);
-	} else if (g_strcmp0 (command, "error") == 0) {
-		if (size != 3) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		error_enum = pk_error_enum_from_string (sections[1]);
-		if (error_enum == PK_ERROR_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Error enum not recognised, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
-		/* convert back all the ;'s to newlines */
-		text = g_strdup (sections[2]);
+	pk_backend_job_media_change_required (job, media_type_enum, sections[2], sections[3]);
+	return TRUE;
+}
 
-		/* convert ; to \n as we can't emit them on stdout */
-		g_strdelimit (text, ";", '\n');
+static gboolean
+pk_backend_spawn_parse_distro_upgrade (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				       gchar **sections, GError **error)
+{
+	PkDistroUpgradeEnum distro_upgrade_enum;
 
-		/* convert % else we try to format them */
-		g_strdelimit (text, "%", '$');
+	distro_upgrade_enum = pk_distro_upgrade_enum_from_string (sections[1]);
+	if (distro_upgrade_enum == PK_DISTRO_UPGRADE_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "distro upgrade enum not recognised, and hence ignored: '%s'", sections[1]);
+		return FALSE;
+	}
+	g_strdelimit (sections[3], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[3], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[3]);
+		return FALSE;
+	}
 
-		pk_backend_job_error_code (job, error_enum, "%s", text);
-		g_free (text);
-	} else if (g_strcmp0 (command, "requirerestart") == 0) {
-		if (size != 3) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		restart_enum = pk_restart_enum_from_string (sections[1]);
-		if (restart_enum == PK_RESTART_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Restart enum not recognised, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
-		if (!pk_package_id_check (sections[2])) {
-			g_set_error (error, 1, 0, "invalid package_id");
-			return FALSE;
-		}
-		pk_backend_job_require_restart (job, restart_enum, sections[2]);
-	} else if (g_strcmp0 (command, "status") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		status_enum = pk_status_enum_from_string (sections[1]);
-		if (status_enum == PK_STATUS_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Status enum not recognised, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
-		pk_backend_job_set_status (job, status_enum);
-	} else if (g_strcmp0 (command, "speed") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (!pk_strtouint64 (sections[1], &speed)) {
-			g_set_error (error, 1, 0,
-				     "failed to parse speed: '%s'",
-				     sections[1]);
-			return FALSE;
-		}
-		pk_backend_job_set_speed (job, speed);
-	} else if (g_strcmp0 (command, "download-size-remaining") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (!pk_strtouint64 (sections[1], &download_size_remaining)) {
-			g_set_error (error, 1, 0,
-				     "failed to parse download_size_remaining: '%s'",
-				     sections[1]);
-			return FALSE;
-		}
-		pk_backend_job_set_download_size_remaining (job, download_size_remaining);
-	} else if (g_strcmp0 (command, "allow-cancel") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (g_strcmp0 (sections[1], "true") == 0) {
-			pk_backend_job_set_allow_cancel (job, TRUE);
-		} else if (g_strcmp0 (sections[1], "false") == 0) {
-			pk_backend_job_set_allow_cancel (job, FALSE);
-		} else {
-			g_set_error (error, 1, 0, "invalid section '%s'", sections[1]);
-			return FALSE;
-		}
-	} else if (g_strcmp0 (command, "no-percentage-updates") == 0) {
-		if (size != 1) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		pk_backend_job_set_percentage (job, PK_BACKEND_PERCENTAGE_INVALID);
-	} else if (g_strcmp0 (command, "repo-signature-required") == 0) {
+	pk_backend_job_distro_upgrade (job, distro_upgrade_enum, sections[2], sections[3]);
+	return TRUE;
+}
 
-		if (size != 9) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+static gboolean
+pk_backend_spawn_parse_category (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				 gchar **sections, GError **error)
+{
+	if (g_strcmp0 (sections[1], sections[2]) == 0) {
+		g_set_error_literal (error, 1, 0, "cat_id cannot be the same as parent_id");
+		return FALSE;
+	}
+	if (pk_strzero (sections[2])) {
+		g_set_error_literal (error, 1, 0, "cat_id cannot not blank");
+		return FALSE;
+	}
+	if (pk_strzero (sections[3])) {
+		g_set_error_literal (error, 1, 0, "name cannot not blank");
+		return FALSE;
+	}
+	g_strdelimit (sections[4], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[4], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[4]);
+		return FALSE;
+	}
+	if (pk_strzero (sections[5])) {
+		g_set_error_literal (error, 1, 0, "icon cannot not blank");
+		return FALSE;
+	}
+	if (g_str_has_prefix (sections[5], "/")) {
+		g_set_error (error, 1, 0, "icon '%s' should be a named icon, not a path", sections[5]);
+		return FALSE;
+	}
+	pk_backend_job_category (job, sections[1], sections[2], sections[3], sections[4], sections[5]);
+	return TRUE;
+}
 
-		sig_type = pk_sig_type_enum_from_string (sections[8]);
-		if (sig_type == PK_SIGTYPE_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Sig enum not recognised, and hence ignored: '%s'", sections[8]);
-			return FALSE;
-		}
-		if (pk_strzero (sections[1])) {
-			g_set_error (error, 1, 0, "package_id blank, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
-		if (pk_strzero (sections[2])) {
-			g_set_error (error, 1, 0, "repository name blank, and hence ignored: '%s'", sections[2]);
-			return FALSE;
-		}
+static gboolean
+pk_backend_spawn_parse_framing (PkBackendSpawn *backend_spawn, PkBackendJob *job,
+				gchar **sections, GError **error)
+{
+	if (g_strcmp0 (sections[1], "binary") == 0) {
+		pk_spawn_set_framing (backend_spawn->priv->spawn, PK_SPAWN_FRAMING_BINARY);
+	} else if (g_strcmp0 (sections[1], "text") == 0) {
+		pk_spawn_set_framing (backend_spawn->priv->spawn, PK_SPAWN_FRAMING_TEXT);
+	} else {
+		g_set_error (error, 1, 0, "invalid framing '%s'", sections[1]);
+		return FALSE;
+	}
+	return TRUE;
+}
 
-		/* pass _all_ of the data */
-		pk_backend_job_repo_signature_required (job, sections[1],
-							  sections[2], sections[3], sections[4],
-							  sections[5], sections[6], sections[7], sig_type);
-	} else if (g_strcmp0 (command, "eula-required") == 0) {
+/* the size includes the command itself; the index is the tag used for the
+ * command in binary frames, so new commands must only ever be appended and
+ * lib/python/packagekit/backend.py kept in sync */
+static const PkBackendSpawnCommand pk_backend_spawn_commands[] = {
+	{ "package",			4,	pk_backend_spawn_parse_package },
+	{ "details",			8,	pk_backend_spawn_parse_details },
+	{ "finished",			1,	pk_backend_spawn_parse_finished },
+	{ "files",			3,	pk_backend_spawn_parse_files },
+	{ "repo-detail",		4,	pk_backend_spawn_parse_repo_detail },
+	{ "updatedetail",		13,	pk_backend_spawn_parse_update_detail },
+	{ "percentage",			2,	pk_backend_spawn_parse_percentage },
+	{ "item-progress",		4,	pk_backend_spawn_parse_item_progress },
+	{ "error",			3,	pk_backend_spawn_parse_error },
+	{ "requirerestart",		3,	pk_backend_spawn_parse_require_restart },
+	{ "status",			2,	pk_backend_spawn_parse_status },
+	{ "speed",			2,	pk_backend_spawn_parse_speed },
+	{ "download-size-remaining",	2,	pk_backend_spawn_parse_download_size_remaining },
+	{ "allow-cancel",		2,	pk_backend_spawn_parse_allow_cancel },
+	{ "no-percentage-updates",	1,	pk_backend_spawn_parse_no_percentage_updates },
+	{ "repo-signature-required",	9,	pk_backend_spawn_parse_repo_signature_required },
+	{ "eula-required",		5,	pk_backend_spawn_parse_eula_required },
+	{ "media-change-required",	4,	pk_backend_spawn_parse_media_change_required },
+	{ "distro-upgrade",		4,	pk_backend_spawn_parse_distro_upgrade },
+	{ "category",			6,	pk_backend_spawn_parse_category },
+	{ "framing",			2,	pk_backend_spawn_parse_framing },
+};
 
-		if (size != 5) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+/* command name to PkBackendSpawnCommand, filled in class_init */
+static GHashTable *pk_backend_spawn_commands_by_name = NULL;
 
-		if (pk_strzero (sections[1])) {
-			g_set_error (error, 1, 0, "eula_id blank, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
+static gboolean
+pk_backend_spawn_dispatch (PkBackendSpawn *backend_spawn,
+			   PkBackendJob *job,
+			   const PkBackendSpawnCommand *cmd,
+			   gchar **sections,
+			   guint size,
+			   GError **error)
+{
+	if (size != cmd->size) {
+		g_set_error (error, 1, 0, "invalid command '%s', size %i", cmd->command, size);
+		return FALSE;
+	}
+	return cmd->func (backend_spawn, job, sections, error);
+}
 
-		if (pk_strzero (sections[2])) {
-			g_set_error (error, 1, 0, "package_id blank, and hence ignored: '%s'", sections[2]);
-			return FALSE;
-		}
+static gboolean
+pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       const gchar *line,
+			       GError **error)
+{
+	guint size = 0;
+	gchar *tab;
+	gchar *sections[PK_BACKEND_SPAWN_SECTIONS_MAX + 1];
+	const PkBackendSpawnCommand *cmd;
+	g_autofree gchar *buffer = NULL;
 
-		if (pk_strzero (sections[4])) {
-			g_set_error (error, 1, 0, "agreement name blank, and hence ignored: '%s'", sections[4]);
-			return FALSE;
-		}
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
 
-		pk_backend_job_eula_required (job, sections[1], sections[2], sections[3], sections[4]);
-	} else if (g_strcmp0 (command, "media-change-required") == 0) {
+	/* check if output line */
+	if (line == NULL)
+		return FALSE;
 
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+	/* split by tab in place, no command has more than
+	 * PK_BACKEND_SPAWN_SECTIONS_MAX sections so stop counting there */
+	buffer = g_strdup (line);
+	sections[size++] = buffer;
+	for (tab = strchr (buffer, '\t'); tab != NULL; tab = strchr (tab + 1, '\t')) {
+		*tab = '\0';
+		if (size++ == PK_BACKEND_SPAWN_SECTIONS_MAX)
+			break;
+		sections[size - 1] = tab + 1;
+	}
+	sections[MIN (size, PK_BACKEND_SPAWN_SECTIONS_MAX)] = NULL;
 
-		media_type_enum = pk_media_type_enum_from_string (sections[1]);
-		if (media_type_enum == PK_MEDIA_TYPE_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "media type enum not recognised, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
+	cmd = g_hash_table_lookup (pk_backend_spawn_commands_by_name, sections[0]);
+	if (cmd == NULL) {
+		g_set_error (error, 1, 0, "invalid command '%s'", sections[0]);
+		return FALSE;
+	}
+	return pk_backend_spawn_dispatch (backend_spawn, job, cmd, sections, size, error);
+}
 
-		pk_backend_job_media_change_required (job, media_type_enum, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "distro-upgrade") == 0) {
+/* reads an unsigned LEB128 varint that fits in 32 bits */
+static gboolean
+pk_backend_spawn_read_varint (const guint8 *data, gsize len, gsize *pos, guint32 *value)
+{
+	guint shift;
 
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+	*value = 0;
+	for (shift = 0; shift < 32 && *pos < len; shift += 7) {
+		guint8 byte = data[(*pos)++];
+		*value |= (guint32) (byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* pk_backend_spawn_parse_frame:
+ *
+ * A binary frame is the tag of the command, i.e. its index in
+ * pk_backend_spawn_commands, followed by each section as a varint length
+ * and that many bytes. Sections are copied into frame_buf so they can be
+ * NUL terminated for the same handlers the text lines use.
+ **/
+static gboolean
+pk_backend_spawn_parse_frame (PkBackendSpawn *backend_spawn,
+			      PkBackendJob *job,
+			      const guint8 *data,
+			      gsize len,
+			      GError **error)
+{
+	guint i;
+	guint size = 1;
+	gsize pos = 1;
+	guint32 section_len;
+	gsize offsets[PK_BACKEND_SPAWN_SECTIONS_MAX];
+	gchar *sections[PK_BACKEND_SPAWN_SECTIONS_MAX + 1];
+	const PkBackendSpawnCommand *cmd;
+	GString *buffer = backend_spawn->priv->frame_buf;
+
+	if (len == 0) {
+		g_set_error_literal (error, 1, 0, "empty frame");
+		return FALSE;
+	}
+	if (data[0] >= G_N_ELEMENTS (pk_backend_spawn_commands)) {
+		g_set_error (error, 1, 0, "invalid command tag %u", data[0]);
+		return FALSE;
+	}
+	cmd = &pk_backend_spawn_commands[data[0]];
 
-		distro_upgrade_enum = pk_distro_upgrade_enum_from_string (sections[1]);
-		if (distro_upgrade_enum == PK_DISTRO_UPGRADE_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "distro upgrade enum not recognised, and hence ignored: '%s'", sections[1]);
+	g_string_set_size (buffer, 0);
+	while (pos < len) {
+		if (size == cmd->size) {
+			g_set_error (error, 1, 0, "too many sections for command '%s'", cmd->command);
 			return FALSE;
 		}
-		g_strdelimit (sections[3], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[3], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[3]);
+		if (!pk_backend_spawn_read_varint (data, len, &pos, &section_len) ||
+		    len - pos < section_len) {
+			g_set_error (error, 1, 0, "truncated frame for command '%s'", cmd->command);
 			return FALSE;
 		}
+		offsets[size++] = buffer->len;
+		g_string_append_len (buffer, (const gchar *) data + pos, section_len);
+		g_string_append_c (buffer, '\0');
+		pos += section_len;
+	}
 
-		pk_backend_job_distro_upgrade (job, distro_upgrade_enum, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "category") == 0) {
+	/* the buffer is only stable once everything has been appended */
+	sections[0] = (gchar *) cmd->command;
+	for (i = 1; i < size; i++)
+		sections[i] = buffer->str + offsets[i];
+	sections[size] = NULL;
 
-		if (size != 6) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-		if (g_strcmp0 (sections[1], sections[2]) == 0) {
-			g_set_error_literal (error, 1, 0, "cat_id cannot be the same as parent_id");
-			return FALSE;
-		}
-		if (pk_strzero (sections[2])) {
-			g_set_error_literal (error, 1, 0, "cat_id cannot not blank");
-			return FALSE;
-		}
-		if (pk_strzero (sections[3])) {
-			g_set_error_literal (error, 1, 0, "name cannot not blank");
-			return FALSE;
-		}
-		g_strdelimit (sections[4], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[4], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[4]);
-			return FALSE;
-		}
-		if (pk_strzero (sections[5])) {
-			g_set_error_literal (error, 1, 0, "icon cannot not blank");
-			return FALSE;
-		}
-		if (g_str_has_prefix (sections[5], "/")) {
-			g_set_error (error, 1, 0, "icon '%s' should be a named icon, not a path", sections[5]);
-			return FALSE;
-		}
-		pk_backend_job_category (job, sections[1], sections[2], sections[3], sections[4], sections[5]);
-	} else {
-		g_set_error (error, 1, 0, "invalid command '%s'", command);
-		return FALSE;
+	/* the stdout filter only understands text lines, so give it the
+	 * line the helper would have printed without binary framing */
+	if (backend_spawn->priv->stdout_func != NULL) {
+		g_autofree gchar *line = g_strjoinv ("\t", sections);
+		if (!backend_spawn->priv->stdout_func (job, line))
+			return TRUE;
 	}
-	return TRUE;
+	return pk_backend_spawn_dispatch (backend_spawn, job, cmd, sections, size, error);
 }
 
 static void
@@ -557,6 +786,12 @@ pk_backend_spawn_exit_cb (PkSpawn *spawn, PkSpawnExitType exit_enum, PkBackendSp
 	gboolean ret;
 	g_return_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn));
 
+	/* an idle helper in the pool was evicted or died, no job to tidy up */
+	if (spawn != backend_spawn->priv->spawn) {
+		g_debug ("pooled helper exited: %i", exit_enum);
+		return;
+	}
+
 	/* reset the busy flag */
 	backend_spawn->priv->is_busy = FALSE;
 
@@ -567,6 +802,12 @@ pk_backend_spawn_exit_cb (PkSpawn *spawn, PkSpawnExitType exit_enum, PkBackendSp
 				       "Process had to be killed to be cancelled");
 	}
 
+	/* the helper was killed as its output could no longer be parsed */
+	if (exit_enum == PK_SPAWN_EXIT_TYPE_PROTOCOL_ERROR && !backend_spawn->priv->finished) {
+		pk_backend_job_error_code (backend_spawn->priv->job, PK_ERROR_ENUM_INTERNAL_ERROR,
+				       "The backend sent a frame that was too large to parse");
+	}
+
 	if (exit_enum == PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT ||
 	    exit_enum == PK_SPAWN_EXIT_TYPE_DISPATCHER_CHANGED) {
 		g_debug ("dispatcher exited, nothing to see here");
@@ -604,11 +845,33 @@ pk_backend_spawn_inject_data (PkBackendSpawn *backend_spawn,
 	return pk_backend_spawn_parse_stdout (backend_spawn, job, line, error);
 }
 
+/**
+ * pk_backend_spawn_inject_frame:
+ *
+ * Parses a binary frame as if it had been sent by the helper, with the
+ * length prefix already removed.
+ **/
+gboolean
+pk_backend_spawn_inject_frame (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       const guint8 *data,
+			       gsize len,
+			       GError **error)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+	return pk_backend_spawn_parse_frame (backend_spawn, job, data, len, error);
+}
+
 static void
-pk_backend_spawn_stdout_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendSpawn *backend_spawn)
+pk_backend_spawn_stdout_cb (PkSpawn *spawn, const gchar *line, PkBackendSpawn *backend_spawn)
 {
 	gboolean ret;
 	g_autoptr(GError) error = NULL;
+
+	if (spawn != backend_spawn->priv->spawn) {
+		g_warning ("ignoring output from idle helper: %s", line);
+		return;
+	}
 	ret = pk_backend_spawn_inject_data (backend_spawn,
 					    backend_spawn->priv->job,
 					    line,
@@ -618,7 +881,26 @@ pk_backend_spawn_stdout_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendS
 }
 
 static void
-pk_backend_spawn_stderr_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendSpawn *backend_spawn)
+pk_backend_spawn_frame_cb (PkSpawn *spawn, gpointer data, guint len, PkBackendSpawn *backend_spawn)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+
+	if (spawn != backend_spawn->priv->spawn) {
+		g_warning ("ignoring frame from idle helper");
+		return;
+	}
+
+	ret = pk_backend_spawn_inject_frame (backend_spawn,
+					     backend_spawn->priv->job,
+					     data, len,
+					     &error);
+	if (!ret)
+		g_warning ("failed to parse frame: %s", error->message);
+}
+
+static void
+pk_backend_spawn_stderr_cb (PkSpawn *spawn, const gchar *line, PkBackendSpawn *backend_spawn)
 {
 	gboolean ret;
 	g_return_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn));
@@ -753,6 +1035,9 @@ pk_backend_spawn_get_envp (PkBackendSpawn *backend_spawn)
 			      g_strdup ("UID"),
 			      g_strdup_printf ("%u", pk_backend_job_get_uid (priv->job)));
 
+	/* helpers can ask for binary framing with "framing\tbinary" */
+	g_hash_table_replace (env_table, g_strdup ("PK_BACKEND_FRAMING"), g_strdup ("binary"));
+
 	/* CACHE_AGE */
 	cache_age = pk_backend_job_get_cache_age (priv->job);
 	if (cache_age == G_MAXUINT) {
@@ -835,6 +1120,82 @@ pk_backend_spawn_va_list_to_argv (const gchar *string_first, va_list *args)
 	return (gchar **) g_ptr_array_free (ptr_array, FALSE);
 }
 
+static PkBackendSpawnInstance *
+pk_backend_spawn_instance_new (PkBackendSpawn *backend_spawn)
+{
+	PkBackendSpawnInstance *instance;
+	PkBackendSpawnPrivate *priv = backend_spawn->priv;
+
+	instance = g_new0 (PkBackendSpawnInstance, 1);
+	instance->backend_spawn = backend_spawn;
+	instance->spawn = pk_spawn_new (priv->conf);
+	g_object_set (instance->spawn,
+		      "allow-sigkill", priv->allow_sigkill,
+		      NULL);
+	g_signal_connect (instance->spawn, "exit",
+			  G_CALLBACK (pk_backend_spawn_exit_cb), backend_spawn);
+	g_signal_connect (instance->spawn, "stdout",
+			  G_CALLBACK (pk_backend_spawn_stdout_cb), backend_spawn);
+	g_signal_connect (instance->spawn, "frame",
+			  G_CALLBACK (pk_backend_spawn_frame_cb), backend_spawn);
+	g_signal_connect (instance->spawn, "stderr",
+			  G_CALLBACK (pk_backend_spawn_stderr_cb), backend_spawn);
+	g_ptr_array_add (priv->instances, instance);
+	g_debug ("helper pool now has %u of %u instances",
+		 priv->instances->len, priv->pool_size);
+	return instance;
+}
+
+static void
+pk_backend_spawn_instance_free (PkBackendSpawnInstance *instance)
+{
+	if (instance->idle_id > 0)
+		g_source_remove (instance->idle_id);
+	g_signal_handlers_disconnect_by_data (instance->spawn, instance->backend_spawn);
+	g_object_unref (instance->spawn);
+	g_free (instance);
+}
+
+/* pk_backend_spawn_instance_find:
+ *
+ * Prefers a running helper that can be handed the command over stdin, then
+ * one that is not running, then a new one if the pool isn't full. Failing
+ * that the least recently used helper is restarted with the new argv.
+ **/
+static PkBackendSpawnInstance *
+pk_backend_spawn_instance_find (PkBackendSpawn *backend_spawn,
+				gchar **argv,
+				gchar **envp,
+				PkSpawnArgvFlags flags)
+{
+	guint i;
+	PkBackendSpawnInstance *instance;
+	PkBackendSpawnInstance *oldest = NULL;
+	PkBackendSpawnInstance *stopped = NULL;
+	PkBackendSpawnPrivate *priv = backend_spawn->priv;
+
+	for (i = 0; i < priv->instances->len; i++) {
+		instance = g_ptr_array_index (priv->instances, i);
+		if (!pk_spawn_is_running (instance->spawn)) {
+			if (stopped == NULL)
+				stopped = instance;
+			continue;
+		}
+		if ((flags & PK_SPAWN_ARGV_FLAGS_NEVER_REUSE) == 0 &&
+		    pk_spawn_can_reuse (instance->spawn, argv, envp)) {
+			g_debug ("using warm helper %u", i);
+			return instance;
+		}
+		if (oldest == NULL || instance->last_used < oldest->last_used)
+			oldest = instance;
+	}
+	if (stopped != NULL)
+		return stopped;
+	if (priv->instances->len < priv->pool_size)
+		return pk_backend_spawn_instance_new (backend_spawn);
+	return oldest;
+}
+
 static gboolean
 pk_backend_spawn_helper_va_list (PkBackendSpawn *backend_spawn,
 				 PkBackendJob *job,
@@ -842,6 +1203,7 @@ pk_backend_spawn_helper_va_list (PkBackendSpawn *backend_spawn,
 				 va_list *args)
 {
 	gboolean background;
+	PkBackendSpawnInstance *instance;
 	PkBackendSpawnPrivate *priv = backend_spawn->priv;
 	PkSpawnArgvFlags flags = PK_SPAWN_ARGV_FLAGS_NONE;
 #ifdef SOURCEROOTDIR
@@ -891,19 +1253,28 @@ pk_backend_spawn_helper_va_list (PkBackendSpawn *backend_spawn,
 	g_free (argv[PK_BACKEND_SPAWN_ARGV0]);
 	argv[PK_BACKEND_SPAWN_ARGV0] = g_strdup (filename);
 
+#ifdef ENABLE_STRACE
+	/* we can't reuse when using strace */
+	flags |= PK_SPAWN_ARGV_FLAGS_NEVER_REUSE;
+#endif
+
+	/* pick the helper from the pool, and don't auto-kill it */
+	envp = pk_backend_spawn_get_envp (backend_spawn);
+	instance = pk_backend_spawn_instance_find (backend_spawn, argv, envp, flags);
+	if (instance->idle_id > 0) {
+		g_source_remove (instance->idle_id);
+		instance->idle_id = 0;
+	}
+	instance->last_used = g_get_monotonic_time ();
+	priv->spawn = instance->spawn;
+
 	/* copy idle setting from backend to PkSpawn instance */
 	background = pk_backend_job_get_background (job);
 	g_object_set (priv->spawn,
 		      "background", (background == TRUE),
 		      NULL);
 
-#ifdef ENABLE_STRACE
-	/* we can't reuse when using strace */
-	flags |= PK_SPAWN_ARGV_FLAGS_NEVER_REUSE;
-#endif
-
 	priv->finished = FALSE;
-	envp = pk_backend_spawn_get_envp (backend_spawn);
 	if (!pk_spawn_argv (priv->spawn, argv, envp, flags, &error)) {
 		pk_backend_job_error_code (priv->job,
 					   PK_ERROR_ENUM_INTERNAL_ERROR,
@@ -957,8 +1328,17 @@ pk_backend_spawn_is_busy (PkBackendSpawn *backend_spawn)
 gboolean
 pk_backend_spawn_exit (PkBackendSpawn *backend_spawn)
 {
+	guint i;
+	PkBackendSpawnInstance *instance;
+
 	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
-	pk_spawn_exit (backend_spawn->priv->spawn);
+
+	/* close the whole pool */
+	for (i = 0; i < backend_spawn->priv->instances->len; i++) {
+		instance = g_ptr_array_index (backend_spawn->priv->instances, i);
+		if (pk_spawn_is_running (instance->spawn))
+			pk_spawn_exit (instance->spawn);
+	}
 	return TRUE;
 }
 
@@ -979,12 +1359,6 @@ pk_backend_spawn_helper (PkBackendSpawn *backend_spawn,
 	backend_spawn->priv->job = job;
 	backend_spawn->priv->backend = g_object_ref (pk_backend_job_get_backend (job));
 
-	/* don't auto-kill this */
-	if (backend_spawn->priv->kill_id > 0) {
-		g_source_remove (backend_spawn->priv->kill_id);
-		backend_spawn->priv->kill_id = 0;
-	}
-
 	/* get the argument list */
 	va_start (args, first_element);
 	ret = pk_backend_spawn_helper_va_list (backend_spawn, job, first_element, &args);
@@ -996,10 +1370,19 @@ pk_backend_spawn_helper (PkBackendSpawn *backend_spawn,
 void
 pk_backend_spawn_set_allow_sigkill (PkBackendSpawn *backend_spawn, gboolean allow_sigkill)
 {
+	guint i;
+	PkBackendSpawnInstance *instance;
+
 	g_return_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn));
-	g_object_set (backend_spawn->priv->spawn,
-		      "allow-sigkill", allow_sigkill,
-		      NULL);
+
+	/* also used for helpers added to the pool later */
+	backend_spawn->priv->allow_sigkill = allow_sigkill;
+	for (i = 0; i < backend_spawn->priv->instances->len; i++) {
+		instance = g_ptr_array_index (backend_spawn->priv->instances, i);
+		g_object_set (instance->spawn,
+			      "allow-sigkill", allow_sigkill,
+			      NULL);
+	}
 }
 
 static void
@@ -1011,12 +1394,10 @@ pk_backend_spawn_finalize (GObject *object)
 
 	backend_spawn = PK_BACKEND_SPAWN (object);
 
-	if (backend_spawn->priv->kill_id > 0)
-		g_source_remove (backend_spawn->priv->kill_id);
-
+	g_ptr_array_unref (backend_spawn->priv->instances);
 	g_free (backend_spawn->priv->name);
+	g_string_free (backend_spawn->priv->frame_buf, TRUE);
 	g_key_file_unref (backend_spawn->priv->conf);
-	g_object_unref (backend_spawn->priv->spawn);
 	if (backend_spawn->priv->backend != NULL)
 		g_object_unref (backend_spawn->priv->backend);
 
@@ -1026,30 +1407,52 @@ pk_backend_spawn_finalize (GObject *object)
 static void
 pk_backend_spawn_class_init (PkBackendSpawnClass *klass)
 {
+	guint i;
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	object_class->finalize = pk_backend_spawn_finalize;
 	g_type_class_add_private (klass, sizeof (PkBackendSpawnPrivate));
+
+	pk_backend_spawn_commands_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < G_N_ELEMENTS (pk_backend_spawn_commands); i++) {
+		g_hash_table_insert (pk_backend_spawn_commands_by_name,
+				     (gpointer) pk_backend_spawn_commands[i].command,
+				     (gpointer) &pk_backend_spawn_commands[i]);
+	}
 }
 
 static void
 pk_backend_spawn_init (PkBackendSpawn *backend_spawn)
 {
 	backend_spawn->priv = PK_BACKEND_SPAWN_GET_PRIVATE (backend_spawn);
+	backend_spawn->priv->frame_buf = g_string_new (NULL);
+	backend_spawn->priv->instances = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_backend_spawn_instance_free);
+	backend_spawn->priv->allow_sigkill = TRUE;
 }
 
 PkBackendSpawn *
 pk_backend_spawn_new (GKeyFile *conf)
 {
+	gint value;
 	PkBackendSpawn *backend_spawn;
+	PkBackendSpawnInstance *instance;
+
 	backend_spawn = g_object_new (PK_TYPE_BACKEND_SPAWN, NULL);
 	backend_spawn->priv->conf = g_key_file_ref (conf);
-	backend_spawn->priv->spawn = pk_spawn_new (backend_spawn->priv->conf);
-	g_signal_connect (backend_spawn->priv->spawn, "exit",
-			  G_CALLBACK (pk_backend_spawn_exit_cb), backend_spawn);
-	g_signal_connect (backend_spawn->priv->spawn, "stdout",
-			  G_CALLBACK (pk_backend_spawn_stdout_cb), backend_spawn);
-	g_signal_connect (backend_spawn->priv->spawn, "stderr",
-			  G_CALLBACK (pk_backend_spawn_stderr_cb), backend_spawn);
+
+	/* how many helpers to keep warm */
+	value = g_key_file_get_integer (conf, "Daemon", "HelperPoolSize", NULL);
+	backend_spawn->priv->pool_size = MAX (value, 1);
+
+	/* and for how long */
+	value = g_key_file_get_integer (conf, "Daemon", "HelperIdleTimeout", NULL);
+	if (value <= 0)
+		value = g_key_file_get_integer (conf, "Daemon", "BackendShutdownTimeout", NULL);
+	if (value <= 0)
+		value = 5;
+	backend_spawn->priv->idle_timeout = value;
+
+	/* there's always one, so the current helper is never NULL */
+	instance = pk_backend_spawn_instance_new (backend_spawn);
+	backend_spawn->priv->spawn = instance->spawn;
 	return PK_BACKEND_SPAWN (backend_spawn);
 }
-
@@ -203,6 +203,7 @@ struct PkBackendPrivate
 	guint			 repo_list_changed_id;
 	guint			 installed_db_changed_id;
 	guint			 updates_changed_id;
+	PkResultsCache		*results_cache;
 };
 
 G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
@@ -210,6 +211,7 @@ G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
 enum {
 	SIGNAL_REPO_LIST_CHANGED,
 	SIGNAL_UPDATES_CHANGED,
+	SIGNAL_INSTALLED_DB_CHANGED,
 	SIGNAL_LAST
 };
 
@@ -620,6 +622,9 @@ pk_backend_repo_list_changed (PkBackend *backend)
 	g_return_if_fail (PK_IS_BACKEND (backend));
 	g_return_if_fail (backend->priv->loaded);
 
+	/* do not answer from the cache until the signal is emitted */
+	pk_results_cache_invalidate (backend->priv->results_cache);
+
 	/* already scheduled */
 	if (backend->priv->repo_list_changed_id != 0)
 		return;
@@ -635,6 +640,8 @@ pk_backend_updates_changed (PkBackend *backend)
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
 	g_return_val_if_fail (pk_is_thread_default (), FALSE);
 
+	pk_results_cache_invalidate (backend->priv->results_cache);
+
 	g_debug ("emitting updates-changed");
 	g_signal_emit (backend, signals [SIGNAL_UPDATES_CHANGED], 0);
 	return TRUE;
@@ -668,12 +675,28 @@ pk_backend_updates_changed_delay (PkBackend *backend, guint timeout)
 	return TRUE;
 }
 
+/**
+ * pk_backend_get_results_cache:
+ *
+ * Return value: (transfer none): the results of queries that are still
+ * valid for the current package and repo state
+ **/
+PkResultsCache *
+pk_backend_get_results_cache (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	return backend->priv->results_cache;
+}
+
 static gboolean
 pk_backend_installed_db_changed_cb (gpointer user_data)
 {
 	PkBackend *backend = PK_BACKEND (user_data);
 	g_autoptr(GError) error = NULL;
 
+	g_debug ("emitting installed-db-changed");
+	g_signal_emit (backend, signals [SIGNAL_INSTALLED_DB_CHANGED], 0);
+
 	if (!backend->priv->transaction_in_progress) {
 		g_debug ("invalidating offline updates");
 		if (!pk_offline_auth_invalidate (&error))
@@ -704,6 +727,9 @@ pk_backend_installed_db_changed (PkBackend *backend)
 	g_return_if_fail (PK_IS_BACKEND (backend));
 	g_return_if_fail (backend->priv->loaded);
 
+	/* do not answer from the cache until the signal is emitted */
+	pk_results_cache_invalidate (backend->priv->results_cache);
+
 	/* already scheduled */
 	if (backend->priv->installed_db_changed_id != 0)
 		return;
@@ -1075,6 +1101,7 @@ pk_backend_finalize (GObject *object)
 	g_mutex_clear (&backend->priv->thread_hash_mutex);
 	g_hash_table_unref (backend->priv->thread_hash);
 	g_free (backend->priv->desc);
+	g_object_unref (backend->priv->results_cache);
 
 	if (backend->priv->monitor != NULL)
 		g_object_unref (backend->priv->monitor);
@@ -1104,6 +1131,11 @@ pk_backend_class_init (PkBackendClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
 			      G_TYPE_NONE, 0);
+	signals [SIGNAL_INSTALLED_DB_CHANGED] =
+		g_signal_new ("installed-db-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 
 	g_type_class_add_private (klass, sizeof (PkBackendPrivate));
 }
@@ -1717,6 +1749,7 @@ pk_backend_init (PkBackend *backend)
 							    g_free);
 	g_mutex_init (&backend->priv->eulas_mutex);
 	g_mutex_init (&backend->priv->thread_hash_mutex);
+	backend->priv->results_cache = pk_results_cache_new ();
 }
 
 PkBackend *
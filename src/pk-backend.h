@@ -36,6 +36,7 @@
 
 #include "pk-backend.h"
 #include "pk-backend-job.h"
+#include "pk-results-cache.h"
 
 G_BEGIN_DECLS
 
@@ -90,6 +91,7 @@ void		 pk_backend_installed_db_changed	(PkBackend      *backend);
 gboolean	 pk_backend_updates_changed		(PkBackend	*backend);
 gboolean	 pk_backend_updates_changed_delay	(PkBackend	*backend,
 							 guint		 timeout);
+PkResultsCache	*pk_backend_get_results_cache		(PkBackend	*backend);
 
 void		 pk_backend_transaction_inhibit_start	(PkBackend      *backend);
 void		 pk_backend_transaction_inhibit_end	(PkBackend      *backend);
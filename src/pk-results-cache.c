@@ -0,0 +1,316 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "pk-shared.h"
+
+#include "pk-results-cache.h"
+
+/* Keeps the results of queries that only depend on the package and repo
+ * state, e.g. GetUpdates, so they can be answered again without waking up
+ * the backend.
+ *
+ * Anything that may change that state bumps the generation, and results
+ * are only valid for the generation they were computed in.
+ *
+ * Package managers outside of PackageKit do not tell us about their changes,
+ * so the backend also names the files they write, and a change to any of
+ * them is treated the same way. */
+
+static void     pk_results_cache_finalize	(GObject        *object);
+
+#define PK_RESULTS_CACHE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_RESULTS_CACHE, PkResultsCachePrivate))
+
+struct PkResultsCachePrivate
+{
+	GHashTable		*hash;
+	gint			 generation;
+	guint			 hits;
+	guint			 misses;
+	GPtrArray		*stamp_files;
+	GArray			*stamp;
+};
+
+typedef struct {
+	guint			 generation;
+	gint64			 created;
+	PkResults		*results;
+} PkResultsCacheItem;
+
+G_DEFINE_TYPE (PkResultsCache, pk_results_cache, G_TYPE_OBJECT)
+
+static void
+pk_results_cache_item_free (PkResultsCacheItem *item)
+{
+	g_object_unref (item->results);
+	g_free (item);
+}
+
+/* pk_results_cache_get_stamp:
+ *
+ * Returns the modification time and size of each stamp file, so that
+ * writing any of them gives a different array.
+ **/
+static GArray *
+pk_results_cache_get_stamp (PkResultsCache *cache)
+{
+	GArray *stamp;
+	GStatBuf buf;
+	gint64 value;
+
+	stamp = g_array_new (FALSE, FALSE, sizeof (gint64));
+	for (guint i = 0; i < cache->priv->stamp_files->len; i++) {
+		const gchar *filename = g_ptr_array_index (cache->priv->stamp_files, i);
+		if (g_stat (filename, &buf) != 0) {
+			value = 0;
+			g_array_append_val (stamp, value);
+			g_array_append_val (stamp, value);
+			continue;
+		}
+		value = (gint64) buf.st_mtim.tv_sec * G_USEC_PER_SEC + buf.st_mtim.tv_nsec / 1000;
+		g_array_append_val (stamp, value);
+		value = (gint64) buf.st_size;
+		g_array_append_val (stamp, value);
+	}
+	return stamp;
+}
+
+/* pk_results_cache_check_stamp:
+ *
+ * Invalidates the cache if a stamp file changed since the last check.
+ **/
+static void
+pk_results_cache_check_stamp (PkResultsCache *cache)
+{
+	GArray *stamp;
+
+	if (cache->priv->stamp_files->len == 0)
+		return;
+
+	stamp = pk_results_cache_get_stamp (cache);
+	if (stamp->len == cache->priv->stamp->len &&
+	    memcmp (stamp->data, cache->priv->stamp->data,
+		    stamp->len * sizeof (gint64)) == 0) {
+		g_array_unref (stamp);
+		return;
+	}
+	g_debug ("stamp files changed, invalidating results");
+	pk_results_cache_invalidate (cache);
+	g_array_unref (cache->priv->stamp);
+	cache->priv->stamp = stamp;
+}
+
+/**
+ * pk_results_cache_add_stamp_file:
+ * @filename: a file written by the package manager, e.g. the package database
+ *
+ * Makes the saved results stale whenever @filename changes, even if the
+ * change was made without PackageKit, e.g. by running the native tools.
+ * The file does not have to exist yet.
+ **/
+void
+pk_results_cache_add_stamp_file (PkResultsCache *cache, const gchar *filename)
+{
+	g_return_if_fail (PK_IS_RESULTS_CACHE (cache));
+	g_return_if_fail (filename != NULL);
+	g_return_if_fail (pk_is_thread_default ());
+
+	g_ptr_array_add (cache->priv->stamp_files, g_strdup (filename));
+	g_array_unref (cache->priv->stamp);
+	cache->priv->stamp = pk_results_cache_get_stamp (cache);
+}
+
+/**
+ * pk_results_cache_get_generation:
+ *
+ * Return value: the generation that results computed from now on belong to
+ **/
+guint
+pk_results_cache_get_generation (PkResultsCache *cache)
+{
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), 0);
+	g_return_val_if_fail (pk_is_thread_default (), 0);
+
+	pk_results_cache_check_stamp (cache);
+	return (guint) g_atomic_int_get (&cache->priv->generation);
+}
+
+/**
+ * pk_results_cache_invalidate:
+ *
+ * Drops all the results, as the package or repo state may have changed.
+ * This function can be called on any thread.
+ **/
+void
+pk_results_cache_invalidate (PkResultsCache *cache)
+{
+	g_return_if_fail (PK_IS_RESULTS_CACHE (cache));
+
+	/* the stale items are removed lazily in the main thread */
+	g_atomic_int_inc (&cache->priv->generation);
+}
+
+static gboolean
+pk_results_cache_item_is_stale_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	PkResultsCacheItem *item = (PkResultsCacheItem *) value;
+	return item->generation != GPOINTER_TO_UINT (user_data);
+}
+
+/**
+ * pk_results_cache_lookup:
+ * @max_age: the oldest results to return in seconds, or %G_MAXUINT
+ *
+ * Return value: (transfer full): the results saved for @key, or %NULL
+ **/
+PkResults *
+pk_results_cache_lookup (PkResultsCache *cache, const gchar *key, guint max_age)
+{
+	PkResultsCacheItem *item;
+	gint64 age;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+	g_return_val_if_fail (pk_is_thread_default (), NULL);
+
+	item = g_hash_table_lookup (cache->priv->hash, key);
+	if (item != NULL &&
+	    item->generation == pk_results_cache_get_generation (cache)) {
+		age = (g_get_monotonic_time () - item->created) / G_USEC_PER_SEC;
+		if (max_age == G_MAXUINT || age <= max_age) {
+			cache->priv->hits++;
+			return g_object_ref (item->results);
+		}
+	}
+
+	/* this is going to be replaced by the new results */
+	if (item != NULL)
+		g_hash_table_remove (cache->priv->hash, key);
+	cache->priv->misses++;
+	return NULL;
+}
+
+/**
+ * pk_results_cache_add:
+ * @generation: the generation when the query was started
+ *
+ * Saves the results of a query, unless the state changed while it was
+ * running.
+ **/
+void
+pk_results_cache_add (PkResultsCache *cache,
+		      const gchar *key,
+		      guint generation,
+		      PkResults *results)
+{
+	PkResultsCacheItem *item;
+	guint current;
+
+	g_return_if_fail (PK_IS_RESULTS_CACHE (cache));
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (PK_IS_RESULTS (results));
+	g_return_if_fail (pk_is_thread_default ());
+
+	current = pk_results_cache_get_generation (cache);
+	g_hash_table_foreach_remove (cache->priv->hash,
+				     pk_results_cache_item_is_stale_cb,
+				     GUINT_TO_POINTER (current));
+	if (generation != current) {
+		g_debug ("not caching %s as the state has changed", key);
+		return;
+	}
+
+	item = g_new0 (PkResultsCacheItem, 1);
+	item->generation = generation;
+	item->created = g_get_monotonic_time ();
+	item->results = g_object_ref (results);
+	g_hash_table_insert (cache->priv->hash, g_strdup (key), item);
+}
+
+/**
+ * pk_results_cache_get_hits:
+ **/
+guint
+pk_results_cache_get_hits (PkResultsCache *cache)
+{
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), 0);
+	return cache->priv->hits;
+}
+
+/**
+ * pk_results_cache_get_misses:
+ **/
+guint
+pk_results_cache_get_misses (PkResultsCache *cache)
+{
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), 0);
+	return cache->priv->misses;
+}
+
+static void
+pk_results_cache_class_init (PkResultsCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_results_cache_finalize;
+	g_type_class_add_private (klass, sizeof (PkResultsCachePrivate));
+}
+
+static void
+pk_results_cache_init (PkResultsCache *cache)
+{
+	cache->priv = PK_RESULTS_CACHE_GET_PRIVATE (cache);
+	cache->priv->hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+						   g_free, (GDestroyNotify) pk_results_cache_item_free);
+	cache->priv->stamp_files = g_ptr_array_new_with_free_func (g_free);
+	cache->priv->stamp = g_array_new (FALSE, FALSE, sizeof (gint64));
+}
+
+static void
+pk_results_cache_finalize (GObject *object)
+{
+	PkResultsCache *cache;
+	g_return_if_fail (PK_IS_RESULTS_CACHE (object));
+	cache = PK_RESULTS_CACHE (object);
+
+	g_hash_table_unref (cache->priv->hash);
+	g_ptr_array_unref (cache->priv->stamp_files);
+	g_array_unref (cache->priv->stamp);
+
+	G_OBJECT_CLASS (pk_results_cache_parent_class)->finalize (object);
+}
+
+/**
+ * pk_results_cache_new:
+ *
+ * Return value: a new #PkResultsCache object.
+ **/
+PkResultsCache *
+pk_results_cache_new (void)
+{
+	PkResultsCache *cache;
+	cache = g_object_new (PK_TYPE_RESULTS_CACHE, NULL);
+	return PK_RESULTS_CACHE (cache);
+}
@@ -61,6 +61,7 @@
 
 #include <glib/gi18n.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-transaction-past.h>
 
 #include "pk-shared.h"
 #include "pk-transaction.h"
@@ -86,6 +87,19 @@ static void     pk_scheduler_finalize	(GObject	*object);
 /* maximum number of requests a given user is able to request and queue */
 #define PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID	500
 
+/* how many old transactions are used to guess the runtime of each role */
+#define PK_SCHEDULER_COST_HISTORY			100
+
+/* the runtime we guess for a role that was never run */
+#define PK_SCHEDULER_COST_DEFAULT			1000 /* ms */
+
+/* a transaction gets 1 ms cheaper for every this many ms it waits, so a
+ * role that is expected to take a second more only overtakes after ~4s */
+#define PK_SCHEDULER_COST_AGING				4
+
+/* how much more expensive background transactions are */
+#define PK_SCHEDULER_COST_BACKGROUND			4
+
 struct PkSchedulerPrivate
 {
 	GPtrArray		*array;
@@ -93,6 +107,8 @@ struct PkSchedulerPrivate
 	GKeyFile		*conf;
 	PkBackend		*backend;
 	GDBusNodeInfo		*introspection;
+	guint			 max_parallel;
+	guint			 costs[PK_ROLE_ENUM_LAST];
 };
 
 typedef struct {
@@ -392,62 +408,239 @@ pk_scheduler_get_background_running (PkScheduler *scheduler)
 	return FALSE;
 }
 
-static PkSchedulerItem *
-pk_scheduler_get_next_item (PkScheduler *scheduler)
+/**
+ * pk_scheduler_get_parallel_running:
+ *
+ * Return value: the number of non-exclusive transactions in progress
+ **/
+static guint
+pk_scheduler_get_parallel_running (PkScheduler *scheduler)
 {
-	PkSchedulerItem *item = NULL;
+	PkSchedulerItem *item;
 	GPtrArray *array;
+	guint count = 0;
 	guint i;
-	PkTransactionState state;
-	gboolean exclusive_running;
 
 	array = scheduler->priv->array;
+	for (i = 0; i < array->len; i++) {
+		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (pk_transaction_get_state (item->transaction) != PK_TRANSACTION_STATE_RUNNING)
+			continue;
+		if (pk_transaction_is_subscriber (item->transaction))
+			continue;
+		if (!pk_transaction_is_exclusive (item->transaction))
+			count++;
+	}
+	return count;
+}
 
-	/* check for running exclusive transaction */
-	exclusive_running = pk_scheduler_get_exclusive_running (scheduler) > 0;
+static guint
+pk_scheduler_get_running_for_uid (PkScheduler *scheduler, guint uid)
+{
+	PkSchedulerItem *item;
+	GPtrArray *array;
+	guint count = 0;
+	guint i;
 
-	/* first try the waiting non-background transactions */
+	array = scheduler->priv->array;
 	for (i = 0; i < array->len; i++) {
 		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
-		state = pk_transaction_get_state (item->transaction);
-
-		if ((state == PK_TRANSACTION_STATE_READY) && (!pk_transaction_get_background (item->transaction))) {
-			/* check if we can run the transaction now or if we need to wait for lock release */
-			if (pk_transaction_is_exclusive (item->transaction)) {
-				if (!exclusive_running)
-					goto out;
-			} else {
-				goto out;
-			}
-		}
+		if (item->uid != uid)
+			continue;
+		if (pk_transaction_is_subscriber (item->transaction))
+			continue;
+		if (pk_transaction_get_state (item->transaction) == PK_TRANSACTION_STATE_RUNNING)
+			count++;
 	}
+	return count;
+}
+
+/* pk_scheduler_add_cost:
+ *
+ * Adds a runtime to the moving average of the role, so the estimate
+ * follows slow changes like a growing repository.
+ **/
+static void
+pk_scheduler_add_cost (PkScheduler *scheduler, PkRoleEnum role, guint runtime)
+{
+	guint *cost;
+
+	if (role >= PK_ROLE_ENUM_LAST)
+		return;
+	cost = &scheduler->priv->costs[role];
+	if (*cost == 0)
+		*cost = runtime;
+	else
+		*cost = ((guint64) *cost * 3 + runtime) / 4;
+
+	/* zero means never run */
+	if (*cost == 0)
+		*cost = 1;
+}
+
+static guint
+pk_scheduler_get_cost (PkScheduler *scheduler, PkRoleEnum role)
+{
+	if (role >= PK_ROLE_ENUM_LAST || scheduler->priv->costs[role] == 0)
+		return PK_SCHEDULER_COST_DEFAULT;
+	return scheduler->priv->costs[role];
+}
+
+/**
+ * pk_scheduler_cost_for:
+ * @role_cost: the expected runtime of the role in ms
+ * @running_for_uid: the number of transactions the user already has running
+ * @background: if the transaction is a background one
+ * @queue_wait_time: how long the transaction has been queued in ms
+ *
+ * Return value: the cost of running a transaction now, lower runs first
+ **/
+gint64
+pk_scheduler_cost_for (guint role_cost,
+		       guint running_for_uid,
+		       gboolean background,
+		       guint queue_wait_time)
+{
+	gint64 cost = role_cost;
+
+	/* share the parallel slots between the users */
+	cost *= 1 + running_for_uid;
+
+	/* let the foreground transactions go first */
+	if (background)
+		cost *= PK_SCHEDULER_COST_BACKGROUND;
+
+	/* so expensive transactions are not starved by a stream of cheap ones */
+	cost -= queue_wait_time / PK_SCHEDULER_COST_AGING;
+	return cost;
+}
+
+static gint64
+pk_scheduler_get_item_cost (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	return pk_scheduler_cost_for (pk_scheduler_get_cost (scheduler, pk_transaction_get_role (item->transaction)),
+				      pk_scheduler_get_running_for_uid (scheduler, item->uid),
+				      pk_transaction_get_background (item->transaction),
+				      pk_transaction_get_queue_wait_time (item->transaction));
+}
+
+static PkSchedulerItem *
+pk_scheduler_get_next_exclusive (PkScheduler *scheduler, gboolean background)
+{
+	PkSchedulerItem *item;
+	GPtrArray *array;
+	guint i;
 
-	/* then try the other waiting transactions (background tasks) */
+	array = scheduler->priv->array;
 	for (i = 0; i < array->len; i++) {
 		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
-		state = pk_transaction_get_state (item->transaction);
+		if (pk_transaction_get_state (item->transaction) != PK_TRANSACTION_STATE_READY)
+			continue;
+		if (!pk_transaction_is_exclusive (item->transaction))
+			continue;
+		if (pk_transaction_get_background (item->transaction) == background)
+			return item;
+	}
+	return NULL;
+}
+
+static PkSchedulerItem *
+pk_scheduler_get_next_item (PkScheduler *scheduler)
+{
+	PkSchedulerItem *item;
+	PkSchedulerItem *item_best = NULL;
+	GPtrArray *array;
+	guint i;
+	gint64 cost;
+	gint64 cost_best = G_MAXINT64;
+
+	array = scheduler->priv->array;
 
-		if (state == PK_TRANSACTION_STATE_READY) {
-			/* check if we can run the transaction now or if we need to wait for lock release */
-			if (pk_transaction_is_exclusive (item->transaction)) {
-				if (!exclusive_running)
-					goto out;
-			} else {
-				goto out;
-			}
+	/* exclusive transactions change the system, so they keep their order,
+	 * waiting non-background transactions first */
+	if (pk_scheduler_get_exclusive_running (scheduler) == 0) {
+		item = pk_scheduler_get_next_exclusive (scheduler, FALSE);
+		if (item == NULL)
+			item = pk_scheduler_get_next_exclusive (scheduler, TRUE);
+		if (item != NULL)
+			return item;
+	}
+
+	/* all the parallel slots are used */
+	if (pk_scheduler_get_parallel_running (scheduler) >= scheduler->priv->max_parallel)
+		return NULL;
+
+	/* the others run side by side, so try the cheapest first */
+	for (i = 0; i < array->len; i++) {
+		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (pk_transaction_get_state (item->transaction) != PK_TRANSACTION_STATE_READY)
+			continue;
+		if (pk_transaction_is_exclusive (item->transaction))
+			continue;
+		cost = pk_scheduler_get_item_cost (scheduler, item);
+		if (cost < cost_best) {
+			cost_best = cost;
+			item_best = item;
 		}
 	}
+	return item_best;
+}
 
-	/* nothing to run */
-	item = NULL;
-out:
-	return item;
+/**
+ * pk_scheduler_load_costs:
+ *
+ * Guesses the runtime of each role from the transaction history, until
+ * transactions of that role are finished by this scheduler.
+ **/
+void
+pk_scheduler_load_costs (PkScheduler *scheduler, PkTransactionDb *tdb)
+{
+	GList *list;
+	GList *l;
+	PkTransactionPast *item;
+
+	g_return_if_fail (PK_IS_SCHEDULER (scheduler));
+	g_return_if_fail (PK_IS_TRANSACTION_DB (tdb));
+
+	/* oldest first, so the newest weigh the most */
+	list = pk_transaction_db_get_list (tdb, PK_SCHEDULER_COST_HISTORY);
+	for (l = g_list_last (list); l != NULL; l = l->prev) {
+		item = PK_TRANSACTION_PAST (l->data);
+		if (!pk_transaction_past_get_succeeded (item))
+			continue;
+		pk_scheduler_add_cost (scheduler,
+				       pk_transaction_past_get_role (item),
+				       pk_transaction_past_get_duration (item));
+	}
+	g_list_free_full (list, (GDestroyNotify) g_object_unref);
+}
+
+/* pk_scheduler_get_leader:
+ *
+ * Return value: a queued or running transaction asking the same query
+ * as the item, so the item can share its backend run
+ **/
+static PkSchedulerItem *
+pk_scheduler_get_leader (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	PkSchedulerItem *leader;
+	GPtrArray *array;
+	guint i;
+
+	array = scheduler->priv->array;
+	for (i = 0; i < array->len; i++) {
+		leader = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (pk_transaction_can_subscribe (item->transaction, leader->transaction))
+			return leader;
+	}
+	return NULL;
 }
 
 static void
 pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 {
 	PkSchedulerItem *item;
+	PkSchedulerItem *leader;
 
 	g_return_if_fail (PK_IS_SCHEDULER (scheduler));
 	g_return_if_fail (tid != NULL);
@@ -458,10 +651,6 @@ pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 		return;
 	}
 
-	/* treat all transactions as exclusive if backend does not support parallelization */
-	if (!pk_backend_supports_parallelization (scheduler->priv->backend))
-		pk_transaction_make_exclusive (item->transaction);
-
 	/* we've been 'used' */
 	if (item->commit_id != 0) {
 		g_source_remove (item->commit_id);
@@ -471,6 +660,20 @@ pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 	/* we will changed what is running */
 	g_signal_emit (scheduler, signals [PK_SCHEDULER_CHANGED], 0);
 
+	/* the same query is already being asked, so just share the results,
+	 * this never runs the backend so it does not have to be exclusive */
+	leader = pk_scheduler_get_leader (scheduler, item);
+	if (leader != NULL) {
+		g_debug ("%s shares the backend run of %s", item->tid, leader->tid);
+		pk_transaction_set_state (item->transaction, PK_TRANSACTION_STATE_RUNNING);
+		pk_transaction_subscribe (item->transaction, leader->transaction);
+		return;
+	}
+
+	/* treat all transactions as exclusive if backend does not support parallelization */
+	if (!pk_backend_supports_parallelization (scheduler->priv->backend))
+		pk_transaction_make_exclusive (item->transaction);
+
 	/* is one of the current running transactions background, and this new
 	 * transaction foreground? */
 	if (!pk_transaction_get_background (item->transaction) &&
@@ -481,9 +684,12 @@ pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 	}
 
 	/* do the transaction now, if possible */
-	if (pk_transaction_is_exclusive (item->transaction) == FALSE ||
-	    pk_scheduler_get_exclusive_running (scheduler) == 0)
+	if (pk_transaction_is_exclusive (item->transaction)) {
+		if (pk_scheduler_get_exclusive_running (scheduler) == 0)
+			pk_scheduler_run_item (scheduler, item);
+	} else if (pk_scheduler_get_parallel_running (scheduler) < scheduler->priv->max_parallel) {
 		pk_scheduler_run_item (scheduler, item);
+	}
 }
 
 static void
@@ -562,6 +768,14 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 		}
 		pk_transaction_set_state (item->transaction, PK_TRANSACTION_STATE_FINISHED);
 
+		/* learn how long this role takes */
+		job = pk_transaction_get_backend_job (item->transaction);
+		if (job != NULL && pk_backend_job_get_exit_code (job) == PK_EXIT_ENUM_SUCCESS) {
+			pk_scheduler_add_cost (scheduler,
+					       pk_transaction_get_role (item->transaction),
+					       pk_backend_job_get_runtime (job));
+		}
+
 		/* give the client a few seconds to still query the runner */
 		item->remove_id = g_timeout_add_seconds (PK_TRANSACTION_KEEP_FINISHED_TIMOUT,
 							 pk_scheduler_remove_item_cb,
@@ -569,9 +783,8 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 		g_source_set_name_by_id (item->remove_id, "[PkScheduler] remove");
 	}
 
-	/* try to run the next transaction, if possible */
-	item = pk_scheduler_get_next_item (scheduler);
-	if (item != NULL) {
+	/* try to run the next transactions, if possible */
+	while ((item = pk_scheduler_get_next_item (scheduler)) != NULL) {
 		g_debug ("running %s as previous one finished", item->tid);
 		pk_scheduler_run_item (scheduler, item);
 	}
@@ -880,11 +1093,13 @@ pk_scheduler_get_state (PkScheduler *scheduler)
 
 		role = pk_transaction_get_role (item->transaction);
 		g_string_append_printf (string, "%0i\t%s\t%s\tstate[%s] "
-					"exclusive[%i] background[%i]\n", i,
+					"exclusive[%i] background[%i] cost[%u] waited[%u]\n", i,
 					pk_role_enum_to_string (role), item->tid,
 					pk_transaction_state_to_string (state),
 					pk_transaction_is_exclusive (item->transaction),
-					pk_transaction_get_background (item->transaction));
+					pk_transaction_get_background (item->transaction),
+					pk_scheduler_get_cost (scheduler, role),
+					pk_transaction_get_queue_wait_time (item->transaction));
 	}
 
 	/* nothing running */
@@ -1063,8 +1278,15 @@ pk_scheduler_finalize (GObject *object)
 PkScheduler *
 pk_scheduler_new (GKeyFile *conf)
 {
+	gint max_parallel;
 	PkScheduler *scheduler = PK_SCHEDULER (g_object_new (PK_TYPE_SCHEDULER, NULL));
 	scheduler->priv->conf = g_key_file_ref (conf);
+
+	/* how many non-exclusive transactions run side by side */
+	max_parallel = g_key_file_get_integer (conf, "Daemon", "MaximumParallelTransactions", NULL);
+	if (max_parallel <= 0)
+		max_parallel = g_get_num_processors ();
+	scheduler->priv->max_parallel = max_parallel;
 	return scheduler;
 }
 
@@ -26,6 +26,7 @@
 #include <packagekit-glib2/pk-enum.h>
 
 #include "pk-transaction.h"
+#include "pk-transaction-db.h"
 
 G_BEGIN_DECLS
 
@@ -79,6 +80,14 @@ void		 pk_scheduler_cancel_background	(PkScheduler	*scheduler);
 void		 pk_scheduler_cancel_queued	(PkScheduler	*scheduler);
 void		 pk_scheduler_set_backend	(PkScheduler	*scheduler,
 						 PkBackend	*backend);
+void		 pk_scheduler_load_costs	(PkScheduler	*scheduler,
+						 PkTransactionDb *tdb);
+
+/* only here for the self test program to use */
+gint64		 pk_scheduler_cost_for		(guint		 role_cost,
+						 guint		 running_for_uid,
+						 gboolean	 background,
+						 guint		 queue_wait_time);
 
 G_END_DECLS
 
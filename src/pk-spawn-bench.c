@@ -0,0 +1,111 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include "pk-backend.h"
+#include "pk-backend-job.h"
+#include "pk-backend-spawn.h"
+
+/* streams package lines from a spawned helper through PkBackendSpawn and
+ * reports how long it took for all of them to reach the job */
+
+#define PK_SPAWN_BENCH_PACKAGES		100000
+
+typedef struct {
+	GMainLoop	*loop;
+	guint		 packages;
+} PkSpawnBench;
+
+static void
+pk_spawn_bench_package_cb (PkBackendJob *job, gpointer object, gpointer user_data)
+{
+	PkSpawnBench *bench = (PkSpawnBench *) user_data;
+	bench->packages++;
+}
+
+static void
+pk_spawn_bench_finished_cb (PkBackendJob *job, gpointer object, gpointer user_data)
+{
+	PkSpawnBench *bench = (PkSpawnBench *) user_data;
+	g_main_loop_quit (bench->loop);
+}
+
+int
+main (int argc, char **argv)
+{
+	guint count = PK_SPAWN_BENCH_PACKAGES;
+	gdouble elapsed;
+	PkBackendSpawn *backend_spawn;
+	PkSpawnBench bench = { NULL, 0 };
+	g_autofree gchar *count_str = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkBackendJob) job = NULL;
+	g_autoptr(GTimer) timer = NULL;
+
+	if (argc > 1)
+		count = (guint) atoi (argv[1]);
+	count_str = g_strdup_printf ("%u", count);
+
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "test_spawn");
+	backend = pk_backend_new (conf);
+	job = pk_backend_job_new (conf);
+	pk_backend_job_set_backend (job, backend);
+
+	backend_spawn = pk_backend_spawn_new (conf);
+	pk_backend_spawn_set_name (backend_spawn, "test_spawn");
+
+	bench.loop = g_main_loop_new (NULL, FALSE);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_PACKAGE,
+				  pk_spawn_bench_package_cb,
+				  &bench);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_FINISHED,
+				  pk_spawn_bench_finished_cb,
+				  &bench);
+
+	timer = g_timer_new ();
+	if (!pk_backend_spawn_helper (backend_spawn, job,
+				      "bench-packages.sh", count_str, NULL)) {
+		g_printerr ("failed to spawn the helper\n");
+		g_object_unref (backend_spawn);
+		return EXIT_FAILURE;
+	}
+	g_main_loop_run (bench.loop);
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_print ("%u/%u packages in %.3fs (%.0f lines/s)\n",
+		 bench.packages, count, elapsed,
+		 elapsed > 0 ? bench.packages / elapsed : 0.f);
+
+	/* manually unlock as we have no engine */
+	pk_backend_unload (backend);
+	g_object_unref (backend_spawn);
+	g_main_loop_unref (bench.loop);
+	return bench.packages == count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
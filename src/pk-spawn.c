@@ -39,6 +39,7 @@
 #include <fcntl.h>
 
 #include <glib/gi18n.h>
+#include <glib-unix.h>
 
 #include "pk-spawn.h"
 #include "pk-shared.h"
@@ -46,8 +47,8 @@
 static void     pk_spawn_finalize	(GObject       *object);
 
 #define PK_SPAWN_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SPAWN, PkSpawnPrivate))
-#define PK_SPAWN_POLL_DELAY	50 /* ms */
 #define PK_SPAWN_SIGKILL_DELAY	2500 /* ms */
+#define PK_SPAWN_FRAME_MAX	(16 * 1024 * 1024) /* bytes */
 
 struct PkSpawnPrivate
 {
@@ -55,7 +56,9 @@ struct PkSpawnPrivate
 	gint			 stdin_fd;
 	gint			 stdout_fd;
 	gint			 stderr_fd;
-	guint			 poll_id;
+	guint			 stdout_id;
+	guint			 stderr_id;
+	guint			 child_id;
 	guint			 kill_id;
 	gboolean		 finished;
 	gboolean		 background;
@@ -64,6 +67,9 @@ struct PkSpawnPrivate
 	gboolean		 allow_sigkill;
 	PkSpawnExitType		 exit;
 	GString			*stdout_buf;
+	gsize			 stdout_scanned;
+	PkSpawnFraming		 framing;
+	gboolean		 protocol_error;
 	GString			*stderr_buf;
 	gchar			*last_argv0;
 	gchar			**last_envp;
@@ -74,6 +80,7 @@ enum {
 	SIGNAL_EXIT,
 	SIGNAL_STDOUT,
 	SIGNAL_STDERR,
+	SIGNAL_FRAME,
 	SIGNAL_LAST
 };
 
@@ -88,52 +95,128 @@ static guint signals [SIGNAL_LAST] = { 0 };
 
 G_DEFINE_TYPE (PkSpawn, pk_spawn, G_TYPE_OBJECT)
 
+/* returns FALSE once the child has closed its end */
 static gboolean
 pk_spawn_read_fd_into_buffer (gint fd, GString *string)
 {
-	gint bytes_read;
+	gssize bytes_read;
 	gchar buffer[BUFSIZ];
 
-	/* ITS4: ignore, we manually NULL terminate and GString cannot overflow */
-	while ((bytes_read = read (fd, buffer, BUFSIZ-1)) > 0) {
-		buffer[bytes_read] = '\0';
-		g_string_append (string, buffer);
+	while ((bytes_read = read (fd, buffer, BUFSIZ)) > 0)
+		g_string_append_len (string, buffer, bytes_read);
+
+	return bytes_read != 0;
+}
+
+/* emits the complete lines at the start of stdout_buf, stopping early if
+ * the helper asks for binary framing, and returns the bytes consumed */
+static gsize
+pk_spawn_emit_lines (PkSpawn *spawn)
+{
+	GString *string = spawn->priv->stdout_buf;
+	gchar *eol;
+	gsize start = 0;
+	gsize pos;
+
+	/* the bytes before stdout_scanned are an incomplete line we've
+	 * already looked at, so only search what has arrived since */
+	pos = spawn->priv->stdout_scanned;
+	while (spawn->priv->framing == PK_SPAWN_FRAMING_TEXT && pos < string->len &&
+	       (eol = memchr (string->str + pos, '\n', string->len - pos)) != NULL) {
+		*eol = '\0';
+		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, string->str + start);
+		start = pos = eol - string->str + 1;
 	}
+	return start;
+}
 
-	return TRUE;
+/* pk_spawn_protocol_error:
+ *
+ * The stream can't be resynchronised once a length prefix is bogus, so
+ * ignore everything the helper sends from now on and kill it straight
+ * away rather than interpreting the payload as more frames.
+ **/
+static void
+pk_spawn_protocol_error (PkSpawn *spawn)
+{
+	spawn->priv->protocol_error = TRUE;
+	if (spawn->priv->child_pid == -1 || spawn->priv->finished)
+		return;
+	g_debug ("sending SIGKILL %ld", (long)spawn->priv->child_pid);
+	if (kill (spawn->priv->child_pid, SIGKILL) != 0)
+		g_warning ("failed to kill helper: %s", g_strerror (errno));
 }
 
-static gboolean
-pk_spawn_emit_whole_lines (PkSpawn *spawn, GString *string)
+/* each frame is a little endian guint32 payload length and then the payload */
+static gsize
+pk_spawn_emit_frames (PkSpawn *spawn, gsize start)
 {
-	guint i;
-	guint size;
-	guint bytes_processed;
-	g_auto(GStrv) lines = NULL;
+	GString *string = spawn->priv->stdout_buf;
+	guint32 len;
+
+	while (string->len - start >= sizeof (guint32)) {
+		memcpy (&len, string->str + start, sizeof (guint32));
+		len = GUINT32_FROM_LE (len);
+		if (len > PK_SPAWN_FRAME_MAX) {
+			g_debug ("frame of %u bytes is too large, killing helper", len);
+			pk_spawn_protocol_error (spawn);
+			return string->len;
+		}
+		if (string->len - start - sizeof (guint32) < len)
+			break;
+		g_signal_emit (spawn, signals [SIGNAL_FRAME], 0,
+			       string->str + start + sizeof (guint32), len);
+		start += sizeof (guint32) + len;
+	}
+	return start;
+}
 
-	/* if nothing then don't emit */
-	if (pk_strzero (string->str))
-		return FALSE;
+static void
+pk_spawn_emit_stdout (PkSpawn *spawn)
+{
+	GString *string = spawn->priv->stdout_buf;
+	gsize start = 0;
+
+	/* the helper is being killed, nothing it sends can be trusted */
+	if (spawn->priv->protocol_error) {
+		g_string_set_size (string, 0);
+		spawn->priv->stdout_scanned = 0;
+		return;
+	}
 
-	/* split into lines - the last line may be incomplete */
-	lines = g_strsplit (string->str, "\n", 0);
-	if (lines == NULL)
-		return FALSE;
+	if (spawn->priv->framing == PK_SPAWN_FRAMING_TEXT)
+		start = pk_spawn_emit_lines (spawn);
+	if (spawn->priv->framing == PK_SPAWN_FRAMING_BINARY)
+		start = pk_spawn_emit_frames (spawn, start);
 
-	/* find size */
-	size = g_strv_length (lines);
+	/* remove the data we've processed, keeping the last partial line or frame */
+	g_string_erase (string, 0, start);
+	spawn->priv->stdout_scanned = string->len;
+}
 
-	bytes_processed = 0;
-	/* we only emit n-1 strings */
-	for (i = 0; i < (size-1); i++) {
-		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, lines[i]);
-		/* ITS4: ignore, g_strsplit always NULL terminates */
-		bytes_processed += strlen (lines[i]) + 1;
+static void
+pk_spawn_emit_stderr (PkSpawn *spawn)
+{
+	/* emit all lines on standard out in one callback, as it's all probably
+	* related to the error that just happened */
+	if (spawn->priv->stderr_buf->len != 0) {
+		g_signal_emit (spawn, signals [SIGNAL_STDERR], 0, spawn->priv->stderr_buf->str);
+		g_string_set_size (spawn->priv->stderr_buf, 0);
 	}
+}
 
-	/* remove the text we've processed */
-	g_string_erase (string, 0, bytes_processed);
-	return TRUE;
+static void
+pk_spawn_read_output (PkSpawn *spawn)
+{
+	if (spawn->priv->stdout_fd != -1)
+		pk_spawn_read_fd_into_buffer (spawn->priv->stdout_fd, spawn->priv->stdout_buf);
+	if (spawn->priv->stderr_fd != -1)
+		pk_spawn_read_fd_into_buffer (spawn->priv->stderr_fd, spawn->priv->stderr_buf);
+
+	pk_spawn_emit_stderr (spawn);
+
+	/* all usual output goes on standard out, only bad libraries bitch to stderr */
+	pk_spawn_emit_stdout (spawn);
 }
 
 static const gchar *
@@ -151,62 +234,35 @@ pk_spawn_exit_type_enum_to_string (PkSpawnExitType type)
 		return "sigquit";
 	if (type == PK_SPAWN_EXIT_TYPE_SIGKILL)
 		return "sigkill";
+	if (type == PK_SPAWN_EXIT_TYPE_PROTOCOL_ERROR)
+		return "protocol-error";
 	return "unknown";
 }
 
-static gboolean
-pk_spawn_check_child (PkSpawn *spawn)
+static void
+pk_spawn_remove_watches (PkSpawn *spawn)
 {
-	pid_t pid;
-	int status;
-	gint retval;
-	static guint limit_printing = 0;
-
-	/* this shouldn't happen */
-	if (spawn->priv->finished) {
-		g_warning ("finished twice!");
-		spawn->priv->poll_id = 0;
-		return FALSE;
-	}
-
-	pk_spawn_read_fd_into_buffer (spawn->priv->stdout_fd, spawn->priv->stdout_buf);
-	pk_spawn_read_fd_into_buffer (spawn->priv->stderr_fd, spawn->priv->stderr_buf);
-
-	/* emit all lines on standard out in one callback, as it's all probably
-	* related to the error that just happened */
-	if (spawn->priv->stderr_buf->len != 0) {
-		g_signal_emit (spawn, signals [SIGNAL_STDERR], 0, spawn->priv->stderr_buf->str);
-		g_string_set_size (spawn->priv->stderr_buf, 0);
-	}
-
-	/* all usual output goes on standard out, only bad libraries bitch to stderr */
-	pk_spawn_emit_whole_lines (spawn, spawn->priv->stdout_buf);
-
-	/* Only print one in twenty times to avoid filling the screen */
-	if (limit_printing++ % 20 == 0)
-		g_debug ("polling child_pid=%ld (1/20)", (long)spawn->priv->child_pid);
-
-	/* check if the child exited */
-	pid = waitpid (spawn->priv->child_pid, &status, WNOHANG);
-	if (pid == -1) {
-		g_warning ("failed to get the child PID data for %ld", (long)spawn->priv->child_pid);
-		return TRUE;
+	if (spawn->priv->stdout_id != 0) {
+		g_source_remove (spawn->priv->stdout_id);
+		spawn->priv->stdout_id = 0;
 	}
-	if (pid == 0) {
-		/* process still exist, but has not changed state */
-		return TRUE;
+	if (spawn->priv->stderr_id != 0) {
+		g_source_remove (spawn->priv->stderr_id);
+		spawn->priv->stderr_id = 0;
 	}
-	if (pid != spawn->priv->child_pid) {
-		g_warning ("some other process id was returned: got %ld and wanted %ld",
-			     (long)pid, (long)spawn->priv->child_pid);
-		return TRUE;
+	if (spawn->priv->child_id != 0) {
+		g_source_remove (spawn->priv->child_id);
+		spawn->priv->child_id = 0;
 	}
+}
 
-	/* disconnect the poll as there will be no more updates */
-	if (spawn->priv->poll_id > 0) {
-		g_source_remove (spawn->priv->poll_id);
-		spawn->priv->poll_id = 0;
-	}
+static void
+pk_spawn_child_exited (PkSpawn *spawn, gint status)
+{
+	gint retval;
+
+	/* disconnect the watches as there will be no more updates */
+	pk_spawn_remove_watches (spawn);
 
 	/* child exited, close resources */
 	close (spawn->priv->stdin_fd);
@@ -231,12 +287,6 @@ pk_spawn_check_child (PkSpawn *spawn)
 			spawn->priv->exit = PK_SPAWN_EXIT_TYPE_SIGKILL;
 		}
 	} else {
-		/* check we are dead and buried */
-		if (!WIFEXITED (status)) {
-			g_warning ("the process did not exit, but waitpid() returned!");
-			return TRUE;
-		}
-
 		/* get the exit code */
 		retval = WEXITSTATUS (status);
 		if (retval == 0) {
@@ -268,14 +318,122 @@ pk_spawn_check_child (PkSpawn *spawn)
 	else if (spawn->priv->is_sending_exit)
 		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT;
 
+	/* we killed it ourselves, so the signal isn't interesting */
+	if (spawn->priv->protocol_error)
+		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_PROTOCOL_ERROR;
+
 	/* don't emit if we just closed an invalid dispatcher */
 	g_debug ("emitting exit %s", pk_spawn_exit_type_enum_to_string (spawn->priv->exit));
 	g_signal_emit (spawn, signals [SIGNAL_EXIT], 0, spawn->priv->exit);
+}
+
+/* pk_spawn_check_child:
+ *
+ * Reads any pending output and reaps the child without blocking, for when
+ * we can't wait for the main loop to dispatch the watches.
+ *
+ * Returns: %TRUE if the child is still running
+ **/
+static gboolean
+pk_spawn_check_child (PkSpawn *spawn)
+{
+	pid_t pid;
+	int status;
+
+	/* this shouldn't happen */
+	if (spawn->priv->finished) {
+		g_warning ("finished twice!");
+		return FALSE;
+	}
+
+	pk_spawn_read_output (spawn);
+
+	/* check if the child exited */
+	pid = waitpid (spawn->priv->child_pid, &status, WNOHANG);
+	if (pid == -1) {
+		g_warning ("failed to get the child PID data for %ld", (long)spawn->priv->child_pid);
+		return TRUE;
+	}
+	if (pid == 0) {
+		/* process still exist, but has not changed state */
+		return TRUE;
+	}
+	if (pid != spawn->priv->child_pid) {
+		g_warning ("some other process id was returned: got %ld and wanted %ld",
+			     (long)pid, (long)spawn->priv->child_pid);
+		return TRUE;
+	}
 
-	spawn->priv->poll_id = 0;
+	/* check we are dead and buried */
+	if (!WIFSIGNALED (status) && !WIFEXITED (status)) {
+		g_warning ("the process did not exit, but waitpid() returned!");
+		return TRUE;
+	}
+
+	pk_spawn_child_exited (spawn, status);
 	return FALSE;
 }
 
+static gboolean
+pk_spawn_stdout_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+	gboolean ret;
+
+	ret = pk_spawn_read_fd_into_buffer (fd, spawn->priv->stdout_buf);
+	pk_spawn_emit_stdout (spawn);
+
+	/* closed, the child watch picks up the exit status */
+	if (!ret || (condition & G_IO_ERR) > 0) {
+		spawn->priv->stdout_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+pk_spawn_stderr_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+	gboolean ret;
+
+	ret = pk_spawn_read_fd_into_buffer (fd, spawn->priv->stderr_buf);
+	pk_spawn_emit_stderr (spawn);
+
+	if (!ret || (condition & G_IO_ERR) > 0) {
+		spawn->priv->stderr_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+pk_spawn_child_watch_cb (GPid pid, gint status, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+
+	/* the source is destroyed when we return */
+	spawn->priv->child_id = 0;
+
+	/* this shouldn't happen */
+	if (spawn->priv->finished) {
+		g_warning ("finished twice!");
+		return;
+	}
+
+	/* the fd watches may not have been dispatched for the last output */
+	pk_spawn_read_output (spawn);
+	pk_spawn_child_exited (spawn, status);
+}
+
+static void
+pk_spawn_watch_child (PkSpawn *spawn)
+{
+	spawn->priv->child_id = g_child_watch_add (spawn->priv->child_pid,
+						   pk_spawn_child_watch_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->child_id, "[PkSpawn] child");
+}
+
 static gboolean
 pk_spawn_sigkill_cb (PkSpawn *spawn)
 {
@@ -438,6 +596,12 @@ pk_spawn_exit (PkSpawn *spawn)
 		goto out;
 	}
 
+	/* the child watch would reap the child behind our back */
+	if (spawn->priv->child_id != 0) {
+		g_source_remove (spawn->priv->child_id);
+		spawn->priv->child_id = 0;
+	}
+
 	/* block until the previous script exited */
 	do {
 		g_debug ("waiting for exit");
@@ -450,15 +614,34 @@ pk_spawn_exit (PkSpawn *spawn)
 	} while (ret && count++ < 500);
 
 	/* the script exited okay */
-	if (count < 500)
+	if (count < 500) {
 		ret = TRUE;
-	else
+	} else {
 		g_warning ("failed to exit script");
+		pk_spawn_watch_child (spawn);
+	}
 out:
 	spawn->priv->is_sending_exit = FALSE;
 	return ret;
 }
 
+/**
+ * pk_spawn_set_framing:
+ *
+ * Switches how the output of the running helper is split, e.g. once it has
+ * asked for binary framing. Output that has not been emitted yet is split
+ * using the new framing.
+ **/
+void
+pk_spawn_set_framing (PkSpawn *spawn, PkSpawnFraming framing)
+{
+	g_return_if_fail (PK_IS_SPAWN (spawn));
+	g_return_if_fail (framing < PK_SPAWN_FRAMING_LAST);
+	g_debug ("using %s framing",
+		 framing == PK_SPAWN_FRAMING_BINARY ? "binary" : "text");
+	spawn->priv->framing = framing;
+}
+
 static gboolean
 pk_strvequal (gchar **id1, gchar **id2)
 {
@@ -489,6 +672,67 @@ pk_strvequal (gchar **id1, gchar **id2)
 	return TRUE;
 }
 
+/* pk_spawn_has_exited:
+ *
+ * Whether the child has exited, even if the child watch hasn't been
+ * dispatched yet, e.g. an idle helper that crashed. The child isn't reaped.
+ **/
+static gboolean
+pk_spawn_has_exited (PkSpawn *spawn)
+{
+	siginfo_t info;
+
+	memset (&info, 0, sizeof (info));
+	if (waitid (P_PID, spawn->priv->child_pid, &info,
+		    WEXITED | WNOHANG | WNOWAIT) != 0)
+		return errno == ECHILD;
+	return info.si_pid != 0;
+}
+
+/* pk_spawn_reap:
+ *
+ * Tidies up after a child that exited while idle, so that a new instance
+ * can be started without waiting for the child watch.
+ **/
+static void
+pk_spawn_reap (PkSpawn *spawn)
+{
+	gint status = 0;
+
+	/* the child watch may have got there first */
+	if (waitpid (spawn->priv->child_pid, &status, WNOHANG) != spawn->priv->child_pid)
+		status = 0;
+	pk_spawn_child_exited (spawn, status);
+}
+
+/**
+ * pk_spawn_can_reuse:
+ *
+ * Whether the running dispatcher could be sent @argv over stdin by
+ * pk_spawn_argv(), rather than having to start a new instance.
+ *
+ * This checks that the dispatcher is still alive, but there's no round-trip
+ * to check it is responsive: the dispatchers never reply to a command
+ * other than by running it, and waiting for a reply would block the
+ * daemon. A dispatcher that hangs is caught like any other hung helper,
+ * by the job being cancelled.
+ **/
+gboolean
+pk_spawn_can_reuse (PkSpawn *spawn, gchar **argv, gchar **envp)
+{
+	g_return_val_if_fail (PK_IS_SPAWN (spawn), FALSE);
+	g_return_val_if_fail (argv != NULL, FALSE);
+
+	if (spawn->priv->stdin_fd == -1 || spawn->priv->is_sending_exit ||
+	    spawn->priv->protocol_error)
+		return FALSE;
+	if (pk_spawn_has_exited (spawn))
+		return FALSE;
+	if (g_strcmp0 (spawn->priv->last_argv0, argv[0]) != 0)
+		return FALSE;
+	return pk_strvequal (spawn->priv->last_envp, envp);
+}
+
 /**
  * pk_spawn_argv:
  * @argv: Can be generated using g_strsplit (command, " ", 0)
@@ -528,6 +772,14 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 		goto out;
 	}
 
+	/* a dispatcher that died while idle can't be reused or told to exit */
+	if (spawn->priv->stdin_fd != -1 && pk_spawn_has_exited (spawn)) {
+		g_debug ("dispatcher exited while idle, starting a new one");
+		spawn->priv->is_changing_dispatcher = TRUE;
+		pk_spawn_reap (spawn);
+		spawn->priv->is_changing_dispatcher = FALSE;
+	}
+
 	/* we can reuse the dispatcher if:
 	 *  - it's still running
 	 *  - argv[0] (executable name is the same)
@@ -559,17 +811,18 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 		ret = pk_spawn_exit (spawn);
 		if (!ret) {
 			g_warning ("failed to exit previous instance");
-			/* remove poll, as we can't reply on pk_spawn_check_child() */
-			if (spawn->priv->poll_id != 0) {
-				g_source_remove (spawn->priv->poll_id);
-				spawn->priv->poll_id = 0;
-			}
+			/* remove the watches, as the fds are about to be replaced */
+			pk_spawn_remove_watches (spawn);
 		}
 		spawn->priv->is_changing_dispatcher = FALSE;
 	}
 
 	/* create spawned object for tracking */
 	spawn->priv->finished = FALSE;
+	g_string_set_size (spawn->priv->stdout_buf, 0);
+	spawn->priv->stdout_scanned = 0;
+	spawn->priv->framing = PK_SPAWN_FRAMING_TEXT;
+	spawn->priv->protocol_error = FALSE;
 	g_debug ("creating new instance of %s", argv[0]);
 	ret = g_spawn_async_with_pipes (NULL, argv, envp,
 				 G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_SEARCH_PATH,
@@ -625,14 +878,21 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 	}
 
 	/* sanity check */
-	if (spawn->priv->poll_id != 0) {
-		g_warning ("trying to set timeout when already set");
-		g_source_remove (spawn->priv->poll_id);
+	if (spawn->priv->stdout_id != 0 || spawn->priv->child_id != 0) {
+		g_warning ("trying to watch the child when already watching");
+		pk_spawn_remove_watches (spawn);
 	}
 
-	/* poll quickly */
-	spawn->priv->poll_id = g_timeout_add (PK_SPAWN_POLL_DELAY, (GSourceFunc) pk_spawn_check_child, spawn);
-	g_source_set_name_by_id (spawn->priv->poll_id, "[PkSpawn] main poll");
+	/* wake up when there's output, and when the child exits */
+	spawn->priv->stdout_id = g_unix_fd_add (spawn->priv->stdout_fd,
+						G_IO_IN | G_IO_HUP | G_IO_ERR,
+						pk_spawn_stdout_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->stdout_id, "[PkSpawn] stdout");
+	spawn->priv->stderr_id = g_unix_fd_add (spawn->priv->stderr_fd,
+						G_IO_IN | G_IO_HUP | G_IO_ERR,
+						pk_spawn_stderr_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->stderr_id, "[PkSpawn] stderr");
+	pk_spawn_watch_child (spawn);
 out:
 	return ret;
 }
@@ -719,6 +979,11 @@ pk_spawn_class_init (PkSpawnClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__STRING,
 			      G_TYPE_NONE, 1, G_TYPE_STRING);
+	signals [SIGNAL_FRAME] =
+		g_signal_new ("frame",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_generic,
+			      G_TYPE_NONE, 2, G_TYPE_POINTER, G_TYPE_UINT);
 
 	g_type_class_add_private (klass, sizeof (PkSpawnPrivate));
 }
@@ -732,7 +997,9 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->stdout_fd = -1;
 	spawn->priv->stderr_fd = -1;
 	spawn->priv->stdin_fd = -1;
-	spawn->priv->poll_id = 0;
+	spawn->priv->stdout_id = 0;
+	spawn->priv->stderr_id = 0;
+	spawn->priv->child_id = 0;
 	spawn->priv->kill_id = 0;
 	spawn->priv->finished = FALSE;
 	spawn->priv->is_sending_exit = FALSE;
@@ -742,6 +1009,7 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->last_envp = NULL;
 	spawn->priv->background = FALSE;
 	spawn->priv->exit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	spawn->priv->framing = PK_SPAWN_FRAMING_TEXT;
 
 	spawn->priv->stdout_buf = g_string_new ("");
 	spawn->priv->stderr_buf = g_string_new ("");
@@ -759,11 +1027,8 @@ pk_spawn_finalize (GObject *object)
 
 	g_return_if_fail (spawn->priv != NULL);
 
-	/* disconnect the poll in case we were cancelled before completion */
-	if (spawn->priv->poll_id != 0) {
-		g_source_remove (spawn->priv->poll_id);
-		spawn->priv->poll_id = 0;
-	}
+	/* disconnect the watches in case we were cancelled before completion */
+	pk_spawn_remove_watches (spawn);
 
 	/* disconnect the SIGKILL check */
 	if (spawn->priv->kill_id != 0) {
@@ -64,6 +64,7 @@ typedef enum {
 	PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT,	/* we timed out, and exited the dispatcher instance */
 	PK_SPAWN_EXIT_TYPE_SIGQUIT,		/* we killed the instance (SIGQUIT) */
 	PK_SPAWN_EXIT_TYPE_SIGKILL,		/* we killed the instance (SIGKILL) */
+	PK_SPAWN_EXIT_TYPE_PROTOCOL_ERROR,	/* we killed the instance as its output was invalid */
 	PK_SPAWN_EXIT_TYPE_UNKNOWN
 } PkSpawnExitType;
 
@@ -73,6 +74,17 @@ typedef enum {
 	PK_SPAWN_ARGV_FLAGS_LAST
 } PkSpawnArgvFlags;
 
+/**
+ * PkSpawnFraming:
+ *
+ * How the standard output of the spawned file is split
+ **/
+typedef enum {
+	PK_SPAWN_FRAMING_TEXT,			/* newline terminated lines, emitted as ::stdout */
+	PK_SPAWN_FRAMING_BINARY,		/* length prefixed frames, emitted as ::frame */
+	PK_SPAWN_FRAMING_LAST
+} PkSpawnFraming;
+
 GType		 pk_spawn_get_type			(void);
 PkSpawn		*pk_spawn_new				(GKeyFile		*conf);
 
@@ -83,8 +95,13 @@ gboolean	 pk_spawn_argv				(PkSpawn	*spawn,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
 gboolean	 pk_spawn_is_running			(PkSpawn	*spawn);
+gboolean	 pk_spawn_can_reuse			(PkSpawn	*spawn,
+							 gchar		**argv,
+							 gchar		**envp);
 gboolean	 pk_spawn_kill				(PkSpawn	*spawn);
 gboolean	 pk_spawn_exit				(PkSpawn	*spawn);
+void		 pk_spawn_set_framing			(PkSpawn	*spawn,
+							 PkSpawnFraming	 framing);
 
 G_END_DECLS
 
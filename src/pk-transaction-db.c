@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #include "config.h"
 
 #include <stdlib.h>
@@ -48,7 +49,59 @@ static void     pk_transaction_db_finalize	(GObject        *object);
 
 #define PK_TRANSACTION_DB_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION_DB, PkTransactionDbPrivate))
 
-G_DEFINE_AUTOPTR_CLEANUP_FUNC (sqlite3_stmt, sqlite3_finalize);
+/* the statements used from the main thread, prepared when first used */
+typedef enum {
+	PK_TRANSACTION_DB_STATEMENT_GET_ACTION_TIME,
+	PK_TRANSACTION_DB_STATEMENT_SET_ACTION_TIME,
+	PK_TRANSACTION_DB_STATEMENT_GET_LIST,
+	PK_TRANSACTION_DB_STATEMENT_GET_PROXY,
+	PK_TRANSACTION_DB_STATEMENT_UPDATE_PROXY,
+	PK_TRANSACTION_DB_STATEMENT_INSERT_PROXY,
+	PK_TRANSACTION_DB_STATEMENT_SET_JOB_COUNT,
+	PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_HISTORY,
+	PK_TRANSACTION_DB_STATEMENT_LAST
+} PkTransactionDbStatement;
+
+static const gchar *pk_transaction_db_statements[] = {
+	"SELECT timespec FROM last_action WHERE role = ?1",
+	"INSERT OR REPLACE INTO last_action (role, timespec) VALUES (?1, ?2)",
+	"SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline "
+	"FROM transactions ORDER BY timespec DESC LIMIT ?1",
+	"SELECT proxy_http, proxy_https, proxy_ftp, proxy_socks, no_proxy, pac "
+	"FROM proxy WHERE uid = ?1 AND session = ?2 LIMIT 1",
+	"UPDATE proxy SET proxy_http = ?1, proxy_https = ?2, proxy_ftp = ?3, "
+	"proxy_socks = ?4, no_proxy = ?5, pac = ?6 WHERE uid = ?7 AND session = ?8",
+	"INSERT INTO proxy (created, uid, session, proxy_http, proxy_https, "
+	"proxy_ftp, proxy_socks, no_proxy, pac) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)",
+	"UPDATE config SET value = ?1 WHERE key = 'job_count'",
+	"SELECT p.info, p.data, p.version, p.timestamp, t.uid "
+	"FROM transaction_packages p JOIN transactions t ON t.transaction_id = p.transaction_id "
+	"WHERE p.name = ?1 AND p.timestamp > 0 AND p.info IN (?3, ?4, ?5) AND t.succeeded = 1 "
+	"GROUP BY p.timestamp ORDER BY p.timestamp DESC LIMIT ?2",
+	NULL
+};
+
+/* the updates are saved by the writer thread, NULL leaves the column alone */
+#define PK_TRANSACTION_DB_SQL_ADD	"INSERT OR IGNORE INTO transactions (transaction_id, timespec) VALUES (?1, ?2)"
+#define PK_TRANSACTION_DB_SQL_UPDATE	"UPDATE transactions SET "			\
+					"role = COALESCE(?2, role), "			\
+					"uid = COALESCE(?3, uid), "			\
+					"cmdline = COALESCE(?4, cmdline), "		\
+					"data = COALESCE(?5, data), "			\
+					"succeeded = COALESCE(?6, succeeded), "		\
+					"duration = COALESCE(?7, duration) "		\
+					"WHERE transaction_id = ?1"
+#define PK_TRANSACTION_DB_SQL_GET_TIMESPEC	"SELECT timespec FROM transactions WHERE transaction_id = ?1"
+#define PK_TRANSACTION_DB_SQL_DELETE_PACKAGES	"DELETE FROM transaction_packages WHERE transaction_id = ?1"
+#define PK_TRANSACTION_DB_SQL_ADD_PACKAGE	"INSERT INTO transaction_packages "		\
+						"(transaction_id, name, arch, version, data, info, timestamp) " \
+						"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)"
+
+/* how long the writer waits for more updates on busy databases */
+#define PK_TRANSACTION_DB_BUSY_TIMEOUT	5000 /* ms */
+
+/* how long readers in the main thread wait for the writer to catch up */
+#define PK_TRANSACTION_DB_SYNC_TIMEOUT	250 /* ms */
 
 struct PkTransactionDbPrivate
 {
@@ -56,10 +109,43 @@ struct PkTransactionDbPrivate
 	sqlite3			*db;
 	guint			 job_count;
 	guint			 database_save_id;
+	sqlite3_stmt		*statements[PK_TRANSACTION_DB_STATEMENT_LAST];
+
+	/* pending updates, merged by transaction ID */
+	GPtrArray		*pending;
+	GHashTable		*pending_hash;
+	guint			 pending_id;
+
+	/* only used from the writer thread once loaded */
+	GThreadPool		*writer;
+	sqlite3			*writer_db;
+	sqlite3_stmt		*writer_add;
+	sqlite3_stmt		*writer_update;
+	sqlite3_stmt		*writer_get_timespec;
+	sqlite3_stmt		*writer_delete_packages;
+	sqlite3_stmt		*writer_add_package;
+
+	/* batches pushed to the writer and not saved yet */
+	GMutex			 writes_mutex;
+	GCond			 writes_cond;
+	guint			 writes;
 };
 
+typedef struct {
+	gchar		*tid;
+	gchar		*timespec;	/* only set if the row has to be added */
+	gchar		*role;
+	gint64		 uid;		/* -1 if unset */
+	gchar		*cmdline;
+	gchar		*data;
+	gint		 succeeded;	/* -1 if unset */
+	gint64		 duration;	/* -1 if unset */
+} PkTransactionDbRow;
+
 G_DEFINE_TYPE (PkTransactionDb, pk_transaction_db, G_TYPE_OBJECT)
 
+static gpointer pk_transaction_db_object = NULL;
+
 typedef struct {
 	gchar		*proxy_http;
 	gchar		*proxy_https;
@@ -70,62 +156,78 @@ typedef struct {
 	gboolean	set;
 } PkTransactionDbProxyItem;
 
-static gint
-pk_transaction_db_add_transaction_cb (void *data,
-				      gint argc,
-				      gchar **argv,
-				      gchar **col_name)
+static gboolean
+pk_transaction_db_prepare (sqlite3 *db, const gchar *sql, sqlite3_stmt **statement)
 {
-	PkTransactionPast *item;
-	GList **list = (GList **) data;
-	gint i;
-	gchar *col;
-	gchar *value;
-	guint temp;
+	gint rc;
 
-	item = pk_transaction_past_new ();
-	for (i = 0; i < argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "succeeded") == 0) {
-			if (!pk_strtouint (value, &temp)) {
-				g_warning ("failed to parse succeeded: %s", value);
-				continue;
-			}
-			if (temp == 1)
-				g_object_set (item, "succeeded", TRUE, NULL);
-			else
-				g_object_set (item, "succeeded", FALSE, NULL);
-		} else if (g_strcmp0 (col, "role") == 0) {
-			if (value != NULL)
-				g_object_set (item, "role", pk_role_enum_from_string (value), NULL);
-		} else if (g_strcmp0 (col, "transaction_id") == 0) {
-			if (value != NULL)
-				g_object_set (item, "tid", value, NULL);
-		} else if (g_strcmp0 (col, "timespec") == 0) {
-			if (value != NULL)
-				g_object_set (item, "timespec", value, NULL);
-		} else if (g_strcmp0 (col, "cmdline") == 0) {
-			if (value != NULL)
-				g_object_set (item, "cmdline", value, NULL);
-		} else if (g_strcmp0 (col, "data") == 0) {
-			if (value != NULL)
-				g_object_set (item, "data", value, NULL);
-		} else if (g_strcmp0 (col, "uid") == 0) {
-			if (pk_strtouint (value, &temp))
-				g_object_set (item, "uid", temp, NULL);
-		} else if (g_strcmp0 (col, "duration") == 0) {
-			if (pk_strtouint (value, &temp))
-				g_object_set (item, "duration", temp, NULL);
-		} else {
-			g_warning ("%s = %s", col, value);
-		}
+	*statement = NULL;
+	rc = sqlite3_prepare_v2 (db, sql, -1, statement, NULL);
+	if (rc != SQLITE_OK) {
+		g_warning ("(%s) prepare error: %d: %s", sql, rc, sqlite3_errmsg (db));
+		return FALSE;
 	}
+	return TRUE;
+}
 
-	/* add to start of the list */
-	*list = g_list_prepend (*list, item);
+/*
+ * pk_transaction_db_get_statement:
+ *
+ * Return value: (transfer none): the cached statement, ready to be bound,
+ * which has to be reset when done so the database snapshot is released
+ **/
+static sqlite3_stmt *
+pk_transaction_db_get_statement (PkTransactionDb *tdb, PkTransactionDbStatement kind)
+{
+	sqlite3_stmt *statement = tdb->priv->statements[kind];
+
+	if (statement == NULL) {
+		if (!pk_transaction_db_prepare (tdb->priv->db,
+						pk_transaction_db_statements[kind],
+						&statement))
+			return NULL;
+		tdb->priv->statements[kind] = statement;
+		return statement;
+	}
+	sqlite3_reset (statement);
+	sqlite3_clear_bindings (statement);
+	return statement;
+}
 
-	return 0;
+static const gchar *
+pk_transaction_db_column_text (sqlite3_stmt *statement, gint column)
+{
+	return (const gchar *) sqlite3_column_text (statement, column);
+}
+
+static PkTransactionPast *
+pk_transaction_db_past_from_statement (sqlite3_stmt *statement)
+{
+	PkTransactionPast *item;
+	const gchar *value;
+
+	item = pk_transaction_past_new ();
+	g_object_set (item,
+		      "succeeded", sqlite3_column_int (statement, 2) == 1,
+		      "duration", (guint) sqlite3_column_int (statement, 3),
+		      "uid", (guint) sqlite3_column_int (statement, 6),
+		      NULL);
+	value = pk_transaction_db_column_text (statement, 0);
+	if (value != NULL)
+		g_object_set (item, "tid", value, NULL);
+	value = pk_transaction_db_column_text (statement, 1);
+	if (value != NULL)
+		g_object_set (item, "timespec", value, NULL);
+	value = pk_transaction_db_column_text (statement, 4);
+	if (value != NULL)
+		g_object_set (item, "role", pk_role_enum_from_string (value), NULL);
+	value = pk_transaction_db_column_text (statement, 5);
+	if (value != NULL)
+		g_object_set (item, "data", value, NULL);
+	value = pk_transaction_db_column_text (statement, 7);
+	if (value != NULL)
+		g_object_set (item, "cmdline", value, NULL);
+	return item;
 }
 
 static gboolean
@@ -147,23 +249,308 @@ pk_transaction_db_sql_statement (PkTransactionDb *tdb, const gchar *sql)
 	return TRUE;
 }
 
-static gint
-pk_time_action_sqlite_callback (void *data, gint argc, gchar **argv, gchar **col_name)
+static void
+pk_transaction_db_row_free (PkTransactionDbRow *row)
+{
+	g_free (row->tid);
+	g_free (row->timespec);
+	g_free (row->role);
+	g_free (row->cmdline);
+	g_free (row->data);
+	g_free (row);
+}
+
+static void
+pk_transaction_db_bind_text (sqlite3_stmt *statement, gint column, const gchar *value)
+{
+	if (value == NULL)
+		sqlite3_bind_null (statement, column);
+	else
+		sqlite3_bind_text (statement, column, value, -1, SQLITE_STATIC);
+}
+
+static void
+pk_transaction_db_bind_int (sqlite3_stmt *statement, gint column, gint64 value)
+{
+	if (value < 0)
+		sqlite3_bind_null (statement, column);
+	else
+		sqlite3_bind_int64 (statement, column, value);
+}
+
+static gint64
+pk_transaction_db_timespec_to_timestamp (const gchar *timespec)
+{
+	g_autoptr(GDateTime) datetime = NULL;
+
+	if (timespec == NULL)
+		return 0;
+	datetime = pk_iso8601_to_datetime (timespec);
+	if (datetime == NULL)
+		return 0;
+	return g_date_time_to_unix (datetime);
+}
+
+/*
+ * pk_transaction_db_add_packages:
+ * @data: the transaction data, one "info\tpackage_id\tsummary" per line
+ *
+ * Saves the packages of a transaction in the package history.
+ **/
+static gboolean
+pk_transaction_db_add_packages (sqlite3_stmt *statement,
+				const gchar *tid,
+				gint64 timestamp,
+				const gchar *data)
+{
+	gint rc;
+	guint i;
+	g_auto(GStrv) lines = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	package = pk_package_new ();
+	lines = g_strsplit (data, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		g_autoptr(GError) error = NULL;
+
+		if (lines[i][0] == '\0')
+			continue;
+		if (!pk_package_parse (package, lines[i], &error)) {
+			g_warning ("failed to parse package: '%s': %s",
+				   lines[i], error->message);
+			continue;
+		}
+		sqlite3_reset (statement);
+		sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+		pk_transaction_db_bind_text (statement, 2, pk_package_get_name (package));
+		pk_transaction_db_bind_text (statement, 3, pk_package_get_arch (package));
+		pk_transaction_db_bind_text (statement, 4, pk_package_get_version (package));
+		pk_transaction_db_bind_text (statement, 5, pk_package_get_data (package));
+		sqlite3_bind_int (statement, 6, pk_package_get_info (package));
+		sqlite3_bind_int64 (statement, 7, timestamp);
+		rc = sqlite3_step (statement);
+		sqlite3_reset (statement);
+		if (rc != SQLITE_DONE)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * pk_transaction_db_write_packages:
+ *
+ * Replaces the package history of the transaction with the new data.
+ **/
+static gboolean
+pk_transaction_db_write_packages (PkTransactionDb *tdb, PkTransactionDbRow *row)
 {
-	gint i;
-	gchar *col;
-	gchar *value;
-	gchar **timespec = (gchar**) data;
+	PkTransactionDbPrivate *priv = tdb->priv;
+	gint rc;
+	g_autofree gchar *timespec = NULL;
 
-	for (i = 0; i < argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "timespec") == 0)
-			*timespec = g_strdup (value);
-		else
-			g_warning ("%s = %s", col, value);
+	sqlite3_reset (priv->writer_get_timespec);
+	sqlite3_bind_text (priv->writer_get_timespec, 1, row->tid, -1, SQLITE_STATIC);
+	if (sqlite3_step (priv->writer_get_timespec) == SQLITE_ROW)
+		timespec = g_strdup (pk_transaction_db_column_text (priv->writer_get_timespec, 0));
+	sqlite3_reset (priv->writer_get_timespec);
+
+	sqlite3_reset (priv->writer_delete_packages);
+	sqlite3_bind_text (priv->writer_delete_packages, 1, row->tid, -1, SQLITE_STATIC);
+	rc = sqlite3_step (priv->writer_delete_packages);
+	sqlite3_reset (priv->writer_delete_packages);
+	if (rc != SQLITE_DONE)
+		return FALSE;
+
+	return pk_transaction_db_add_packages (priv->writer_add_package,
+					       row->tid,
+					       pk_transaction_db_timespec_to_timestamp (timespec),
+					       row->data);
+}
+
+static gboolean
+pk_transaction_db_write_row (PkTransactionDb *tdb, PkTransactionDbRow *row)
+{
+	sqlite3_stmt *statement;
+	gint rc;
+
+	/* add the row first if it is new */
+	if (row->timespec != NULL) {
+		statement = tdb->priv->writer_add;
+		sqlite3_reset (statement);
+		sqlite3_bind_text (statement, 1, row->tid, -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 2, row->timespec, -1, SQLITE_STATIC);
+		rc = sqlite3_step (statement);
+		sqlite3_reset (statement);
+		if (rc != SQLITE_DONE)
+			return FALSE;
 	}
-	return 0;
+
+	/* then everything else in one go */
+	statement = tdb->priv->writer_update;
+	sqlite3_reset (statement);
+	sqlite3_bind_text (statement, 1, row->tid, -1, SQLITE_STATIC);
+	pk_transaction_db_bind_text (statement, 2, row->role);
+	pk_transaction_db_bind_int (statement, 3, row->uid);
+	pk_transaction_db_bind_text (statement, 4, row->cmdline);
+	pk_transaction_db_bind_text (statement, 5, row->data);
+	pk_transaction_db_bind_int (statement, 6, row->succeeded);
+	pk_transaction_db_bind_int (statement, 7, row->duration);
+	rc = sqlite3_step (statement);
+	sqlite3_reset (statement);
+	if (rc != SQLITE_DONE)
+		return FALSE;
+
+	/* keep the package history in step with the data */
+	if (row->data != NULL)
+		return pk_transaction_db_write_packages (tdb, row);
+	return TRUE;
+}
+
+/*
+ * pk_transaction_db_write_cb:
+ *
+ * Saves a batch of updates in one database transaction, so they all
+ * share one journal commit. This runs in the writer thread.
+ **/
+static void
+pk_transaction_db_write_cb (gpointer data, gpointer user_data)
+{
+	GPtrArray *rows = (GPtrArray *) data;
+	PkTransactionDb *tdb = PK_TRANSACTION_DB (user_data);
+	gchar *error_msg = NULL;
+	guint i;
+
+	if (sqlite3_exec (tdb->priv->writer_db, "BEGIN IMMEDIATE", NULL, NULL, &error_msg) != SQLITE_OK) {
+		g_warning ("failed to start the write: %s", error_msg);
+		sqlite3_free (error_msg);
+		goto out;
+	}
+	for (i = 0; i < rows->len; i++) {
+		PkTransactionDbRow *row = g_ptr_array_index (rows, i);
+		if (!pk_transaction_db_write_row (tdb, row)) {
+			g_warning ("failed to save %s: %s",
+				   row->tid, sqlite3_errmsg (tdb->priv->writer_db));
+		}
+	}
+	if (sqlite3_exec (tdb->priv->writer_db, "COMMIT", NULL, NULL, &error_msg) != SQLITE_OK) {
+		g_warning ("failed to save the write: %s", error_msg);
+		sqlite3_free (error_msg);
+		sqlite3_exec (tdb->priv->writer_db, "ROLLBACK", NULL, NULL, NULL);
+	}
+out:
+	g_ptr_array_unref (rows);
+
+	/* wake up anyone waiting for this to be saved */
+	g_mutex_lock (&tdb->priv->writes_mutex);
+	tdb->priv->writes--;
+	g_cond_broadcast (&tdb->priv->writes_cond);
+	g_mutex_unlock (&tdb->priv->writes_mutex);
+}
+
+/*
+ * pk_transaction_db_push_pending:
+ *
+ * Hands the pending updates to the writer thread.
+ **/
+static void
+pk_transaction_db_push_pending (PkTransactionDb *tdb)
+{
+	PkTransactionDbPrivate *priv = tdb->priv;
+	GPtrArray *rows;
+
+	if (priv->pending_id != 0) {
+		g_source_remove (priv->pending_id);
+		priv->pending_id = 0;
+	}
+	if (priv->pending->len == 0)
+		return;
+
+	/* the writer owns the rows from now on */
+	rows = priv->pending;
+	priv->pending = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_transaction_db_row_free);
+	g_hash_table_remove_all (priv->pending_hash);
+
+	g_mutex_lock (&priv->writes_mutex);
+	priv->writes++;
+	g_mutex_unlock (&priv->writes_mutex);
+	g_thread_pool_push (priv->writer, rows, NULL);
+}
+
+static gboolean
+pk_transaction_db_push_pending_cb (gpointer user_data)
+{
+	PkTransactionDb *tdb = PK_TRANSACTION_DB (user_data);
+	tdb->priv->pending_id = 0;
+	pk_transaction_db_push_pending (tdb);
+	return FALSE;
+}
+
+/*
+ * pk_transaction_db_sync:
+ *
+ * Waits for the updates to be saved, so the main thread can read them.
+ *
+ * The writer may be stuck behind another process holding the database for
+ * up to the busy timeout, and the main loop must not stall for that long,
+ * so this gives up after %PK_TRANSACTION_DB_SYNC_TIMEOUT and the reader
+ * sees the last saved state. The updates are still saved later.
+ *
+ * Return value: %TRUE if all the updates were saved
+ **/
+static gboolean
+pk_transaction_db_sync (PkTransactionDb *tdb)
+{
+	PkTransactionDbPrivate *priv = tdb->priv;
+	gboolean ret = TRUE;
+	gint64 end_time;
+
+	if (priv->writer == NULL)
+		return TRUE;
+	pk_transaction_db_push_pending (tdb);
+	end_time = g_get_monotonic_time () + PK_TRANSACTION_DB_SYNC_TIMEOUT * G_TIME_SPAN_MILLISECOND;
+	g_mutex_lock (&priv->writes_mutex);
+	while (priv->writes > 0) {
+		if (!g_cond_wait_until (&priv->writes_cond, &priv->writes_mutex, end_time)) {
+			g_debug ("%u writes not saved yet, reading the old state",
+				 priv->writes);
+			ret = FALSE;
+			break;
+		}
+	}
+	g_mutex_unlock (&priv->writes_mutex);
+	return ret;
+}
+
+/*
+ * pk_transaction_db_get_row:
+ *
+ * Return value: (transfer none): the pending updates for @tid, which are
+ * saved the next time we are idle
+ **/
+static PkTransactionDbRow *
+pk_transaction_db_get_row (PkTransactionDb *tdb, const gchar *tid)
+{
+	PkTransactionDbPrivate *priv = tdb->priv;
+	PkTransactionDbRow *row;
+
+	row = g_hash_table_lookup (priv->pending_hash, tid);
+	if (row != NULL)
+		return row;
+
+	row = g_new0 (PkTransactionDbRow, 1);
+	row->tid = g_strdup (tid);
+	row->uid = -1;
+	row->succeeded = -1;
+	row->duration = -1;
+	g_ptr_array_add (priv->pending, row);
+	g_hash_table_insert (priv->pending_hash, row->tid, row);
+
+	/* everything set in this main loop iteration is saved together */
+	if (priv->pending_id == 0) {
+		priv->pending_id = g_idle_add (pk_transaction_db_push_pending_cb, tdb);
+		g_source_set_name_by_id (priv->pending_id, "[PkTransactionDb] write");
+	}
+	return row;
 }
 
 /**
@@ -199,25 +586,23 @@ pk_transaction_db_iso8601_difference (const gchar *isodate)
 guint
 pk_transaction_db_action_time_since (PkTransactionDb *tdb, PkRoleEnum role)
 {
-	gchar *error_msg = NULL;
 	gint rc;
-	const gchar *role_text;
-	g_autofree gchar *statement = NULL;
+	sqlite3_stmt *statement;
 	g_autofree gchar *timespec = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), 0);
 	g_return_val_if_fail (tdb->priv->db != NULL, 0);
 
-	role_text = pk_role_enum_to_string (role);
-
-	statement = g_strdup_printf ("SELECT timespec FROM last_action WHERE role = '%s'", role_text);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_time_action_sqlite_callback, &timespec, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_ACTION_TIME);
+	if (statement == NULL)
 		return G_MAXUINT;
-	}
+	sqlite3_bind_text (statement, 1, pk_role_enum_to_string (role), -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	if (rc == SQLITE_ROW)
+		timespec = g_strdup (pk_transaction_db_column_text (statement, 0));
+	else if (rc != SQLITE_DONE)
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+	sqlite3_reset (statement);
 	if (timespec == NULL)
 		return G_MAXUINT;
 
@@ -228,32 +613,25 @@ pk_transaction_db_action_time_since (PkTransactionDb *tdb, PkRoleEnum role)
 gboolean
 pk_transaction_db_action_time_reset (PkTransactionDb *tdb, PkRoleEnum role)
 {
-	gchar *error_msg = NULL;
 	gint rc;
-	const gchar *role_text;
-	guint since;
-	g_autofree gchar *statement = NULL;
+	sqlite3_stmt *statement;
 	g_autofree gchar *timespec = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
 
 	timespec = pk_iso8601_present ();
-	role_text = pk_role_enum_to_string (role);
-
-	/* get the previous entry */
-	since = pk_transaction_db_action_time_since (tdb, role);
-	if (since == G_MAXUINT) {
-		statement = g_strdup_printf ("INSERT INTO last_action (role, timespec) VALUES ('%s', '%s')", role_text, timespec);
-	} else {
-		statement = g_strdup_printf ("UPDATE last_action SET timespec = '%s' WHERE role = '%s'", timespec, role_text);
-	}
 
 	/* update or insert the entry */
-	rc = sqlite3_exec (tdb->priv->db, statement, NULL, NULL, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_SET_ACTION_TIME);
+	if (statement == NULL)
+		return FALSE;
+	sqlite3_bind_text (statement, 1, pk_role_enum_to_string (role), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, timespec, -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	sqlite3_reset (statement);
+	if (rc != SQLITE_DONE) {
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
 		return FALSE;
 	}
 	return TRUE;
@@ -262,195 +640,197 @@ pk_transaction_db_action_time_reset (PkTransactionDb *tdb, PkRoleEnum role)
 GList *
 pk_transaction_db_get_list (PkTransactionDb *tdb, guint limit)
 {
-	gchar *error_msg = NULL;
 	gint rc;
 	GList *list = NULL;
-	g_autofree gchar *statement = NULL;
+	sqlite3_stmt *statement;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
 
-	if (limit == 0) {
-		statement = g_strdup ("SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline "
-				      "FROM transactions ORDER BY timespec DESC");
-	} else {
-		statement = g_strdup_printf ("SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline "
-					     "FROM transactions ORDER BY timespec DESC LIMIT %i", limit);
-	}
-	rc = sqlite3_exec (tdb->priv->db,
-			   statement,
-			   pk_transaction_db_add_transaction_cb,
-			   &list,
-			   &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
+	/* make sure the transactions we know about are included */
+	pk_transaction_db_sync (tdb);
+
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_LIST);
+	if (statement == NULL)
+		return NULL;
+
+	/* a negative limit means no limit */
+	if (limit == 0)
+		sqlite3_bind_int (statement, 1, -1);
+	else
+		sqlite3_bind_int64 (statement, 1, limit);
+	while ((rc = sqlite3_step (statement)) == SQLITE_ROW) {
+		/* add to start of the list */
+		list = g_list_prepend (list, pk_transaction_db_past_from_statement (statement));
 	}
-out:
+	if (rc != SQLITE_DONE)
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+	sqlite3_reset (statement);
 	return list;
 }
 
-static gboolean
-pk_transaction_db_prepare (PkTransactionDb *tdb, const gchar *sql, sqlite3_stmt **statement)
-{
-	gint rc = 0;
-	*statement = NULL;
-
-	if ((rc = sqlite3_prepare_v2 (tdb->priv->db,
-				      sql,
-				      -1,
-				      statement,
-				      NULL) != SQLITE_OK)) {
-		g_warning ("(%s) prepare error: %d: %s", sql, rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
-
-	return TRUE;
-}
-
-static gboolean
-pk_transaction_db_step (sqlite3 *db, sqlite3_stmt *statement)
-{
-	gint rc = 0;
-
-	rc = sqlite3_step (statement);
-
-	if (rc != SQLITE_OK && rc != SQLITE_DONE) {
-		g_warning ("SQL error: %d: %s", rc, sqlite3_errmsg (db));
-		return FALSE;
-	}
-
-	return TRUE;
-}
-
-static gboolean
-pk_transaction_db_set_strings (PkTransactionDb *tdb, const gchar *sql, const gchar *first, const gchar *second)
+/**
+ * pk_transaction_db_get_package_history:
+ * @tdb: the #PkTransactionDb instance
+ * @name: the package name
+ * @limit: the maximum number of entries, or 0 for no limit
+ *
+ * Gets the successful installs, updates and removals of a package.
+ *
+ * Return value: (transfer floating): an array of a{sv}, oldest first
+ **/
+GVariant *
+pk_transaction_db_get_package_history (PkTransactionDb *tdb, const gchar *name, guint limit)
 {
-	g_autoptr (sqlite3_stmt) statement = NULL;
-	gint rc = 0;
-
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
-	g_return_val_if_fail (sql != NULL, FALSE);
-	g_return_val_if_fail (first != NULL, FALSE);
-	g_return_val_if_fail (second != NULL, FALSE);
-
-	if (!pk_transaction_db_prepare (tdb, sql, &statement))
-		return FALSE;
+	const gchar *source;
+	const gchar *version;
+	gint rc;
+	guint i;
+	sqlite3_stmt *statement;
+	GVariantBuilder builder;
+	g_autoptr(GPtrArray) array = NULL;
 
-	if ((rc = sqlite3_bind_text (statement, 1, first, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text1 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	/* make sure the transactions we know about are included */
+	pk_transaction_db_sync (tdb);
+
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_HISTORY);
+	if (statement == NULL)
+		return NULL;
+	sqlite3_bind_text (statement, 1, name, -1, SQLITE_STATIC);
+	if (limit == 0)
+		sqlite3_bind_int (statement, 2, -1);
+	else
+		sqlite3_bind_int64 (statement, 2, limit);
+	sqlite3_bind_int (statement, 3, PK_INFO_ENUM_INSTALLING);
+	sqlite3_bind_int (statement, 4, PK_INFO_ENUM_REMOVING);
+	sqlite3_bind_int (statement, 5, PK_INFO_ENUM_UPDATING);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	while ((rc = sqlite3_step (statement)) == SQLITE_ROW) {
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&builder, "{sv}", "info",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 0)));
+		source = pk_transaction_db_column_text (statement, 1);
+		g_variant_builder_add (&builder, "{sv}", "source",
+				       g_variant_new_string (source != NULL ? source : ""));
+		version = pk_transaction_db_column_text (statement, 2);
+		g_variant_builder_add (&builder, "{sv}", "version",
+				       g_variant_new_string (version != NULL ? version : ""));
+		g_variant_builder_add (&builder, "{sv}", "timestamp",
+				       g_variant_new_uint64 (sqlite3_column_int64 (statement, 3)));
+		g_variant_builder_add (&builder, "{sv}", "user-id",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 4)));
+		g_ptr_array_add (array, g_variant_ref_sink (g_variant_builder_end (&builder)));
 	}
-
-	if ((rc = sqlite3_bind_text (statement, 2, second, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text2 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
+	if (rc != SQLITE_DONE)
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+	sqlite3_reset (statement);
+
+	/* the newest entries were selected so that the limit applies to them */
+	for (i = 0; i < array->len / 2; i++) {
+		gpointer tmp = array->pdata[i];
+		array->pdata[i] = array->pdata[array->len - i - 1];
+		array->pdata[array->len - i - 1] = tmp;
 	}
-
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	return g_variant_new_array (G_VARIANT_TYPE ("a{sv}"),
+				    (GVariant * const *) array->pdata,
+				    array->len);
 }
 
 gboolean
 pk_transaction_db_add (PkTransactionDb *tdb, const gchar *tid)
 {
-	g_autofree gchar *timespec = NULL;
-	timespec = pk_iso8601_present ();
+	PkTransactionDbRow *row;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->loaded, FALSE);
+	g_return_val_if_fail (tid != NULL, FALSE);
 
-	return pk_transaction_db_set_strings (tdb,
-					      "INSERT INTO transactions (transaction_id, timespec) VALUES (?1, ?2)",
-					      tid,
-					      timespec);
+	row = pk_transaction_db_get_row (tdb, tid);
+	g_free (row->timespec);
+	row->timespec = pk_iso8601_present ();
+	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_role (PkTransactionDb *tdb, const gchar *tid, PkRoleEnum role)
 {
-	const gchar *role_text;
-	role_text = pk_role_enum_to_string (role);
+	PkTransactionDbRow *row;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->loaded, FALSE);
+	g_return_val_if_fail (tid != NULL, FALSE);
 
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET role=?1 WHERE transaction_id=?2",
-					      role_text,
-					      tid);
+	row = pk_transaction_db_get_row (tdb, tid);
+	g_free (row->role);
+	row->role = g_strdup (pk_role_enum_to_string (role));
+	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_uid (PkTransactionDb *tdb, const gchar *tid, guint uid)
 {
-	g_autoptr (sqlite3_stmt) statement = NULL;
-	gint rc = 0;
+	PkTransactionDbRow *row;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
+	g_return_val_if_fail (tdb->priv->loaded, FALSE);
 	g_return_val_if_fail (tid != NULL, FALSE);
 
-	if (!pk_transaction_db_prepare (tdb, "UPDATE transactions SET uid=?1 WHERE transaction_id=?2", &statement))
-		return FALSE;
-
-	if ((rc = sqlite3_bind_int (statement, 1, uid)) != SQLITE_OK) {
-		g_warning ("bind int error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
-
-	if ((rc = sqlite3_bind_text (statement, 2, tid, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
-
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	row = pk_transaction_db_get_row (tdb, tid);
+	row->uid = uid;
+	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_cmdline (PkTransactionDb *tdb, const gchar *tid, const gchar *cmdline)
 {
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET cmdline=?1 WHERE transaction_id=?2",
-					      cmdline,
-					      tid);
+	PkTransactionDbRow *row;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->loaded, FALSE);
+	g_return_val_if_fail (tid != NULL, FALSE);
+	g_return_val_if_fail (cmdline != NULL, FALSE);
+
+	row = pk_transaction_db_get_row (tdb, tid);
+	g_free (row->cmdline);
+	row->cmdline = g_strdup (cmdline);
+	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_data (PkTransactionDb *tdb, const gchar *tid, const gchar *data)
 {
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET data=?1 WHERE transaction_id=?2",
-					      data,
-					      tid);
+	PkTransactionDbRow *row;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->loaded, FALSE);
+	g_return_val_if_fail (tid != NULL, FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	row = pk_transaction_db_get_row (tdb, tid);
+	g_free (row->data);
+	row->data = g_strdup (data);
+	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_finished (PkTransactionDb *tdb, const gchar *tid, gboolean success, guint runtime)
 {
-	g_autoptr (sqlite3_stmt) statement = NULL;
-	gint rc = 0;
+	PkTransactionDbRow *row;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
+	g_return_val_if_fail (tdb->priv->loaded, FALSE);
 	g_return_val_if_fail (tid != NULL, FALSE);
 
-	if (!pk_transaction_db_prepare (tdb, "UPDATE transactions SET succeeded=?1, duration=?2 WHERE transaction_id=?3",
-					&statement))
-		return FALSE;
-
-	if ((rc = sqlite3_bind_int (statement, 1, success)) != SQLITE_OK) {
-		g_warning ("bind int1 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
-
-	if ((rc = sqlite3_bind_int (statement, 2, runtime)) != SQLITE_OK) {
-		g_warning ("bind int2 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
-
-	if ((rc = sqlite3_bind_text (statement, 3, tid, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
-
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	row = pk_transaction_db_get_row (tdb, tid);
+	row->succeeded = success ? 1 : 0;
+	row->duration = runtime;
+	return TRUE;
 }
 
+
 gboolean
 pk_transaction_db_print (PkTransactionDb *tdb)
 {
@@ -513,9 +893,8 @@ pk_transaction_db_get_random_hex_string (guint length)
 static gboolean
 pk_transaction_db_defer_write_job_count_cb (PkTransactionDb *tdb)
 {
-	gchar *error_msg = NULL;
 	gint rc;
-	g_autofree gchar *statement = NULL;
+	sqlite3_stmt *statement;
 
 	/* not loaded! */
 	if (tdb->priv->db == NULL) {
@@ -524,20 +903,20 @@ pk_transaction_db_defer_write_job_count_cb (PkTransactionDb *tdb)
 	}
 
 	/* force fsync as we don't want to repeat this number */
-	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=ON", NULL, NULL, NULL);
+	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=FULL", NULL, NULL, NULL);
 
 	/* save the job count */
-	statement = g_strdup_printf ("UPDATE config SET value = '%i' WHERE key = 'job_count'",
-				     tdb->priv->job_count);
-	rc = sqlite3_exec (tdb->priv->db, statement, NULL, NULL, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("failed to set job id: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_SET_JOB_COUNT);
+	if (statement != NULL) {
+		sqlite3_bind_int (statement, 1, tdb->priv->job_count);
+		rc = sqlite3_step (statement);
+		sqlite3_reset (statement);
+		if (rc != SQLITE_DONE)
+			g_warning ("failed to set job id: %s", sqlite3_errmsg (tdb->priv->db));
 	}
 
-	/* turn off fsync */
-	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=OFF", NULL, NULL, NULL);
+	/* the WAL is enough for everything else */
+	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
 out:
 	tdb->priv->database_save_id = 0;
 	return FALSE;
@@ -568,38 +947,44 @@ pk_transaction_db_generate_id (PkTransactionDb *tdb)
 	return tid;
 }
 
-static gint
-pk_transaction_sqlite_proxy_cb (void *data, gint argc, gchar **argv, gchar **col_name)
-{
-	PkTransactionDbProxyItem *item = (PkTransactionDbProxyItem *) data;
-	gint i;
-
-	g_return_val_if_fail (item != NULL, 0);
-
-	for (i = 0; i < argc; i++) {
-		if (g_strcmp0 (col_name[i], "proxy_http") == 0) {
-			item->proxy_http = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "proxy_https") == 0) {
-			item->proxy_https = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "proxy_ftp") == 0) {
-			item->proxy_ftp = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "proxy_socks") == 0) {
-			item->proxy_socks = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "no_proxy") == 0) {
-			item->no_proxy = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "pac") == 0) {
-			item->pac = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else {
-			g_warning ("%s = %s", col_name[i], argv[i]);
-		}
+static gchar *
+pk_transaction_db_column_dup (sqlite3_stmt *statement, gint column)
+{
+	return g_strdup (pk_transaction_db_column_text (statement, column));
+}
+
+/*
+ * pk_transaction_db_get_proxy_item:
+ *
+ * Return value: the saved proxy settings, which are not set if there were none
+ **/
+static PkTransactionDbProxyItem *
+pk_transaction_db_get_proxy_item (PkTransactionDb *tdb, guint uid, const gchar *session)
+{
+	gint rc;
+	sqlite3_stmt *statement;
+	PkTransactionDbProxyItem *item;
+
+	item = g_new0 (PkTransactionDbProxyItem, 1);
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_PROXY);
+	if (statement == NULL)
+		return item;
+	sqlite3_bind_int (statement, 1, uid);
+	sqlite3_bind_text (statement, 2, session, -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	if (rc == SQLITE_ROW) {
+		item->proxy_http = pk_transaction_db_column_dup (statement, 0);
+		item->proxy_https = pk_transaction_db_column_dup (statement, 1);
+		item->proxy_ftp = pk_transaction_db_column_dup (statement, 2);
+		item->proxy_socks = pk_transaction_db_column_dup (statement, 3);
+		item->no_proxy = pk_transaction_db_column_dup (statement, 4);
+		item->pac = pk_transaction_db_column_dup (statement, 5);
+		item->set = TRUE;
+	} else if (rc != SQLITE_DONE) {
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
 	}
-	return 0;
+	sqlite3_reset (statement);
+	return item;
 }
 
 static void
@@ -619,32 +1004,15 @@ pk_transaction_db_proxy_item_free (PkTransactionDbProxyItem *item)
 static gboolean
 pk_transaction_db_is_proxy_set (PkTransactionDb *tdb, guint uid, const gchar *session)
 {
-	gchar *error_msg = NULL;
-	gboolean ret = FALSE;
-	gint rc;
+	gboolean ret;
 	PkTransactionDbProxyItem *item;
-	g_autofree gchar *statement = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (uid != G_MAXUINT, FALSE);
 
 	/* get existing data */
-	item = g_new0 (PkTransactionDbProxyItem, 1);
-	statement = g_strdup_printf ("SELECT proxy_http, proxy_https, proxy_ftp, proxy_socks, no_proxy, pac FROM proxy WHERE uid = '%i' AND session = '%s' LIMIT 1",
-				     uid, session);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_transaction_sqlite_proxy_cb,
-			   item,
-			   &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
-	}
-
+	item = pk_transaction_db_get_proxy_item (tdb, uid, session);
 	ret = item->set;
-
-out:
 	pk_transaction_db_proxy_item_free (item);
 	return ret;
 }
@@ -670,28 +1038,14 @@ pk_transaction_db_get_proxy (PkTransactionDb *tdb, guint uid, const gchar *sessi
 			     gchar **no_proxy,
 			     gchar **pac)
 {
-	gchar *error_msg = NULL;
-	gboolean ret = FALSE;
-	gint rc;
+	gboolean ret;
 	PkTransactionDbProxyItem *item;
-	g_autofree gchar *statement = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (uid != G_MAXUINT, FALSE);
 
 	/* get existing data */
-	item = g_new0 (PkTransactionDbProxyItem, 1);
-	statement = g_strdup_printf ("SELECT proxy_http, proxy_https, proxy_ftp, proxy_socks, no_proxy, pac FROM proxy WHERE uid = '%i' AND session = '%s' LIMIT 1",
-				     uid, session);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_transaction_sqlite_proxy_cb,
-			   item,
-			   &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
-	}
+	item = pk_transaction_db_get_proxy_item (tdb, uid, session);
 
 	/* success, even if we got no data */
 	ret = TRUE;
@@ -743,9 +1097,8 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 {
 	gboolean ret = FALSE;
 	gint rc;
-	sqlite3_stmt *statement = NULL;
+	sqlite3_stmt *statement;
 	g_autofree gchar *timespec = NULL;
-	g_autofree gchar *proxy_http_tmp = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (uid != G_MAXUINT, FALSE);
@@ -756,21 +1109,9 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 		g_debug ("updated proxy %s, %s for uid:%i and session:%s",
 			 proxy_http, proxy_ftp, uid, session);
 
-		/* prepare statement */
-		rc = sqlite3_prepare_v2 (tdb->priv->db,
-					 "UPDATE proxy SET "
-					 "proxy_http = ?, "
-					 "proxy_https = ?, "
-					 "proxy_ftp = ?, "
-					 "proxy_socks = ?, "
-					 "no_proxy = ?, "
-					 "pac = ? "
-					 "WHERE uid = ? AND session = ?",
-					 -1, &statement, NULL);
-		if (rc != SQLITE_OK) {
-			g_warning ("failed to prepare statement: %s", sqlite3_errmsg (tdb->priv->db));
-			goto out;
-		}
+		statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_UPDATE_PROXY);
+		if (statement == NULL)
+			return FALSE;
 
 		/* bind data, so that the freeform proxy text cannot be used to inject SQL */
 		sqlite3_bind_text (statement, 1, proxy_http, -1, SQLITE_STATIC);
@@ -786,7 +1127,7 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 		rc = sqlite3_step (statement);
 		if (rc != SQLITE_DONE) {
 			g_warning ("failed to execute statement: %s", sqlite3_errmsg (tdb->priv->db));
-			goto out;
+			ret = FALSE;
 		}
 		goto out;
 	}
@@ -795,21 +1136,9 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 	timespec = pk_iso8601_present ();
 	g_debug ("set proxy %s, %s for uid:%i and session:%s", proxy_http, proxy_ftp, uid, session);
 
-	/* prepare statement */
-	rc = sqlite3_prepare_v2 (tdb->priv->db,
-				 "INSERT INTO proxy (created, uid, session, "
-				 "proxy_http, "
-				 "proxy_https, "
-				 "proxy_ftp, "
-				 "proxy_socks, "
-				 "no_proxy, "
-				 "pac) "
-				 "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)",
-				 -1, &statement, NULL);
-	if (rc != SQLITE_OK) {
-		g_warning ("failed to prepare statement: %s", sqlite3_errmsg (tdb->priv->db));
-		goto out;
-	}
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_INSERT_PROXY);
+	if (statement == NULL)
+		return FALSE;
 
 	/* bind data, so that the freeform proxy text cannot be used to inject SQL */
 	sqlite3_bind_text (statement, 1, timespec, -1, SQLITE_STATIC);
@@ -831,8 +1160,7 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 
 	ret = TRUE;
 out:
-	if (statement != NULL)
-		sqlite3_finalize (statement);
+	sqlite3_reset (statement);
 	return ret;
 }
 
@@ -874,10 +1202,158 @@ pk_transaction_db_execute (PkTransactionDb *tdb,
 	return ret;
 }
 
+/*
+ * pk_transaction_db_enable_wal:
+ *
+ * Switches to the WAL journal. The pragma does not fail when the WAL is
+ * not supported, e.g. on file systems without shared memory, it just
+ * returns the journal mode that is still in use.
+ **/
+static gboolean
+pk_transaction_db_enable_wal (PkTransactionDb *tdb, GError **error)
+{
+	const gchar *mode;
+	gboolean ret = TRUE;
+	gint rc;
+	sqlite3_stmt *statement = NULL;
+
+	rc = sqlite3_prepare_v2 (tdb->priv->db, "PRAGMA journal_mode=WAL", -1, &statement, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0,
+			     "Failed to prepare the journal mode: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		return FALSE;
+	}
+	rc = sqlite3_step (statement);
+	if (rc != SQLITE_ROW) {
+		g_set_error (error, 1, 0,
+			     "Failed to set the journal mode: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		ret = FALSE;
+		goto out;
+	}
+	mode = (const gchar *) sqlite3_column_text (statement, 0);
+	if (mode == NULL || g_ascii_strcasecmp (mode, "wal") != 0) {
+		g_set_error (error, 1, 0,
+			     "The journal mode is still %s",
+			     mode != NULL ? mode : "unknown");
+		ret = FALSE;
+		goto out;
+	}
+out:
+	sqlite3_finalize (statement);
+	return ret;
+}
+
+static gboolean
+pk_transaction_db_open_writer (PkTransactionDb *tdb, const gchar *synchronous, GError **error)
+{
+	PkTransactionDbPrivate *priv = tdb->priv;
+
+	if (sqlite3_open (PK_DB_DIR "/transactions.db", &priv->writer_db) != SQLITE_OK) {
+		g_set_error (error,
+			     1, 0,
+			     "Can't open transaction database for writing: %s",
+			     sqlite3_errmsg (priv->writer_db));
+		return FALSE;
+	}
+	sqlite3_busy_timeout (priv->writer_db, PK_TRANSACTION_DB_BUSY_TIMEOUT);
+	sqlite3_exec (priv->writer_db, synchronous, NULL, NULL, NULL);
+	if (!pk_transaction_db_prepare (priv->writer_db, PK_TRANSACTION_DB_SQL_ADD, &priv->writer_add) ||
+	    !pk_transaction_db_prepare (priv->writer_db, PK_TRANSACTION_DB_SQL_UPDATE, &priv->writer_update) ||
+	    !pk_transaction_db_prepare (priv->writer_db, PK_TRANSACTION_DB_SQL_GET_TIMESPEC, &priv->writer_get_timespec) ||
+	    !pk_transaction_db_prepare (priv->writer_db, PK_TRANSACTION_DB_SQL_DELETE_PACKAGES, &priv->writer_delete_packages) ||
+	    !pk_transaction_db_prepare (priv->writer_db, PK_TRANSACTION_DB_SQL_ADD_PACKAGE, &priv->writer_add_package)) {
+		g_set_error (error,
+			     1, 0,
+			     "Can't prepare the transaction updates: %s",
+			     sqlite3_errmsg (priv->writer_db));
+		return FALSE;
+	}
+
+	/* one thread, so the batches are saved in order */
+	priv->writer = g_thread_pool_new (pk_transaction_db_write_cb, tdb, 1, TRUE, error);
+	return priv->writer != NULL;
+}
+
+/*
+ * pk_transaction_db_create_package_history:
+ *
+ * Adds the package history table, filled from the existing transactions.
+ **/
+static gboolean
+pk_transaction_db_create_package_history (PkTransactionDb *tdb, GError **error)
+{
+	gboolean ret = FALSE;
+	gint rc;
+	sqlite3_stmt *select = NULL;
+	sqlite3_stmt *insert = NULL;
+
+	if (!pk_transaction_db_execute (tdb, "BEGIN", error))
+		return FALSE;
+	if (!pk_transaction_db_execute (tdb,
+					"CREATE TABLE transaction_packages ("
+					"transaction_id TEXT,"
+					"name TEXT,"
+					"arch TEXT,"
+					"version TEXT,"
+					"data TEXT,"
+					"info INTEGER,"
+					"timestamp INTEGER);",
+					error))
+		goto out;
+	if (!pk_transaction_db_execute (tdb,
+					"CREATE INDEX transaction_packages_name "
+					"ON transaction_packages (name, timestamp);",
+					error))
+		goto out;
+	if (!pk_transaction_db_execute (tdb,
+					"CREATE INDEX transaction_packages_tid "
+					"ON transaction_packages (transaction_id);",
+					error))
+		goto out;
+
+	/* parse the old transactions just this once */
+	if (!pk_transaction_db_prepare (tdb->priv->db,
+					"SELECT transaction_id, timespec, data FROM transactions "
+					"WHERE data IS NOT NULL",
+					&select) ||
+	    !pk_transaction_db_prepare (tdb->priv->db, PK_TRANSACTION_DB_SQL_ADD_PACKAGE, &insert)) {
+		g_set_error (error, 1, 0,
+			     "Can't prepare the package history: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		goto out;
+	}
+	while ((rc = sqlite3_step (select)) == SQLITE_ROW) {
+		const gchar *timespec = pk_transaction_db_column_text (select, 1);
+		if (!pk_transaction_db_add_packages (insert,
+						     pk_transaction_db_column_text (select, 0),
+						     pk_transaction_db_timespec_to_timestamp (timespec),
+						     pk_transaction_db_column_text (select, 2))) {
+			rc = SQLITE_ERROR;
+			break;
+		}
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0,
+			     "Failed to add the package history: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		goto out;
+	}
+	ret = pk_transaction_db_execute (tdb, "COMMIT", error);
+out:
+	sqlite3_finalize (select);
+	sqlite3_finalize (insert);
+	if (!ret)
+		sqlite3_exec (tdb->priv->db, "ROLLBACK", NULL, NULL, NULL);
+	return ret;
+}
+
 gboolean
 pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 {
 	const gchar *statement;
+	const gchar *synchronous = "PRAGMA synchronous=NORMAL";
 	gchar *error_msg = NULL;
 	gchar *text;
 	GError *error_local = NULL;
@@ -902,8 +1378,18 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 		return FALSE;
 	}
 
-	/* we don't need to keep doing fsync */
-	if (!pk_transaction_db_execute (tdb, "PRAGMA synchronous=OFF", error))
+	sqlite3_busy_timeout (tdb->priv->db, PK_TRANSACTION_DB_BUSY_TIMEOUT);
+
+	/* readers don't block the writer thread, and with the WAL only
+	 * checkpoints have to be synced */
+	if (!pk_transaction_db_enable_wal (tdb, &error_local)) {
+		g_debug ("not using the WAL: %s", error_local->message);
+		g_clear_error (&error_local);
+
+		/* we don't need to keep doing fsync */
+		synchronous = "PRAGMA synchronous=OFF";
+	}
+	if (!pk_transaction_db_execute (tdb, synchronous, error))
 		return FALSE;
 
 	/* check transactions */
@@ -969,9 +1455,21 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 			return FALSE;
 	}
 
+	/* package history, rather than parsing all the data (since 1.2.4) */
+	if (!pk_transaction_db_execute (tdb, "SELECT * FROM transaction_packages LIMIT 1", &error_local)) {
+		g_debug ("adding table transaction_packages: %s", error_local->message);
+		g_clear_error (&error_local);
+		if (!pk_transaction_db_create_package_history (tdb, error))
+			return FALSE;
+	}
+
 	/* try to set correct permissions */
 	g_chmod (PK_DB_DIR "/transactions.db", 0644);
 
+	/* the transaction updates are saved in the background */
+	if (!pk_transaction_db_open_writer (tdb, synchronous, error))
+		return FALSE;
+
 	/* success */
 	tdb->priv->loaded = TRUE;
 	return TRUE;
@@ -981,16 +1479,33 @@ static void
 pk_transaction_db_init (PkTransactionDb *tdb)
 {
 	tdb->priv = PK_TRANSACTION_DB_GET_PRIVATE (tdb);
+	tdb->priv->pending = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_transaction_db_row_free);
+	tdb->priv->pending_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	g_mutex_init (&tdb->priv->writes_mutex);
+	g_cond_init (&tdb->priv->writes_cond);
 }
 
 static void
 pk_transaction_db_finalize (GObject *object)
 {
 	PkTransactionDb *tdb;
+	guint i;
 	g_return_if_fail (PK_IS_TRANSACTION_DB (object));
 	tdb = PK_TRANSACTION_DB (object);
 	g_return_if_fail (tdb->priv != NULL);
 
+	/* save the pending updates and wait for the writer */
+	if (tdb->priv->writer != NULL) {
+		pk_transaction_db_push_pending (tdb);
+		g_thread_pool_free (tdb->priv->writer, FALSE, TRUE);
+	}
+	if (tdb->priv->pending_id != 0)
+		g_source_remove (tdb->priv->pending_id);
+	g_ptr_array_unref (tdb->priv->pending);
+	g_hash_table_unref (tdb->priv->pending_hash);
+	g_mutex_clear (&tdb->priv->writes_mutex);
+	g_cond_clear (&tdb->priv->writes_cond);
+
 	/* if we shutdown with a deferred database write, then enforce it here */
 	if (tdb->priv->database_save_id != 0) {
 		pk_transaction_db_defer_write_job_count_cb (tdb);
@@ -998,6 +1513,14 @@ pk_transaction_db_finalize (GObject *object)
 	}
 
 	/* close the database */
+	for (i = 0; i < PK_TRANSACTION_DB_STATEMENT_LAST; i++)
+		sqlite3_finalize (tdb->priv->statements[i]);
+	sqlite3_finalize (tdb->priv->writer_add);
+	sqlite3_finalize (tdb->priv->writer_update);
+	sqlite3_finalize (tdb->priv->writer_get_timespec);
+	sqlite3_finalize (tdb->priv->writer_delete_packages);
+	sqlite3_finalize (tdb->priv->writer_add_package);
+	sqlite3_close (tdb->priv->writer_db);
 	sqlite3_close (tdb->priv->db);
 
 	G_OBJECT_CLASS (pk_transaction_db_parent_class)->finalize (object);
@@ -1006,8 +1529,12 @@ pk_transaction_db_finalize (GObject *object)
 PkTransactionDb *
 pk_transaction_db_new (void)
 {
-	PkTransactionDb *tdb;
-	tdb = g_object_new (PK_TYPE_TRANSACTION_DB, NULL);
-	return PK_TRANSACTION_DB (tdb);
+	if (pk_transaction_db_object != NULL) {
+		g_object_ref (pk_transaction_db_object);
+	} else {
+		pk_transaction_db_object = g_object_new (PK_TYPE_TRANSACTION_DB, NULL);
+		g_object_add_weak_pointer (pk_transaction_db_object, &pk_transaction_db_object);
+	}
+	return PK_TRANSACTION_DB (pk_transaction_db_object);
 }
 
@@ -28,6 +28,9 @@
 G_BEGIN_DECLS
 
 /* only here for the self test program to use */
+void	pk_transaction_get_details	(PkTransaction	*transaction,
+					 GVariant	*params,
+					 GDBusMethodInvocation *context);
 void	pk_transaction_get_updates	(PkTransaction	*transaction,
 					 GVariant	*params,
 					 GDBusMethodInvocation *context);
@@ -48,6 +51,7 @@ gboolean	 pk_transaction_strvalidate			(const gchar	*textr,
 								 GError		**error);
 gboolean	 pk_transaction_set_tid				(PkTransaction	*transaction,
 								 const gchar	*tid);
+PkResults	*pk_transaction_get_results			(PkTransaction	*transaction);
 
 
 G_END_DECLS
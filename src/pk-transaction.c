@@ -69,6 +69,7 @@ static gboolean pk_transaction_is_supported_content_type (PkTransaction *transac
 
 #define PK_TRANSACTION_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION, PkTransactionPrivate))
 #define PK_TRANSACTION_UPDATES_CHANGED_TIMEOUT	100 /* ms */
+#define PK_TRANSACTION_PROGRESS_INTERVAL	50 /* ms */
 
 /* when the UID is invalid or not known */
 #define PK_TRANSACTION_UID_INVALID		G_MAXUINT
@@ -83,6 +84,8 @@ struct PkTransactionPrivate
 	PkTransactionState	 state;
 	guint			 percentage;
 	guint			 elapsed_time;
+	guint			 queue_wait_time;
+	gint64			 queued_time;
 	guint			 speed;
 	guint			 download_size_remaining;
 	gboolean		 finished;
@@ -92,6 +95,7 @@ struct PkTransactionPrivate
 	gboolean		 emit_signature_required;
 	gboolean		 emit_media_change_required;
 	gboolean		 caller_active;
+	gboolean		 client_supports_packages;
 	gboolean		 exclusive;
 	guint			 uid;
 	guint			 watch_id;
@@ -112,6 +116,15 @@ struct PkTransactionPrivate
 	PkResults		*results;
 	PkTransactionDb		*transaction_db;
 
+	/* the transaction whose backend run we share, if any */
+	PkTransaction		*leader;
+	GPtrArray		*subscribers;
+	GHashTable		*replayed;
+
+	/* the generation of the results cache when the backend was started */
+	guint			 cache_generation;
+	gboolean		 from_cache;
+
 	/* cached */
 	gboolean		 cached_force;
 	gboolean		 cached_allow_deps;
@@ -135,6 +148,20 @@ struct PkTransactionPrivate
 	guint			 registration_id;
 	GDBusConnection		*connection;
 	GDBusNodeInfo		*introspection;
+
+	/* progress updates merged until the next flush */
+	guint			 progress_interval;
+	guint			 progress_pending;
+	GPtrArray		*progress_items;
+	guint			 progress_id;
+	gint64			 progress_emitted;
+};
+
+/* progress properties waiting for pk_transaction_progress_flush() */
+enum {
+	PK_TRANSACTION_PROGRESS_PERCENTAGE		= 1 << 0,
+	PK_TRANSACTION_PROGRESS_SPEED			= 1 << 1,
+	PK_TRANSACTION_PROGRESS_DOWNLOAD_SIZE_REMAINING	= 1 << 2,
 };
 
 typedef enum {
@@ -265,8 +292,43 @@ pk_transaction_get_background (PkTransaction *transaction)
 	return pk_backend_job_get_background (transaction->priv->job);
 }
 
+/*
+ * pk_transaction_get_cache_key:
+ *
+ * Return value: the key of the results in the results cache, or %NULL if
+ * the role does not only depend on the package and repo state
+ **/
+static gchar *
+pk_transaction_get_cache_key (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	const gchar *locale;
+
+	if (priv->role != PK_ROLE_ENUM_GET_UPDATES &&
+	    priv->role != PK_ROLE_ENUM_GET_PACKAGES)
+		return NULL;
+	locale = pk_backend_job_get_locale (priv->job);
+	return g_strdup_printf ("%s;%" G_GUINT64_FORMAT ";%s",
+				pk_role_enum_to_string (priv->role),
+				priv->cached_filters,
+				locale != NULL ? locale : "");
+}
+
+static void
+pk_transaction_cache_results (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	g_autofree gchar *key = NULL;
+
+	key = pk_transaction_get_cache_key (transaction);
+	if (key == NULL)
+		return;
+	pk_results_cache_add (pk_backend_get_results_cache (priv->backend),
+			      key, priv->cache_generation, priv->results);
+}
+
 static gboolean
-pk_transaction_finish_invalidate_caches (PkTransaction *transaction)
+pk_transaction_finish_invalidate_caches (PkTransaction *transaction, PkExitEnum exit_enum)
 {
 	PkTransactionPrivate *priv = transaction->priv;
 
@@ -281,47 +343,164 @@ pk_transaction_finish_invalidate_caches (PkTransaction *transaction)
 		goto out;
 	if (priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES ||
 	    priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
+	    priv->role == PK_ROLE_ENUM_INSTALL_FILES ||
 	    priv->role == PK_ROLE_ENUM_REMOVE_PACKAGES ||
 	    priv->role == PK_ROLE_ENUM_REPO_ENABLE ||
 	    priv->role == PK_ROLE_ENUM_REPO_SET_DATA ||
 	    priv->role == PK_ROLE_ENUM_REPO_REMOVE ||
-	    priv->role == PK_ROLE_ENUM_REFRESH_CACHE) {
+	    priv->role == PK_ROLE_ENUM_REFRESH_CACHE ||
+	    priv->role == PK_ROLE_ENUM_UPGRADE_SYSTEM ||
+	    priv->role == PK_ROLE_ENUM_REPAIR_SYSTEM) {
+
+		/* even a failed transaction may have changed something */
+		pk_results_cache_invalidate (pk_backend_get_results_cache (priv->backend));
 
 		/* this needs to be done after a small delay */
-		pk_backend_updates_changed_delay (priv->backend,
-						  PK_TRANSACTION_UPDATES_CHANGED_TIMEOUT);
+		if (exit_enum == PK_EXIT_ENUM_SUCCESS) {
+			pk_backend_updates_changed_delay (priv->backend,
+							  PK_TRANSACTION_UPDATES_CHANGED_TIMEOUT);
+		}
 	}
 out:
 	return TRUE;
 }
 
+static void
+pk_transaction_emit_properties_changed (PkTransaction *transaction,
+					GVariantBuilder *builder)
+{
+	GVariantBuilder invalidated_builder;
+
+	g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
+	g_dbus_connection_emit_signal (transaction->priv->connection,
+				       NULL,
+				       transaction->priv->tid,
+				       "org.freedesktop.DBus.Properties",
+				       "PropertiesChanged",
+				       g_variant_new ("(sa{sv}as)",
+						      PK_DBUS_INTERFACE_TRANSACTION,
+						      builder,
+						      &invalidated_builder),
+				       NULL);
+}
+
 static void
 pk_transaction_emit_property_changed (PkTransaction *transaction,
 				      const gchar *property_name,
 				      GVariant *property_value)
 {
 	GVariantBuilder builder;
-	GVariantBuilder invalidated_builder;
 
 	/* build the dict */
-	g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
 	g_variant_builder_add (&builder,
 			       "{sv}",
 			       property_name,
 			       property_value);
+	pk_transaction_emit_properties_changed (transaction, &builder);
+}
+
+static void
+pk_transaction_item_progress_emit (PkTransaction *transaction,
+				   PkItemProgress *item_progress)
+{
+	g_debug ("emitting item-progress %s, %s: %u",
+		 pk_item_progress_get_package_id (item_progress),
+		 pk_status_enum_to_string (pk_item_progress_get_status (item_progress)),
+		 pk_item_progress_get_percentage (item_progress));
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
-				       "org.freedesktop.DBus.Properties",
-				       "PropertiesChanged",
-				       g_variant_new ("(sa{sv}as)",
-						      PK_DBUS_INTERFACE_TRANSACTION,
-						      &builder,
-						      &invalidated_builder),
+				       PK_DBUS_INTERFACE_TRANSACTION,
+				       "ItemProgress",
+				       g_variant_new ("(suu)",
+						      pk_item_progress_get_package_id (item_progress),
+						      pk_item_progress_get_status (item_progress),
+						      pk_item_progress_get_percentage (item_progress)),
 				       NULL);
 }
 
+/*
+ * pk_transaction_progress_flush:
+ *
+ * Emits the progress updates merged since the last flush, the changed
+ * properties in a single PropertiesChanged signal.
+ **/
+static void
+pk_transaction_progress_flush (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	GVariantBuilder builder;
+	guint i;
+
+	if (priv->progress_pending == 0 && priv->progress_items->len == 0)
+		return;
+
+	if (priv->progress_id != 0) {
+		g_source_remove (priv->progress_id);
+		priv->progress_id = 0;
+	}
+	priv->progress_emitted = g_get_monotonic_time ();
+
+	if (priv->progress_pending != 0) {
+		g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+		if (priv->progress_pending & PK_TRANSACTION_PROGRESS_PERCENTAGE) {
+			g_variant_builder_add (&builder, "{sv}", "Percentage",
+					       g_variant_new_uint32 (priv->percentage));
+		}
+		if (priv->progress_pending & PK_TRANSACTION_PROGRESS_SPEED) {
+			g_variant_builder_add (&builder, "{sv}", "Speed",
+					       g_variant_new_uint32 (priv->speed));
+		}
+		if (priv->progress_pending & PK_TRANSACTION_PROGRESS_DOWNLOAD_SIZE_REMAINING) {
+			g_variant_builder_add (&builder, "{sv}", "DownloadSizeRemaining",
+					       g_variant_new_uint64 (priv->download_size_remaining));
+		}
+		priv->progress_pending = 0;
+		pk_transaction_emit_properties_changed (transaction, &builder);
+	}
+
+	for (i = 0; i < priv->progress_items->len; i++)
+		pk_transaction_item_progress_emit (transaction, g_ptr_array_index (priv->progress_items, i));
+	g_ptr_array_set_size (priv->progress_items, 0);
+}
+
+static gboolean
+pk_transaction_progress_flush_cb (gpointer user_data)
+{
+	PkTransaction *transaction = PK_TRANSACTION (user_data);
+	transaction->priv->progress_id = 0;
+	pk_transaction_progress_flush (transaction);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * pk_transaction_progress_queue:
+ *
+ * Emits the pending progress now if nothing was emitted for the
+ * progress interval, otherwise when the interval is over.
+ **/
+static void
+pk_transaction_progress_queue (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	gint64 elapsed;
+
+	/* already scheduled */
+	if (priv->progress_id != 0)
+		return;
+
+	elapsed = (g_get_monotonic_time () - priv->progress_emitted) / 1000;
+	if (elapsed >= priv->progress_interval) {
+		pk_transaction_progress_flush (transaction);
+		return;
+	}
+	priv->progress_id = g_timeout_add (priv->progress_interval - elapsed,
+					   pk_transaction_progress_flush_cb,
+					   transaction);
+	g_source_set_name_by_id (priv->progress_id, "[PkTransaction] progress");
+}
+
 static void
 pk_transaction_progress_changed_emit (PkTransaction *transaction,
 				     guint percentage,
@@ -330,6 +509,9 @@ pk_transaction_progress_changed_emit (PkTransaction *transaction,
 {
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 
+	/* don't let older merged values follow these */
+	pk_transaction_progress_flush (transaction);
+
 	/* save so we can do GetProgress on a queued or finished transaction */
 	transaction->priv->percentage = percentage;
 	transaction->priv->elapsed_time = elapsed;
@@ -378,6 +560,9 @@ pk_transaction_status_changed_emit (PkTransaction *transaction, PkStatusEnum sta
 
 	transaction->priv->status = status;
 
+	/* the progress so far belongs to the previous status */
+	pk_transaction_progress_flush (transaction);
+
 	/* emit */
 	pk_transaction_emit_property_changed (transaction,
 					      "Status",
@@ -389,6 +574,8 @@ pk_transaction_finished_emit (PkTransaction *transaction,
 			      PkExitEnum exit_enum,
 			      guint time_ms)
 {
+	pk_transaction_progress_flush (transaction);
+
 	g_debug ("emitting finished '%s', %i",
 		 pk_exit_enum_to_string (exit_enum),
 		 time_ms);
@@ -414,6 +601,7 @@ pk_transaction_error_code_emit (PkTransaction *transaction,
 	g_debug ("emitting error-code %s, '%s'",
 		 pk_error_enum_to_string (error_enum),
 		 details);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -447,8 +635,9 @@ pk_transaction_locked_changed_cb (PkBackendJob *job,
 
 	g_debug ("backend job lock status changed: %i", locked);
 
-	/* if backend cache is locked at some time, this transaction is running in exclusive mode */
-	if (locked)
+	/* if backend cache is locked at some time, this transaction is running in exclusive mode,
+	 * which is only true for the transaction that started the backend */
+	if (locked && transaction->priv->leader == NULL)
 		pk_transaction_make_exclusive (transaction);
 }
 
@@ -498,6 +687,7 @@ pk_transaction_details_cb (PkBackendJob *job,
 		g_variant_builder_add (&builder, "{sv}", "size",
 				       g_variant_new_uint64 (size));
 
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -577,6 +767,7 @@ pk_transaction_files_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting files %s", package_id);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -616,6 +807,7 @@ pk_transaction_category_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting category %s, %s, %s, %s, %s ", parent_id, cat_id, name, summary, icon);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -635,24 +827,29 @@ pk_transaction_item_progress_cb (PkBackendJob *job,
 				 PkItemProgress *item_progress,
 				 PkTransaction *transaction)
 {
+	GPtrArray *items;
+	guint i;
+
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 	g_return_if_fail (transaction->priv->tid != NULL);
 
+	/* only the latest progress of a package in the same status matters */
+	items = transaction->priv->progress_items;
+	for (i = 0; i < items->len; i++) {
+		PkItemProgress *pending = g_ptr_array_index (items, i);
+		if (pk_item_progress_get_status (pending) == pk_item_progress_get_status (item_progress) &&
+		    g_strcmp0 (pk_item_progress_get_package_id (pending),
+			       pk_item_progress_get_package_id (item_progress)) == 0) {
+			g_object_unref (pending);
+			g_ptr_array_index (items, i) = g_object_ref (item_progress);
+			break;
+		}
+	}
+	if (i == items->len)
+		g_ptr_array_add (items, g_object_ref (item_progress));
+
 	/* emit */
-	g_debug ("emitting item-progress %s, %s: %u",
-		 pk_item_progress_get_package_id (item_progress),
-		 pk_status_enum_to_string (pk_item_progress_get_status (item_progress)),
-		 pk_item_progress_get_percentage (item_progress));
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "ItemProgress",
-				       g_variant_new ("(suu)",
-						      pk_item_progress_get_package_id (item_progress),
-						      pk_item_progress_get_status (item_progress),
-						      pk_item_progress_get_percentage (item_progress)),
-				       NULL);
+	pk_transaction_progress_queue (transaction);
 }
 
 static void
@@ -681,6 +878,7 @@ pk_transaction_distro_upgrade_cb (PkBackendJob *job,
 	g_debug ("emitting distro-upgrade %s, %s, %s",
 		 pk_update_state_enum_to_string (state),
 		 name, summary);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -762,6 +960,18 @@ pk_transaction_set_state (PkTransaction *transaction, PkTransactionState state)
 
 	g_debug ("transaction now %s", pk_transaction_state_to_string (state));
 	priv->state = state;
+	pk_transaction_progress_flush (transaction);
+
+	/* time how long we wait for the scheduler */
+	if (state == PK_TRANSACTION_STATE_READY) {
+		priv->queued_time = g_get_monotonic_time ();
+	} else if (priv->queued_time != 0) {
+		priv->queue_wait_time = pk_transaction_get_queue_wait_time (transaction);
+		priv->queued_time = 0;
+		pk_transaction_emit_property_changed (transaction,
+						      "QueueWaitTime",
+						      g_variant_new_uint32 (priv->queue_wait_time));
+	}
 	g_signal_emit (transaction, signals[SIGNAL_STATE_CHANGED], 0, state);
 
 	/* only save into the database for useful stuff */
@@ -821,6 +1031,22 @@ pk_transaction_get_uid (PkTransaction *transaction)
 	return transaction->priv->uid;
 }
 
+/**
+ * pk_transaction_get_queue_wait_time:
+ *
+ * Return value: the time in ms the transaction waited before it was run,
+ * or has waited so far if it is still queued
+ **/
+guint
+pk_transaction_get_queue_wait_time (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (priv->queued_time == 0)
+		return priv->queue_wait_time;
+	return (g_get_monotonic_time () - priv->queued_time) / 1000;
+}
+
 static void
 pk_transaction_setup_mime_types (PkTransaction *transaction)
 {
@@ -860,6 +1086,18 @@ pk_transaction_get_backend_job (PkTransaction *transaction)
 	return transaction->priv->job;
 }
 
+/**
+ * pk_transaction_get_results:
+ *
+ * Returns: (transfer none): What the transaction got so far
+ **/
+PkResults *
+pk_transaction_get_results (PkTransaction *transaction)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), NULL);
+	return transaction->priv->results;
+}
+
 /**
  * pk_transaction_is_finished_with_lock_required:
  **/
@@ -1004,11 +1242,99 @@ pk_transaction_offline_finished (PkTransaction *transaction)
 	}
 }
 
+/*
+ * pk_transaction_unsubscribe:
+ *
+ * Stops sharing the results of the leader transaction.
+ * Returns %FALSE if the transaction was not subscribed.
+ **/
+static gboolean
+pk_transaction_unsubscribe (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (priv->leader == NULL)
+		return FALSE;
+	pk_backend_job_remove_subscriber (priv->leader->priv->job, priv->job);
+	g_ptr_array_remove (priv->leader->priv->subscribers, transaction);
+	g_clear_object (&priv->leader);
+	return TRUE;
+}
+
+static gchar *
+pk_transaction_package_key (PkPackage *item)
+{
+	return g_strdup_printf ("%u;%s",
+				pk_package_get_info (item),
+				pk_package_get_id (item));
+}
+
+/*
+ * pk_transaction_requeue_subscribers:
+ *
+ * Detaches the transactions sharing the backend run and queues them
+ * again, so cancelling a leader never cancels the query of somebody else.
+ * The caller has to set the exit code of the leader job first so the
+ * scheduler does not pick it as the leader again.
+ **/
+static void
+pk_transaction_requeue_subscribers (PkTransaction *transaction)
+{
+	guint i;
+	PkTransaction *subscriber;
+
+	while (transaction->priv->subscribers->len > 0) {
+		g_autoptr(GPtrArray) packages = NULL;
+
+		subscriber = g_object_ref (g_ptr_array_index (transaction->priv->subscribers, 0));
+		g_debug ("%s no longer shares the results of %s",
+			 subscriber->priv->tid, transaction->priv->tid);
+		pk_transaction_unsubscribe (subscriber);
+
+		/* the client already got these, don't emit them again when
+		 * the backend runs for the subscriber itself */
+		packages = pk_results_get_package_array (subscriber->priv->results);
+		if (subscriber->priv->replayed == NULL) {
+			subscriber->priv->replayed = g_hash_table_new_full (g_str_hash, g_str_equal,
+									    g_free, NULL);
+		}
+		for (i = 0; i < packages->len; i++) {
+			g_hash_table_add (subscriber->priv->replayed,
+					  pk_transaction_package_key (g_ptr_array_index (packages, i)));
+		}
+
+		/* it never ran the backend, so it can go back to the queue */
+		subscriber->priv->state = PK_TRANSACTION_STATE_UNKNOWN;
+		pk_transaction_set_state (subscriber, PK_TRANSACTION_STATE_READY);
+		g_object_unref (subscriber);
+	}
+}
+
+static void pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransaction *transaction);
+
+/*
+ * pk_transaction_finish_subscribers:
+ *
+ * Finishes the transactions sharing the backend run when the backend
+ * failed to start, so there won't be any ::finished to share.
+ **/
+static void
+pk_transaction_finish_subscribers (PkTransaction *transaction, PkExitEnum exit_enum)
+{
+	PkTransaction *subscriber;
+
+	while (transaction->priv->subscribers->len > 0) {
+		subscriber = g_ptr_array_index (transaction->priv->subscribers, 0);
+		pk_transaction_finished_cb (subscriber->priv->job, exit_enum, subscriber);
+	}
+}
+
 static void
 pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransaction *transaction)
 {
 	guint time_ms;
 	guint i;
+	gboolean subscribed;
 	PkPackage *item;
 	PkInfoEnum info;
 	PkBitfield transaction_flags;
@@ -1022,6 +1348,10 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 		return;
 	}
 
+	/* the backend was never started for this transaction if it only
+	 * shared the results of another one */
+	subscribed = pk_transaction_unsubscribe (transaction);
+
 	/* save this so we know if the cache is valid */
 	pk_results_set_exit_code (transaction->priv->results, exit_enum);
 
@@ -1050,9 +1380,13 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	else if (transaction->priv->emit_media_change_required)
 		exit_enum = PK_EXIT_ENUM_MEDIA_CHANGE_REQUIRED;
 
-	/* invalidate some caches if we succeeded */
-	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
-		pk_transaction_finish_invalidate_caches (transaction);
+	/* invalidate some caches */
+	pk_transaction_finish_invalidate_caches (transaction, exit_enum);
+
+	/* save the results for the next identical query */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS && !subscribed &&
+	    !transaction->priv->from_cache)
+		pk_transaction_cache_results (transaction);
 
 	/* find the length of time we have been running */
 	time_ms = pk_transaction_get_runtime (transaction);
@@ -1132,29 +1466,30 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	pk_backend_job_disconnect_vfuncs (transaction->priv->job);
 
 	/* destroy the job */
-	pk_backend_stop_job (transaction->priv->backend, transaction->priv->job);
+	if (!subscribed && !transaction->priv->from_cache)
+		pk_backend_stop_job (transaction->priv->backend, transaction->priv->job);
 
 	/* we emit last, as other backends will be running very soon after us, and we don't want to be notified */
 	pk_transaction_finished_emit (transaction, exit_enum, time_ms);
 }
 
-static void
-pk_transaction_package_cb (PkBackend *backend,
-			   PkPackage *item,
-			   PkTransaction *transaction)
+/*
+ * pk_transaction_package_add:
+ *
+ * Checks the package the backend emitted and adds it to the results.
+ * Returns %FALSE if it has to be dropped.
+ **/
+static gboolean
+pk_transaction_package_add (PkTransaction *transaction, PkPackage *item)
 {
 	const gchar *role_text;
 	PkInfoEnum info;
-	const gchar *package_id;
-	const gchar *summary = NULL;
-
-	g_return_if_fail (PK_IS_TRANSACTION (transaction));
-	g_return_if_fail (transaction->priv->tid != NULL);
 
-	/* have we already been marked as finished? */
-	if (transaction->priv->finished) {
-		g_warning ("Already finished");
-		return;
+	/* already replayed from the leader we used to share */
+	if (transaction->priv->replayed != NULL) {
+		g_autofree gchar *key = pk_transaction_package_key (item);
+		if (g_hash_table_remove (transaction->priv->replayed, key))
+			return FALSE;
 	}
 
 	/* check the backend is doing the right thing */
@@ -1165,7 +1500,7 @@ pk_transaction_package_cb (PkBackend *backend,
 			role_text = pk_role_enum_to_string (transaction->priv->role);
 			g_warning ("%s emitted 'installed' rather than 'installing'",
 				   role_text);
-			return;
+			return FALSE;
 		}
 	}
 
@@ -1177,7 +1512,7 @@ pk_transaction_package_cb (PkBackend *backend,
 			g_warning ("%s emitted package that was installed when "
 				   "the ~installed filter is in place",
 				   role_text);
-			return;
+			return FALSE;
 		}
 	}
 	if (pk_bitfield_contain (transaction->priv->cached_filters,
@@ -1187,7 +1522,7 @@ pk_transaction_package_cb (PkBackend *backend,
 			g_warning ("%s emitted package that was ~installed when "
 				   "the installed filter is in place",
 				   role_text);
-			return;
+			return FALSE;
 		}
 	}
 
@@ -1195,10 +1530,38 @@ pk_transaction_package_cb (PkBackend *backend,
 	if (info != PK_INFO_ENUM_FINISHED)
 		pk_results_add_package (transaction->priv->results, item);
 
+	g_free (transaction->priv->last_package_id);
+	transaction->priv->last_package_id = g_strdup (pk_package_get_id (item));
+	return TRUE;
+}
+
+static void
+pk_transaction_package_cb (PkBackend *backend,
+			   PkPackage *item,
+			   PkTransaction *transaction)
+{
+	PkInfoEnum info;
+	const gchar *package_id;
+	const gchar *summary = NULL;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	/* have we already been marked as finished? */
+	if (transaction->priv->finished) {
+		g_warning ("Already finished");
+		return;
+	}
+
+	if (!pk_transaction_package_add (transaction, item))
+		return;
+
+	/* keep the package after the progress that preceded it */
+	pk_transaction_progress_flush (transaction);
+
 	/* emit */
+	info = pk_package_get_info (item);
 	package_id = pk_package_get_id (item);
-	g_free (transaction->priv->last_package_id);
-	transaction->priv->last_package_id = g_strdup (package_id);
 	summary = pk_package_get_summary (item);
 	if (transaction->priv->role != PK_ROLE_ENUM_GET_PACKAGES) {
 		g_debug ("emit package %s, %s, %s",
@@ -1218,6 +1581,64 @@ pk_transaction_package_cb (PkBackend *backend,
 				       NULL);
 }
 
+static void
+pk_transaction_packages_cb (PkBackend *backend,
+			    GPtrArray *array,
+			    PkTransaction *transaction)
+{
+	guint i;
+	guint count = 0;
+	GVariantBuilder builder;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	/* have we already been marked as finished? */
+	if (transaction->priv->finished) {
+		g_warning ("Already finished");
+		return;
+	}
+
+	/* the client only knows about the Package signal */
+	if (!transaction->priv->client_supports_packages) {
+		for (i = 0; i < array->len; i++)
+			pk_transaction_package_cb (backend, g_ptr_array_index (array, i), transaction);
+		return;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(uss)"));
+	for (i = 0; i < array->len; i++) {
+		PkPackage *item = g_ptr_array_index (array, i);
+		const gchar *summary;
+
+		if (!pk_transaction_package_add (transaction, item))
+			continue;
+		summary = pk_package_get_summary (item);
+		g_variant_builder_add (&builder, "(uss)",
+				       pk_package_get_info (item),
+				       pk_package_get_id (item),
+				       summary ? summary : "");
+		count++;
+	}
+	if (count == 0) {
+		g_variant_builder_clear (&builder);
+		return;
+	}
+
+	/* keep the packages after the progress that preceded them */
+	pk_transaction_progress_flush (transaction);
+
+	/* emit */
+	g_debug ("emit %u packages", count);
+	g_dbus_connection_emit_signal (transaction->priv->connection,
+				       NULL,
+				       transaction->priv->tid,
+				       PK_DBUS_INTERFACE_TRANSACTION,
+				       "Packages",
+				       g_variant_new ("(a(uss))", &builder),
+				       NULL);
+}
+
 static void
 pk_transaction_repo_detail_cb (PkBackend *backend,
 			       PkRepoDetail *item,
@@ -1238,6 +1659,7 @@ pk_transaction_repo_detail_cb (PkBackend *backend,
 	description = pk_repo_detail_get_description (item);
 	enabled = pk_repo_detail_get_enabled (item);
 	g_debug ("emitting repo-detail %s, %s, %i", repo_id, description, enabled);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1287,6 +1709,7 @@ pk_transaction_repo_signature_required_cb (PkBackend *backend,
 		 package_id, repository_name, key_url, key_userid, key_id,
 		 key_fingerprint, key_timestamp,
 		 pk_sig_type_enum_to_string (type));
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1332,6 +1755,7 @@ pk_transaction_eula_required_cb (PkBackend *backend,
 	/* emit */
 	g_debug ("emitting eula-required %s, %s, %s, %s",
 		   eula_id, package_id, vendor_name, license_agreement);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1375,6 +1799,7 @@ pk_transaction_media_change_required_cb (PkBackend *backend,
 		 pk_media_type_enum_to_string (media_type),
 		 media_id,
 		 media_text);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1440,6 +1865,7 @@ pk_transaction_require_restart_cb (PkBackend *backend,
 	g_debug ("emitting require-restart %s, '%s'",
 		 pk_restart_enum_to_string (restart),
 		 package_id);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1508,6 +1934,7 @@ pk_transaction_update_detail_cb (PkBackend *backend,
 	issued = pk_update_detail_get_issued (item);
 	updated = pk_update_detail_get_updated (item);
 	g_debug ("emitting update-detail for %s", package_id);
+	pk_transaction_progress_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1593,9 +2020,8 @@ pk_transaction_speed_cb (PkBackendJob *job,
 {
 	/* emit */
 	transaction->priv->speed = speed;
-	pk_transaction_emit_property_changed (transaction,
-					      "Speed",
-					      g_variant_new_uint32 (speed));
+	transaction->priv->progress_pending |= PK_TRANSACTION_PROGRESS_SPEED;
+	pk_transaction_progress_queue (transaction);
 }
 
 static void
@@ -1605,9 +2031,8 @@ pk_transaction_download_size_remaining_cb (PkBackendJob *job,
 {
 	/* emit */
 	transaction->priv->download_size_remaining = *download_size_remaining;
-	pk_transaction_emit_property_changed (transaction,
-					      "DownloadSizeRemaining",
-					      g_variant_new_uint64 (*download_size_remaining));
+	transaction->priv->progress_pending |= PK_TRANSACTION_PROGRESS_DOWNLOAD_SIZE_REMAINING;
+	pk_transaction_progress_queue (transaction);
 }
 
 static void
@@ -1617,63 +2042,14 @@ pk_transaction_percentage_cb (PkBackendJob *job,
 {
 	/* emit */
 	transaction->priv->percentage = percentage;
-	pk_transaction_emit_property_changed (transaction,
-					      "Percentage",
-					      g_variant_new_uint32 (percentage));
+	transaction->priv->progress_pending |= PK_TRANSACTION_PROGRESS_PERCENTAGE;
+	pk_transaction_progress_queue (transaction);
 }
 
-gboolean
-pk_transaction_run (PkTransaction *transaction)
+static void
+pk_transaction_connect_vfuncs (PkTransaction *transaction)
 {
-	GError *error = NULL;
-	PkExitEnum exit_status;
-	PkTransactionPrivate *priv = PK_TRANSACTION_GET_PRIVATE (transaction);
-
-	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
-	g_return_val_if_fail (priv->tid != NULL, FALSE);
-	g_return_val_if_fail (transaction->priv->backend != NULL, FALSE);
-
-	/* we are no longer waiting, we are setting up */
-	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_SETUP);
-
-	/* set proxy */
-	if (!pk_transaction_set_session_state (transaction, &error)) {
-		g_debug ("failed to set the session state (non-fatal): %s",
-			 error->message);
-		g_clear_error (&error);
-	}
-
-	/* already cancelled? */
-	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_CANCELLED) {
-		exit_status = pk_backend_job_get_exit_code (priv->job);
-		pk_transaction_finished_emit (transaction, exit_status, 0);
-		return TRUE;
-	}
-
-	/* run the job */
-	pk_backend_start_job (priv->backend, priv->job);
-
-	/* is an error code set? */
-	if (pk_backend_job_get_is_error_set (priv->job)) {
-		exit_status = pk_backend_job_get_exit_code (priv->job);
-		pk_transaction_finished_emit (transaction, exit_status, 0);
-		/* do not fail the transaction */
-	}
-
-	/* check if we should skip this transaction */
-	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_SKIP_TRANSACTION) {
-		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_SUCCESS, 0);
-		/* do not fail the transaction */
-	}
-
-	/* set the role */
-	pk_backend_job_set_role (priv->job, priv->role);
-	g_debug ("setting role for %s to %s",
-		 priv->tid,
-		 pk_role_enum_to_string (priv->role));
-
-	/* reset after the pre-transaction checks */
-	pk_backend_job_set_percentage (priv->job, PK_BACKEND_PERCENTAGE_INVALID);
+	PkTransactionPrivate *priv = transaction->priv;
 
 	/* connect signal to receive backend lock changes */
 	pk_backend_job_set_vfunc (priv->job,
@@ -1708,6 +2084,10 @@ pk_transaction_run (PkTransaction *transaction)
 				  PK_BACKEND_SIGNAL_PACKAGE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_package_cb),
 				  transaction);
+	pk_backend_job_set_vfunc (priv->job,
+				  PK_BACKEND_SIGNAL_PACKAGES,
+				  PK_BACKEND_JOB_VFUNC (pk_transaction_packages_cb),
+				  transaction);
 	pk_backend_job_set_vfunc (priv->job,
 				  PK_BACKEND_SIGNAL_ITEM_PROGRESS,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_item_progress_cb),
@@ -1756,6 +2136,113 @@ pk_transaction_run (PkTransaction *transaction)
 				  PK_BACKEND_SIGNAL_CATEGORY,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_category_cb),
 				  transaction);
+}
+
+/*
+ * pk_transaction_run_from_cache:
+ *
+ * Answers the query with the results saved by an earlier transaction.
+ * Returns %FALSE if the backend has to be run.
+ **/
+static gboolean
+pk_transaction_run_from_cache (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	PkResultsCache *cache;
+	g_autofree gchar *key = NULL;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	key = pk_transaction_get_cache_key (transaction);
+	if (key == NULL)
+		return FALSE;
+
+	/* anything changing the state from now on makes the results stale */
+	cache = pk_backend_get_results_cache (priv->backend);
+	priv->cache_generation = pk_results_cache_get_generation (cache);
+	results = pk_results_cache_lookup (cache, key,
+					   pk_backend_job_get_cache_age (priv->job));
+	if (results == NULL)
+		return FALSE;
+
+	/* the backend is never started, so emit what it would have */
+	g_debug ("answering %s from the results cache", priv->tid);
+	priv->from_cache = TRUE;
+	pk_transaction_connect_vfuncs (transaction);
+	pk_backend_job_replay_vfunc (priv->job,
+				     PK_BACKEND_SIGNAL_STATUS_CHANGED,
+				     GUINT_TO_POINTER (PK_STATUS_ENUM_QUERY));
+	packages = pk_results_get_package_array (results);
+	if (packages->len > 0)
+		pk_backend_job_replay_vfunc (priv->job, PK_BACKEND_SIGNAL_PACKAGES, packages);
+	pk_backend_job_replay_vfunc (priv->job,
+				     PK_BACKEND_SIGNAL_FINISHED,
+				     GUINT_TO_POINTER (PK_EXIT_ENUM_SUCCESS));
+	return TRUE;
+}
+
+gboolean
+pk_transaction_run (PkTransaction *transaction)
+{
+	GError *error = NULL;
+	PkExitEnum exit_status;
+	PkTransactionPrivate *priv = PK_TRANSACTION_GET_PRIVATE (transaction);
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+	g_return_val_if_fail (priv->tid != NULL, FALSE);
+	g_return_val_if_fail (transaction->priv->backend != NULL, FALSE);
+
+	/* we are no longer waiting, we are setting up */
+	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_SETUP);
+
+	/* set proxy */
+	if (!pk_transaction_set_session_state (transaction, &error)) {
+		g_debug ("failed to set the session state (non-fatal): %s",
+			 error->message);
+		g_clear_error (&error);
+	}
+
+	/* already cancelled? */
+	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_CANCELLED) {
+		exit_status = pk_backend_job_get_exit_code (priv->job);
+		pk_transaction_requeue_subscribers (transaction);
+		pk_transaction_finished_emit (transaction, exit_status, 0);
+		return TRUE;
+	}
+
+	/* the same query was answered before and nothing changed since */
+	if (pk_transaction_run_from_cache (transaction))
+		return TRUE;
+
+	/* run the job */
+	pk_backend_start_job (priv->backend, priv->job);
+
+	/* is an error code set? */
+	if (pk_backend_job_get_is_error_set (priv->job)) {
+		exit_status = pk_backend_job_get_exit_code (priv->job);
+		pk_transaction_finish_subscribers (transaction, exit_status);
+		pk_transaction_finished_emit (transaction, exit_status, 0);
+		/* do not fail the transaction */
+	}
+
+	/* check if we should skip this transaction */
+	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_SKIP_TRANSACTION) {
+		pk_transaction_finish_subscribers (transaction, PK_EXIT_ENUM_SUCCESS);
+		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_SUCCESS, 0);
+		/* do not fail the transaction */
+	}
+
+	/* set the role */
+	pk_backend_job_set_role (priv->job, priv->role);
+	g_debug ("setting role for %s to %s",
+		 priv->tid,
+		 pk_role_enum_to_string (priv->role));
+
+	/* reset after the pre-transaction checks */
+	pk_backend_job_set_percentage (priv->job, PK_BACKEND_PERCENTAGE_INVALID);
+
+	/* get the results of the backend */
+	pk_transaction_connect_vfuncs (transaction);
 
 	/* do the correct action with the cached parameters */
 	switch (priv->role) {
@@ -1948,6 +2435,172 @@ pk_transaction_run (PkTransaction *transaction)
 	return TRUE;
 }
 
+/*
+ * pk_transaction_role_is_shareable:
+ *
+ * Returns %TRUE for the roles that only query the backend, so the results
+ * of one run are valid for several identical transactions.
+ **/
+static gboolean
+pk_transaction_role_is_shareable (PkRoleEnum role)
+{
+	switch (role) {
+	case PK_ROLE_ENUM_DEPENDS_ON:
+	case PK_ROLE_ENUM_GET_CATEGORIES:
+	case PK_ROLE_ENUM_GET_DETAILS:
+	case PK_ROLE_ENUM_GET_DISTRO_UPGRADES:
+	case PK_ROLE_ENUM_GET_FILES:
+	case PK_ROLE_ENUM_GET_PACKAGES:
+	case PK_ROLE_ENUM_GET_REPO_LIST:
+	case PK_ROLE_ENUM_GET_UPDATE_DETAIL:
+	case PK_ROLE_ENUM_GET_UPDATES:
+	case PK_ROLE_ENUM_REQUIRED_BY:
+	case PK_ROLE_ENUM_RESOLVE:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_SEARCH_FILE:
+	case PK_ROLE_ENUM_SEARCH_GROUP:
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_WHAT_PROVIDES:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+pk_transaction_strv_equal (gchar **a, gchar **b)
+{
+	if (a == NULL || b == NULL)
+		return a == b;
+	return g_strv_equal ((const gchar * const *) a, (const gchar * const *) b);
+}
+
+/**
+ * pk_transaction_can_subscribe:
+ *
+ * Return value: %TRUE if @transaction asks the same query as @leader,
+ * so it can share the results of the backend run of @leader.
+ **/
+gboolean
+pk_transaction_can_subscribe (PkTransaction *transaction, PkTransaction *leader)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	PkTransactionPrivate *priv_leader = leader->priv;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+	g_return_val_if_fail (PK_IS_TRANSACTION (leader), FALSE);
+
+	if (transaction == leader)
+		return FALSE;
+	if (!pk_transaction_role_is_shareable (priv->role) || priv->exclusive)
+		return FALSE;
+
+	/* background transactions get cancelled for foreground ones */
+	if (pk_transaction_get_background (transaction) != pk_transaction_get_background (leader))
+		return FALSE;
+
+	/* the leader has to run the backend itself and still be going */
+	if (priv_leader->leader != NULL || priv_leader->finished)
+		return FALSE;
+	if (priv_leader->state != PK_TRANSACTION_STATE_READY &&
+	    priv_leader->state != PK_TRANSACTION_STATE_RUNNING)
+		return FALSE;
+	if (pk_backend_job_get_is_error_set (priv_leader->job) ||
+	    pk_backend_job_get_exit_code (priv_leader->job) != PK_EXIT_ENUM_UNKNOWN)
+		return FALSE;
+
+	/* same query */
+	if (priv->role != priv_leader->role ||
+	    priv->cached_filters != priv_leader->cached_filters ||
+	    priv->cached_transaction_flags != priv_leader->cached_transaction_flags ||
+	    priv->cached_force != priv_leader->cached_force)
+		return FALSE;
+	if (!pk_transaction_strv_equal (priv->cached_package_ids, priv_leader->cached_package_ids) ||
+	    !pk_transaction_strv_equal (priv->cached_values, priv_leader->cached_values))
+		return FALSE;
+
+	/* the results depend on these hints too */
+	if (g_strcmp0 (pk_backend_job_get_locale (priv->job),
+		       pk_backend_job_get_locale (priv_leader->job)) != 0)
+		return FALSE;
+	if (pk_backend_job_get_cache_age (priv->job) != pk_backend_job_get_cache_age (priv_leader->job))
+		return FALSE;
+	return TRUE;
+}
+
+static void
+pk_transaction_replay_array (PkTransaction *transaction,
+			     PkBackendJobSignal signal_kind,
+			     GPtrArray *array)
+{
+	guint i;
+	for (i = 0; i < array->len; i++)
+		pk_backend_job_replay_vfunc (transaction->priv->job, signal_kind,
+					     g_ptr_array_index (array, i));
+	g_ptr_array_unref (array);
+}
+
+/**
+ * pk_transaction_subscribe:
+ *
+ * Shares the backend run of @leader instead of running the backend again.
+ * What @leader got so far is replayed, then the backend signals of
+ * @leader are emitted on both transactions until it is finished.
+ **/
+void
+pk_transaction_subscribe (PkTransaction *transaction, PkTransaction *leader)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	PkResults *results = leader->priv->results;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (PK_IS_TRANSACTION (leader));
+	g_return_if_fail (priv->leader == NULL);
+
+	g_debug ("%s shares the results of %s", priv->tid, leader->priv->tid);
+	priv->leader = g_object_ref (leader);
+	pk_transaction_connect_vfuncs (transaction);
+
+	/* catch up */
+	pk_backend_job_replay_vfunc (priv->job,
+				     PK_BACKEND_SIGNAL_STATUS_CHANGED,
+				     GUINT_TO_POINTER (leader->priv->status));
+	if (leader->priv->percentage != PK_BACKEND_PERCENTAGE_INVALID) {
+		pk_backend_job_replay_vfunc (priv->job,
+					     PK_BACKEND_SIGNAL_PERCENTAGE,
+					     GUINT_TO_POINTER (leader->priv->percentage));
+	}
+	packages = pk_results_get_package_array (results);
+	if (packages->len > 0)
+		pk_backend_job_replay_vfunc (priv->job, PK_BACKEND_SIGNAL_PACKAGES, packages);
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_DETAILS,
+				     pk_results_get_details_array (results));
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_UPDATE_DETAIL,
+				     pk_results_get_update_detail_array (results));
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_FILES,
+				     pk_results_get_files_array (results));
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_CATEGORY,
+				     pk_results_get_category_array (results));
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_REPO_DETAIL,
+				     pk_results_get_repo_detail_array (results));
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_DISTRO_UPGRADE,
+				     pk_results_get_distro_upgrade_array (results));
+	pk_transaction_replay_array (transaction, PK_BACKEND_SIGNAL_REQUIRE_RESTART,
+				     pk_results_get_require_restart_array (results));
+
+	/* then follow */
+	pk_backend_job_add_subscriber (leader->priv->job, priv->job);
+	g_ptr_array_add (leader->priv->subscribers, transaction);
+}
+
+gboolean
+pk_transaction_is_subscriber (PkTransaction *transaction)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+	return transaction->priv->leader != NULL;
+}
+
 const gchar *
 pk_transaction_get_tid (PkTransaction *transaction)
 {
@@ -2618,19 +3271,34 @@ pk_transaction_cancel_bg (PkTransaction *transaction)
 
 	/* if it's never been run, just remove this transaction from the list */
 	if (transaction->priv->state <= PK_TRANSACTION_STATE_READY) {
+		pk_backend_job_set_exit_code (transaction->priv->job, PK_EXIT_ENUM_CANCELLED);
+		pk_transaction_requeue_subscribers (transaction);
 		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_CANCELLED, 0);
 		return;
 	}
 
+	/* just stop sharing the backend run, the others still want it */
+	if (transaction->priv->leader != NULL) {
+		pk_transaction_error_code_emit (transaction,
+						PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+						"The transaction was cancelled");
+		pk_transaction_finished_cb (transaction->priv->job, PK_EXIT_ENUM_CANCELLED_PRIORITY, transaction);
+		return;
+	}
+
+	/* we need ::finished to not return success or failed */
+	pk_backend_job_set_exit_code (transaction->priv->job, PK_EXIT_ENUM_CANCELLED_PRIORITY);
+
+	/* the others still want their results, so they must not see any
+	 * of the cancellation */
+	pk_transaction_requeue_subscribers (transaction);
+
 	/* set the state, as cancelling might take a few seconds */
 	pk_backend_job_set_status (transaction->priv->job, PK_STATUS_ENUM_CANCEL);
 
 	/* we don't want to cancel twice */
 	pk_backend_job_set_allow_cancel (transaction->priv->job, FALSE);
 
-	/* we need ::finished to not return success or failed */
-	pk_backend_job_set_exit_code (transaction->priv->job, PK_EXIT_ENUM_CANCELLED_PRIORITY);
-
 	/* actually run the method */
 	pk_backend_cancel (transaction->priv->backend, transaction->priv->job);
 }
@@ -2734,19 +3402,36 @@ skip_uid:
 		pk_transaction_error_code_emit (transaction,
 						PK_ERROR_ENUM_TRANSACTION_CANCELLED,
 						msg);
+		pk_backend_job_set_exit_code (transaction->priv->job, PK_EXIT_ENUM_CANCELLED);
+		pk_transaction_requeue_subscribers (transaction);
 		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_CANCELLED, 0);
 		goto out;
 	}
 
+	/* just stop sharing the backend run, the others still want it */
+	if (transaction->priv->leader != NULL) {
+		g_autofree gchar *msg = NULL;
+		msg = g_strdup_printf ("%s was cancelled", transaction->priv->tid);
+		pk_transaction_error_code_emit (transaction,
+						PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+						msg);
+		pk_transaction_finished_cb (transaction->priv->job, PK_EXIT_ENUM_CANCELLED, transaction);
+		goto out;
+	}
+
+	/* we need ::finished to not return success or failed */
+	pk_backend_job_set_exit_code (transaction->priv->job, PK_EXIT_ENUM_CANCELLED);
+
+	/* the others still want their results, so they must not see any
+	 * of the cancellation */
+	pk_transaction_requeue_subscribers (transaction);
+
 	/* set the state, as cancelling might take a few seconds */
 	pk_backend_job_set_status (transaction->priv->job, PK_STATUS_ENUM_CANCEL);
 
 	/* we don't want to cancel twice */
 	pk_backend_job_set_allow_cancel (transaction->priv->job, FALSE);
 
-	/* we need ::finished to not return success or failed */
-	pk_backend_job_set_exit_code (transaction->priv->job, PK_EXIT_ENUM_CANCELLED);
-
 	/* actually run the method */
 	pk_backend_cancel (transaction->priv->backend, transaction->priv->job);
 out:
@@ -2905,7 +3590,7 @@ out:
 	pk_transaction_dbus_return (context, error);
 }
 
-static void
+void
 pk_transaction_get_details (PkTransaction *transaction,
 			    GVariant *params,
 			    GDBusMethodInvocation *context)
@@ -3301,6 +3986,7 @@ pk_transaction_get_old_transactions (PkTransaction *transaction,
 			 tid, modified, succeeded,
 			 pk_role_enum_to_string (role),
 			 duration, data, uid, cmdline);
+		pk_transaction_progress_flush (transaction);
 		g_dbus_connection_emit_signal (transaction->priv->connection,
 					       NULL,
 					       transaction->priv->tid,
@@ -4454,6 +5140,22 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* supports-packages=true */
+	if (g_strcmp0 (key, "supports-packages") == 0) {
+		if (g_strcmp0 (value, "true") == 0) {
+			priv->client_supports_packages = TRUE;
+		} else if (g_strcmp0 (value, "false") == 0) {
+			priv->client_supports_packages = FALSE;
+		} else {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				     "supports-packages hint expects true or false, not %s", value);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);
@@ -4760,6 +5462,8 @@ pk_transaction_get_property (GDBusConnection *connection_, const gchar *sender,
 		return g_variant_new_boolean (priv->caller_active);
 	if (g_strcmp0 (property_name, "ElapsedTime") == 0)
 		return g_variant_new_uint32 (priv->elapsed_time);
+	if (g_strcmp0 (property_name, "QueueWaitTime") == 0)
+		return g_variant_new_uint32 (pk_transaction_get_queue_wait_time (transaction));
 	if (g_strcmp0 (property_name, "Speed") == 0)
 		return g_variant_new_uint32 (priv->speed);
 	if (g_strcmp0 (property_name, "DownloadSizeRemaining") == 0)
@@ -5027,6 +5731,9 @@ pk_transaction_init (PkTransaction *transaction)
 	transaction->priv->results = pk_results_new ();
 	transaction->priv->supported_content_types = g_ptr_array_new_with_free_func (g_free);
 	transaction->priv->cancellable = g_cancellable_new ();
+	transaction->priv->progress_interval = PK_TRANSACTION_PROGRESS_INTERVAL;
+	transaction->priv->progress_items = g_ptr_array_new_with_free_func (g_object_unref);
+	transaction->priv->subscribers = g_ptr_array_new ();
 
 	transaction->priv->transaction_db = pk_transaction_db_new ();
 	ret = pk_transaction_db_load (transaction->priv->transaction_db, &error);
@@ -5051,6 +5758,14 @@ pk_transaction_dispose (GObject *object)
 		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_FAILED, 0);
 	}
 
+	if (transaction->priv->progress_id > 0) {
+		g_source_remove (transaction->priv->progress_id);
+		transaction->priv->progress_id = 0;
+	}
+
+	/* the leader must not call us anymore */
+	pk_transaction_unsubscribe (transaction);
+
 	if (transaction->priv->registration_id > 0) {
 		g_dbus_connection_unregister_object (transaction->priv->connection,
 						     transaction->priv->registration_id);
@@ -5099,6 +5814,10 @@ pk_transaction_finalize (GObject *object)
 	g_free (transaction->priv->sender);
 	g_free (transaction->priv->cmdline);
 	g_ptr_array_unref (transaction->priv->supported_content_types);
+	g_ptr_array_unref (transaction->priv->progress_items);
+	g_ptr_array_unref (transaction->priv->subscribers);
+	if (transaction->priv->replayed != NULL)
+		g_hash_table_unref (transaction->priv->replayed);
 
 	if (transaction->priv->connection != NULL)
 		g_object_unref (transaction->priv->connection);
@@ -5126,6 +5845,10 @@ pk_transaction_new (GKeyFile *conf, GDBusNodeInfo *introspection)
 	transaction = g_object_new (PK_TYPE_TRANSACTION, NULL);
 	transaction->priv->conf = g_key_file_ref (conf);
 	transaction->priv->job = pk_backend_job_new (conf);
+	if (g_key_file_has_key (conf, "Daemon", "ProgressInterval", NULL)) {
+		gint interval = g_key_file_get_integer (conf, "Daemon", "ProgressInterval", NULL);
+		transaction->priv->progress_interval = MAX (interval, 0);
+	}
 	transaction->priv->introspection = g_dbus_node_info_ref (introspection);
 	return PK_TRANSACTION (transaction);
 }
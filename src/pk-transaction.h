@@ -76,6 +76,7 @@ void		 pk_transaction_cancel_bg			(PkTransaction	*transaction);
 gboolean	 pk_transaction_get_background			(PkTransaction	*transaction);
 PkRoleEnum	 pk_transaction_get_role			(PkTransaction	*transaction);
 guint		 pk_transaction_get_uid				(PkTransaction	*transaction);
+guint		 pk_transaction_get_queue_wait_time		(PkTransaction	*transaction);
 void		 pk_transaction_set_backend			(PkTransaction	*transaction,
 								 PkBackend	*backend);
 PkBackendJob	*pk_transaction_get_backend_job 		(PkTransaction	*transaction);
@@ -88,6 +89,11 @@ gboolean	 pk_transaction_is_exclusive			(PkTransaction	*transaction);
 gboolean	 pk_transaction_is_finished_with_lock_required	(PkTransaction *transaction);
 void		 pk_transaction_reset_after_lock_error		(PkTransaction *transaction);
 void		 pk_transaction_make_exclusive			(PkTransaction *transaction);
+gboolean	 pk_transaction_can_subscribe			(PkTransaction	*transaction,
+								 PkTransaction	*leader);
+void		 pk_transaction_subscribe			(PkTransaction	*transaction,
+								 PkTransaction	*leader);
+gboolean	 pk_transaction_is_subscriber			(PkTransaction	*transaction);
 void		 pk_transaction_skip_auth_checks		(PkTransaction *transaction,
 								 gboolean skip_checks);
 